@@ -2,7 +2,7 @@
 
   cooling.c
 
-  DESCRIPTION 
+  DESCRIPTION
   Thermal monitor and mitigation implementation functions.
 
 ===========================================================================*/
@@ -19,16 +19,27 @@
 #include <sys/stat.h>
 #include <sys/resource.h>
 
-#include <libubox/ustream.h>
+#include <netlink/genl/genl.h>
+#include <netlink/genl/family.h>
+#include <netlink/genl/ctrl.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+
 #include <libubox/uloop.h>
 #include <libubox/list.h>
 #include <libubox/ulog.h>
 #include <libubus.h>
+#include <uci.h>
+
 
+/* the tests point this at a fake sysfs tree */
+#ifndef SYSFS_ROOT
+#define SYSFS_ROOT ""
+#endif
 
-#define CUR_STATE_PATH "/sys/devices/virtual/thermal/cooling_device%i/cur_state"
-#define TEMPER_PATH "/sys/devices/virtual/thermal/thermal_zone%i/temp"
-#define CPU_FREQ_PATH "/sys/devices/system/cpu/cpu0/cpufreq/%s"
+#define CUR_STATE_PATH SYSFS_ROOT "/sys/devices/virtual/thermal/cooling_device%i/cur_state"
+#define TEMPER_PATH SYSFS_ROOT "/sys/devices/virtual/thermal/thermal_zone%i/temp"
+#define CPU_FREQ_PATH SYSFS_ROOT "/sys/devices/system/cpu/cpu0/cpufreq/%s"
 
 #define PATH_MAX 256
 #define BUF_MAX 32
@@ -36,274 +47,615 @@
 #define PHY1 1
 #define NUM_VALUES 4
 
-int load_config_file=0;
-
-//#define ULOG_INFO(fmt, ...) ulog(LOG_INFO, fmt, ## __VA_ARGS__)
-
-typedef unsigned char	u8;
-typedef unsigned long	u32;
-
-u8 w2g_threshold_level=0;
-u8 w5g_threshold_level=0;
-u8 w2g_cur_temper=0;
-u8 w5g_cur_temper=0;
-u32 level_cpu_freq=1008000;
+/* poll interval, only a safety net when thermal netlink events are available */
+#define POLL_INTERVAL (30 * 1000)
+
+/*
+ * Thermal generic netlink ABI from linux/thermal.h, which is not part of
+ * the 5.4 uapi headers. Kernels without it simply fall back to polling.
+ */
+#define THERMAL_GENL_FAMILY_NAME		"thermal"
+#define THERMAL_GENL_SAMPLING_GROUP_NAME	"sampling"
+#define THERMAL_GENL_EVENT_GROUP_NAME		"event"
+
+enum {
+	THERMAL_GENL_ATTR_UNSPEC,
+	THERMAL_GENL_ATTR_TZ,
+	THERMAL_GENL_ATTR_TZ_ID,
+	THERMAL_GENL_ATTR_TZ_TEMP,
+	__THERMAL_GENL_ATTR_PARSE_MAX,
+};
+#define THERMAL_GENL_ATTR_PARSE_MAX (__THERMAL_GENL_ATTR_PARSE_MAX - 1)
+
+enum {
+	THERMAL_GENL_SAMPLING_TEMP,
+};
+
+enum {
+	THERMAL_GENL_EVENT_UNSPEC,
+	THERMAL_GENL_EVENT_TZ_CREATE,
+	THERMAL_GENL_EVENT_TZ_DELETE,
+	THERMAL_GENL_EVENT_TZ_DISABLE,
+	THERMAL_GENL_EVENT_TZ_ENABLE,
+	THERMAL_GENL_EVENT_TZ_TRIP_UP,
+	THERMAL_GENL_EVENT_TZ_TRIP_DOWN,
+};
+
+struct cooling_zone {
+	const char *name;
+
+	int tz_id;
+	int cdev_id;
+	bool cpu_freq;
+
+	/* level n is entered at thresholds[n] and left below it minus hysteresis */
+	int thresholds[NUM_VALUES];
+	int mitigation[NUM_VALUES];
+	int freq[NUM_VALUES];
+	int hysteresis;
+	int critical;
+
+	int temp_fd;
+	int cdev_fd;
+
+	int temp;
+	int level;
+};
 
 /* default value of wifi thresholds*/
 #ifdef PLATFORM_RAP630C_311G
-u8 level_2g_high[4]={105, 110, 115, 120};
-u8 level_2g_low[4]={0, 105, 110, 115};
-u8 level_2g_mitigation[4]={0, 35, 50, 70};
-u8 level_5g_high[4]={105, 110, 115, 120};
-u8 level_5g_low[4]={0, 105, 110, 115};
-u8 level_5g_mitigation[4]={0, 20, 30, 50};
-u32 level_cpu_frequency[4]={1008000, 800000, 800000, 800000};
+static struct cooling_zone zones[] = {
+	{
+		.name = "wifi2g",
+		.tz_id = 0,
+		.cdev_id = PHY0,
+		.thresholds = { 0, 105, 110, 115 },
+		.mitigation = { 0, 35, 50, 70 },
+	},
+	{
+		.name = "wifi5g",
+		.tz_id = 3,
+		.cdev_id = PHY1,
+		.cpu_freq = true,
+		.thresholds = { 0, 105, 110, 115 },
+		.mitigation = { 0, 20, 30, 50 },
+		.freq = { 1008000, 800000, 800000, 800000 },
+		.critical = 120,
+	},
+};
 #endif
 
 #ifdef PLATFORM_RAP630W_311G
-u8 level_2g_high[4]={105, 110, 115, 120};
-u8 level_2g_low[4]={0, 105, 110, 115};
-u8 level_2g_mitigation[4]={0, 20, 50, 70};
-u8 level_5g_high[4]={105, 110, 115, 120};
-u8 level_5g_low[4]={0, 105, 110, 115};
-u8 level_5g_mitigation[4]={0, 20, 50, 70};
-u32 level_cpu_frequency[4]={1008000, 800000, 800000, 800000};
+static struct cooling_zone zones[] = {
+	{
+		.name = "wifi2g",
+		.tz_id = 0,
+		.cdev_id = PHY0,
+		.thresholds = { 0, 105, 110, 115 },
+		.mitigation = { 0, 20, 50, 70 },
+	},
+	{
+		.name = "wifi5g",
+		.tz_id = 3,
+		.cdev_id = PHY1,
+		.cpu_freq = true,
+		.thresholds = { 0, 105, 110, 115 },
+		.mitigation = { 0, 20, 50, 70 },
+		.freq = { 1008000, 800000, 800000, 800000 },
+		.critical = 120,
+	},
+};
 #endif
 
-static char *config_file = NULL;
+#define NUM_ZONES (sizeof(zones) / sizeof(zones[0]))
+
+static int cpu_freq_fd = -1;
+static int cpu_freq_cur;
+
+static struct ubus_context *ubus_ctx;
+
+static struct nl_sock *genl;
+static struct nl_cb *genl_cb;
+static struct uloop_fd genl_fd;
+
+static int read_int(int fd, int *val)
+{
+	char buf[BUF_MAX];
+	ssize_t len;
+
+	len = pread(fd, buf, sizeof(buf) - 1, 0);
+	if (len <= 0)
+		return -1;
+
+	buf[len] = 0;
+	*val = atoi(buf);
+
+	return 0;
+}
 
-typedef struct {
-    int thresholds_high[NUM_VALUES];
-    int thresholds_low[NUM_VALUES];
-    int mitigation[NUM_VALUES];
-    int cpu_freq[NUM_VALUES];
-} WifiConfig;
+static int write_int(int fd, int val)
+{
+	char buf[BUF_MAX];
+	int len;
+
+	len = snprintf(buf, sizeof(buf), "%d", val);
+	if (pwrite(fd, buf, len, 0) != len)
+		return -1;
 
-WifiConfig wifi2g = {0}, wifi5g = {0};
+	return 0;
+}
 
-static void set_cpu_freq (int freq) {
-	FILE * fp;
+static int open_sysfs(const char *fmt, int id, int flags)
+{
 	char filename[PATH_MAX];
+	int fd;
 
-	snprintf(filename, PATH_MAX, CPU_FREQ_PATH, "scaling_governor");
+	snprintf(filename, PATH_MAX, fmt, id);
+	fd = open(filename, flags | O_CLOEXEC);
+	if (fd < 0)
+		ULOG_ERR("open %s file error\n", filename);
+
+	return fd;
+}
+
+static void set_cpu_freq(int freq)
+{
+	if (cpu_freq_fd < 0 || freq == cpu_freq_cur)
+		return;
+
+	if (write_int(cpu_freq_fd, freq))
+		ULOG_ERR("write scaling_setspeed error\n");
+	else
+		cpu_freq_cur = freq;
+}
 
-	fp = fopen(filename, "w");
-	if (!fp) {
+static void cpu_freq_init(void)
+{
+	char filename[PATH_MAX];
+	int fd;
+
+	snprintf(filename, PATH_MAX, CPU_FREQ_PATH, "scaling_governor");
+	fd = open(filename, O_WRONLY | O_CLOEXEC);
+	if (fd < 0) {
 		ULOG_ERR("open scaling_governor error\n");
+		return;
 	}
-	fprintf(fp, "%s", "userspace");
-	fclose(fp);
 
-	snprintf(filename, PATH_MAX, CPU_FREQ_PATH, "scaling_setspeed");
+	if (write(fd, "userspace", strlen("userspace")) < 0)
+		ULOG_ERR("write scaling_governor error\n");
+	close(fd);
 
-	fp = fopen(filename, "w");
-	if (!fp) {
+	snprintf(filename, PATH_MAX, CPU_FREQ_PATH, "scaling_setspeed");
+	cpu_freq_fd = open(filename, O_WRONLY | O_CLOEXEC);
+	if (cpu_freq_fd < 0)
 		ULOG_ERR("open scaling_setspeed error\n");
-	}
-	fprintf(fp, "%d", freq);
-	fclose(fp);
 }
 
-void parse_line(const char* line, const char* key, int* array) {
-	char label[64];
-	int values[NUM_VALUES];
+static struct cooling_zone *zone_find_name(const char *name)
+{
 	int i;
 
-	if (sscanf(line, "%s %d %d %d %d %d", label, &values[0], &values[1], &values[2], &values[3], &values[4]) == 5) {
-		for (i = 0; i < NUM_VALUES; ++i) {
-			array[i] = values[i];
-		}
-	}
+	for (i = 0; i < NUM_ZONES; i++)
+		if (!strcmp(zones[i].name, name))
+			return &zones[i];
+
+	return NULL;
+}
+
+static struct cooling_zone *zone_find_tz(int tz_id)
+{
+	int i;
+
+	for (i = 0; i < NUM_ZONES; i++)
+		if (zones[i].tz_id == tz_id)
+			return &zones[i];
+
+	return NULL;
+}
+
+static void uci_get_int(struct uci_context *ctx, struct uci_section *s,
+			const char *name, int *val)
+{
+	const char *str = uci_lookup_option_string(ctx, s, name);
+
+	if (str)
+		*val = atoi(str);
 }
 
-int load_config() {
-	FILE * fp = fopen(config_file, "r");
-	if (!fp) {
-		ULOG_ERR("open config file error\n");
-		return 1;
+static void uci_get_list(struct uci_context *ctx, struct uci_section *s,
+			 const char *name, int *array)
+{
+	struct uci_option *o = uci_lookup_option(ctx, s, name);
+	struct uci_element *e;
+	int i = 0;
+
+	if (!o || o->type != UCI_TYPE_LIST)
+		return;
+
+	uci_foreach_element(&o->v.list, e) {
+		if (i == NUM_VALUES)
+			break;
+		array[i++] = atoi(e->name);
 	}
+}
+
+/*
+ * config zone 'wifi5g'
+ *	option thermal_zone '3'
+ *	option cooling_device '1'
+ *	option hysteresis '2'
+ *	option critical '120'
+ *	list threshold '0'
+ *	list threshold '105'
+ *	...
+ *	list mitigation / list cpu_freq
+ */
+static void load_config(void)
+{
+	struct uci_context *ctx = uci_alloc_context();
+	struct uci_package *pkg = NULL;
+	struct uci_element *e;
+
+	if (!ctx)
+		return;
 
-	WifiConfig* current_config = NULL;
-	char line[256];
-
-	while (fgets(line, sizeof(line), fp)) {
-		if (strstr(line, "[wifi2g]")) {
-			current_config = &wifi2g;
-		} else if (strstr(line, "[wifi5g]")) {
-			current_config = &wifi5g;
-		} else if (current_config) {
-			if (strstr(line, "thresholds_high")) {
-				parse_line(line, "thresholds_high", current_config->thresholds_high);
-			} else if (strstr(line, "thresholds_low")) {
-				parse_line(line, "thresholds_low", current_config->thresholds_low);
-			} else if (strstr(line, "mitigation")) {
-				parse_line(line, "mitigation", current_config->mitigation);
-			} else if (strstr(line, "CPU_freq")) {
-				parse_line(line, "CPU_freq", current_config->cpu_freq);
-			}
+	if (uci_load(ctx, "cooling", &pkg))
+		goto out;
+
+	uci_foreach_element(&pkg->sections, e) {
+		struct uci_section *s = uci_to_section(e);
+		struct cooling_zone *z;
+
+		if (strcmp(s->type, "zone"))
+			continue;
+
+		z = zone_find_name(s->e.name);
+		if (!z) {
+			ULOG_ERR("unknown cooling zone %s\n", s->e.name);
+			continue;
 		}
-	}
 
-	fclose(fp);
-	set_cpu_freq(wifi5g.cpu_freq[0]);
+		uci_get_int(ctx, s, "thermal_zone", &z->tz_id);
+		uci_get_int(ctx, s, "cooling_device", &z->cdev_id);
+		uci_get_int(ctx, s, "hysteresis", &z->hysteresis);
+		uci_get_int(ctx, s, "critical", &z->critical);
+		uci_get_list(ctx, s, "threshold", z->thresholds);
+		uci_get_list(ctx, s, "mitigation", z->mitigation);
+		if (uci_lookup_option(ctx, s, "cpu_freq")) {
+			uci_get_list(ctx, s, "cpu_freq", z->freq);
+			z->cpu_freq = true;
+		}
+	}
 
-	return 0;
+out:
+	uci_free_context(ctx);
 }
 
-int load_default_config(){
-	int i=0;
-
-	set_cpu_freq(1008000);
-	for (i = 0; i < NUM_VALUES; i++) {
-		wifi2g.thresholds_high[i]=level_2g_high[i];
-		wifi2g.thresholds_low[i]=level_2g_low[i];
-		wifi2g.mitigation[i]=level_2g_mitigation[i];
-		wifi2g.cpu_freq[i]=level_cpu_frequency[i];
-		wifi5g.thresholds_high[i]=level_5g_high[i];
-		wifi5g.thresholds_low[i]=level_5g_low[i];
-		wifi5g.mitigation[i]=level_5g_mitigation[i];
-		wifi5g.cpu_freq[i]=level_cpu_frequency[i];
+static void system_reboot(struct cooling_zone *z)
+{
+	static bool rebooting;
+	uint32_t id;
+
+	if (rebooting || !ubus_ctx)
+		return;
+
+	ULOG_ERR("!! %s temperature is over %d degree, system will reboot\n",
+		 z->name, z->temp);
+	sync();
+
+	if (ubus_lookup_id(ubus_ctx, "system", &id) ||
+	    ubus_invoke(ubus_ctx, id, "reboot", NULL, NULL, NULL, 1000)) {
+		ULOG_ERR("reboot request failed\n");
+		return;
 	}
-	return 0;
 
+	rebooting = true;
 }
 
-static void write_cur_state (const char *filename, int state) {
-	FILE * fp;
+static int zone_level(struct cooling_zone *z)
+{
+	int level = z->level;
 
-	fp = fopen(filename, "w");
-	if (!fp){
-		ULOG_ERR("open %s file error\n",filename);
-	}
-	fprintf(fp, "%d", state);
-	fclose(fp);
+	while (level < NUM_VALUES - 1 && z->temp >= z->thresholds[level + 1])
+		level++;
+
+	while (level > 0 && z->temp < z->thresholds[level] - z->hysteresis)
+		level--;
+
+	return level;
 }
 
-int read_cur_state(const char *filename, char *buf, size_t buffer) {
-	FILE *fp;
-	
-	fp = fopen(filename, "r");
-	if (!fp) {
-		ULOG_ERR("open %s file error\n",filename);
-		return -1;
-	}
-	if (!fgets(buf, buffer, fp)) {
-		ULOG_ERR("Failed to read %s file\n", filename);
-		fclose(fp);
-		return -1;
+static void zone_update(struct cooling_zone *z)
+{
+	int level;
+
+	if (z->critical && z->temp >= z->critical) {
+		system_reboot(z);
+		return;
 	}
-	fclose(fp);
-	return 0;
+
+	level = zone_level(z);
+	if (level == z->level)
+		return;
+
+	ULOG_INFO("%s at level %d, %d degree, reduce %d percent\n",
+		  z->name, level, z->temp, z->mitigation[level]);
+
+	if (z->cdev_fd >= 0 && write_int(z->cdev_fd, z->mitigation[level]))
+		ULOG_ERR("%s: write cur_state error\n", z->name);
+
+	if (z->cpu_freq)
+		set_cpu_freq(z->freq[level]);
+
+	z->level = level;
+}
+
+static void zone_read(struct cooling_zone *z)
+{
+	if (z->temp_fd < 0 || read_int(z->temp_fd, &z->temp))
+		ULOG_ERR("%s: failed to read temperature\n", z->name);
 }
 
+static void zone_init(struct cooling_zone *z)
+{
+	z->temp_fd = open_sysfs(TEMPER_PATH, z->tz_id, O_RDONLY);
+	z->cdev_fd = -1;
+	if (z->cdev_id >= 0)
+		z->cdev_fd = open_sysfs(CUR_STATE_PATH, z->cdev_id, O_WRONLY);
 
-static void wifi_get_temperature() {
-	char filename[PATH_MAX];
-	char buffer[BUF_MAX];
-	int i = 0;
+	z->level = 0;
+	if (z->cdev_fd >= 0)
+		write_int(z->cdev_fd, 0);
+
+	if (z->cpu_freq)
+		set_cpu_freq(z->freq[0]);
+}
 
-//	ULOG_INFO("=================================\n");
+static int no_seq_check(struct nl_msg *msg, void *arg)
+{
+	return NL_OK;
+}
+
+static int error_handler(struct sockaddr_nl *nla, struct nlmsgerr *err,
+			 void *arg)
+{
+	int *ret = arg;
+	*ret = err->error;
+	return NL_STOP;
+}
 
-	/* read cpuinfo_cur_freq*/
-	snprintf(filename, PATH_MAX, CPU_FREQ_PATH, "cpuinfo_cur_freq");
+static int ack_handler(struct nl_msg *msg, void *arg)
+{
+	int *ret = arg;
+	*ret = 0;
+	return NL_STOP;
+}
 
-	memset(buffer, 0, BUF_MAX);
-	read_cur_state(filename, buffer, sizeof(buffer));
-//	ULOG_INFO("CPU current frequency: %s\n", buffer);
+struct handler_args {
+	const char *group;
+	int id;
+};
 
-	/* get current phy cooling state*/
-	for (i=0; i <= 1; i++) {
-		memset(buffer, 0, BUF_MAX);
-		snprintf(filename, PATH_MAX, CUR_STATE_PATH, i);
-		read_cur_state(filename, buffer, sizeof(buffer));
-//		ULOG_INFO("Phy%i cur_state is: %s\n", i, buffer);
+static int family_handler(struct nl_msg *msg, void *arg)
+{
+	struct handler_args *grp = arg;
+	struct nlattr *tb[CTRL_ATTR_MAX + 1];
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+	struct nlattr *mcgrp;
+	int rem_mcgrp;
+
+	nla_parse(tb, CTRL_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
+		  genlmsg_attrlen(gnlh, 0), NULL);
+
+	if (!tb[CTRL_ATTR_MCAST_GROUPS])
+		return NL_SKIP;
+
+	nla_for_each_nested(mcgrp, tb[CTRL_ATTR_MCAST_GROUPS], rem_mcgrp) {
+		struct nlattr *tb_mcgrp[CTRL_ATTR_MCAST_GRP_MAX + 1];
+
+		nla_parse(tb_mcgrp, CTRL_ATTR_MCAST_GRP_MAX,
+			  nla_data(mcgrp), nla_len(mcgrp), NULL);
+
+		if (!tb_mcgrp[CTRL_ATTR_MCAST_GRP_NAME] ||
+		    !tb_mcgrp[CTRL_ATTR_MCAST_GRP_ID])
+			continue;
+		if (strncmp(nla_data(tb_mcgrp[CTRL_ATTR_MCAST_GRP_NAME]),
+			    grp->group, nla_len(tb_mcgrp[CTRL_ATTR_MCAST_GRP_NAME])))
+			continue;
+		grp->id = nla_get_u32(tb_mcgrp[CTRL_ATTR_MCAST_GRP_ID]);
+		break;
 	}
 
-	for (i=0; i <= 3; i++) {
-		memset(buffer, 0, BUF_MAX);
-		snprintf(filename, PATH_MAX, TEMPER_PATH, i);
-		read_cur_state(filename, buffer, sizeof(buffer));
-//		ULOG_INFO("thermal_zone%i cur_temp is: %s\n", i, buffer);
+	return NL_SKIP;
+}
+
+/* libnl-tiny has no genl_ctrl_resolve_grp(), look the group up by hand */
+static int nl_get_multicast_id(struct nl_sock *sock, const char *family,
+			       const char *group)
+{
+	struct nl_msg *msg;
+	struct nl_cb *cb;
+	struct handler_args grp = {
+		.group = group,
+		.id = -ENOENT,
+	};
+	int ret, ctrlid;
 
-		if (i == 0)
-			w2g_cur_temper=atoi(buffer);
-		else if (i == 3)
-			w5g_cur_temper=atoi(buffer);
+	msg = nlmsg_alloc();
+	if (!msg)
+		return -ENOMEM;
+
+	cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!cb) {
+		ret = -ENOMEM;
+		goto out_fail_cb;
 	}
 
-	if (w5g_cur_temper >= 120)
-	{
-		ULOG_ERR("!! Temperature is over %d degree, system will reboot\n", w5g_cur_temper);
-		sync();
-		if ( -1 != system("reboot &") ){
-			printf("sysyem reboot...\n");
-		}
+	ctrlid = genl_ctrl_resolve(sock, "nlctrl");
+
+	genlmsg_put(msg, 0, 0, ctrlid, 0,
+		    0, CTRL_CMD_GETFAMILY, 0);
+
+	ret = -ENOBUFS;
+	NLA_PUT_STRING(msg, CTRL_ATTR_FAMILY_NAME, family);
+
+	ret = nl_send_auto_complete(sock, msg);
+	if (ret < 0)
+		goto out;
+
+	ret = 1;
+
+	nl_cb_err(cb, NL_CB_CUSTOM, error_handler, &ret);
+	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, ack_handler, &ret);
+	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, family_handler, &grp);
+
+	while (ret > 0)
+		nl_recvmsgs(sock, cb);
+
+	if (ret == 0)
+		ret = grp.id;
+ nla_put_failure:
+ out:
+	nl_cb_put(cb);
+ out_fail_cb:
+	nlmsg_free(msg);
+	return ret;
+}
+
+static int thermal_event(struct nl_msg *msg, void *arg)
+{
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+	struct nlattr *tb[THERMAL_GENL_ATTR_PARSE_MAX + 1];
+	struct cooling_zone *z;
+
+	nla_parse(tb, THERMAL_GENL_ATTR_PARSE_MAX, genlmsg_attrdata(gnlh, 0),
+		  genlmsg_attrlen(gnlh, 0), NULL);
+
+	if (!tb[THERMAL_GENL_ATTR_TZ_ID])
+		return NL_SKIP;
+
+	z = zone_find_tz(nla_get_u32(tb[THERMAL_GENL_ATTR_TZ_ID]));
+	if (!z)
+		return NL_SKIP;
+
+	/* sampling and event commands share the same number space */
+	switch (gnlh->cmd) {
+	case THERMAL_GENL_SAMPLING_TEMP:
+		if (!tb[THERMAL_GENL_ATTR_TZ_TEMP])
+			return NL_SKIP;
+		z->temp = (int)nla_get_u32(tb[THERMAL_GENL_ATTR_TZ_TEMP]);
+		break;
+	case THERMAL_GENL_EVENT_TZ_TRIP_UP:
+	case THERMAL_GENL_EVENT_TZ_TRIP_DOWN:
+		zone_read(z);
+		break;
+	default:
+		return NL_SKIP;
 	}
+
+	zone_update(z);
+
+	return NL_SKIP;
 }
 
-static void wifi_set_cooling() {
-	char filename[PATH_MAX];
-	int level;
+static void thermal_sock_cb(struct uloop_fd *fd, unsigned int events)
+{
+	nl_recvmsgs(genl, genl_cb);
+}
 
-	for (level = 0; level <= 3; level++) {
-		if (w2g_cur_temper >= wifi2g.thresholds_low[level] && w2g_cur_temper < wifi2g.thresholds_high[level]) {
-//			ULOG_INFO("2G at level %d , %d degree\n" ,level, w2g_cur_temper);
-			if (w2g_threshold_level != level) {
-//				ULOG_INFO("setting 2G reduce %d percent\n" ,wifi2g.mitigation[level]);
-				snprintf(filename, PATH_MAX, CUR_STATE_PATH, PHY0);
-				write_cur_state(filename, wifi2g.mitigation[level]);
-				w2g_threshold_level = level;
-			}
-		}
-		if (w5g_cur_temper >= wifi5g.thresholds_low[level] && w5g_cur_temper < wifi5g.thresholds_high[level]) {
-//			ULOG_INFO("5G at level %d , %d degree\n" ,level, w5g_cur_temper);
-			if (w5g_threshold_level != level) {
-//				ULOG_INFO("setting 5G reduce %d percent\n" ,wifi5g.mitigation[level]);
-				snprintf(filename, PATH_MAX, CUR_STATE_PATH, PHY1);
-				write_cur_state(filename, wifi5g.mitigation[level]);
-				w5g_threshold_level = level;
-				set_cpu_freq(wifi5g.cpu_freq[level]);
-			}
-		}
+static void thermal_netlink_done(void)
+{
+	if (!genl)
+		return;
+
+	if (genl_fd.registered)
+		uloop_fd_delete(&genl_fd);
+	if (genl_cb)
+		nl_cb_put(genl_cb);
+	nl_socket_free(genl);
+	genl = NULL;
+	genl_cb = NULL;
+}
+
+static int thermal_netlink_init(void)
+{
+	static const char * const groups[] = {
+		THERMAL_GENL_EVENT_GROUP_NAME,
+		THERMAL_GENL_SAMPLING_GROUP_NAME,
+	};
+	int i, id;
+
+	genl = nl_socket_alloc();
+	if (!genl)
+		return -1;
+
+	if (genl_connect(genl))
+		goto error;
+
+	for (i = 0; i < ARRAY_SIZE(groups); i++) {
+		id = nl_get_multicast_id(genl, THERMAL_GENL_FAMILY_NAME, groups[i]);
+		if (id < 0 || nl_socket_add_membership(genl, id) < 0)
+			goto error;
 	}
 
+	genl_cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!genl_cb)
+		goto error;
+
+	nl_cb_set(genl_cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, no_seq_check, NULL);
+	nl_cb_set(genl_cb, NL_CB_VALID, NL_CB_CUSTOM, thermal_event, NULL);
+	nl_socket_set_cb(genl, genl_cb);
+
+	genl_fd.fd = nl_socket_get_fd(genl);
+	genl_fd.cb = thermal_sock_cb;
+	uloop_fd_add(&genl_fd, ULOOP_READ);
+
+	return 0;
+
+error:
+	thermal_netlink_done();
+	return -1;
 }
 
+static void cooling_init(bool use_config)
+{
+	int i;
 
-static void cooling_init() {
-	char filename[PATH_MAX];
-	int i,result=0;
+	if (use_config)
+		load_config();
 
-	for (i=0 ; i <= 1; i++) {
-		snprintf(filename, PATH_MAX, CUR_STATE_PATH, i);
-		write_cur_state(filename, 0);
-	}
+	cpu_freq_init();
 
-	if(load_config_file)
-		result = load_config();
+	for (i = 0; i < NUM_ZONES; i++)
+		zone_init(&zones[i]);
 
-	if (result == 1 || load_config_file == 0)
-		load_default_config();
+	if (thermal_netlink_init())
+		ULOG_INFO("thermal netlink not available, polling only\n");
 }
 
 void print_usage(void)
 {
 	printf("\nWifi-cooling daemon usage\n");
 	printf("Optional arguments:\n");
-	printf("  -c <file>        setting with config file\n");
-	printf("  -d               default setting\n");
+	printf("  -d               default setting, ignore UCI zone configuration\n");
 	printf("  -h               this usage screen\n");
 }
 
-static void state_timeout_cb(struct uloop_timeout *t) 
+static void state_timeout_cb(struct uloop_timeout *t)
 {
-	wifi_get_temperature();
-	wifi_set_cooling();
-	uloop_timeout_set(t, 30 * 1000);		// interval 30 seconds
+	int i;
+
+	for (i = 0; i < NUM_ZONES; i++) {
+		zone_read(&zones[i]);
+		zone_update(&zones[i]);
+	}
+
+	uloop_timeout_set(t, POLL_INTERVAL);
 }
 
-int main(int argc, char *argv[]) 
+int main(int argc, char *argv[])
 {
+	bool use_config = true;
 	int ch;
 	struct uloop_timeout state_timeout = {
 		.cb = state_timeout_cb,
@@ -315,15 +667,11 @@ int main(int argc, char *argv[])
 	ulog_threshold(LOG_ERR);
 //	ulog_threshold(LOG_INFO);
 
- 	while ((ch = getopt(argc, argv, "c:dh")) != -1) {
+ 	while ((ch = getopt(argc, argv, "dh")) != -1) {
 		switch (ch) {
-		case 'c':
-			printf("wifi-cooling load configuration file %s\n", optarg);
-			config_file = optarg;
-			load_config_file=1;
-			break;
 		case 'd':
 			printf("wifi-cooling set to default value\n");
+			use_config = false;
 			break;
 		case 'h':
 		default:
@@ -333,10 +681,18 @@ int main(int argc, char *argv[])
 
 	}
 
-	cooling_init();
 	uloop_init();
+
+	ubus_ctx = ubus_connect(NULL);
+	if (!ubus_ctx)
+		ULOG_ERR("failed to connect to ubus\n");
+
+	cooling_init(use_config);
 	uloop_timeout_set(&state_timeout, 1000);
 	uloop_run();
+	thermal_netlink_done();
+	if (ubus_ctx)
+		ubus_free(ubus_ctx);
 	uloop_done();
 
 	return 0;
@@ -0,0 +1,242 @@
+/*===========================================================================
+
+  cooling_test.c
+
+  DESCRIPTION
+  Drives the cooling zones with fake thermal netlink events against a fake
+  sysfs tree and checks that mitigation, cpu frequency and reboot actions
+  happen in the expected order.
+
+===========================================================================*/
+/* pull in the static helpers, the daemon main() is not used */
+#define main cooling_main
+#include "../src/cooling.c"
+#undef main
+
+#include <stdarg.h>
+
+static int reboots;
+
+/* ubus is only used to request the reboot */
+int ubus_lookup_id(struct ubus_context *ctx, const char *path, uint32_t *id)
+{
+	*id = 1;
+	return strcmp(path, "system") ? UBUS_STATUS_NOT_FOUND : 0;
+}
+
+int ubus_invoke_fd(struct ubus_context *ctx, uint32_t obj, const char *method,
+		   struct blob_attr *msg, ubus_data_handler_t cb, void *priv,
+		   int timeout, int fd)
+{
+	if (!strcmp(method, "reboot"))
+		reboots++;
+
+	return 0;
+}
+
+/*
+ * sysfs attributes are rewritten in place, so the test truncates every fake
+ * attribute after looking at it: -1 below means nothing was written.
+ */
+struct step {
+	const char *what;
+	int tz_id;
+	int cmd;
+	int temp;
+	/* writes caused by the event */
+	int cdev[2];
+	int freq;
+	int reboots;
+};
+
+static const struct step steps[] = {
+	{ "5g below the first threshold", 3, THERMAL_GENL_SAMPLING_TEMP, 100,
+	  { -1, -1 }, -1, 0 },
+	{ "5g enters level 1", 3, THERMAL_GENL_SAMPLING_TEMP, 106,
+	  { -1, 20 }, 800000, 0 },
+	{ "5g stays inside the hysteresis", 3, THERMAL_GENL_SAMPLING_TEMP, 104,
+	  { -1, -1 }, -1, 0 },
+	{ "5g jumps to level 3", 3, THERMAL_GENL_SAMPLING_TEMP, 116,
+	  { -1, 50 }, -1, 0 },
+	{ "5g drops one level", 3, THERMAL_GENL_SAMPLING_TEMP, 109,
+	  { -1, 30 }, -1, 0 },
+	{ "5g trip down reads sysfs", 3, THERMAL_GENL_EVENT_TZ_TRIP_DOWN, 90,
+	  { -1, 0 }, 1008000, 0 },
+	{ "2g trip up reads sysfs", 0, THERMAL_GENL_EVENT_TZ_TRIP_UP, 111,
+	  { 50, -1 }, -1, 0 },
+	{ "unknown zone is ignored", 7, THERMAL_GENL_SAMPLING_TEMP, 130,
+	  { -1, -1 }, -1, 0 },
+	{ "unhandled event is ignored", 0, THERMAL_GENL_EVENT_TZ_CREATE, 90,
+	  { -1, -1 }, -1, 0 },
+	{ "5g critical reboots", 3, THERMAL_GENL_SAMPLING_TEMP, 121,
+	  { -1, -1 }, -1, 1 },
+	{ "reboot is only requested once", 3, THERMAL_GENL_SAMPLING_TEMP, 125,
+	  { -1, -1 }, -1, 1 },
+};
+
+#define FAKE_CPU_FREQ(_name) SYSFS_ROOT "/sys/devices/system/cpu/cpu0/cpufreq/" _name
+
+static void fake_write(const char *fmt, int id, const char *val)
+{
+	char path[PATH_MAX], *p;
+	FILE *f;
+
+	snprintf(path, sizeof(path), fmt, id);
+	for (p = strchr(path, '/'); p; p = strchr(p + 1, '/')) {
+		*p = 0;
+		mkdir(path, 0755);
+		*p = '/';
+	}
+
+	f = fopen(path, "w");
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	fputs(val, f);
+	fclose(f);
+}
+
+static void fake_write_int(const char *fmt, int id, int val)
+{
+	char buf[BUF_MAX];
+
+	snprintf(buf, sizeof(buf), "%d", val);
+	fake_write(fmt, id, buf);
+}
+
+/* returns what was written since the last call, -1 for nothing */
+static int fake_read(const char *fmt, int id)
+{
+	char path[PATH_MAX];
+	int val = -1;
+	FILE *f;
+
+	snprintf(path, sizeof(path), fmt, id);
+	f = fopen(path, "r+");
+	if (!f)
+		return -1;
+	if (fscanf(f, "%d", &val) != 1)
+		val = -1;
+	if (ftruncate(fileno(f), 0))
+		val = -2;
+	fclose(f);
+
+	return val;
+}
+
+/* what the thermal genl family multicasts */
+static struct nl_msg *fake_event(int cmd, int tz_id, int temp)
+{
+	struct nl_msg *msg = nlmsg_alloc();
+
+	if (!msg)
+		exit(1);
+
+	genlmsg_put(msg, 0, 0, 0x20, 0, 0, cmd, 1);
+	nla_put_u32(msg, THERMAL_GENL_ATTR_TZ_ID, tz_id);
+	if (cmd == THERMAL_GENL_SAMPLING_TEMP)
+		nla_put_u32(msg, THERMAL_GENL_ATTR_TZ_TEMP, temp);
+
+	return msg;
+}
+
+static int check(bool cond, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("%s: ", cond ? "ok" : "FAIL");
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf("\n");
+
+	return !cond;
+}
+
+static int check_state(const char *what, const int *cdev, int freq, int n_reboots)
+{
+	int cdev0 = fake_read(CUR_STATE_PATH, 0);
+	int cdev1 = fake_read(CUR_STATE_PATH, 1);
+	int speed = fake_read(FAKE_CPU_FREQ("scaling_setspeed"), 0);
+
+	return check(cdev0 == cdev[0] && cdev1 == cdev[1] && speed == freq &&
+		     reboots == n_reboots,
+		     "%s (cdev %d/%d freq %d reboots %d)", what, cdev0, cdev1, speed,
+		     reboots);
+}
+
+int main(int argc, char **argv)
+{
+	char dir[] = "/tmp/cooling-test.XXXXXX";
+	struct uloop_timeout poll = {};
+	struct nl_msg *msg;
+	int i, failed = 0;
+
+	if (!mkdtemp(dir) || chdir(dir)) {
+		perror(dir);
+		return 1;
+	}
+
+	ulog_open(ULOG_STDIO, LOG_DAEMON, "cooling-test");
+	ulog_threshold(LOG_ERR);
+
+	fake_write_int(TEMPER_PATH, 0, 40);
+	fake_write_int(TEMPER_PATH, 3, 40);
+	fake_write(CUR_STATE_PATH, 0, "");
+	fake_write(CUR_STATE_PATH, 1, "");
+	fake_write(FAKE_CPU_FREQ("scaling_governor"), 0, "");
+	fake_write(FAKE_CPU_FREQ("scaling_setspeed"), 0, "");
+
+	/* the board config plus the shipped hysteresis */
+	for (i = 0; i < NUM_ZONES; i++)
+		zones[i].hysteresis = 2;
+
+	/* a non-NULL context, the ubus calls are mocked above */
+	ubus_ctx = (struct ubus_context *)&poll;
+
+	cpu_freq_init();
+	for (i = 0; i < NUM_ZONES; i++)
+		zone_init(&zones[i]);
+
+	{
+		static const int idle[2] = { 0, 0 };
+		char buf[BUF_MAX] = "";
+		FILE *f = fopen(FAKE_CPU_FREQ("scaling_governor"), "r");
+
+		if (f) {
+			if (!fgets(buf, sizeof(buf), f))
+				buf[0] = 0;
+			fclose(f);
+		}
+		failed |= check(!strcmp(buf, "userspace"), "governor switched to userspace");
+		failed |= check_state("zones start unmitigated", idle, 1008000, 0);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(steps); i++) {
+		const struct step *s = &steps[i];
+
+		if (s->cmd != THERMAL_GENL_SAMPLING_TEMP)
+			fake_write_int(TEMPER_PATH, s->tz_id, s->temp);
+
+		msg = fake_event(s->cmd, s->tz_id, s->temp);
+		thermal_event(msg, NULL);
+		nlmsg_free(msg);
+
+		failed |= check_state(s->what, s->cdev, s->freq, s->reboots);
+	}
+
+	/* without events the poll timer picks up the temperature */
+	{
+		static const int polled[2] = { 35, -1 };
+
+		zones[1].critical = 0;
+		fake_write_int(TEMPER_PATH, 0, 106);
+		fake_write_int(TEMPER_PATH, 3, 60);
+		state_timeout_cb(&poll);
+		uloop_timeout_cancel(&poll);
+		failed |= check_state("poll fallback", polled, -1, 1);
+	}
+
+	return failed;
+}
@@ -1473,6 +1473,7 @@ hostapd_wnm_disassoc_imminent(struct ubus_context *ctx, struct ubus_object *obj,
 enum {
 	UPDATE_AIRTIME_STA,
 	UPDATE_AIRTIME_WEIGHT,
+	UPDATE_AIRTIME_STATIONS,
 	__UPDATE_AIRTIME_MAX,
 };
 
@@ -1480,8 +1481,34 @@ enum {
 static const struct blobmsg_policy airtime_policy[__UPDATE_AIRTIME_MAX] = {
 	[UPDATE_AIRTIME_STA] = { "sta", BLOBMSG_TYPE_STRING },
 	[UPDATE_AIRTIME_WEIGHT] = { "weight", BLOBMSG_TYPE_INT32 },
+	[UPDATE_AIRTIME_STATIONS] = { "stations", BLOBMSG_TYPE_TABLE },
 };
 
+static void
+hostapd_bss_update_airtime_stations(struct hostapd_data *hapd,
+				    struct blob_attr *stations)
+{
+	struct sta_info *sta;
+	struct blob_attr *cur;
+	u8 addr[ETH_ALEN];
+	int rem;
+
+	blobmsg_for_each_attr(cur, stations, rem) {
+		if (blobmsg_type(cur) != BLOBMSG_TYPE_INT32)
+			continue;
+
+		if (hwaddr_aton(blobmsg_name(cur), addr))
+			continue;
+
+		sta = ap_get_sta(hapd, addr);
+		if (!sta)
+			continue;
+
+		sta->dyn_airtime_weight = blobmsg_get_u32(cur);
+		airtime_policy_new_sta(hapd, sta);
+	}
+}
+
 static int
 hostapd_bss_update_airtime(struct ubus_context *ctx, struct ubus_object *obj,
 			   struct ubus_request_data *ureq, const char *method,
@@ -1495,6 +1522,11 @@ hostapd_bss_update_airtime(struct ubus_context *ctx, struct ubus_object *obj,
 
 	blobmsg_parse(airtime_policy, __UPDATE_AIRTIME_MAX, tb, blob_data(msg), blob_len(msg));
 
+	if (tb[UPDATE_AIRTIME_STATIONS]) {
+		hostapd_bss_update_airtime_stations(hapd, tb[UPDATE_AIRTIME_STATIONS]);
+		return 0;
+	}
+
 	if (!tb[UPDATE_AIRTIME_WEIGHT])
 		return UBUS_STATUS_INVALID_ARGUMENT;
 
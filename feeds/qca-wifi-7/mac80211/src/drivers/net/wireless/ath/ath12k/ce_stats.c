@@ -24,28 +24,16 @@ void ath12k_record_exec_entry_ts(struct ath12k_base *ab, int ce_id)
 		stats->exec_entry_ts = ktime_to_us(ktime_get());
 }
 
-static  enum ce_buckets ath12k_get_ce_stats_bucket_index(u64 time_us)
+VISIBLE_IF_ATH12K_KUNIT
+void ath12k_ce_stats_hist_add(struct ath12k_ce_stats_hist *hist,
+			      u64 time_us, u64 now)
 {
-	u64 time_ms;
-	enum ce_buckets index = CE_BUCKET_MAX;
-
-	time_ms = do_div(time_us, 1000);
-
-	if (time_ms > 10)
-		index = CE_BUCKET_BEYOND;
-	else if (time_ms > 5)
-		index = CE_BUCKET_10_MS;
-	else if (time_ms > 2)
-		index = CE_BUCKET_5_MS;
-	else if (time_ms > 1)
-		index = CE_BUCKET_2_MS;
-	else if (time_us > 500)
-		index = CE_BUCKET_1_MS;
-	else
-		index = CE_BUCKET_500_US;
-
-	return index;
+	unsigned int bucket = ath12k_ce_stats_bucket(time_us);
+
+	hist->count[bucket]++;
+	hist->last_update[bucket] = now;
 }
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_ce_stats_hist_add);
 
 void ath12k_update_ce_stats_bucket(struct ath12k_base *ab, int ce_id)
 {
@@ -55,7 +43,6 @@ void ath12k_update_ce_stats_bucket(struct ath12k_base *ab, int ce_id)
 	u64 exec_time;
 	u64 sched_time;
 	u64 curr_time = ktime_to_us(ktime_get());
-	enum ce_buckets bucket_index;
 
 	if (!stats)
 		return;
@@ -70,11 +57,55 @@ void ath12k_update_ce_stats_bucket(struct ath12k_base *ab, int ce_id)
 	stats->exec_time_record[index] = exec_time;
 	stats->record_index = index;
 
-	bucket_index =  ath12k_get_ce_stats_bucket_index(exec_time);
-	stats->exec_bucket[bucket_index]++;
-	stats->exec_last_update[bucket_index] = curr_time;
+	ath12k_ce_stats_hist_add(&stats->exec, exec_time, curr_time);
+	ath12k_ce_stats_hist_add(&stats->sched, sched_time, curr_time);
+}
+
+/* Returns the upper bound in us of the bucket holding the pct-th percentile
+ * sample, 0 if the histogram is empty.
+ */
+u64 ath12k_ce_stats_percentile(const struct ath12k_ce_stats_hist *hist,
+			       unsigned int pct)
+{
+	u64 total = 0, sum = 0, target;
+	unsigned int i;
+
+	for (i = 0; i < CE_STATS_HIST_BUCKETS; i++)
+		total += hist->count[i];
 
-	bucket_index =  ath12k_get_ce_stats_bucket_index(sched_time);
-	stats->sched_bucket[bucket_index]++;
-	stats->sched_last_update[bucket_index] = curr_time;
+	if (!total)
+		return 0;
+
+	target = DIV_ROUND_UP_ULL(total * min(pct, 100U), 100);
+	for (i = 0; i < CE_STATS_HIST_BUCKETS - 1; i++) {
+		sum += hist->count[i];
+		if (sum >= target)
+			break;
+	}
+
+	return ath12k_ce_stats_bucket_limit(i);
+}
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_ce_stats_percentile);
+
+void ath12k_ce_stats_reset(struct ath12k_base *ab)
+{
+	struct ath12k_ce_stats *stats;
+	int i;
+
+	for (i = 0; i < ab->hw_params->ce_count; i++) {
+		stats = ab->ce.ce_pipe[i].ce_stats;
+		if (!stats)
+			continue;
+
+		/* racing tasklets may land a sample on either side of this,
+		 * which is fine for debug counters
+		 */
+		memset(&stats->sched, 0, sizeof(stats->sched));
+		memset(&stats->exec, 0, sizeof(stats->exec));
+		memset(stats->sched_time_record, 0,
+		       sizeof(stats->sched_time_record));
+		memset(stats->exec_time_record, 0,
+		       sizeof(stats->exec_time_record));
+		stats->record_index = 0;
+	}
 }
@@ -4,26 +4,21 @@
 #ifndef ATH12K_CE_STATS_H
 #define ATH12K_CE_STATS_H
 
+#include <linux/bitops.h>
+
 struct ath12k_base;
 #define MAX_CE_STATS_RECORDS 20
-/**
- * enum ce_buckets - CE tasklet time buckets
- * @CE_BUCKET_500_US: tasklet bucket to store 0-0.5ms
- * @CE_BUCKET_1_MS: tasklet bucket to store 0.5-1ms
- * @CE_BUCKET_2_MS: tasklet bucket to store 1-2ms
- * @CE_BUCKET_5_MS: tasklet bucket to store 2-5ms
- * @CE_BUCKET_10_MS: tasklet bucket to store 5-10ms
- * @CE_BUCKET_BEYOND: tasklet bucket to store > 10ms
- * @CE_BUCKET_MAX: enum max value
+
+/* Latencies are kept in log2 buckets of microseconds: bucket 0 holds 0us,
+ * bucket n holds [2^(n-1), 2^n) us and the last bucket is open ended,
+ * i.e. everything from 2^(CE_STATS_HIST_BUCKETS - 2) us (~262ms) up.
  */
-enum ce_buckets {
-	CE_BUCKET_500_US,
-	CE_BUCKET_1_MS,
-	CE_BUCKET_2_MS,
-	CE_BUCKET_5_MS,
-	CE_BUCKET_10_MS,
-	CE_BUCKET_BEYOND,
-	CE_BUCKET_MAX,
+#define CE_STATS_HIST_BUCKETS 20
+
+struct ath12k_ce_stats_hist {
+	u64 count[CE_STATS_HIST_BUCKETS];
+	/* Timestamp of the last sample that landed in each bucket */
+	u64 last_update[CE_STATS_HIST_BUCKETS];
 };
 
 struct ath12k_ce_stats {
@@ -36,15 +31,37 @@ struct ath12k_ce_stats {
 	u64 sched_time_record[MAX_CE_STATS_RECORDS];
 	/* Last N number of tasklets//work queue execution time */
 	u64 exec_time_record[MAX_CE_STATS_RECORDS];
-	u64 exec_bucket[CE_BUCKET_MAX];
-	u64 exec_time, exec_ms;
-	u64 sched_time, sched_ms;
-	u64 sched_bucket[CE_BUCKET_MAX];
-	u64 exec_last_update[CE_BUCKET_MAX];
-	u64 sched_last_update[CE_BUCKET_MAX];
+	/* IRQ to tasklet/work queue start delay */
+	struct ath12k_ce_stats_hist sched;
+	/* Tasklet/work queue run time */
+	struct ath12k_ce_stats_hist exec;
 };
 
+static inline unsigned int ath12k_ce_stats_bucket(u64 time_us)
+{
+	return min_t(unsigned int, fls64(time_us), CE_STATS_HIST_BUCKETS - 1);
+}
+
+/* Exclusive upper bound in us of a bucket, the last one reports its lower
+ * bound as it has no upper one.
+ */
+static inline u64 ath12k_ce_stats_bucket_limit(unsigned int bucket)
+{
+	if (bucket >= CE_STATS_HIST_BUCKETS - 1)
+		return 1ULL << (CE_STATS_HIST_BUCKETS - 2);
+
+	return 1ULL << bucket;
+}
+
 void ath12k_record_exec_entry_ts(struct ath12k_base *ab, int ce_id);
 void ath12k_record_sched_entry_ts(struct ath12k_base *ab, int ce_id);
 void ath12k_update_ce_stats_bucket(struct ath12k_base *ab, int ce_id);
+u64 ath12k_ce_stats_percentile(const struct ath12k_ce_stats_hist *hist,
+			       unsigned int pct);
+void ath12k_ce_stats_reset(struct ath12k_base *ab);
+
+#if IS_ENABLED(CPTCFG_ATH12K_KUNIT_TEST)
+void ath12k_ce_stats_hist_add(struct ath12k_ce_stats_hist *hist,
+			      u64 time_us, u64 now);
+#endif
 #endif
@@ -18,6 +18,7 @@
 #include <linux/panic_notifier.h>
 #include <linux/average.h>
 #include <linux/rhashtable.h>
+#include <kunit/visibility.h>
 #include "qmi.h"
 #include "htc.h"
 #include "wmi.h"
@@ -59,6 +60,14 @@
 #include "ath_debug/athdbg_qmi.h"
 #endif
 
+#if IS_ENABLED(CPTCFG_ATH12K_KUNIT_TEST)
+#define EXPORT_SYMBOL_IF_ATH12K_KUNIT(sym) EXPORT_SYMBOL_IF_KUNIT(sym)
+#define VISIBLE_IF_ATH12K_KUNIT
+#else
+#define EXPORT_SYMBOL_IF_ATH12K_KUNIT(sym)
+#define VISIBLE_IF_ATH12K_KUNIT static
+#endif
+
 #define SM(_v, _f) (((_v) << _f##_LSB) & _f##_MASK)
 
 #define ATH12K_TX_MGMT_NUM_PENDING_MAX	512
@@ -239,7 +248,6 @@ struct ath12k_skb_cb {
 		u8 eid;
 	} u;
 	struct ieee80211_vif *vif;
-	dma_addr_t paddr_ext_desc;
 	u32 cipher;
 	u8 flags;
 	u8 link_id;
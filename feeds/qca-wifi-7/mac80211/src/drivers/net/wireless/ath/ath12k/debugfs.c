@@ -1078,6 +1078,11 @@ static ssize_t ath12k_debugfs_dump_device_dp_stats(struct file *file,
 		len += scnprintf(buf + len, size - len, "ring%d: %u\n",
 			 i, device_stats->tx_err.txbuf_na[i]);
 
+	len += scnprintf(buf + len, size - len, "\nTx Ext Desc Pool Exhausted:\n");
+	for (i = 0; i < DP_TCL_NUM_RING_MAX; i++)
+		len += scnprintf(buf + len, size - len, "ring%d: %u\n",
+				 i, device_stats->tx_err.ext_desc_na[i]);
+
 	len += scnprintf(buf + len, size - len,
 			 "\nMisc Transmit Failures: %d\n",
 			 atomic_read(&device_stats->tx_err.misc_fail));
@@ -3207,6 +3212,14 @@ static ssize_t ath12k_dump_fst_flow_stats(struct file *file,
 			"\nFlow deletion failure: %u\n",
 			fst->flow_del_fail);
 
+	len += scnprintf(buf + len, size - len,
+			"\nFlow table occupancy: %u/%u\n",
+			fst->num_entries, fst->hal_rx_fst->max_entries);
+
+	len += scnprintf(buf + len, size - len,
+			"\nFlow hash collisions: %u (max skid %u)\n",
+			fst->flow_collisions, fst->flow_max_skid);
+
 	len += scnprintf(buf + len, size - len,
 			"\nNo of Flows per reo:\n0:%u\t1:%u\t2:%u\t3:%u\n",
 			fst->flows_per_reo[0],
@@ -3279,97 +3292,69 @@ void ath12k_fst_debugfs_init(struct ath12k_base *ab)
 			    &fops_fse);
 }
 
-static ssize_t ath12k_dump_ce_stats_histogram(struct file *file,
-					      char __user *user_buf,
-					      size_t count, loff_t *ppos)
+static int ath12k_dump_ce_stats_hist(struct ath12k_base *ab, char *buf,
+				     int len, int size, const char *title,
+				     bool exec, bool last_update)
 {
-	struct ath12k_base *ab = file->private_data;
+	const struct ath12k_ce_stats_hist *hist;
 	struct ath12k_ce_pipe *pipe;
-	struct ath12k_ce_stats *stats;
-	char header[] = {"CENum\t0-0.5ms\t0.5-1ms\t1-2ms\t2-5ms\t5-10ms\t >10ms"};
-	char *print_buff;
-	int len = 0, size = 12288;
-	int i, retval;
-
-	print_buff = kzalloc(size, GFP_KERNEL);
-	if (!print_buff)
-		return -ENOMEM;
+	int i, j;
 
-	len += scnprintf(print_buff + len, size - len, "\n----- Tasklet Scheduled  Bucket -----\n");
-	len += scnprintf(print_buff + len, size - len, "%s\n", header);
+	len += scnprintf(buf + len, size - len, "\n----- %s -----\nCENum", title);
+	if (!last_update)
+		len += scnprintf(buf + len, size - len, "\tp50\tp90\tp99");
+	for (j = 0; j < CE_STATS_HIST_BUCKETS - 1; j++)
+		len += scnprintf(buf + len, size - len, "\t<%llu",
+				 ath12k_ce_stats_bucket_limit(j));
+	len += scnprintf(buf + len, size - len, "\t>=%llu\n",
+			 ath12k_ce_stats_bucket_limit(j));
 
 	for (i = 0; i < ab->hw_params->ce_count; i++) {
 		pipe = &ab->ce.ce_pipe[i];
-		stats = pipe->ce_stats;
-		if (!stats)
+		if (!pipe->ce_stats)
 			continue;
 
-		len += scnprintf(print_buff + len, size - len,
-				" CE%02d \t %04llu\t %04llu\t %04llu\t %04llu\t %04llu\t %04llu \t\n",
-				pipe->pipe_num, stats->sched_bucket[CE_BUCKET_500_US],
-				stats->sched_bucket[CE_BUCKET_1_MS],
-				stats->sched_bucket[CE_BUCKET_2_MS],
-				stats->sched_bucket[CE_BUCKET_5_MS],
-				stats->sched_bucket[CE_BUCKET_10_MS],
-				stats->sched_bucket[CE_BUCKET_BEYOND]
-				);
+		hist = exec ? &pipe->ce_stats->exec : &pipe->ce_stats->sched;
+		len += scnprintf(buf + len, size - len, " CE%02d", pipe->pipe_num);
+		if (!last_update)
+			len += scnprintf(buf + len, size - len,
+					 "\t%llu\t%llu\t%llu",
+					 ath12k_ce_stats_percentile(hist, 50),
+					 ath12k_ce_stats_percentile(hist, 90),
+					 ath12k_ce_stats_percentile(hist, 99));
+		for (j = 0; j < CE_STATS_HIST_BUCKETS; j++)
+			len += scnprintf(buf + len, size - len, "\t%llu",
+					 last_update ? hist->last_update[j] :
+						       hist->count[j]);
+		len += scnprintf(buf + len, size - len, "\n");
 	}
 
-	len += scnprintf(print_buff + len, size - len, "\n----- Tasklet Execution Bucket -----\n");
-	len += scnprintf(print_buff + len, size - len, "%s\n", header);
-
-	for (i = 0; i < ab->hw_params->ce_count; i++) {
-		pipe = &ab->ce.ce_pipe[i];
-		stats = pipe->ce_stats;
-		if (!stats)
-			continue;
-		len += scnprintf(print_buff + len, size - len,
-				" CE%02d \t %04llu\t %04llu\t %04llu\t %04llu\t %04llu\t %04llu \t\n",
-				pipe->pipe_num, stats->exec_bucket[CE_BUCKET_500_US],
-				stats->exec_bucket[CE_BUCKET_1_MS],
-				stats->exec_bucket[CE_BUCKET_2_MS],
-				stats->exec_bucket[CE_BUCKET_5_MS],
-				stats->exec_bucket[CE_BUCKET_10_MS],
-				stats->exec_bucket[CE_BUCKET_BEYOND]
-				);
-	}
-	len += scnprintf(print_buff + len, size - len, "\n----- Scheduled Last Updated -----\n");
-	len += scnprintf(print_buff + len, size - len, "%s\n", header);
+	return len;
+}
 
-	for (i = 0; i < ab->hw_params->ce_count; i++) {
-		pipe = &ab->ce.ce_pipe[i];
-		stats = pipe->ce_stats;
-		if (!stats)
-			continue;
-		len += scnprintf(print_buff + len, size - len,
-				" CE%02d \t %lluus\t %lluus\t %lluus\t %lluus\t %lluus\t %lluus \t\n",
-				pipe->pipe_num, stats->sched_last_update[CE_BUCKET_500_US],
-				stats->sched_last_update[CE_BUCKET_1_MS],
-				stats->sched_last_update[CE_BUCKET_2_MS],
-				stats->sched_last_update[CE_BUCKET_5_MS],
-				stats->sched_last_update[CE_BUCKET_10_MS],
-				stats->sched_last_update[CE_BUCKET_BEYOND]
-				);
-	}
+static ssize_t ath12k_dump_ce_stats_histogram(struct file *file,
+					      char __user *user_buf,
+					      size_t count, loff_t *ppos)
+{
+	struct ath12k_base *ab = file->private_data;
+	char *print_buff;
+	int len = 0, size = 32768;
+	int retval;
 
-	len += scnprintf(print_buff + len, size - len, "\n----- Execution Last Updated -----\n");
-	len += scnprintf(print_buff + len, size - len, "%s\n", header);
+	print_buff = kzalloc(size, GFP_KERNEL);
+	if (!print_buff)
+		return -ENOMEM;
 
-	for (i = 0; i < ab->hw_params->ce_count; i++) {
-		pipe = &ab->ce.ce_pipe[i];
-		stats = pipe->ce_stats;
-		if (!stats)
-			continue;
-		len += scnprintf(print_buff + len, size - len,
-				" CE%02d \t %lluus\t %lluus\t %lluus\t %lluus\t %lluus\t %lluus \t\n",
-				pipe->pipe_num, stats->exec_last_update[CE_BUCKET_500_US],
-				stats->exec_last_update[CE_BUCKET_1_MS],
-				stats->exec_last_update[CE_BUCKET_2_MS],
-				stats->exec_last_update[CE_BUCKET_5_MS],
-				stats->exec_last_update[CE_BUCKET_10_MS],
-				stats->exec_last_update[CE_BUCKET_BEYOND]
-				);
-	}
+	len += scnprintf(print_buff + len, size - len,
+			 "Latencies in us, percentiles are bucket upper bounds\n");
+	len = ath12k_dump_ce_stats_hist(ab, print_buff, len, size,
+					"Tasklet Scheduled Bucket", false, false);
+	len = ath12k_dump_ce_stats_hist(ab, print_buff, len, size,
+					"Tasklet Execution Bucket", true, false);
+	len = ath12k_dump_ce_stats_hist(ab, print_buff, len, size,
+					"Scheduled Last Updated (us)", false, true);
+	len = ath12k_dump_ce_stats_hist(ab, print_buff, len, size,
+					"Execution Last Updated (us)", true, true);
 
 	if (len > size)
 		len = size;
@@ -3443,6 +3428,27 @@ static ssize_t ath12k_write_ce_stats_enable(struct file *file,
 	return count;
 }
 
+static ssize_t ath12k_write_ce_stats_reset(struct file *file,
+					   const char __user *user_buf,
+					   size_t count, loff_t *ppos)
+{
+	struct ath12k_base *ab = file->private_data;
+	bool reset;
+
+	if (kstrtobool_from_user(user_buf, count, &reset))
+		return -EINVAL;
+
+	if (reset)
+		ath12k_ce_stats_reset(ab);
+
+	return count;
+}
+
+static const struct file_operations fops_ce_stats_reset = {
+	.open = simple_open,
+	.write = ath12k_write_ce_stats_reset,
+};
+
 static const struct file_operations fops_ce_stats_enable = {
 	.open = simple_open,
 	.write = ath12k_write_ce_stats_enable,
@@ -3470,6 +3476,9 @@ void ath12k_ce_stats_debugfs_init(struct ath12k_base *ab)
 
 	debugfs_create_file("enable_ce_stats", 0600, cestats_dir, ab,
 			    &fops_ce_stats_enable);
+
+	debugfs_create_file("reset_ce_stats", 0200, cestats_dir, ab,
+			    &fops_ce_stats_reset);
 }
 
 void ath12k_debugfs_pdev_destroy(struct ath12k_base *ab)
@@ -11616,6 +11616,75 @@ static int ath12k_dbg_htt_ext_stats_parse(struct ath12k_base *ab,
 	return 0;
 }
 
+static void ath12k_htt_stats_bin_append(struct debug_htt_stats_req *stats_req,
+					const u8 *data, u32 len)
+{
+	/* Only whole messages are copied so the exported stream never ends
+	 * in a partial TLV.
+	 */
+	if (len > ATH12K_HTT_STATS_BUF_SIZE - stats_req->buf_len) {
+		stats_req->truncated = true;
+		return;
+	}
+
+	memcpy(stats_req->buf + stats_req->buf_len, data, len);
+	stats_req->buf_len += len;
+}
+
+VISIBLE_IF_ATH12K_KUNIT
+void ath12k_htt_stats_bin_fill_hdr(struct debug_htt_stats_req *stats_req,
+				   bool timeout)
+{
+	struct ath12k_htt_stats_bin_hdr *hdr;
+	u32 flags = 0;
+
+	if (stats_req->truncated)
+		flags |= ATH12K_HTT_STATS_BIN_FLAG_TRUNCATED;
+	if (timeout)
+		flags |= ATH12K_HTT_STATS_BIN_FLAG_TIMEOUT;
+
+	hdr = (struct ath12k_htt_stats_bin_hdr *)stats_req->buf;
+	hdr->magic = cpu_to_le32(ATH12K_HTT_STATS_BIN_MAGIC);
+	hdr->version = cpu_to_le16(ATH12K_HTT_STATS_BIN_VERSION);
+	hdr->hdr_len = cpu_to_le16(sizeof(*hdr));
+	hdr->stats_type = cpu_to_le32(stats_req->type);
+	hdr->pdev_id = cpu_to_le32(stats_req->pdev_id);
+	hdr->flags = cpu_to_le32(flags);
+	hdr->tlv_len = cpu_to_le32(stats_req->buf_len - sizeof(*hdr));
+}
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_htt_stats_bin_fill_hdr);
+
+/* Called with ar->data_lock held. Returns true when the message completed
+ * the request. Once the request completed or timed out its buffer belongs
+ * to the reader, so late messages are dropped rather than appended past
+ * what the reader, and the binary header, already accounted for.
+ */
+VISIBLE_IF_ATH12K_KUNIT
+bool ath12k_htt_stats_msg_add(struct ath12k_base *ab,
+			      struct debug_htt_stats_req *stats_req,
+			      const void *data, u32 len, bool done)
+{
+	int ret;
+
+	if (stats_req->done)
+		return false;
+
+	if (stats_req->binary) {
+		ath12k_htt_stats_bin_append(stats_req, data, len);
+	} else {
+		ret = ath12k_dp_htt_tlv_iter(ab, data, len,
+					     ath12k_dbg_htt_ext_stats_parse,
+					     stats_req);
+		if (ret)
+			ath12k_warn(ab, "Failed to parse tlv %d\n", ret);
+	}
+
+	stats_req->done = done;
+
+	return done;
+}
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_htt_stats_msg_add);
+
 void ath12k_debugfs_htt_ext_stats_handler(struct ath12k_base *ab,
 					  struct sk_buff *skb)
 {
@@ -11623,9 +11692,8 @@ void ath12k_debugfs_htt_ext_stats_handler(struct ath12k_base *ab,
 	struct debug_htt_stats_req *stats_req;
 	struct ath12k *ar;
 	u32 len, pdev_id, stats_info;
+	bool send_completion, done;
 	u64 cookie;
-	int ret;
-	bool send_completion = false;
 
 	msg = (struct ath12k_htt_extd_stats_msg *)skb->data;
 	cookie = le64_to_cpu(msg->cookie);
@@ -11648,26 +11716,18 @@ void ath12k_debugfs_htt_ext_stats_handler(struct ath12k_base *ab,
 	if (!stats_req)
 		goto exit;
 
-	spin_lock_bh(&ar->data_lock);
-
 	stats_info = le32_to_cpu(msg->info1);
-	stats_req->done = u32_get_bits(stats_info, ATH12K_HTT_T2H_EXT_STATS_INFO1_DONE);
-	if (stats_req->done)
-		send_completion = true;
-
-	spin_unlock_bh(&ar->data_lock);
-
+	done = u32_get_bits(stats_info, ATH12K_HTT_T2H_EXT_STATS_INFO1_DONE);
 	len = u32_get_bits(stats_info, ATH12K_HTT_T2H_EXT_STATS_INFO1_LENGTH);
 	if (len > skb->len) {
 		ath12k_warn(ab, "invalid length %d for HTT stats", len);
 		goto exit;
 	}
 
-	ret = ath12k_dp_htt_tlv_iter(ab, msg->data, len,
-				     ath12k_dbg_htt_ext_stats_parse,
-				     stats_req);
-	if (ret)
-		ath12k_warn(ab, "Failed to parse tlv %d\n", ret);
+	spin_lock_bh(&ar->data_lock);
+	send_completion = ath12k_htt_stats_msg_add(ab, stats_req, msg->data,
+						   len, done);
+	spin_unlock_bh(&ar->data_lock);
 
 	if (send_completion)
 		complete(&stats_req->htt_stats_rcvd);
@@ -11792,8 +11852,8 @@ int ath12k_debugfs_htt_stats_req(struct ath12k *ar)
 	return 0;
 }
 
-static int ath12k_open_htt_stats(struct inode *inode,
-				 struct file *file)
+static int ath12k_open_htt_stats_common(struct inode *inode,
+					struct file *file, bool binary)
 {
 	struct ath12k *ar = inode->i_private;
 	struct debug_htt_stats_req *stats_req;
@@ -11836,9 +11896,20 @@ static int ath12k_open_htt_stats(struct inode *inode,
 					!!stats_req->cfg_param[2] ||
 					!!stats_req->cfg_param[3];
 
+	if (binary) {
+		stats_req->binary = true;
+		stats_req->buf_len = sizeof(struct ath12k_htt_stats_bin_hdr);
+	}
+
 	ret = ath12k_debugfs_htt_stats_req(ar);
-	if (ret < 0)
+	if (binary && ret == -ETIMEDOUT) {
+		/* Hand out whatever arrived, flagged as incomplete */
+		ath12k_htt_stats_bin_fill_hdr(stats_req, true);
+	} else if (ret < 0) {
 		goto out;
+	} else if (binary) {
+		ath12k_htt_stats_bin_fill_hdr(stats_req, false);
+	}
 
 	file->private_data = stats_req;
 
@@ -11854,6 +11925,18 @@ err_unlock:
 	return ret;
 }
 
+static int ath12k_open_htt_stats(struct inode *inode,
+				 struct file *file)
+{
+	return ath12k_open_htt_stats_common(inode, file, false);
+}
+
+static int ath12k_open_htt_stats_bin(struct inode *inode,
+				     struct file *file)
+{
+	return ath12k_open_htt_stats_common(inode, file, true);
+}
+
 static int ath12k_release_htt_stats(struct inode *inode,
 				    struct file *file)
 {
@@ -11888,6 +11971,14 @@ static const struct file_operations fops_dump_htt_stats = {
 	.llseek = default_llseek,
 };
 
+static const struct file_operations fops_dump_htt_stats_bin = {
+	.open = ath12k_open_htt_stats_bin,
+	.release = ath12k_release_htt_stats,
+	.read = ath12k_read_htt_stats,
+	.owner = THIS_MODULE,
+	.llseek = default_llseek,
+};
+
 static ssize_t ath12k_read_htt_stats_reset(struct file *file,
 					   char __user *user_buf,
 					   size_t count, loff_t *ppos)
@@ -11969,6 +12060,8 @@ void ath12k_debugfs_htt_stats_register(struct ath12k *ar)
 			    ar, &fops_htt_stats_type);
 	debugfs_create_file("htt_stats", 0400, ar->debug.debugfs_pdev,
 			    ar, &fops_dump_htt_stats);
+	debugfs_create_file("htt_stats_bin", 0400, ar->debug.debugfs_pdev,
+			    ar, &fops_dump_htt_stats_bin);
 	debugfs_create_file("htt_stats_reset", 0200, ar->debug.debugfs_pdev,
 			    ar, &fops_htt_stats_reset);
 }
@@ -703,9 +703,31 @@ enum ath12k_htt_stats_reset_cfg_param_alloc_pos {
 	ATH12K_HTT_STATS_RESET_PARAM_CFG_128_BYTES,
 };
 
+/* Binary HTT stats export: htt_stats_bin returns this header followed by
+ * the raw firmware TLVs (struct htt_tlv framed, little endian).
+ * Fields are only ever appended; readers must honour hdr_len.
+ */
+#define ATH12K_HTT_STATS_BIN_MAGIC		0x48545453 /* "HTTS" */
+#define ATH12K_HTT_STATS_BIN_VERSION		1
+#define ATH12K_HTT_STATS_BIN_FLAG_TRUNCATED	BIT(0)
+#define ATH12K_HTT_STATS_BIN_FLAG_TIMEOUT	BIT(1)
+
+struct ath12k_htt_stats_bin_hdr {
+	__le32 magic;
+	__le16 version;
+	__le16 hdr_len;
+	__le32 stats_type;
+	__le32 pdev_id;
+	__le32 flags;
+	__le32 tlv_len;
+} __packed;
+
 struct debug_htt_stats_req {
 	bool done;
 	bool override_cfg_param;
+	/* keep raw TLVs instead of formatting them as text */
+	bool binary;
+	bool truncated;
 	u8 pdev_id;
 	enum ath12k_dbg_htt_ext_stats_type type;
 	u32 cfg_param[4];
@@ -5398,5 +5420,13 @@ enum HTT_RX_TX_PDEV_STATS_WIFI_VERSION {
 	HTT_WIFI_VER_11BE = 7,
 	HTT_WIFI_VER_11BN = 8,
 };
+
+#if IS_ENABLED(CPTCFG_ATH12K_KUNIT_TEST)
+void ath12k_htt_stats_bin_fill_hdr(struct debug_htt_stats_req *stats_req,
+				   bool timeout);
+bool ath12k_htt_stats_msg_add(struct ath12k_base *ab,
+			      struct debug_htt_stats_req *stats_req,
+			      const void *data, u32 len, bool done);
+#endif
 #endif
 
@@ -1297,15 +1297,7 @@ void ath12k_dp_cc_cleanup(struct ath12k_base *ab)
 					continue;
 
 				tx_desc_info[k].skb = NULL;
-
-				if (tx_desc_info[k].skb_ext_desc) {
-					ath12k_core_dma_unmap_single(ab->dev,
-								     tx_desc_info[k].paddr_ext_desc,
-								     tx_desc_info[k].skb_ext_desc->len,
-								     DMA_TO_DEVICE);
-					dev_kfree_skb_any(tx_desc_info[k].skb_ext_desc);
-					tx_desc_info[k].skb_ext_desc = NULL;
-				}
+				ath12k_dp_tx_ext_desc_put_nolock(dp, &tx_desc_info[k], i);
 
 				/* if we are unregistering, hw would've been destroyed and
 				 * ar is no longer valid.
@@ -1343,6 +1335,8 @@ void ath12k_dp_cc_cleanup(struct ath12k_base *ab)
 		spin_unlock_bh(&dp->tx_desc_lock[pool_id]);
 	}
 
+	ath12k_dp_tx_ext_desc_pool_free(ab);
+
 	/* unmap SPT pages */
 	for (i = 0; i < dp->num_spt_pages; i++) {
 		if (!dp->spt_info[i].vaddr)
@@ -1690,6 +1684,7 @@ static int ath12k_dp_cc_desc_init(struct ath12k_base *ab)
 			for (j = 0; j < ATH12K_MAX_SPT_ENTRIES; j++) {
 				tx_descs[j].desc_id = ath12k_dp_cc_cookie_gen(ppt_idx, j);
 				tx_descs[j].pool_id = pool_id;
+				tx_descs[j].ext_desc_id = ATH12K_TX_EXT_DESC_ID_INVALID;
 				list_add_tail(&tx_descs[j].list,
 					      &dp->tx_desc_free_list[pool_id]);
 
@@ -1817,6 +1812,12 @@ int ath12k_dp_cc_init(struct ath12k_base *ab)
 		goto free;
 	}
 
+	ret = ath12k_dp_tx_ext_desc_pool_alloc(ab);
+	if (ret) {
+		ath12k_warn(ab, "tx ext desc pool alloc failed %d", ret);
+		goto free;
+	}
+
 	return 0;
 free:
 	ath12k_dp_cc_cleanup(ab);
@@ -1923,6 +1924,8 @@ static int ath12k_dp_setup(struct ath12k_base *ab)
 
 	spin_lock_init(&dp->dp_lock);
 	INIT_LIST_HEAD(&dp->peers);
+	hash_init(dp->peers_by_addr);
+	hash_init(dp->peers_by_ast);
 	INIT_LIST_HEAD(&dp->neighbor_peers);
 	mutex_init(&dp->tbl_mtx_lock);
 	ath12k_dp_link_peer_rhash_tbl_init(dp);
@@ -2110,15 +2113,7 @@ void ath12k_dp_umac_txrx_desc_cleanup(struct ath12k_base *ab)
 					continue;
 
 				tx_desc_info[k].skb = NULL;
-
-				if (tx_desc_info[k].skb_ext_desc) {
-					ath12k_core_dma_unmap_single(ab->dev,
-								     tx_desc_info[k].paddr_ext_desc,
-								     tx_desc_info[k].skb_ext_desc->len,
-								     DMA_TO_DEVICE);
-					dev_kfree_skb_any(tx_desc_info[k].skb_ext_desc);
-					tx_desc_info[k].skb_ext_desc = NULL;
-				}
+				ath12k_dp_tx_ext_desc_put_nolock(dp, &tx_desc_info[k], i);
 
 				ath12k_core_dma_unmap_single(ab->dev, tx_desc_info[k].paddr,
 							     tx_desc_info[k].len, DMA_TO_DEVICE);
@@ -14,6 +14,7 @@
 #include "hal.h"
 #include "ppe.h"
 #include <linux/rhashtable.h>
+#include <linux/hashtable.h>
 #include "dp_stats.h"
 
 #define HTT_TCL_META_DATA_PEER_ID_MISSION       GENMASK(15, 3)
@@ -229,6 +230,15 @@ enum ath12k_dp_eapol_key_type {
 #define ATH12K_NUM_EAPOL_RESERVE       1024
 #define ATH12K_DP_PDEV_TX_LIMIT        ATH12K_NUM_POOL_TX_DESC
 
+/* MSDU extension descriptors are only needed on the slow tx paths (sw
+ * crypto, raw/ethernet encap overrides), so each tx desc pool gets a much
+ * smaller preallocated pool of them. A slot holds the hal_tx_msdu_ext_desc
+ * and the optional HTT metadata that follows it.
+ */
+#define ATH12K_TX_EXT_DESC_PER_POOL	1024
+#define ATH12K_TX_EXT_DESC_SIZE		128
+#define ATH12K_TX_EXT_DESC_ID_INVALID	U16_MAX
+
 #define DP_WBM_RELEASE_RING_SIZE	64
 #define DP_TCL_DATA_RING_SIZE		2048
 #define DP_TX_IDR_SIZE			DP_TX_COMP_RING_SIZE
@@ -322,6 +332,8 @@ enum ath12k_dp_eapol_key_type {
 #define DP_MAX_PEER_ID		2047
 #define ATH12K_PEER_ID_INVALID	0x3FFF
 
+#define ATH12K_DP_PEER_HASH_BITS	8
+
 #define DP_TCL_ENCAP_TYPE_MAX	4
 
 /* Total size of the LUT is based on 2K peers, each having reference
@@ -377,12 +389,11 @@ struct ath12k_rx_desc_info {
 struct ath12k_tx_desc_info {
 	struct list_head list;
 	struct sk_buff *skb;
-	struct sk_buff *skb_ext_desc;
 	dma_addr_t paddr;
-	dma_addr_t paddr_ext_desc;
 	u32 desc_id; /* Cookie */
 	u16 len;
-	u16 ext_desc_len;
+	/* slot in the pool's tx_ext_desc_pool or ATH12K_TX_EXT_DESC_ID_INVALID */
+	u16 ext_desc_id;
 	u8 mac_id	: 5,
 	   in_use	: 1,
 	   reserved	: 2;
@@ -391,6 +402,15 @@ struct ath12k_tx_desc_info {
 	u8 pool_id;
 };
 
+struct ath12k_tx_ext_desc_pool {
+	/* DMA coherent, ATH12K_TX_EXT_DESC_PER_POOL slots */
+	void *vaddr;
+	dma_addr_t paddr;
+	/* stack of free slot ids */
+	u16 free_ids[ATH12K_TX_EXT_DESC_PER_POOL];
+	u16 num_free;
+};
+
 #ifdef CPTCFG_ATH12K_PPE_DS_SUPPORT
 struct ath12k_ppeds_tx_desc_info {
 	union {
@@ -532,6 +552,8 @@ struct ath12k_device_dp_tx_err_stats {
 	u32 desc_na[DP_TCL_NUM_RING_MAX];
 	/* TCL Ring Buffers unavailable */
 	u32 txbuf_na[DP_TCL_NUM_RING_MAX];
+	/* MSDU extension descriptor pool exhausted */
+	u32 ext_desc_na[DP_TCL_NUM_RING_MAX];
 
 	u32 threshold_limit;
 
@@ -645,13 +667,21 @@ struct ath12k_dp {
 	struct dp_tx_ring tx_ring[DP_TCL_NUM_RING_MAX];
 	struct ath12k_device_dp_stats device_stats;
 	struct wbm_idle_scatter_list scatter_list[DP_IDLE_SCATTER_BUFS_MAX];
+	/* Pending REO commands, indexed by cmd_num - 1. Commands issued while
+	 * their slot is still pending (lost status) go to reo_cmd_list.
+	 */
+	struct ath12k_dp_rx_reo_cmd *reo_cmd_pool;
 	struct list_head reo_cmd_list;
-	struct list_head reo_cmd_cache_flush_list;
+	/* FIFO of REO descriptors waiting for a cache flush */
+	struct ath12k_dp_rx_reo_cache_flush_elem *reo_cmd_cache_flush_ring;
+	u32 reo_cmd_cache_flush_head;
 	u32 reo_cmd_cache_flush_count;
 
 	/* protects access to below fields,
+	 * - reo_cmd_pool
 	 * - reo_cmd_list
-	 * - reo_cmd_cache_flush_list
+	 * - reo_cmd_cache_flush_ring
+	 * - reo_cmd_cache_flush_head
 	 * - reo_cmd_cache_flush_count
 	 */
 	spinlock_t reo_cmd_lock;
@@ -674,8 +704,9 @@ struct ath12k_dp {
 	spinlock_t rx_desc_lock;
 
 	struct list_head tx_desc_free_list[ATH12K_HW_MAX_QUEUES];
-	/* protects the free and used desc lists */
+	/* protects the free and used desc lists and the ext desc pools */
 	spinlock_t tx_desc_lock[ATH12K_HW_MAX_QUEUES];
+	struct ath12k_tx_ext_desc_pool tx_ext_desc_pool[ATH12K_HW_MAX_QUEUES];
 
 	struct dp_rxdma_ring rx_refill_buf_ring;
 	struct dp_srng rx_mac_buf_ring[MAX_RXDMA_PER_PDEV];
@@ -703,6 +734,14 @@ struct ath12k_dp {
 	/* Linked list of struct ath12k_dp_link_peer */
 	struct list_head peers;
 
+	/* Lookup indexes over peers, protected by dp_lock. Peer id and ML peer
+	 * id are direct-indexed, (vdev_id/pdev_idx, addr) and AST are hashed.
+	 */
+	struct hlist_head peers_by_id[DP_MAX_PEER_ID + 1];
+	struct hlist_head peers_by_ml_id[DP_MAX_PEER_ID + 1];
+	DECLARE_HASHTABLE(peers_by_addr, ATH12K_DP_PEER_HASH_BITS);
+	DECLARE_HASHTABLE(peers_by_ast, ATH12K_DP_PEER_HASH_BITS);
+
 	/* To synchronize rhash tbl write operation */
 	struct mutex tbl_mtx_lock;
 
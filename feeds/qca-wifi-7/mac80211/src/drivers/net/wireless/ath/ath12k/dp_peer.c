@@ -9,6 +9,100 @@
 #include "debug.h"
 #include "debugfs.h"
 #include "telemetry_agent_if.h"
+#include <linux/jhash.h>
+
+static inline u32 ath12k_dp_link_peer_addr_hash(const u8 *addr)
+{
+	return jhash(addr, ETH_ALEN, 0);
+}
+
+static struct hlist_head *
+ath12k_dp_link_peer_id_head(struct ath12k_dp *dp, int peer_id)
+{
+	if (peer_id < 0 || peer_id > DP_MAX_PEER_ID)
+		return NULL;
+
+	return &dp->peers_by_id[peer_id];
+}
+
+static struct hlist_head *
+ath12k_dp_link_peer_ml_id_head(struct ath12k_dp *dp, int ml_peer_id)
+{
+	BUILD_BUG_ON(ATH12K_MAX_MLO_PEERS > ARRAY_SIZE(dp->peers_by_ml_id));
+
+	if (ml_peer_id == ATH12K_MLO_PEER_ID_INVALID ||
+	    !(ml_peer_id & ATH12K_PEER_ML_ID_VALID))
+		return NULL;
+
+	ml_peer_id &= ~ATH12K_PEER_ML_ID_VALID;
+	if (ml_peer_id < 0 || ml_peer_id > DP_MAX_PEER_ID)
+		return NULL;
+
+	return &dp->peers_by_ml_id[ml_peer_id];
+}
+
+VISIBLE_IF_ATH12K_KUNIT
+void ath12k_dp_link_peer_index(struct ath12k_dp *dp,
+			       struct ath12k_dp_link_peer *peer)
+{
+	struct hlist_head *head;
+
+	lockdep_assert_held(&dp->dp_lock);
+
+	/* ids outside of the tables are still found through dp->peers */
+	head = ath12k_dp_link_peer_id_head(dp, peer->peer_id);
+	if (head)
+		hlist_add_head(&peer->id_node, head);
+
+	head = ath12k_dp_link_peer_ml_id_head(dp, peer->ml_id);
+	if (head)
+		hlist_add_head(&peer->ml_id_node, head);
+
+	hash_add(dp->peers_by_addr, &peer->addr_node,
+		 ath12k_dp_link_peer_addr_hash(peer->addr));
+	hash_add(dp->peers_by_ast, &peer->ast_node, peer->ast_hash);
+}
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_dp_link_peer_index);
+
+/* Must be called under dp_lock before the peer leaves dp->peers, calling it
+ * again for an already unindexed peer is harmless.
+ */
+void ath12k_dp_link_peer_unindex(struct ath12k_dp_link_peer *peer)
+{
+	hlist_del_init(&peer->id_node);
+	hlist_del_init(&peer->ml_id_node);
+	hash_del(&peer->addr_node);
+	hash_del(&peer->ast_node);
+}
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_dp_link_peer_unindex);
+
+void ath12k_dp_link_peer_set_ml_id(struct ath12k_dp *dp,
+				   struct ath12k_dp_link_peer *peer, u16 ml_id)
+{
+	struct hlist_head *head;
+
+	lockdep_assert_held(&dp->dp_lock);
+
+	hlist_del_init(&peer->ml_id_node);
+	peer->ml_id = ml_id;
+
+	head = ath12k_dp_link_peer_ml_id_head(dp, ml_id);
+	if (head)
+		hlist_add_head(&peer->ml_id_node, head);
+}
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_dp_link_peer_set_ml_id);
+
+void ath12k_dp_link_peer_set_ast_hash(struct ath12k_dp *dp,
+				      struct ath12k_dp_link_peer *peer,
+				      u16 ast_hash)
+{
+	lockdep_assert_held(&dp->dp_lock);
+
+	hash_del(&peer->ast_node);
+	peer->ast_hash = ast_hash;
+	hash_add(dp->peers_by_ast, &peer->ast_node, ast_hash);
+}
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_dp_link_peer_set_ast_hash);
 
 struct ath12k_dp_link_peer *
 ath12k_dp_link_peer_find_by_vdev_id_and_addr(struct ath12k_dp *dp,
@@ -18,7 +112,8 @@ ath12k_dp_link_peer_find_by_vdev_id_and_addr(struct ath12k_dp *dp,
 
 	lockdep_assert_held(&dp->dp_lock);
 
-	list_for_each_entry(peer, &dp->peers, list) {
+	hash_for_each_possible(dp->peers_by_addr, peer, addr_node,
+			       ath12k_dp_link_peer_addr_hash(addr)) {
 		if (peer->vdev_id != vdev_id)
 			continue;
 		if (!ether_addr_equal(peer->addr, addr))
@@ -29,6 +124,7 @@ ath12k_dp_link_peer_find_by_vdev_id_and_addr(struct ath12k_dp *dp,
 
 	return NULL;
 }
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_dp_link_peer_find_by_vdev_id_and_addr);
 
 struct ath12k_dp_link_peer *
 ath12k_dp_link_peer_find_by_pdev_idx(struct ath12k_dp *dp, u8 pdev_idx,
@@ -38,7 +134,8 @@ ath12k_dp_link_peer_find_by_pdev_idx(struct ath12k_dp *dp, u8 pdev_idx,
 
 	lockdep_assert_held(&dp->dp_lock);
 
-	list_for_each_entry(peer, &dp->peers, list) {
+	hash_for_each_possible(dp->peers_by_addr, peer, addr_node,
+			       ath12k_dp_link_peer_addr_hash(addr)) {
 		if (peer->pdev_idx != pdev_idx)
 			continue;
 		if (!ether_addr_equal(peer->addr, addr))
@@ -49,6 +146,7 @@ ath12k_dp_link_peer_find_by_pdev_idx(struct ath12k_dp *dp, u8 pdev_idx,
 
 	return NULL;
 }
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_dp_link_peer_find_by_pdev_idx);
 
 struct ath12k_dp_link_peer *
 ath12k_dp_link_peer_find_by_addr(struct ath12k_dp *dp, const u8 *addr)
@@ -64,23 +162,44 @@ ath12k_dp_link_peer_find_by_addr(struct ath12k_dp *dp, const u8 *addr)
 EXPORT_SYMBOL(ath12k_dp_link_peer_find_by_addr);
 
 static struct ath12k_dp_link_peer *
-ath12k_dp_link_peer_find_by_ml_id(struct ath12k_dp *dp, int ml_peer_id)
+ath12k_dp_link_peer_find_by_ml_vdev_id(struct ath12k_dp *dp,
+				       int ml_peer_id,
+				       int vdev_id)
 {
 	struct ath12k_dp_link_peer *peer;
+	struct hlist_head *head;
 
 	lockdep_assert_held(&dp->dp_lock);
 
-	list_for_each_entry(peer, &dp->peers, list)
-		if (ml_peer_id == peer->ml_id)
+	head = ath12k_dp_link_peer_ml_id_head(dp, ml_peer_id);
+	if (unlikely(!head)) {
+		list_for_each_entry(peer, &dp->peers, list)
+			if (ml_peer_id == peer->ml_id &&
+			    (vdev_id < 0 || vdev_id == peer->vdev_id))
+				return peer;
+
+		return NULL;
+	}
+
+	hlist_for_each_entry(peer, head, ml_id_node)
+		if (ml_peer_id == peer->ml_id &&
+		    (vdev_id < 0 || vdev_id == peer->vdev_id))
 			return peer;
 
 	return NULL;
 }
 
+static struct ath12k_dp_link_peer *
+ath12k_dp_link_peer_find_by_ml_id(struct ath12k_dp *dp, int ml_peer_id)
+{
+	return ath12k_dp_link_peer_find_by_ml_vdev_id(dp, ml_peer_id, -1);
+}
+
 struct ath12k_dp_link_peer *
 ath12k_dp_link_peer_find_by_id(struct ath12k_dp *dp, int peer_id)
 {
 	struct ath12k_dp_link_peer *peer;
+	struct hlist_head *head;
 
 	lockdep_assert_held(&dp->dp_lock);
 
@@ -90,39 +209,28 @@ ath12k_dp_link_peer_find_by_id(struct ath12k_dp *dp, int peer_id)
 	if (peer_id & ATH12K_PEER_ML_ID_VALID)
 		return ath12k_dp_link_peer_find_by_ml_id(dp, peer_id);
 
-	list_for_each_entry(peer, &dp->peers, list)
-		if (peer_id == peer->peer_id)
-			return peer;
+	head = ath12k_dp_link_peer_id_head(dp, peer_id);
+	if (unlikely(!head)) {
+		list_for_each_entry(peer, &dp->peers, list)
+			if (peer_id == peer->peer_id)
+				return peer;
 
-	return NULL;
-}
-EXPORT_SYMBOL(ath12k_dp_link_peer_find_by_id);
-
-/* ToDO: Need to see it it can be optimized */
-static struct ath12k_dp_link_peer *
-ath12k_dp_link_peer_find_by_ml_vdev_id(struct ath12k_dp *dp,
-				       int ml_peer_id,
-				       int vdev_id)
-{
-	struct ath12k_dp_link_peer *peer;
-
-	lockdep_assert_held(&dp->dp_lock);
+		return NULL;
+	}
 
-	list_for_each_entry(peer, &dp->peers, list)
-		if (ml_peer_id == peer->ml_id &&
-		    vdev_id == peer->vdev_id)
+	hlist_for_each_entry(peer, head, id_node)
+		if (peer_id == peer->peer_id)
 			return peer;
 
 	return NULL;
 }
+EXPORT_SYMBOL(ath12k_dp_link_peer_find_by_id);
 
 struct ath12k_dp_link_peer *
 ath12k_dp_link_peer_find_by_ml_peer_vdev_id(struct ath12k_dp *dp,
 					    int peer_id,
 					    int vdev_id)
 {
-	struct ath12k_dp_link_peer *peer;
-
 	lockdep_assert_held(&dp->dp_lock);
 
 	if (peer_id == ATH12K_PEER_ID_INVALID)
@@ -133,11 +241,7 @@ ath12k_dp_link_peer_find_by_ml_peer_vdev_id(struct ath12k_dp *dp,
 							      peer_id,
 							      vdev_id);
 
-	list_for_each_entry(peer, &dp->peers, list)
-		if (peer_id == peer->peer_id)
-			return peer;
-
-	return NULL;
+	return ath12k_dp_link_peer_find_by_id(dp, peer_id);
 }
 EXPORT_SYMBOL(ath12k_dp_link_peer_find_by_ml_peer_vdev_id);
 
@@ -149,12 +253,13 @@ ath12k_dp_link_peer_find_by_ast(struct ath12k_dp *dp,
 
 	lockdep_assert_held(&dp->dp_lock);
 
-	list_for_each_entry(peer, &dp->peers, list)
+	hash_for_each_possible(dp->peers_by_ast, peer, ast_node, ast_hash)
 		if (ast_hash == peer->ast_hash)
 			return peer;
 
 	return NULL;
 }
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_dp_link_peer_find_by_ast);
 
 bool ath12k_dp_link_peer_exist_by_vdev_id(struct ath12k_dp *dp, int vdev_id)
 {
@@ -177,6 +282,7 @@ void ath12k_link_peer_free(struct ath12k_dp_link_peer *peer)
 	if (!peer)
 		return;
 
+	ath12k_dp_link_peer_unindex(peer);
 	list_del(&peer->list);
 
 	kfree(peer->peer_stats.rx_stats);
@@ -229,6 +335,7 @@ void ath12k_peer_map_event(struct ath12k_base *ab, u8 vdev_id, u16 peer_id,
 		peer->hw_peer_id = hw_peer_id;
 		ether_addr_copy(peer->addr, mac_addr);
 		list_add(&peer->list, &dp->peers);
+		ath12k_dp_link_peer_index(dp, peer);
 		wake_up(&ab->peer_mapping_wq);
 		ewma_avg_rssi_init(&peer->avg_rssi);
 	}
@@ -275,7 +382,7 @@ void ath12k_peer_mlo_map_event(struct ath12k_base *ab, struct sk_buff *skb)
 	ath12k_dp_get_mac_addr(msg->mac_addr.mac_addr_l32, mld_mac_h16, mld_addr);
 
 	peer->hw_peer_id = ast_idx;
-	peer->ast_hash = cache_num;
+	ath12k_dp_link_peer_set_ast_hash(dp, peer, cache_num);
 
 	WARN_ON(memcmp(mld_addr, peer->ml_addr, ETH_ALEN));
 
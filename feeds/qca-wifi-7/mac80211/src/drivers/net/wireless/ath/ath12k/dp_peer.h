@@ -118,6 +118,12 @@ struct ath12k_dp_link_peer {
 	struct rhash_head rhash_addr;
 	bool rhash_done;
 
+	/* ath12k_dp lookup index nodes, protected by dp_lock */
+	struct hlist_node id_node;
+	struct hlist_node ml_id_node;
+	struct hlist_node addr_node;
+	struct hlist_node ast_node;
+
 	bool is_bridge_peer;
 	u8 hw_link_id;
 
@@ -335,4 +341,15 @@ u16 dp_peer_msduq_qos_id(struct ath12k_base *ab,
 void ath12k_peer_qos_queue_ind_handler(struct ath12k_base *ab,
 				       struct sk_buff *skb);
 void ath12k_link_peer_free(struct ath12k_dp_link_peer *peer);
+void ath12k_dp_link_peer_unindex(struct ath12k_dp_link_peer *peer);
+void ath12k_dp_link_peer_set_ml_id(struct ath12k_dp *dp,
+				   struct ath12k_dp_link_peer *peer, u16 ml_id);
+void ath12k_dp_link_peer_set_ast_hash(struct ath12k_dp *dp,
+				      struct ath12k_dp_link_peer *peer,
+				      u16 ast_hash);
+
+#if IS_ENABLED(CPTCFG_ATH12K_KUNIT_TEST)
+void ath12k_dp_link_peer_index(struct ath12k_dp *dp,
+			       struct ath12k_dp_link_peer *peer);
+#endif
 #endif
@@ -597,13 +597,65 @@ err_reo_cleanup:
 }
 EXPORT_SYMBOL(ath12k_dp_rx_reo_setup);
 
+/* Queue a deleted REO descriptor for its cache flush. Returns false when the
+ * FIFO is full, the caller then frees the descriptor right away.
+ */
+bool ath12k_dp_rx_reo_cache_flush_enqueue(struct ath12k_dp *dp,
+					  struct ath12k_dp_rx_tid *rx_tid)
+{
+	struct ath12k_dp_rx_reo_cache_flush_elem *elem;
+	u32 tail;
+
+	lockdep_assert_held(&dp->reo_cmd_lock);
+
+	if (dp->reo_cmd_cache_flush_count == ATH12K_DP_RX_REO_CACHE_FLUSH_RING_SIZE)
+		return false;
+
+	tail = (dp->reo_cmd_cache_flush_head + dp->reo_cmd_cache_flush_count) %
+	       ATH12K_DP_RX_REO_CACHE_FLUSH_RING_SIZE;
+	elem = &dp->reo_cmd_cache_flush_ring[tail];
+	elem->ts = jiffies;
+	memcpy(&elem->data, rx_tid, sizeof(*rx_tid));
+	dp->reo_cmd_cache_flush_count++;
+
+	return true;
+}
+EXPORT_SYMBOL(ath12k_dp_rx_reo_cache_flush_enqueue);
+
+/* The oldest queued descriptor, it stays valid until the next enqueue */
+struct ath12k_dp_rx_reo_cache_flush_elem *
+ath12k_dp_rx_reo_cache_flush_peek(struct ath12k_dp *dp)
+{
+	lockdep_assert_held(&dp->reo_cmd_lock);
+
+	if (!dp->reo_cmd_cache_flush_count)
+		return NULL;
+
+	return &dp->reo_cmd_cache_flush_ring[dp->reo_cmd_cache_flush_head];
+}
+EXPORT_SYMBOL(ath12k_dp_rx_reo_cache_flush_peek);
+
+void ath12k_dp_rx_reo_cache_flush_pop(struct ath12k_dp *dp)
+{
+	lockdep_assert_held(&dp->reo_cmd_lock);
+
+	if (WARN_ON_ONCE(!dp->reo_cmd_cache_flush_count))
+		return;
+
+	dp->reo_cmd_cache_flush_head = (dp->reo_cmd_cache_flush_head + 1) %
+				       ATH12K_DP_RX_REO_CACHE_FLUSH_RING_SIZE;
+	dp->reo_cmd_cache_flush_count--;
+}
+EXPORT_SYMBOL(ath12k_dp_rx_reo_cache_flush_pop);
+
 void ath12k_dp_rx_reo_cmd_list_cleanup(struct ath12k_base *ab)
 {
 	struct ath12k_dp *dp = ath12k_ab_to_dp(ab);
 	struct ath12k_dp_rx_reo_cmd *cmd, *tmp;
-	struct ath12k_dp_rx_reo_cache_flush_elem *cmd_cache, *tmp_cache;
+	struct ath12k_dp_rx_reo_cache_flush_elem *cmd_cache;
 	struct ath12k_dp_rx_tid *rx_tid;
 	struct dp_reo_update_rx_queue_elem *cmd_queue, *tmp_queue;
+	int i;
 
 	spin_lock_bh(&dp->reo_cmd_update_rx_queue_lock);
 	list_for_each_entry_safe(cmd_queue, tmp_queue, &dp->reo_cmd_update_rx_queue_list,
@@ -622,16 +674,23 @@ void ath12k_dp_rx_reo_cmd_list_cleanup(struct ath12k_base *ab)
 	spin_unlock_bh(&dp->reo_cmd_update_rx_queue_lock);
 
 	spin_lock_bh(&dp->reo_cmd_lock);
+	for (i = 0; dp->reo_cmd_pool && i < DP_REO_CMD_RING_SIZE; i++) {
+		cmd = &dp->reo_cmd_pool[i];
+		if (!cmd->handler)
+			continue;
+
+		cmd->handler(dp, &cmd->data, HAL_REO_CMD_DRAIN);
+		cmd->handler = NULL;
+	}
+
 	list_for_each_entry_safe(cmd, tmp, &dp->reo_cmd_list, list) {
 		list_del(&cmd->list);
 		cmd->handler(dp, &cmd->data, HAL_REO_CMD_DRAIN);
 		kfree(cmd);
 	}
 
-	list_for_each_entry_safe(cmd_cache, tmp_cache,
-				 &dp->reo_cmd_cache_flush_list, list) {
-		list_del(&cmd_cache->list);
-		dp->reo_cmd_cache_flush_count--;
+	while ((cmd_cache = ath12k_dp_rx_reo_cache_flush_peek(dp))) {
+		ath12k_dp_rx_reo_cache_flush_pop(dp);
 		rx_tid = &cmd_cache->data;
 		if (rx_tid->vaddr) {
 			rx_tid->active = false;
@@ -640,12 +699,130 @@ void ath12k_dp_rx_reo_cmd_list_cleanup(struct ath12k_base *ab)
 			kfree(rx_tid->vaddr);
 			rx_tid->vaddr = NULL;
 		}
-		kfree(cmd_cache);
 	}
 	spin_unlock_bh(&dp->reo_cmd_lock);
 }
 EXPORT_SYMBOL(ath12k_dp_rx_reo_cmd_list_cleanup);
 
+int ath12k_dp_rx_reo_cmd_pool_alloc(struct ath12k_dp *dp)
+{
+	dp->reo_cmd_pool = kcalloc(DP_REO_CMD_RING_SIZE,
+				   sizeof(*dp->reo_cmd_pool), GFP_KERNEL);
+	if (!dp->reo_cmd_pool)
+		return -ENOMEM;
+
+	dp->reo_cmd_cache_flush_ring =
+		kcalloc(ATH12K_DP_RX_REO_CACHE_FLUSH_RING_SIZE,
+			sizeof(*dp->reo_cmd_cache_flush_ring), GFP_KERNEL);
+	if (!dp->reo_cmd_cache_flush_ring) {
+		kfree(dp->reo_cmd_pool);
+		dp->reo_cmd_pool = NULL;
+		return -ENOMEM;
+	}
+
+	dp->reo_cmd_cache_flush_head = 0;
+	dp->reo_cmd_cache_flush_count = 0;
+
+	return 0;
+}
+EXPORT_SYMBOL(ath12k_dp_rx_reo_cmd_pool_alloc);
+
+void ath12k_dp_rx_reo_cmd_pool_free(struct ath12k_dp *dp)
+{
+	kfree(dp->reo_cmd_cache_flush_ring);
+	dp->reo_cmd_cache_flush_ring = NULL;
+	kfree(dp->reo_cmd_pool);
+	dp->reo_cmd_pool = NULL;
+}
+EXPORT_SYMBOL(ath12k_dp_rx_reo_cmd_pool_free);
+
+/* Remember a REO command that expects a status. REO command ring entries
+ * carry fixed command numbers from 1 to the ring size, so the command is kept
+ * in the pool slot of its number. A slot still pending means a status got
+ * lost; the new command then waits behind it on reo_cmd_list.
+ */
+int ath12k_dp_rx_reo_cmd_track(struct ath12k_dp *dp, int cmd_num,
+			       struct ath12k_dp_rx_tid *rx_tid,
+			       void (*cb)(struct ath12k_dp *dp, void *ctx,
+					  enum hal_reo_cmd_status status))
+{
+	struct ath12k_dp_rx_reo_cmd *dp_cmd, *new_cmd = NULL;
+
+	if (WARN_ON_ONCE(cmd_num < 1 || cmd_num > DP_REO_CMD_RING_SIZE))
+		return -EINVAL;
+
+	spin_lock_bh(&dp->reo_cmd_lock);
+	dp_cmd = &dp->reo_cmd_pool[cmd_num - 1];
+	if (unlikely(dp_cmd->handler)) {
+		spin_unlock_bh(&dp->reo_cmd_lock);
+
+		new_cmd = kzalloc(sizeof(*new_cmd), GFP_ATOMIC);
+		if (!new_cmd)
+			return -ENOMEM;
+
+		spin_lock_bh(&dp->reo_cmd_lock);
+		if (dp_cmd->handler) {
+			list_add_tail(&new_cmd->list, &dp->reo_cmd_list);
+			dp_cmd = new_cmd;
+			new_cmd = NULL;
+		}
+	}
+
+	memcpy(&dp_cmd->data, rx_tid, sizeof(*rx_tid));
+	dp_cmd->cmd_num = cmd_num;
+	dp_cmd->handler = cb;
+	spin_unlock_bh(&dp->reo_cmd_lock);
+
+	kfree(new_cmd);
+
+	return 0;
+}
+EXPORT_SYMBOL(ath12k_dp_rx_reo_cmd_track);
+
+/* Take the oldest pending command for cmd_num out of the pool, copying it to
+ * cmd so the handler can run without reo_cmd_lock while the slot is reused.
+ */
+bool ath12k_dp_rx_reo_cmd_complete(struct ath12k_dp *dp, int cmd_num,
+				   struct ath12k_dp_rx_reo_cmd *cmd)
+{
+	struct ath12k_dp_rx_reo_cmd *slot, *next;
+	bool found = false;
+
+	if (cmd_num < 1 || cmd_num > DP_REO_CMD_RING_SIZE)
+		return false;
+
+	spin_lock_bh(&dp->reo_cmd_lock);
+	slot = &dp->reo_cmd_pool[cmd_num - 1];
+	if (!slot->handler)
+		goto unlock;
+
+	memcpy(cmd, slot, sizeof(*cmd));
+	slot->handler = NULL;
+	found = true;
+
+	if (likely(list_empty(&dp->reo_cmd_list)))
+		goto unlock;
+
+	/* move the next waiting command with this number into the slot */
+	list_for_each_entry(next, &dp->reo_cmd_list, list) {
+		if (next->cmd_num != cmd_num)
+			continue;
+
+		list_del(&next->list);
+		memcpy(&slot->data, &next->data, sizeof(next->data));
+		slot->cmd_num = next->cmd_num;
+		slot->handler = next->handler;
+		kfree(next);
+		break;
+	}
+
+unlock:
+	spin_unlock_bh(&dp->reo_cmd_lock);
+
+	return found;
+}
+EXPORT_SYMBOL(ath12k_dp_rx_reo_cmd_complete);
+
 void ath12k_dp_reo_cmd_free(struct ath12k_dp *dp, void *ctx,
 			    enum hal_reo_cmd_status status)
 {
@@ -676,6 +853,8 @@ void ath12k_dp_rx_frags_cleanup(struct ath12k_dp_rx_tid *rx_tid,
 	struct ath12k_buffer_addr *buf_addr_info;
 	struct ath12k_dp *dp = rx_tid->dp;
 	enum hal_wbm_rel_bm_act bm_act;
+	unsigned long frags;
+	int i;
 
 	lockdep_assert_held(&dp->dp_lock);
 
@@ -691,13 +870,58 @@ void ath12k_dp_rx_frags_cleanup(struct ath12k_dp_rx_tid *rx_tid,
 		rx_tid->dst_ring_desc = NULL;
 	}
 
+	frags = rx_tid->rx_frag_bitmap;
+	for_each_set_bit(i, &frags, ATH12K_DP_RX_MAX_FRAGS) {
+		kfree_skb(rx_tid->rx_frags[i]);
+		rx_tid->rx_frags[i] = NULL;
+	}
+
 	rx_tid->cur_sn = 0;
 	rx_tid->last_frag_no = 0;
 	rx_tid->rx_frag_bitmap = 0;
-	__skb_queue_purge(&rx_tid->rx_frags);
 }
 EXPORT_SYMBOL(ath12k_dp_rx_frags_cleanup);
 
+/* Store one fragment of an MPDU in its slot. A new sequence number drops
+ * whatever was collected for the previous one. Returns 1 once fragments 0 up
+ * to the last one are all present, 0 while some are missing and -EINVAL for
+ * a duplicate fragment or one past the last, which is then not stored.
+ */
+int ath12k_dp_rx_frag_insert(struct ath12k_dp_rx_tid *rx_tid,
+			     struct sk_buff *msdu, u16 seqno, u16 frag_no,
+			     bool more_frags)
+{
+	lockdep_assert_held(&rx_tid->dp->dp_lock);
+
+	if (frag_no >= ATH12K_DP_RX_MAX_FRAGS)
+		return -EINVAL;
+
+	if (!rx_tid->rx_frag_bitmap || seqno != rx_tid->cur_sn) {
+		/* Flush stored fragments and start a new sequence */
+		ath12k_dp_rx_frags_cleanup(rx_tid, true);
+		rx_tid->cur_sn = seqno;
+	}
+
+	if (rx_tid->rx_frag_bitmap & BIT(frag_no))
+		return -EINVAL;
+
+	/* nothing may follow the fragment without the more fragments bit */
+	if (rx_tid->last_frag_no && frag_no > rx_tid->last_frag_no)
+		return -EINVAL;
+
+	if (!more_frags && (rx_tid->rx_frag_bitmap & ~GENMASK(frag_no, 0)))
+		return -EINVAL;
+
+	rx_tid->rx_frags[frag_no] = msdu;
+	rx_tid->rx_frag_bitmap |= BIT(frag_no);
+	if (!more_frags)
+		rx_tid->last_frag_no = frag_no;
+
+	return rx_tid->last_frag_no &&
+	       rx_tid->rx_frag_bitmap == GENMASK(rx_tid->last_frag_no, 0);
+}
+EXPORT_SYMBOL(ath12k_dp_rx_frag_insert);
+
 void ath12k_dp_rx_peer_tid_cleanup(struct ath12k *ar, struct ath12k_dp_link_peer *peer)
 {
 	struct ath12k_dp_rx_tid *rx_tid;
@@ -1126,7 +1350,6 @@ int ath12k_dp_rx_peer_frag_setup(struct ath12k *ar,
 		rx_tid = &peer->dp_peer->rx_tid[i];
 		rx_tid->dp = dp;
 		timer_setup(&rx_tid->frag_timer, ath12k_dp_rx_frag_timer, 0);
-		skb_queue_head_init(&rx_tid->rx_frags);
 	}
 
 	peer->dp_peer->tfm_mmic = tfm;
@@ -9,6 +9,7 @@
 #include "core.h"
 #include "debug.h"
 #include <crypto/hash.h>
+#include <linux/hashtable.h>
 
 #define DP_MAX_NWIFI_HDR_LEN	30
 
@@ -91,6 +92,9 @@ enum data_filter {
 	((ab)->hw_params->route_wbm_release)
 #define ATH12K_ROUTE_EAP_METADATA       (ATH12K_RX_PROTOCOL_TAG_START_OFFSET + ATH12K_PKT_TYPE_EAP)
 
+/* 802.11 fragment number is a 4 bit field of the sequence control */
+#define ATH12K_DP_RX_MAX_FRAGS	16
+
 struct ath12k_dp_rx_tid {
 	u8 tid;
 	u32 *vaddr;
@@ -105,7 +109,10 @@ struct ath12k_dp_rx_tid {
 	u16 last_frag_no;
 	u16 rx_frag_bitmap;
 
-	struct sk_buff_head rx_frags;
+	/* Fragments of cur_sn indexed by fragment number, rx_frag_bitmap
+	 * tracks the occupied slots.
+	 */
+	struct sk_buff *rx_frags[ATH12K_DP_RX_MAX_FRAGS];
 	struct hal_reo_dest_ring *dst_ring_desc;
 
 	/* Timer info related to fragments */
@@ -118,7 +125,6 @@ struct ath12k_dp_rx_tid {
 };
 
 struct ath12k_dp_rx_reo_cache_flush_elem {
-	struct list_head list;
 	struct ath12k_dp_rx_tid data;
 	unsigned long ts;
 };
@@ -144,6 +150,9 @@ struct ath12k_dp_rx_reo_cmd {
 #define ATH12K_DP_RX_REO_DESC_FREE_THRES  64
 #define ATH12K_DP_RX_REO_DESC_FREE_TIMEOUT_MS 1000
 
+/* Room for descriptors whose cache flush failed on top of the threshold */
+#define ATH12K_DP_RX_REO_CACHE_FLUSH_RING_SIZE	(2 * ATH12K_DP_RX_REO_DESC_FREE_THRES)
+
 enum ath12k_dp_rx_decap_type {
 	DP_RX_DECAP_TYPE_RAW,
 	DP_RX_DECAP_TYPE_NATIVE_WIFI,
@@ -160,15 +169,24 @@ struct ath12k_dp_rx_rfc1042_hdr {
 	__be16 snap_type;
 } __packed;
 
+#define ATH12K_DP_RX_FST_HASH_BITS	10
+
 struct dp_rx_fst {
 	u8 *base;
 	struct hal_rx_fst *hal_rx_fst;
+	/* Host mirror of the valid entries keyed by flow tuple, used for
+	 * lookups so that the HW table is only probed on insertion.
+	 */
+	DECLARE_HASHTABLE(flow_map, ATH12K_DP_RX_FST_HASH_BITS);
 	u16 num_entries;
 	u16 ipv4_fse_rule_cnt;
 	u16 ipv6_fse_rule_cnt;
 	u16 flows_per_reo[4];
 	u32 flow_add_fail;
 	u32 flow_del_fail;
+	/* Insertions that landed past their hash slot in the HW table */
+	u32 flow_collisions;
+	u32 flow_max_skid;
 	/* spinlock to prevent concurrent table access */
 	spinlock_t fst_lock;
 };
@@ -230,6 +248,19 @@ void ath12k_dp_rx_reo_cleanup(struct ath12k_base *ab);
 int ath12k_dp_rx_alloc(struct ath12k_base *ab);
 void ath12k_dp_rx_free(struct ath12k_base *ab);
 void ath12k_dp_rx_reo_cmd_list_cleanup(struct ath12k_base *ab);
+int ath12k_dp_rx_reo_cmd_pool_alloc(struct ath12k_dp *dp);
+void ath12k_dp_rx_reo_cmd_pool_free(struct ath12k_dp *dp);
+int ath12k_dp_rx_reo_cmd_track(struct ath12k_dp *dp, int cmd_num,
+			       struct ath12k_dp_rx_tid *rx_tid,
+			       void (*cb)(struct ath12k_dp *dp, void *ctx,
+					  enum hal_reo_cmd_status status));
+bool ath12k_dp_rx_reo_cmd_complete(struct ath12k_dp *dp, int cmd_num,
+				   struct ath12k_dp_rx_reo_cmd *cmd);
+bool ath12k_dp_rx_reo_cache_flush_enqueue(struct ath12k_dp *dp,
+					  struct ath12k_dp_rx_tid *rx_tid);
+struct ath12k_dp_rx_reo_cache_flush_elem *
+ath12k_dp_rx_reo_cache_flush_peek(struct ath12k_dp *dp);
+void ath12k_dp_rx_reo_cache_flush_pop(struct ath12k_dp *dp);
 void ath12k_dp_rx_bufs_replenish(struct ath12k_dp *dp,
 				struct dp_rxdma_ring *rx_ring,
 				struct list_head *used_list);
@@ -254,6 +285,9 @@ void ath12k_dp_reo_cmd_free(struct ath12k_dp *dp, void *ctx,
 			    enum hal_reo_cmd_status status);
 void ath12k_dp_rx_frags_cleanup(struct ath12k_dp_rx_tid *rx_tid,
 				bool rel_link_desc);
+int ath12k_dp_rx_frag_insert(struct ath12k_dp_rx_tid *rx_tid,
+			     struct sk_buff *msdu, u16 seqno, u16 frag_no,
+			     bool more_frags);
 int ath12k_dp_rx_crypto_mic_len(struct ath12k_pdev_dp *dp_pdev,
 				enum hal_encrypt_type enctype);
 int ath12k_dp_rx_crypto_param_len(struct ath12k_pdev_dp *dp_pdev,
@@ -544,12 +544,107 @@ void ath12k_dp_tx_encap_nwifi(struct sk_buff *skb)
 }
 EXPORT_SYMBOL(ath12k_dp_tx_encap_nwifi);
 
+int ath12k_dp_tx_ext_desc_pool_alloc(struct ath12k_base *ab)
+{
+	struct ath12k_dp *dp = ath12k_ab_to_dp(ab);
+	struct ath12k_tx_ext_desc_pool *pool;
+	int pool_id, i;
+
+	for (pool_id = 0; pool_id < ATH12K_HW_MAX_QUEUES; pool_id++) {
+		pool = &dp->tx_ext_desc_pool[pool_id];
+		pool->vaddr = ath12k_hal_dma_alloc_coherent(ab->dev,
+							    ATH12K_TX_EXT_DESC_PER_POOL *
+							    ATH12K_TX_EXT_DESC_SIZE,
+							    &pool->paddr,
+							    GFP_KERNEL);
+		if (!pool->vaddr) {
+			ath12k_dp_tx_ext_desc_pool_free(ab);
+			return -ENOMEM;
+		}
+
+		/* hand out the lowest ids first */
+		for (i = 0; i < ATH12K_TX_EXT_DESC_PER_POOL; i++)
+			pool->free_ids[i] = ATH12K_TX_EXT_DESC_PER_POOL - 1 - i;
+		pool->num_free = ATH12K_TX_EXT_DESC_PER_POOL;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(ath12k_dp_tx_ext_desc_pool_alloc);
+
+void ath12k_dp_tx_ext_desc_pool_free(struct ath12k_base *ab)
+{
+	struct ath12k_dp *dp = ath12k_ab_to_dp(ab);
+	struct ath12k_tx_ext_desc_pool *pool;
+	int pool_id;
+
+	for (pool_id = 0; pool_id < ATH12K_HW_MAX_QUEUES; pool_id++) {
+		pool = &dp->tx_ext_desc_pool[pool_id];
+		if (!pool->vaddr)
+			continue;
+
+		ath12k_hal_dma_free_coherent(ab->dev,
+					     ATH12K_TX_EXT_DESC_PER_POOL *
+					     ATH12K_TX_EXT_DESC_SIZE,
+					     pool->vaddr, pool->paddr);
+		pool->vaddr = NULL;
+		pool->num_free = 0;
+	}
+}
+EXPORT_SYMBOL(ath12k_dp_tx_ext_desc_pool_free);
+
+/* Attach a zeroed extension descriptor slot from the tx desc's pool to
+ * tx_desc. The slot is returned to the pool when the tx desc is released.
+ */
+void *ath12k_dp_tx_ext_desc_get(struct ath12k_dp *dp,
+				struct ath12k_tx_desc_info *tx_desc,
+				u8 pool_id, dma_addr_t *paddr)
+{
+	struct ath12k_tx_ext_desc_pool *pool = &dp->tx_ext_desc_pool[pool_id];
+	void *vaddr;
+	u16 id;
+
+	spin_lock_bh(&dp->tx_desc_lock[pool_id]);
+	if (unlikely(!pool->num_free)) {
+		spin_unlock_bh(&dp->tx_desc_lock[pool_id]);
+		return NULL;
+	}
+
+	id = pool->free_ids[--pool->num_free];
+	tx_desc->ext_desc_id = id;
+	spin_unlock_bh(&dp->tx_desc_lock[pool_id]);
+
+	vaddr = pool->vaddr + id * ATH12K_TX_EXT_DESC_SIZE;
+	memset(vaddr, 0, ATH12K_TX_EXT_DESC_SIZE);
+	*paddr = pool->paddr + id * ATH12K_TX_EXT_DESC_SIZE;
+
+	return vaddr;
+}
+EXPORT_SYMBOL(ath12k_dp_tx_ext_desc_get);
+
+/* caller must hold tx_desc_lock[pool_id] */
+void ath12k_dp_tx_ext_desc_put_nolock(struct ath12k_dp *dp,
+				      struct ath12k_tx_desc_info *tx_desc,
+				      u8 pool_id)
+{
+	struct ath12k_tx_ext_desc_pool *pool = &dp->tx_ext_desc_pool[pool_id];
+
+	if (tx_desc->ext_desc_id == ATH12K_TX_EXT_DESC_ID_INVALID)
+		return;
+
+	if (!WARN_ON_ONCE(pool->num_free >= ATH12K_TX_EXT_DESC_PER_POOL))
+		pool->free_ids[pool->num_free++] = tx_desc->ext_desc_id;
+
+	tx_desc->ext_desc_id = ATH12K_TX_EXT_DESC_ID_INVALID;
+}
+EXPORT_SYMBOL(ath12k_dp_tx_ext_desc_put_nolock);
+
 void ath12k_dp_tx_release_txbuf(struct ath12k_dp *dp,
 				struct ath12k_tx_desc_info *tx_desc,
 				u8 pool_id)
 {
 	spin_lock_bh(&dp->tx_desc_lock[pool_id]);
-	tx_desc->skb_ext_desc = NULL;
+	ath12k_dp_tx_ext_desc_put_nolock(dp, tx_desc, pool_id);
 	tx_desc->in_use = false;
 	tx_desc->flags = 0;
 	list_add_tail(&tx_desc->list, &dp->tx_desc_free_list[pool_id]);
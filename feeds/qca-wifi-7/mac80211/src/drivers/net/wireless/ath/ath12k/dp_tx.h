@@ -50,6 +50,14 @@ void ath12k_dp_tx_put_bank_profile(struct ath12k_dp *dp, u8 bank_id);
 void ath12k_dp_tx_encap_nwifi(struct sk_buff *skb);
 void *ath12k_dp_metadata_align_skb(struct sk_buff *skb, u8 tail_len);
 int ath12k_dp_tx_align_payload(struct ath12k_dp *dp, struct sk_buff **pskb);
+int ath12k_dp_tx_ext_desc_pool_alloc(struct ath12k_base *ab);
+void ath12k_dp_tx_ext_desc_pool_free(struct ath12k_base *ab);
+void *ath12k_dp_tx_ext_desc_get(struct ath12k_dp *dp,
+				struct ath12k_tx_desc_info *tx_desc,
+				u8 pool_id, dma_addr_t *paddr);
+void ath12k_dp_tx_ext_desc_put_nolock(struct ath12k_dp *dp,
+				      struct ath12k_tx_desc_info *tx_desc,
+				      u8 pool_id);
 void ath12k_dp_tx_release_txbuf(struct ath12k_dp *dp,
 				struct ath12k_tx_desc_info *tx_desc,
 				u8 pool_id);
@@ -1586,6 +1586,7 @@ void ath12k_mac_peer_cleanup_all(struct ath12k *ar)
 		ath12k_dp_link_peer_rhash_delete(dp, peer);
 		peer->dp_peer = NULL;
 
+		ath12k_dp_link_peer_unindex(peer);
 		list_del(&peer->list);
 		list_add(&peer->list, &peers);
 	}
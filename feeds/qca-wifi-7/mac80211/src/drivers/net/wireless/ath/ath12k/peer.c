@@ -277,12 +277,14 @@ int ath12k_peer_create(struct ath12k *ar, struct ath12k_link_vif *arvif,
 		/* Fill ML info into created peer */
 		if (sta->mlo) {
 			ml_peer_id = ahsta->ml_peer_id;
-			peer->ml_id = ml_peer_id | ATH12K_PEER_ML_ID_VALID;
+			ath12k_dp_link_peer_set_ml_id(ar->ab->dp, peer,
+						      ml_peer_id | ATH12K_PEER_ML_ID_VALID);
 			ether_addr_copy(peer->ml_addr, sta->addr);
 
 			peer->mlo = true;
 		} else {
-			peer->ml_id = ATH12K_MLO_PEER_ID_INVALID;
+			ath12k_dp_link_peer_set_ml_id(ar->ab->dp, peer,
+						      ATH12K_MLO_PEER_ID_INVALID);
 			peer->mlo = false;
 		}
 	}
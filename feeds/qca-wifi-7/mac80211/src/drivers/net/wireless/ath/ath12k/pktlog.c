@@ -5,23 +5,42 @@
 
 #include <linux/device.h>
 #include <linux/debugfs.h>
+#include <linux/poll.h>
 #include <linux/vmalloc.h>
 #include "core.h"
 #include "wmi.h"
 #include "debug.h"
 #include "dp_mon.h"
 
-/* Convert a kernel virtual address to a kernel logical address */
+static char *ath12k_pktlog_data(struct ath12k_pktlog_buf *log_buf)
+{
+	return (char *)log_buf + ATH12K_PKTLOG_DATA_OFFSET;
+}
+
+static u32 ath12k_pktlog_buf_pages(u32 ring_size)
+{
+	return DIV_ROUND_UP(ATH12K_PKTLOG_DATA_OFFSET + ring_size, PAGE_SIZE);
+}
+
 static void ath12k_pktlog_release(struct ath12k_pktlog *pktlog)
 {
 	uintptr_t vaddr, vaddr_start, vaddr_end;
-	unsigned long page_cnt;
+	struct ath12k_pktlog_buf *buf;
 	struct page *page;
 
-	vaddr_start = (uintptr_t)pktlog->buf;
-	page_cnt = DIV_ROUND_UP(sizeof(*pktlog->buf) + pktlog->buf_size,
-				PAGE_SIZE);
-	vaddr_end = vaddr_start + (page_cnt * PAGE_SIZE);
+	mutex_lock(&pktlog->buf_lock);
+	spin_lock_bh(&pktlog->lock);
+	buf = pktlog->buf;
+	pktlog->buf = NULL;
+	spin_unlock_bh(&pktlog->lock);
+	mutex_unlock(&pktlog->buf_lock);
+
+	if (!buf)
+		return;
+
+	vaddr_start = (uintptr_t)buf;
+	vaddr_end = vaddr_start +
+		    ath12k_pktlog_buf_pages(pktlog->ring_size) * PAGE_SIZE;
 
 	for (vaddr = vaddr_start; vaddr < vaddr_end; vaddr += PAGE_SIZE) {
 		page = vmalloc_to_page((const void *)vaddr);
@@ -29,8 +48,7 @@ static void ath12k_pktlog_release(struct ath12k_pktlog *pktlog)
 			clear_bit(PG_reserved, &page->flags);
 	}
 
-	vfree(pktlog->buf);
-	pktlog->buf = NULL;
+	vfree(buf);
 }
 
 static int ath12k_alloc_pktlog_buf(struct ath12k *ar)
@@ -38,21 +56,19 @@ static int ath12k_alloc_pktlog_buf(struct ath12k *ar)
 	u32 page_cnt;
 	uintptr_t vaddr, vaddr_start, vaddr_end;
 	struct page *page;
-	void *buf;
+	struct ath12k_pktlog_buf *buf;
 	struct ath12k_pktlog *pktlog = &ar->debug.pktlog;
 
 	if (pktlog->buf_size == 0)
 		return -EINVAL;
 
-	page_cnt = DIV_ROUND_UP(sizeof(*pktlog->buf) + pktlog->buf_size,
-				PAGE_SIZE);
-	buf =  vmalloc((page_cnt + PKTLOG_EXTRA_PAGES) * PAGE_SIZE);
+	page_cnt = ath12k_pktlog_buf_pages(pktlog->buf_size);
+	/* zeroed as the whole buffer is exposed through mmap */
+	buf = vzalloc(page_cnt * PAGE_SIZE);
 	if (!buf)
 		return -ENOMEM;
 
-	pktlog->buf = (struct ath12k_pktlog_buf *)ALIGN((uintptr_t)(buf),
-							PAGE_SIZE);
-	vaddr_start = (uintptr_t)pktlog->buf;
+	vaddr_start = (uintptr_t)buf;
 	vaddr_end = vaddr_start + (page_cnt * PAGE_SIZE);
 
 	for (vaddr = vaddr_start; vaddr < vaddr_end; vaddr += PAGE_SIZE) {
@@ -61,6 +77,15 @@ static int ath12k_alloc_pktlog_buf(struct ath12k *ar)
 			set_bit(PG_reserved, &page->flags);
 	}
 
+	buf->size = pktlog->buf_size;
+
+	spin_lock_bh(&pktlog->lock);
+	pktlog->ring_size = pktlog->buf_size;
+	pktlog->head = 0;
+	pktlog->overrun = 0;
+	pktlog->buf = buf;
+	spin_unlock_bh(&pktlog->lock);
+
 	return 0;
 }
 
@@ -79,96 +104,94 @@ static void ath12k_init_pktlog_buf(struct ath12k *ar, struct ath12k_pktlog
                 ath12k_warn(ar->ab, "firmware doesn't support pktlog decode info support\n");
                 pktlog->invalid_decode_info = 1;
         }
+}
 
-	pktlog->buf->rd_offset = -1;
-	pktlog->buf->wr_offset = 0;
+VISIBLE_IF_ATH12K_KUNIT
+u32 ath12k_pktlog_ring_used(u32 head, u32 tail, u32 size)
+{
+	return head >= tail ? head - tail : size - tail + head;
 }
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_pktlog_ring_used);
 
-static inline void ath12k_pktlog_mov_rd_idx(struct ath12k_pktlog *pl_info,
-                                            int32_t *rd_offset)
+VISIBLE_IF_ATH12K_KUNIT
+u32 ath12k_pktlog_ring_put(char *data, u32 size, u32 off,
+			   const void *src, u32 len)
 {
-	int32_t boundary;
-	struct ath12k_pktlog_buf *log_buf = pl_info->buf;
-	struct ath12k_pktlog_hdr *log_hdr;
-
-	log_hdr = (struct ath12k_pktlog_hdr *)(log_buf->log_data + *rd_offset);
-	boundary = *rd_offset;
-	boundary += pl_info->hdr_size;
-	boundary += log_hdr->size;
-
-	if (boundary <= pl_info->buf_size)
-		*rd_offset = boundary;
-	else
-		*rd_offset = log_hdr->size;
-
-	if ((pl_info->buf_size - *rd_offset) < pl_info->hdr_size)
-		*rd_offset = 0;
+	u32 chunk = min(len, size - off);
+
+	memcpy(data + off, src, chunk);
+	memcpy(data, src + chunk, len - chunk);
+
+	off += len;
+	return off >= size ? off - size : off;
 }
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_pktlog_ring_put);
 
-static char *ath12k_pktlog_getbuf(struct ath12k_pktlog *pl_info,
-                                  struct ath12k_pktlog_hdr_arg *hdr_arg)
+/* Append one record, returns false if it was dropped */
+VISIBLE_IF_ATH12K_KUNIT
+bool ath12k_pktlog_ring_write(struct ath12k_pktlog *pl_info,
+			      struct ath12k_pktlog_hdr_arg *hdr_arg)
 {
 	struct ath12k_pktlog_buf *log_buf;
-	int32_t cur_wr_offset, buf_size;
-	char *log_ptr;
+	u32 len = pl_info->hdr_size + hdr_arg->payload_size;
+	u32 size, head, tail;
+	bool ret = false;
 
 	spin_lock_bh(&pl_info->lock);
 	log_buf = pl_info->buf;
-	buf_size = pl_info->buf_size;
-
-	cur_wr_offset = log_buf->wr_offset;
-	/* Move read offset to the next entry if there is a buffer overlap */
-	if (log_buf->rd_offset >= 0) {
-		if ((cur_wr_offset <= log_buf->rd_offset) &&
-		    (cur_wr_offset + pl_info->hdr_size) >
-		     log_buf->rd_offset)
-			ath12k_pktlog_mov_rd_idx(pl_info, &log_buf->rd_offset);
-	} else {
-		log_buf->rd_offset = cur_wr_offset;
-	}
-
-	memcpy(&log_buf->log_data[cur_wr_offset],
-	       hdr_arg->pktlog_hdr, pl_info->hdr_size);
-
-	cur_wr_offset += pl_info->hdr_size;
+	if (!log_buf)
+		goto unlock;
 
-	if ((buf_size - cur_wr_offset) < hdr_arg->payload_size) {
-		while ((cur_wr_offset <= log_buf->rd_offset) &&
-		       (log_buf->rd_offset < buf_size))
-			  ath12k_pktlog_mov_rd_idx(pl_info, &log_buf->rd_offset);
-		cur_wr_offset = 0;
+	size = pl_info->ring_size;
+	head = pl_info->head;
+	/* pairs with the release of tail once the reader is done copying */
+	tail = smp_load_acquire(&log_buf->tail);
+	if (tail >= size ||
+	    len > size - 1 - ath12k_pktlog_ring_used(head, tail, size)) {
+		WRITE_ONCE(log_buf->overrun, ++pl_info->overrun);
+		goto unlock;
 	}
 
-	while ((cur_wr_offset <= log_buf->rd_offset) &&
-	       ((cur_wr_offset + hdr_arg->payload_size) > log_buf->rd_offset))
-			  ath12k_pktlog_mov_rd_idx(pl_info, &log_buf->rd_offset);
+	head = ath12k_pktlog_ring_put(ath12k_pktlog_data(log_buf), size, head,
+				      hdr_arg->pktlog_hdr, pl_info->hdr_size);
+	head = ath12k_pktlog_ring_put(ath12k_pktlog_data(log_buf), size, head,
+				      hdr_arg->payload, hdr_arg->payload_size);
+	pl_info->head = head;
 
-	log_ptr = &log_buf->log_data[cur_wr_offset];
-	cur_wr_offset += hdr_arg->payload_size;
+	/* publish the record only once it is completely written */
+	smp_store_release(&log_buf->head, head);
+	ret = true;
 
-	log_buf->wr_offset =
-		((buf_size - cur_wr_offset) >=
-		 pl_info->hdr_size) ? cur_wr_offset : 0;
+unlock:
 	spin_unlock_bh(&pl_info->lock);
-
-	return log_ptr;
+	return ret;
 }
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_pktlog_ring_write);
 
-static  vm_fault_t pktlog_pgfault(struct vm_fault *vmf)
+static vm_fault_t pktlog_pgfault(struct vm_fault *vmf)
 {
-	struct vm_area_struct *vma = vmf->vma;
-	unsigned long address = vmf->address;
+	struct ath12k *ar = vmf->vma->vm_private_data;
+	struct ath12k_pktlog *pktlog = &ar->debug.pktlog;
+	vm_fault_t ret = VM_FAULT_SIGBUS;
+	struct page *page;
 
-	if (address == 0UL)
-		return VM_FAULT_NOPAGE;
+	mutex_lock(&pktlog->buf_lock);
+	if (!pktlog->buf ||
+	    vmf->pgoff >= ath12k_pktlog_buf_pages(pktlog->ring_size))
+		goto unlock;
 
-	if (vmf->pgoff > ((vma->vm_end - vma->vm_start) >> PAGE_SHIFT))
-		return VM_FAULT_SIGBUS;
+	page = vmalloc_to_page((char *)pktlog->buf +
+			       (vmf->pgoff << PAGE_SHIFT));
+	if (!page)
+		goto unlock;
 
-	get_page(virt_to_page((void *)address));
-	vmf->page = virt_to_page((void *)address);
+	get_page(page);
+	vmf->page = page;
+	ret = 0;
 
-	return 0;
+unlock:
+	mutex_unlock(&pktlog->buf_lock);
+	return ret;
 }
 
 static const struct vm_operations_struct pktlog_vmops = {
@@ -194,177 +217,106 @@ static int ath12k_pktlog_mmap(struct file *file, struct vm_area_struct
 	vm_flags_set(vma, VM_LOCKED);
 #endif
 	vma->vm_ops = &pktlog_vmops;
+	vma->vm_private_data = ar;
 
 	return 0;
 }
 
+/* Streams the buffer header followed by the records between tail and head.
+ * Only the buffer lifetime mutex is taken, so a long running capture does
+ * not hold off anything else, and data is copied straight out of the ring.
+ */
 static ssize_t ath12k_pktlog_read(struct file *file, char __user *userbuf,
                                   size_t count, loff_t *ppos)
 {
 	struct ath12k *ar = file->private_data;
 	struct ath12k_pktlog *info = &ar->debug.pktlog;
 	struct ath12k_pktlog_buf *log_buf;
-	size_t bufhdr_size, rem_len, nbytes = 0, ret_val = 0;
-	size_t start_offset, end_offset = 0;
-	size_t fold_offset = INVALID_OFFSET, ppos_data;
-	int cur_rd_offset;
-	char *buf;
+	size_t bufhdr_size, nbytes, chunk, ret_val = 0;
+	u32 size, head, tail;
 	ssize_t final_ret = 0;
+	char *data;
 
 	if (count == 0 || !userbuf)
 		return 0;
 
-	wiphy_lock(ath12k_ar_to_hw(ar)->wiphy);
-	if (!ath12k_ftm_mode && ar->ah->state != ATH12K_HW_STATE_ON) {
-		final_ret = -ENETDOWN;
-		goto unlock;
-	}
-
-	buf = vmalloc(count);
-	if (!buf) {
-		final_ret = -ENOMEM;
-		goto unlock;
-	}
-
-	spin_lock_bh(&info->lock);
+	mutex_lock(&info->buf_lock);
 	log_buf = info->buf;
-	if (!log_buf) {
-		spin_unlock_bh(&info->lock);
-		final_ret = 0;
-		goto free;
-	}
+	if (!log_buf)
+		goto unlock;
 
 	bufhdr_size = sizeof(log_buf->bufhdr);
 	if (!info->fw_version_record || info->invalid_decode_info)
 		bufhdr_size -= sizeof(struct ath12k_pktlog_decode_info);
 
-	/* copy valid log entries from circular buffer into user space */
-	rem_len = count;
-
 	if (*ppos < bufhdr_size) {
-		nbytes = min_t(size_t, bufhdr_size - (size_t)*ppos, rem_len);
-		if (*ppos + nbytes > sizeof(log_buf->bufhdr)) {
+		nbytes = min_t(size_t, bufhdr_size - (size_t)*ppos, count);
+		if (copy_to_user(userbuf, ((char *)&log_buf->bufhdr) + *ppos,
+				 nbytes)) {
 			final_ret = -EFAULT;
-			spin_unlock_bh(&info->lock);
-			goto free;
+			goto unlock;
 		}
-
-		memcpy(buf, ((char *)&log_buf->bufhdr) + *ppos, nbytes);
-		rem_len -= nbytes;
 		ret_val += nbytes;
 	}
 
-	start_offset = log_buf->rd_offset;
-	if (rem_len == 0 || start_offset == INVALID_OFFSET) {
-		spin_unlock_bh(&info->lock);
-		goto copy_to_user;
+	size = info->ring_size;
+	/* pairs with the release in ath12k_pktlog_ring_write() */
+	head = smp_load_acquire(&log_buf->head);
+	tail = READ_ONCE(log_buf->tail);
+	if (head >= size || tail >= size) {
+		final_ret = -EINVAL;
+		goto unlock;
 	}
 
-	cur_rd_offset = start_offset;
-
-	/* Find the last offset and fold-offset if the buffer is folded */
-	do {
-		int log_data_offset;
-		struct ath12k_pktlog_hdr *log_hdr;
-
-		log_hdr = (struct ath12k_pktlog_hdr *)(log_buf->log_data +
-						       cur_rd_offset);
-		log_data_offset = cur_rd_offset + info->hdr_size;
-
-		if (fold_offset == INVALID_OFFSET &&
-		    ((info->buf_size - log_data_offset) <= log_hdr->size))
-			fold_offset = log_data_offset - 1;
-
-		ath12k_pktlog_mov_rd_idx(info, &cur_rd_offset);
-
-		if (fold_offset == INVALID_OFFSET &&
-		    cur_rd_offset == 0 &&
-		    cur_rd_offset != log_buf->wr_offset)
-			fold_offset = log_data_offset + log_hdr->size - 1;
-
-		end_offset = log_data_offset + log_hdr->size - 1;
-
-	} while (cur_rd_offset != log_buf->wr_offset);
-
-	spin_unlock_bh(&info->lock);
-
-	ppos_data = *ppos + ret_val - bufhdr_size + start_offset;
-
-	if (fold_offset == INVALID_OFFSET) {
-		if (ppos_data > end_offset)
-			goto copy_to_user;
-
-		nbytes = min(rem_len, end_offset - ppos_data + 1);
-		if (ppos_data < 0 || ppos_data + nbytes > info->buf_size) {
+	nbytes = min_t(size_t, count - ret_val,
+		       ath12k_pktlog_ring_used(head, tail, size));
+	if (nbytes) {
+		data = ath12k_pktlog_data(log_buf);
+		chunk = min_t(size_t, nbytes, size - tail);
+		if (copy_to_user(userbuf + ret_val, data + tail, chunk) ||
+		    copy_to_user(userbuf + ret_val + chunk, data,
+				 nbytes - chunk)) {
 			final_ret = -EFAULT;
-			goto free;
-		}
-
-		memcpy(buf + ret_val, log_buf->log_data + ppos_data, nbytes);
-		ret_val += nbytes;
-	} else {
-		if (ppos_data <= fold_offset) {
-			nbytes = min(rem_len, fold_offset - ppos_data + 1);
-			if (ppos_data < 0 || ppos_data + nbytes >
-			    info->buf_size) {
-				final_ret = -EFAULT;
-				goto free;
-			}
-
-			memcpy(buf + ret_val, log_buf->log_data + ppos_data,
-			       nbytes);
-			ret_val += nbytes;
-			rem_len -= nbytes;
-		}
-
-		if (rem_len > 0) {
-			ppos_data =
-				*ppos + ret_val - (bufhdr_size +
-						   (fold_offset - start_offset + 1));
-
-			if (ppos_data <= end_offset) {
-				nbytes = min(rem_len, end_offset - ppos_data + 1);
-				if (ppos_data < 0 || ppos_data + nbytes >
-				    info->buf_size) {
-					final_ret = -EFAULT;
-					goto free;
-				}
-
-				memcpy(buf + ret_val, log_buf->log_data + ppos_data,
-				       nbytes);
-				ret_val += nbytes;
-			}
+			goto unlock;
 		}
-	}
-
-	if (ret_val == 0) {
-		final_ret = 0;
-		goto free;
-	}
 
-copy_to_user:
-	if (ret_val < 0 || ret_val > count || *ppos + ret_val < *ppos) {
-		final_ret = -EFAULT;
-		goto free;
-	}
+		tail += nbytes;
+		if (tail >= size)
+			tail -= size;
 
-	if (copy_to_user(userbuf, buf, ret_val)) {
-		final_ret = -EFAULT;
-		goto free;
+		/* hand the space back only after it has been copied out */
+		smp_store_release(&log_buf->tail, tail);
+		ret_val += nbytes;
 	}
 
 	*ppos += ret_val;
 	final_ret = ret_val;
 
-free:
-	vfree(buf);
 unlock:
-	wiphy_unlock(ath12k_ar_to_hw(ar)->wiphy);
+	mutex_unlock(&info->buf_lock);
 	return final_ret;
 }
 
+static __poll_t ath12k_pktlog_poll(struct file *file, poll_table *wait)
+{
+	struct ath12k *ar = file->private_data;
+	struct ath12k_pktlog *info = &ar->debug.pktlog;
+	__poll_t mask = 0;
+
+	poll_wait(file, &info->wq, wait);
+
+	mutex_lock(&info->buf_lock);
+	if (info->buf &&
+	    smp_load_acquire(&info->buf->head) != READ_ONCE(info->buf->tail))
+		mask = EPOLLIN | EPOLLRDNORM;
+	mutex_unlock(&info->buf_lock);
+
+	return mask;
+}
+
 static const struct file_operations fops_pktlog_dump = {
 	.read = ath12k_pktlog_read,
+	.poll = ath12k_pktlog_poll,
 	.mmap = ath12k_pktlog_mmap,
 	.open = simple_open
 };
@@ -406,8 +358,7 @@ static ssize_t ath12k_write_pktlog_start(struct file *file, const char __user *u
 	}
 
 	if (start_pktlog) {
-		if (pktlog->buf)
-			ath12k_pktlog_release(pktlog);
+		ath12k_pktlog_release(pktlog);
 
 		err = ath12k_alloc_pktlog_buf(ar);
 		if (err)
@@ -536,6 +487,8 @@ static void ath12k_pktlog_init(struct ath12k *ar)
 	struct ath12k_pktlog *pktlog = &ar->debug.pktlog;
 
 	spin_lock_init(&pktlog->lock);
+	mutex_init(&pktlog->buf_lock);
+	init_waitqueue_head(&pktlog->wq);
 	pktlog->buf_size = ATH12K_DEBUGFS_PKTLOG_SIZE_DEFAULT;
 	pktlog->buf = NULL;
 
@@ -552,7 +505,8 @@ void ath12k_init_pktlog(struct ath12k *ar)
 			    ar->debug.debugfs_pktlog, ar, &fops_pktlog_start);
 	debugfs_create_file("size", S_IRUGO | S_IWUSR,
 			    ar->debug.debugfs_pktlog, ar, &fops_pktlog_size);
-	debugfs_create_file("dump", S_IRUGO,
+	/* writable so that an mmap reader can consume by updating tail */
+	debugfs_create_file("dump", S_IRUSR | S_IWUSR,
 			    ar->debug.debugfs_pktlog, ar, &fops_pktlog_dump);
 
 	ath12k_pktlog_init(ar);
@@ -560,10 +514,7 @@ void ath12k_init_pktlog(struct ath12k *ar)
 
 void ath12k_deinit_pktlog(struct ath12k *ar)
 {
-	struct ath12k_pktlog *pktlog = &ar->debug.pktlog;
-
-	if (pktlog->buf)
-		ath12k_pktlog_release(pktlog);
+	ath12k_pktlog_release(&ar->debug.pktlog);
 }
 
 static void ath12k_pktlog_pull_hdr(struct ath12k_pktlog_hdr_arg *arg,
@@ -595,8 +546,6 @@ static void ath12k_pktlog_write_buf(struct ath12k *ar,
 				    struct ath12k_pktlog *pl_info,
 				    struct ath12k_pktlog_hdr_arg *hdr_arg)
 {
-	char *log_data;
-
 	if (!pl_info || !pl_info->buf || pl_info->buf_size <= 0) {
 		ath12k_warn(ar->ab, "Invalid pl_info or buffer\n");
 		return;
@@ -607,29 +556,11 @@ static void ath12k_pktlog_write_buf(struct ath12k *ar,
 		return;
 	}
 
-	log_data = ath12k_pktlog_getbuf(pl_info, hdr_arg);
-	if (!log_data) {
-		ath12k_warn(ar->ab, "pktlog data is NULL\n");
+	if (!ath12k_pktlog_ring_write(pl_info, hdr_arg))
 		return;
-	}
-
-	if (hdr_arg->payload_size > pl_info->buf_size) {
-		ath12k_warn(ar->ab,
-			    "Payload size is too large : %d > buf_size: %d\n",
-			    hdr_arg->payload_size, pl_info->buf_size);
-		return;
-	}
-
-	if (log_data < pl_info->buf->log_data ||
-	    (log_data + hdr_arg->payload_size) >
-	    (pl_info->buf->log_data + pl_info->buf_size)) {
-		ath12k_warn(ar->ab,
-			    "memcpy out of bounds : log_data: %p size: %d\n",
-			    log_data, hdr_arg->payload_size);
-		return;
-	}
 
-	memcpy(log_data, hdr_arg->payload, hdr_arg->payload_size);
+	if (wq_has_sleeper(&pl_info->wq))
+		wake_up_interruptible(&pl_info->wq);
 }
 
 void ath12k_htt_pktlog_process(struct ath12k *ar, u8 *data)
@@ -8,7 +8,6 @@
 
 #include "core.h"
 
-#define PKTLOG_EXTRA_PAGES      2
 #define CUR_PKTLOG_VER          10010  /* Packet log version */
 #define PKTLOG_MAGIC_NUM        7735225
 #define PKTLOG_NEW_MAGIC_NUM    2453506
@@ -16,7 +15,6 @@
 #define ATH12K_DEBUGFS_PKTLOG_SIZE_DEFAULT (10 * 1024 * 1024)
 #define ATH12K_PKTLOG_SIZE_MIN  (16 * 1024)
 #define ATH12K_PKTLOG_SIZE_MAX  (50 * 1024 * 1024)
-#define INVALID_OFFSET		((size_t)-1)
 
 #define ATH12K_PKTLOG_HDR_FLAGS_MASK 0xffff
 #define ATH12K_PKTLOG_HDR_FLAGS_SHIFT 0
@@ -100,18 +98,37 @@ struct ath12k_pktlog_bufhdr {
         u32 pktlog_defs_json_version;
 };
 
+/* Log records start on the page after the ath12k_pktlog_buf control page */
+#define ATH12K_PKTLOG_DATA_OFFSET PAGE_SIZE
+
+/* Control page at the start of the pktlog mapping. The log data that
+ * follows is a byte ring of @size bytes: the driver is the only writer of
+ * @head and the reader, either read() or an mmap user, the only writer of
+ * @tail. The ring is empty when both are equal and one byte is always left
+ * unused so that a full ring can be told apart. Records that do not fit are
+ * dropped and counted in @overrun.
+ */
 struct ath12k_pktlog_buf {
         struct ath12k_pktlog_bufhdr bufhdr;
-        int rd_offset;
-        int wr_offset;
-        char log_data[0];
+        u32 head;
+        u32 tail;
+        u32 size;
+        u32 overrun;
 };
 
 struct ath12k_pktlog {
         struct ath12k_pktlog_buf *buf;
         u32 filter;
         u32 buf_size;           /* Size of buffer in bytes */
+        /* Serialises producers, readers never take it */
         spinlock_t lock;
+        /* Keeps buf alive while a reader copies out of it */
+        struct mutex buf_lock;
+        wait_queue_head_t wq;
+        /* Private copies, the shared control page is writable by users */
+        u32 ring_size;
+        u32 head;
+        u32 overrun;
         u8 hdr_size;
         u8 hdr_size_field_offset;
         u32 fw_version_record;
@@ -130,4 +147,12 @@ struct ath12k_pl_fw_info {
         u8 chip_info[40];
         u32 pktlog_defs_json_version;
 } __packed;
+
+#if IS_ENABLED(CPTCFG_ATH12K_KUNIT_TEST)
+u32 ath12k_pktlog_ring_used(u32 head, u32 tail, u32 size);
+u32 ath12k_pktlog_ring_put(char *data, u32 size, u32 off,
+			   const void *src, u32 len);
+bool ath12k_pktlog_ring_write(struct ath12k_pktlog *pl_info,
+			      struct ath12k_pktlog_hdr_arg *hdr_arg);
+#endif
 #endif /* _PKTLOG_H_ */
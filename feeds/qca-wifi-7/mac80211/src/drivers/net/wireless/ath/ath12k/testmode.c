@@ -143,7 +143,7 @@ void ath12k_tm_wmi_event_unsegmented(struct ath12k_base *ab, u32 cmd_id,
 }
 
 void ath12k_tm_process_event(struct ath12k_base *ab, u32 cmd_id,
-			     const void **tb,
+			     const struct ath12k_wmi_tlv_tb *tb,
 			     u16 length)
 {
 	const struct wmi_pdev_utf_event_param *param = NULL;
@@ -155,7 +155,7 @@ void ath12k_tm_process_event(struct ath12k_base *ab, u32 cmd_id,
 	u16 datalen;
 	u8 const *buf_pos;
 
-	ftm_msg = tb[WMI_TAG_ARRAY_BYTE];
+	ftm_msg = ath12k_wmi_tlv_tb_get(tb, WMI_TAG_ARRAY_BYTE);
 	if (!ftm_msg) {
 		ath12k_warn(ab, "failed to fetch ftm msg\n");
 		return;
@@ -167,7 +167,7 @@ void ath12k_tm_process_event(struct ath12k_base *ab, u32 cmd_id,
 	ath12k_dbg_dump(ab, ATH12K_DBG_TESTMODE, NULL, "", ftm_msg, length);
 
 	if (test_bit(WMI_TLV_SERVICE_PDEV_PARAM_IN_UTF_WMI, ab->wmi_ab.svc_map)) {
-		param = tb[WMI_TAG_PDEV_UTF_EVENT_FIXED_PARAM];
+		param = ath12k_wmi_tlv_tb_get(tb, WMI_TAG_PDEV_UTF_EVENT_FIXED_PARAM);
 		if (!param) {
 			ath12k_warn(ab, "failed to fetch utf msg\n");
 			return;
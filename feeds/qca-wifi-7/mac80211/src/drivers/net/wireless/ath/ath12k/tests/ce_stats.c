@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * KUnit tests for the CE latency histogram
+ */
+#include <kunit/test.h>
+#include "../core.h"
+#include "../ce_stats.h"
+
+MODULE_IMPORT_NS("EXPORTED_FOR_KUNIT_TESTING");
+
+static const struct bucket_case {
+	const char *desc;
+	u64 time_us;
+	unsigned int bucket;
+} bucket_cases[] = {
+	{ .desc = "0us", .time_us = 0, .bucket = 0 },
+	{ .desc = "1us", .time_us = 1, .bucket = 1 },
+	{ .desc = "2us", .time_us = 2, .bucket = 2 },
+	{ .desc = "3us", .time_us = 3, .bucket = 2 },
+	{ .desc = "4us", .time_us = 4, .bucket = 3 },
+	{ .desc = "1023us", .time_us = 1023, .bucket = 10 },
+	{ .desc = "1024us", .time_us = 1024, .bucket = 11 },
+	{ .desc = "last closed bucket", .time_us = (1ULL << 18) - 1, .bucket = 18 },
+	{ .desc = "open bucket start", .time_us = 1ULL << 18, .bucket = 19 },
+	{ .desc = "1s", .time_us = USEC_PER_SEC, .bucket = 19 },
+	{ .desc = "u64 max", .time_us = U64_MAX, .bucket = 19 },
+};
+
+KUNIT_ARRAY_PARAM_DESC(bucket, bucket_cases, desc);
+
+static void bucket(struct kunit *test)
+{
+	const struct bucket_case *params = test->param_value;
+	unsigned int b = ath12k_ce_stats_bucket(params->time_us);
+
+	KUNIT_ASSERT_EQ(test, b, params->bucket);
+
+	/* the limits reported by debugfs agree with the bucketing */
+	if (b < CE_STATS_HIST_BUCKETS - 1)
+		KUNIT_EXPECT_LT(test, params->time_us, ath12k_ce_stats_bucket_limit(b));
+	else
+		KUNIT_EXPECT_GE(test, params->time_us, ath12k_ce_stats_bucket_limit(b));
+	if (b)
+		KUNIT_EXPECT_GE(test, params->time_us,
+				ath12k_ce_stats_bucket_limit(b - 1));
+}
+
+static void hist_add(struct kunit *test)
+{
+	struct ath12k_ce_stats_hist hist = {};
+
+	ath12k_ce_stats_hist_add(&hist, 10, 100);
+	ath12k_ce_stats_hist_add(&hist, 12, 200);
+	ath12k_ce_stats_hist_add(&hist, 0, 300);
+
+	KUNIT_EXPECT_EQ(test, hist.count[4], 2);
+	KUNIT_EXPECT_EQ(test, hist.last_update[4], 200);
+	KUNIT_EXPECT_EQ(test, hist.count[0], 1);
+	KUNIT_EXPECT_EQ(test, hist.last_update[0], 300);
+	KUNIT_EXPECT_EQ(test, hist.count[5], 0);
+}
+
+static void percentile(struct kunit *test)
+{
+	struct ath12k_ce_stats_hist hist = {};
+	int i;
+
+	KUNIT_EXPECT_EQ(test, ath12k_ce_stats_percentile(&hist, 50), 0);
+
+	/* 90 fast runs in [8, 16) us and a 10% tail in [4096, 8192) us */
+	for (i = 0; i < 90; i++)
+		ath12k_ce_stats_hist_add(&hist, 10, i);
+	for (i = 0; i < 10; i++)
+		ath12k_ce_stats_hist_add(&hist, 5000, i);
+
+	KUNIT_EXPECT_EQ(test, ath12k_ce_stats_percentile(&hist, 50), 16);
+	KUNIT_EXPECT_EQ(test, ath12k_ce_stats_percentile(&hist, 90), 16);
+	KUNIT_EXPECT_EQ(test, ath12k_ce_stats_percentile(&hist, 91), 8192);
+	KUNIT_EXPECT_EQ(test, ath12k_ce_stats_percentile(&hist, 99), 8192);
+	KUNIT_EXPECT_EQ(test, ath12k_ce_stats_percentile(&hist, 100), 8192);
+	/* out of range percentiles are clamped */
+	KUNIT_EXPECT_EQ(test, ath12k_ce_stats_percentile(&hist, 250), 8192);
+
+	/* a stall in the open ended bucket reports its lower bound */
+	ath12k_ce_stats_hist_add(&hist, 2 * USEC_PER_SEC, 0);
+	KUNIT_EXPECT_EQ(test, ath12k_ce_stats_percentile(&hist, 100),
+			ath12k_ce_stats_bucket_limit(CE_STATS_HIST_BUCKETS - 1));
+	KUNIT_EXPECT_EQ(test, ath12k_ce_stats_percentile(&hist, 99), 8192);
+}
+
+static struct kunit_case ce_stats_test_cases[] = {
+	KUNIT_CASE_PARAM(bucket, bucket_gen_params),
+	KUNIT_CASE(hist_add),
+	KUNIT_CASE(percentile),
+	{}
+};
+
+static struct kunit_suite ce_stats_test_suite = {
+	.name = "ath12k-ce-stats",
+	.test_cases = ce_stats_test_cases,
+};
+
+kunit_test_suite(ce_stats_test_suite);
@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * KUnit tests for the tx MSDU extension descriptor pools
+ */
+#include <linux/dma-mapping.h>
+#include <kunit/device.h>
+#include <kunit/test.h>
+#include "../core.h"
+#include "../dp_tx.h"
+
+struct dp_tx_test_ctx {
+	struct ath12k_base *ab;
+	struct ath12k_dp *dp;
+	u64 dma_mask;
+};
+
+static int dp_tx_test_init(struct kunit *test)
+{
+	struct dp_tx_test_ctx *ctx;
+	struct device *dev;
+	int i;
+
+	ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	dev = kunit_device_register(test, "ath12k-dp-tx-test");
+	if (IS_ERR(dev))
+		return PTR_ERR(dev);
+
+	ctx->dma_mask = DMA_BIT_MASK(32);
+	dev->dma_mask = &ctx->dma_mask;
+	dev->coherent_dma_mask = DMA_BIT_MASK(32);
+
+	ctx->ab = kvzalloc(sizeof(*ctx->ab), GFP_KERNEL);
+	ctx->dp = kvzalloc(sizeof(*ctx->dp), GFP_KERNEL);
+	if (!ctx->ab || !ctx->dp) {
+		kvfree(ctx->ab);
+		kvfree(ctx->dp);
+		return -ENOMEM;
+	}
+
+	ctx->ab->dev = dev;
+	ctx->ab->dp = ctx->dp;
+	ctx->dp->ab = ctx->ab;
+	for (i = 0; i < ATH12K_HW_MAX_QUEUES; i++)
+		spin_lock_init(&ctx->dp->tx_desc_lock[i]);
+
+	test->priv = ctx;
+
+	return 0;
+}
+
+static void dp_tx_test_exit(struct kunit *test)
+{
+	struct dp_tx_test_ctx *ctx = test->priv;
+
+	ath12k_dp_tx_ext_desc_pool_free(ctx->ab);
+	kvfree(ctx->dp);
+	kvfree(ctx->ab);
+}
+
+static void pool_alloc_free(struct kunit *test)
+{
+	struct dp_tx_test_ctx *ctx = test->priv;
+	struct ath12k_tx_ext_desc_pool *pool;
+	int i;
+
+	KUNIT_ASSERT_EQ(test, 0, ath12k_dp_tx_ext_desc_pool_alloc(ctx->ab));
+
+	for (i = 0; i < ATH12K_HW_MAX_QUEUES; i++) {
+		pool = &ctx->dp->tx_ext_desc_pool[i];
+		KUNIT_EXPECT_NOT_NULL(test, pool->vaddr);
+		KUNIT_EXPECT_EQ(test, pool->num_free, ATH12K_TX_EXT_DESC_PER_POOL);
+	}
+
+	ath12k_dp_tx_ext_desc_pool_free(ctx->ab);
+
+	for (i = 0; i < ATH12K_HW_MAX_QUEUES; i++) {
+		pool = &ctx->dp->tx_ext_desc_pool[i];
+		KUNIT_EXPECT_NULL(test, pool->vaddr);
+		KUNIT_EXPECT_EQ(test, pool->num_free, 0);
+	}
+
+	/* freeing twice, as the error paths may, is harmless */
+	ath12k_dp_tx_ext_desc_pool_free(ctx->ab);
+}
+
+static void get_put(struct kunit *test)
+{
+	struct dp_tx_test_ctx *ctx = test->priv;
+	struct ath12k_tx_ext_desc_pool *pool = &ctx->dp->tx_ext_desc_pool[1];
+	struct ath12k_tx_desc_info a = {}, b = {};
+	dma_addr_t paddr;
+	u8 *vaddr;
+
+	KUNIT_ASSERT_EQ(test, 0, ath12k_dp_tx_ext_desc_pool_alloc(ctx->ab));
+
+	/* a recycled slot comes back zeroed */
+	memset(pool->vaddr, 0xa5, ATH12K_TX_EXT_DESC_SIZE);
+
+	vaddr = ath12k_dp_tx_ext_desc_get(ctx->dp, &a, 1, &paddr);
+	KUNIT_ASSERT_NOT_NULL(test, vaddr);
+	KUNIT_EXPECT_EQ(test, a.ext_desc_id, 0);
+	KUNIT_EXPECT_PTR_EQ(test, vaddr, (u8 *)pool->vaddr);
+	KUNIT_EXPECT_EQ(test, paddr, pool->paddr);
+	KUNIT_EXPECT_NULL(test, memchr_inv(vaddr, 0, ATH12K_TX_EXT_DESC_SIZE));
+
+	vaddr = ath12k_dp_tx_ext_desc_get(ctx->dp, &b, 1, &paddr);
+	KUNIT_ASSERT_NOT_NULL(test, vaddr);
+	KUNIT_EXPECT_EQ(test, b.ext_desc_id, 1);
+	KUNIT_EXPECT_PTR_EQ(test, vaddr, (u8 *)pool->vaddr + ATH12K_TX_EXT_DESC_SIZE);
+	KUNIT_EXPECT_EQ(test, paddr, pool->paddr + ATH12K_TX_EXT_DESC_SIZE);
+	KUNIT_EXPECT_EQ(test, pool->num_free, ATH12K_TX_EXT_DESC_PER_POOL - 2);
+
+	/* other pools are not touched */
+	KUNIT_EXPECT_EQ(test, ctx->dp->tx_ext_desc_pool[0].num_free,
+			ATH12K_TX_EXT_DESC_PER_POOL);
+
+	spin_lock_bh(&ctx->dp->tx_desc_lock[1]);
+	ath12k_dp_tx_ext_desc_put_nolock(ctx->dp, &a, 1);
+	KUNIT_EXPECT_EQ(test, a.ext_desc_id, ATH12K_TX_EXT_DESC_ID_INVALID);
+	/* a tx desc without a slot, or released twice, gives nothing back */
+	ath12k_dp_tx_ext_desc_put_nolock(ctx->dp, &a, 1);
+	spin_unlock_bh(&ctx->dp->tx_desc_lock[1]);
+
+	KUNIT_EXPECT_EQ(test, pool->num_free, ATH12K_TX_EXT_DESC_PER_POOL - 1);
+
+	/* the slot just released is the next one handed out */
+	KUNIT_ASSERT_NOT_NULL(test, ath12k_dp_tx_ext_desc_get(ctx->dp, &a, 1, &paddr));
+	KUNIT_EXPECT_EQ(test, a.ext_desc_id, 0);
+}
+
+static void exhaustion(struct kunit *test)
+{
+	struct dp_tx_test_ctx *ctx = test->priv;
+	struct ath12k_tx_ext_desc_pool *pool = &ctx->dp->tx_ext_desc_pool[0];
+	struct ath12k_tx_desc_info *descs, extra = {};
+	dma_addr_t paddr;
+	int i;
+
+	KUNIT_ASSERT_EQ(test, 0, ath12k_dp_tx_ext_desc_pool_alloc(ctx->ab));
+
+	descs = kunit_kcalloc(test, ATH12K_TX_EXT_DESC_PER_POOL, sizeof(*descs),
+			      GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, descs);
+
+	for (i = 0; i < ATH12K_TX_EXT_DESC_PER_POOL; i++)
+		KUNIT_ASSERT_NOT_NULL(test,
+				      ath12k_dp_tx_ext_desc_get(ctx->dp, &descs[i], 0,
+								&paddr));
+
+	/* the caller falls back to dropping the frame */
+	extra.ext_desc_id = ATH12K_TX_EXT_DESC_ID_INVALID;
+	KUNIT_EXPECT_NULL(test, ath12k_dp_tx_ext_desc_get(ctx->dp, &extra, 0, &paddr));
+	KUNIT_EXPECT_EQ(test, extra.ext_desc_id, ATH12K_TX_EXT_DESC_ID_INVALID);
+
+	spin_lock_bh(&ctx->dp->tx_desc_lock[0]);
+	for (i = 0; i < ATH12K_TX_EXT_DESC_PER_POOL; i++)
+		ath12k_dp_tx_ext_desc_put_nolock(ctx->dp, &descs[i], 0);
+	spin_unlock_bh(&ctx->dp->tx_desc_lock[0]);
+
+	KUNIT_EXPECT_EQ(test, pool->num_free, ATH12K_TX_EXT_DESC_PER_POOL);
+	KUNIT_EXPECT_NOT_NULL(test, ath12k_dp_tx_ext_desc_get(ctx->dp, &extra, 0, &paddr));
+}
+
+static struct kunit_case dp_tx_test_cases[] = {
+	KUNIT_CASE(pool_alloc_free),
+	KUNIT_CASE(get_put),
+	KUNIT_CASE(exhaustion),
+	{}
+};
+
+static struct kunit_suite dp_tx_test_suite = {
+	.name = "ath12k-dp-tx",
+	.init = dp_tx_test_init,
+	.exit = dp_tx_test_exit,
+	.test_cases = dp_tx_test_cases,
+};
+
+kunit_test_suite(dp_tx_test_suite);
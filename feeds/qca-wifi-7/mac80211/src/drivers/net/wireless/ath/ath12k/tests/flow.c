@@ -0,0 +1,356 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * KUnit tests for the rx flow search table hash and its host mirror
+ */
+#include <linux/dma-mapping.h>
+#include <linux/timekeeping.h>
+#include <linux/random.h>
+#include <kunit/device.h>
+#include <kunit/test.h>
+#include "util.h"
+#include "../core.h"
+#include "../wifi7/dp_rx.h"
+#include "../wifi7/hal_rx.h"
+
+MODULE_IMPORT_NS("EXPORTED_FOR_KUNIT_TESTING");
+
+struct flow_test_ctx {
+	struct ath12k_base *ab;
+	struct hal_rx_fst *hal_fst;
+	struct dp_rx_fst *fst;
+	u64 dma_mask;
+};
+
+static int flow_test_init(struct kunit *test)
+{
+	struct flow_test_ctx *ctx;
+	struct device *dev;
+
+	ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	dev = kunit_device_register(test, "ath12k-flow-test");
+	if (IS_ERR(dev))
+		return PTR_ERR(dev);
+
+	ctx->dma_mask = DMA_BIT_MASK(32);
+	dev->dma_mask = &ctx->dma_mask;
+	dev->coherent_dma_mask = DMA_BIT_MASK(32);
+
+	ctx->fst = kunit_kzalloc(test, sizeof(*ctx->fst), GFP_KERNEL);
+	if (!ctx->fst)
+		return -ENOMEM;
+	hash_init(ctx->fst->flow_map);
+
+	ctx->ab = kvzalloc(sizeof(*ctx->ab), GFP_KERNEL);
+	if (!ctx->ab)
+		return -ENOMEM;
+	ctx->ab->dev = dev;
+
+	ctx->hal_fst = ath12k_wifi7_hal_rx_fst_attach(ctx->ab);
+	if (!ctx->hal_fst) {
+		kvfree(ctx->ab);
+		return -ENOMEM;
+	}
+
+	test->priv = ctx;
+
+	return 0;
+}
+
+static void flow_test_exit(struct kunit *test)
+{
+	struct flow_test_ctx *ctx = test->priv;
+
+	ath12k_wifi7_hal_rx_fst_detach(ctx->ab, ctx->hal_fst);
+	kvfree(ctx->ab);
+}
+
+/* bit n of the hash key as the HW consumes it: the 40 byte key read as a
+ * little endian number and shifted left by 5, most significant bit first
+ */
+static int flow_test_key_bit(const u8 *key, int n)
+{
+	int q = HAL_FST_HASH_KEY_SIZE_BYTES * 8 - 1 - 5 - n;
+
+	if (q < 0)
+		return 0;
+
+	return (key[q / 8] >> (q % 8)) & 1;
+}
+
+/* Bit serial Toeplitz over the tuple as laid out on little endian hosts,
+ * consumed from its last byte, to check the per byte key cache against.
+ */
+static u32 flow_test_toeplitz_ref(const u8 *key,
+				  const struct hal_flow_tuple_info *t)
+{
+	struct {
+		__be32 ip[8];
+		__le32 ports;
+		__le32 proto;
+	} tuple = {
+		.ip = {
+			cpu_to_be32(t->src_ip_127_96), cpu_to_be32(t->src_ip_95_64),
+			cpu_to_be32(t->src_ip_63_32), cpu_to_be32(t->src_ip_31_0),
+			cpu_to_be32(t->dest_ip_127_96), cpu_to_be32(t->dest_ip_95_64),
+			cpu_to_be32(t->dest_ip_63_32), cpu_to_be32(t->dest_ip_31_0),
+		},
+		.ports = cpu_to_le32(t->dest_port << 16 | t->src_port),
+		.proto = cpu_to_le32(t->l4_protocol),
+	};
+	const u8 *data = (const u8 *)&tuple;
+	u32 window = 0, hash = 0;
+	int i, bit;
+
+	for (i = 0; i < 32; i++)
+		window = window << 1 | flow_test_key_bit(key, i);
+
+	for (i = 0; i < HAL_FST_HASH_DATA_SIZE; i++) {
+		for (bit = 7; bit >= 0; bit--) {
+			if (data[HAL_FST_HASH_DATA_SIZE - 1 - i] & BIT(bit))
+				hash ^= window;
+			window = window << 1 |
+				 flow_test_key_bit(key, i * 8 + (7 - bit) + 32);
+		}
+	}
+
+	return (hash >> 12) & (HAL_RX_FLOW_SEARCH_TABLE_SIZE - 1);
+}
+
+static const struct toeplitz_case {
+	const char *desc;
+	struct hal_flow_tuple_info tuple;
+	u32 hash;
+} toeplitz_cases[] = {
+	{
+		.desc = "ipv4 tcp",
+		.tuple = {
+			.src_ip_31_0 = 0xc0a8010a, .dest_ip_31_0 = 0x0a000001,
+			.src_port = 49152, .dest_port = 443, .l4_protocol = 6,
+		},
+		.hash = 1587,
+	},
+	{
+		.desc = "ipv4 tcp reply",
+		.tuple = {
+			.src_ip_31_0 = 0x0a000001, .dest_ip_31_0 = 0xc0a8010a,
+			.src_port = 443, .dest_port = 49152, .l4_protocol = 6,
+		},
+		.hash = 1865,
+	},
+	{
+		.desc = "ipv6 udp",
+		.tuple = {
+			.src_ip_127_96 = 0x20010db8, .src_ip_31_0 = 1,
+			.dest_ip_127_96 = 0x20010db8, .dest_ip_31_0 = 2,
+			.src_port = 5353, .dest_port = 5353, .l4_protocol = 17,
+		},
+		.hash = 435,
+	},
+	{
+		.desc = "all zero",
+		.hash = 0,
+	},
+	{
+		.desc = "all ones",
+		.tuple = {
+			.src_ip_127_96 = U32_MAX, .src_ip_95_64 = U32_MAX,
+			.src_ip_63_32 = U32_MAX, .src_ip_31_0 = U32_MAX,
+			.dest_ip_127_96 = U32_MAX, .dest_ip_95_64 = U32_MAX,
+			.dest_ip_63_32 = U32_MAX, .dest_ip_31_0 = U32_MAX,
+			.src_port = U16_MAX, .dest_port = U16_MAX,
+			.l4_protocol = U8_MAX,
+		},
+		.hash = 641,
+	},
+};
+
+KUNIT_ARRAY_PARAM_DESC(toeplitz, toeplitz_cases, desc);
+
+static void toeplitz(struct kunit *test)
+{
+	const struct toeplitz_case *params = test->param_value;
+	struct flow_test_ctx *ctx = test->priv;
+	struct hal_flow_tuple_info tuple = params->tuple;
+
+	/* the cache is indexed by the in-memory bytes of the tuple words */
+	if (IS_ENABLED(CONFIG_CPU_BIG_ENDIAN))
+		kunit_skip(test, "reference vectors are for little endian hosts");
+
+	KUNIT_EXPECT_EQ(test, ath12k_wifi7_hal_flow_toeplitz_hash(ctx->ab, ctx->hal_fst,
+								  &tuple),
+			params->hash);
+	KUNIT_EXPECT_EQ(test, flow_test_toeplitz_ref(ctx->hal_fst->key, &tuple),
+			params->hash);
+}
+
+static void toeplitz_random(struct kunit *test)
+{
+	struct flow_test_ctx *ctx = test->priv;
+	struct hal_flow_tuple_info tuple;
+	unsigned int i, mismatches = 0;
+
+	if (IS_ENABLED(CONFIG_CPU_BIG_ENDIAN))
+		kunit_skip(test, "reference vectors are for little endian hosts");
+
+	for (i = 0; i < 1024; i++) {
+		get_random_bytes(&tuple, sizeof(tuple));
+		tuple.src_port &= U16_MAX;
+		tuple.dest_port &= U16_MAX;
+		tuple.l4_protocol &= U8_MAX;
+
+		if (ath12k_wifi7_hal_flow_toeplitz_hash(ctx->ab, ctx->hal_fst, &tuple) !=
+		    flow_test_toeplitz_ref(ctx->hal_fst->key, &tuple))
+			mismatches++;
+	}
+
+	KUNIT_EXPECT_EQ(test, mismatches, 0);
+}
+
+static void flow_test_fill(struct dp_rx_fse *fse, unsigned int i)
+{
+	memset(&fse->tuple_info, 0, sizeof(fse->tuple_info));
+	fse->tuple_info.src_ip_31_0 = 0xc0a80000 | i;
+	fse->tuple_info.dest_ip_31_0 = 0x0a000001;
+	fse->tuple_info.src_port = 1024 + i;
+	fse->tuple_info.dest_port = 443;
+	fse->tuple_info.l4_protocol = 6;
+	fse->flow_id = i;
+	fse->is_valid = true;
+}
+
+static void map_find(struct kunit *test)
+{
+	struct flow_test_ctx *ctx = test->priv;
+	struct hal_flow_tuple_info tuple;
+	struct dp_rx_fse a, b;
+
+	flow_test_fill(&a, 1);
+	flow_test_fill(&b, 1);
+	/* same addresses and ports, different protocol */
+	b.tuple_info.l4_protocol = 17;
+
+	KUNIT_EXPECT_NULL(test, ath12k_dp_rx_flow_map_find(ctx->fst, &a.tuple_info));
+
+	ath12k_dp_rx_flow_map_add(ctx->fst, &a);
+	ath12k_dp_rx_flow_map_add(ctx->fst, &b);
+
+	tuple = a.tuple_info;
+	KUNIT_EXPECT_PTR_EQ(test, ath12k_dp_rx_flow_map_find(ctx->fst, &tuple), &a);
+	tuple.l4_protocol = 17;
+	KUNIT_EXPECT_PTR_EQ(test, ath12k_dp_rx_flow_map_find(ctx->fst, &tuple), &b);
+	tuple.l4_protocol = 1;
+	KUNIT_EXPECT_NULL(test, ath12k_dp_rx_flow_map_find(ctx->fst, &tuple));
+
+	/* delete unlinks from the mirror as the driver does */
+	hash_del(&a.node);
+	KUNIT_EXPECT_NULL(test, ath12k_dp_rx_flow_map_find(ctx->fst, &a.tuple_info));
+	KUNIT_EXPECT_PTR_EQ(test, ath12k_dp_rx_flow_map_find(ctx->fst, &b.tuple_info),
+			    &b);
+}
+
+static void map_full(struct kunit *test)
+{
+	struct flow_test_ctx *ctx = test->priv;
+	const unsigned int n = HAL_RX_FLOW_SEARCH_TABLE_SIZE;
+	unsigned int i, misses = 0, stale = 0;
+	struct dp_rx_fse *fse;
+
+	fse = kunit_kcalloc(test, n, sizeof(*fse), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, fse);
+
+	/* a full HW table is twice as many flows as buckets, so they chain */
+	for (i = 0; i < n; i++) {
+		flow_test_fill(&fse[i], i);
+		ath12k_dp_rx_flow_map_add(ctx->fst, &fse[i]);
+	}
+
+	for (i = 0; i < n; i++)
+		if (ath12k_dp_rx_flow_map_find(ctx->fst, &fse[i].tuple_info) != &fse[i])
+			misses++;
+	KUNIT_EXPECT_EQ(test, misses, 0);
+
+	for (i = 0; i < n; i += 2)
+		hash_del(&fse[i].node);
+
+	for (i = 0; i < n; i++) {
+		struct dp_rx_fse *found;
+
+		found = ath12k_dp_rx_flow_map_find(ctx->fst, &fse[i].tuple_info);
+		if (i % 2 && found != &fse[i])
+			misses++;
+		if (!(i % 2) && found)
+			stale++;
+	}
+	KUNIT_EXPECT_EQ(test, misses, 0);
+	KUNIT_EXPECT_EQ(test, stale, 0);
+
+	/* freed slots are reused for new flows */
+	for (i = 0; i < n; i += 2) {
+		fse[i].tuple_info.dest_port = 80;
+		ath12k_dp_rx_flow_map_add(ctx->fst, &fse[i]);
+	}
+
+	for (i = 0; i < n; i++)
+		if (ath12k_dp_rx_flow_map_find(ctx->fst, &fse[i].tuple_info) != &fse[i])
+			misses++;
+	KUNIT_EXPECT_EQ(test, misses, 0);
+}
+
+static void bench_find(struct kunit *test)
+{
+	struct flow_test_ctx *ctx = test->priv;
+	const unsigned int n = HAL_RX_FLOW_SEARCH_TABLE_SIZE;
+	unsigned int i, misses = 0;
+	struct dp_rx_fse *fse;
+	u64 start, mapped, hashed;
+
+	fse = kunit_kcalloc(test, n, sizeof(*fse), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, fse);
+
+	for (i = 0; i < n; i++) {
+		flow_test_fill(&fse[i], i);
+		ath12k_dp_rx_flow_map_add(ctx->fst, &fse[i]);
+	}
+
+	start = ktime_get_ns();
+	for (i = 0; i < ATH12K_BENCH_ITERATIONS; i++) {
+		struct dp_rx_fse *f = &fse[(i * 7919) % n];
+
+		if (ath12k_dp_rx_flow_map_find(ctx->fst, &f->tuple_info) != f)
+			misses++;
+	}
+	mapped = ktime_get_ns() - start;
+
+	/* what every lookup cost before, ahead of any HW table probing */
+	start = ktime_get_ns();
+	for (i = 0; i < ATH12K_BENCH_ITERATIONS; i++)
+		ath12k_wifi7_hal_flow_toeplitz_hash(ctx->ab, ctx->hal_fst,
+						    &fse[(i * 7919) % n].tuple_info);
+	hashed = ktime_get_ns() - start;
+
+	KUNIT_EXPECT_EQ(test, misses, 0);
+	ath12k_bench_report(test, "flow_map_find", mapped, ATH12K_BENCH_ITERATIONS);
+	ath12k_bench_report(test, "flow_toeplitz_hash", hashed,
+			    ATH12K_BENCH_ITERATIONS);
+}
+
+static struct kunit_case flow_test_cases[] = {
+	KUNIT_CASE_PARAM(toeplitz, toeplitz_gen_params),
+	KUNIT_CASE(toeplitz_random),
+	KUNIT_CASE(map_find),
+	KUNIT_CASE(map_full),
+	KUNIT_CASE(bench_find),
+	{}
+};
+
+static struct kunit_suite flow_test_suite = {
+	.name = "ath12k-flow",
+	.init = flow_test_init,
+	.exit = flow_test_exit,
+	.test_cases = flow_test_cases,
+};
+
+kunit_test_suite(flow_test_suite);
@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * KUnit tests for the rx defragmentation slots
+ */
+#include <kunit/test.h>
+#include "../core.h"
+#include "../dp_rx.h"
+
+static int frag_test_init(struct kunit *test)
+{
+	struct ath12k_dp_rx_tid *rx_tid;
+	struct ath12k_dp *dp;
+
+	rx_tid = kunit_kzalloc(test, sizeof(*rx_tid), GFP_KERNEL);
+	if (!rx_tid)
+		return -ENOMEM;
+
+	dp = kvzalloc(sizeof(*dp), GFP_KERNEL);
+	if (!dp)
+		return -ENOMEM;
+
+	spin_lock_init(&dp->dp_lock);
+	rx_tid->dp = dp;
+	test->priv = rx_tid;
+
+	return 0;
+}
+
+static void frag_test_exit(struct kunit *test)
+{
+	struct ath12k_dp_rx_tid *rx_tid = test->priv;
+	struct ath12k_dp *dp = rx_tid->dp;
+
+	spin_lock_bh(&dp->dp_lock);
+	ath12k_dp_rx_frags_cleanup(rx_tid, false);
+	spin_unlock_bh(&dp->dp_lock);
+
+	kvfree(dp);
+}
+
+static int frag_test_insert(struct kunit *test, u16 seqno, u16 frag_no,
+			    bool more_frags)
+{
+	struct ath12k_dp_rx_tid *rx_tid = test->priv;
+	struct sk_buff *msdu;
+	int ret;
+
+	msdu = alloc_skb(64, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, msdu);
+
+	spin_lock_bh(&rx_tid->dp->dp_lock);
+	ret = ath12k_dp_rx_frag_insert(rx_tid, msdu, seqno, frag_no, more_frags);
+	spin_unlock_bh(&rx_tid->dp->dp_lock);
+
+	/* rejected fragments stay with the caller */
+	if (ret < 0)
+		kfree_skb(msdu);
+	else
+		KUNIT_EXPECT_PTR_EQ(test, rx_tid->rx_frags[frag_no], msdu);
+
+	return ret;
+}
+
+static void in_order(struct kunit *test)
+{
+	struct ath12k_dp_rx_tid *rx_tid = test->priv;
+
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 100, 0, true), 0);
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 100, 1, true), 0);
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 100, 2, false), 1);
+
+	KUNIT_EXPECT_EQ(test, rx_tid->cur_sn, 100);
+	KUNIT_EXPECT_EQ(test, rx_tid->last_frag_no, 2);
+	KUNIT_EXPECT_EQ(test, rx_tid->rx_frag_bitmap, 0x7);
+}
+
+static void out_of_order(struct kunit *test)
+{
+	struct ath12k_dp_rx_tid *rx_tid = test->priv;
+
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 2, false), 0);
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 0, true), 0);
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 1, true), 1);
+
+	KUNIT_EXPECT_EQ(test, rx_tid->rx_frag_bitmap, 0x7);
+}
+
+static void duplicate(struct kunit *test)
+{
+	struct ath12k_dp_rx_tid *rx_tid = test->priv;
+	struct sk_buff *first;
+
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 0, true), 0);
+	first = rx_tid->rx_frags[0];
+
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 0, true), -EINVAL);
+	KUNIT_EXPECT_PTR_EQ(test, rx_tid->rx_frags[0], first);
+	KUNIT_EXPECT_EQ(test, rx_tid->rx_frag_bitmap, 0x1);
+
+	/* a retransmitted last fragment does not complete anything either */
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 1, false), 1);
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 1, false), -EINVAL);
+}
+
+static void missing(struct kunit *test)
+{
+	struct ath12k_dp_rx_tid *rx_tid = test->priv;
+
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 0, true), 0);
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 2, false), 0);
+	KUNIT_EXPECT_EQ(test, rx_tid->rx_frag_bitmap, 0x5);
+
+	/* the next MPDU flushes the incomplete one */
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 8, 1, true), 0);
+	KUNIT_EXPECT_EQ(test, rx_tid->cur_sn, 8);
+	KUNIT_EXPECT_EQ(test, rx_tid->rx_frag_bitmap, 0x2);
+	KUNIT_EXPECT_EQ(test, rx_tid->last_frag_no, 0);
+	KUNIT_EXPECT_NULL(test, rx_tid->rx_frags[0]);
+	KUNIT_EXPECT_NULL(test, rx_tid->rx_frags[2]);
+
+	/* only the first fragment seen so far, nothing to complete */
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 9, 0, true), 0);
+	KUNIT_EXPECT_EQ(test, rx_tid->rx_frag_bitmap, 0x1);
+}
+
+static void oversized(struct kunit *test)
+{
+	struct ath12k_dp_rx_tid *rx_tid = test->priv;
+	int i;
+
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, ATH12K_DP_RX_MAX_FRAGS, true),
+			-EINVAL);
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, U16_MAX, false), -EINVAL);
+
+	/* the largest MPDU that fits completes */
+	for (i = 0; i < ATH12K_DP_RX_MAX_FRAGS - 1; i++)
+		KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, i, true), 0);
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, ATH12K_DP_RX_MAX_FRAGS - 1,
+						false), 1);
+	KUNIT_EXPECT_EQ(test, rx_tid->rx_frag_bitmap, 0xffff);
+}
+
+static void past_last(struct kunit *test)
+{
+	struct ath12k_dp_rx_tid *rx_tid = test->priv;
+
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 0, true), 0);
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 2, false), 0);
+
+	/* a fragment behind the last one could never complete the MPDU */
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 3, true), -EINVAL);
+	KUNIT_EXPECT_EQ(test, rx_tid->rx_frag_bitmap, 0x5);
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 7, 1, true), 1);
+
+	/* nor may the last fragment arrive after a later one */
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 8, 3, true), 0);
+	KUNIT_EXPECT_EQ(test, frag_test_insert(test, 8, 1, false), -EINVAL);
+	KUNIT_EXPECT_EQ(test, rx_tid->last_frag_no, 0);
+}
+
+static struct kunit_case frag_test_cases[] = {
+	KUNIT_CASE(in_order),
+	KUNIT_CASE(out_of_order),
+	KUNIT_CASE(duplicate),
+	KUNIT_CASE(missing),
+	KUNIT_CASE(oversized),
+	KUNIT_CASE(past_last),
+	{}
+};
+
+static struct kunit_suite frag_test_suite = {
+	.name = "ath12k-rx-frag",
+	.init = frag_test_init,
+	.exit = frag_test_exit,
+	.test_cases = frag_test_cases,
+};
+
+kunit_test_suite(frag_test_suite);
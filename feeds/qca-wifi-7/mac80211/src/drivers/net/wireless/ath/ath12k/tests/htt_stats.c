@@ -0,0 +1,333 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * KUnit tests for the binary and text HTT stats exports
+ */
+#include <kunit/test.h>
+#include "../core.h"
+#include "../dp_htt.h"
+#include "../debugfs_htt_stats.h"
+
+MODULE_IMPORT_NS("EXPORTED_FOR_KUNIT_TESTING");
+
+#define HTT_STATS_TEST_PDEV_ID	1
+#define HTT_STATS_TEST_SIFS	4
+
+/* a PDEV_TX reply as the firmware sends it, in two HTT messages */
+struct htt_stats_test_stream {
+	struct {
+		__le32 header;
+		struct ath12k_htt_tx_pdev_stats_cmn_tlv cmn;
+	} __packed msg1;
+	struct {
+		__le32 header;
+		__le32 sifs_status[HTT_STATS_TEST_SIFS];
+	} __packed msg2;
+};
+
+static const struct htt_stats_test_field {
+	const char *name;
+	size_t offset;
+} htt_stats_test_fields[] = {
+	{ "hw_queued", offsetof(struct ath12k_htt_tx_pdev_stats_cmn_tlv, hw_queued) },
+	{ "hw_reaped", offsetof(struct ath12k_htt_tx_pdev_stats_cmn_tlv, hw_reaped) },
+	{ "underrun", offsetof(struct ath12k_htt_tx_pdev_stats_cmn_tlv, underrun) },
+	{ "tx_abort", offsetof(struct ath12k_htt_tx_pdev_stats_cmn_tlv, tx_abort) },
+	{ "ppdu_ok", offsetof(struct ath12k_htt_tx_pdev_stats_cmn_tlv, ppdu_ok) },
+	{ "mpdu_requeued", offsetof(struct ath12k_htt_tx_pdev_stats_cmn_tlv, mpdu_requed) },
+	{ "tx_xretry", offsetof(struct ath12k_htt_tx_pdev_stats_cmn_tlv, tx_xretry) },
+	{ "comp_delivered",
+	  offsetof(struct ath12k_htt_tx_pdev_stats_cmn_tlv, comp_delivered) },
+};
+
+struct htt_stats_test_ctx {
+	struct ath12k_base *ab;
+	struct debug_htt_stats_req *text;
+	struct debug_htt_stats_req *bin;
+	struct htt_stats_test_stream stream;
+};
+
+static struct debug_htt_stats_req *htt_stats_test_req(bool binary)
+{
+	struct debug_htt_stats_req *stats_req;
+
+	stats_req = kvzalloc(sizeof(*stats_req) + ATH12K_HTT_STATS_BUF_SIZE,
+			     GFP_KERNEL);
+	if (!stats_req)
+		return NULL;
+
+	stats_req->type = ATH12K_DBG_HTT_EXT_STATS_PDEV_TX;
+	stats_req->pdev_id = HTT_STATS_TEST_PDEV_ID;
+	if (binary) {
+		stats_req->binary = true;
+		stats_req->buf_len = sizeof(struct ath12k_htt_stats_bin_hdr);
+	}
+
+	return stats_req;
+}
+
+static void htt_stats_test_fill(struct htt_stats_test_stream *s)
+{
+	__le32 *words = (__le32 *)&s->msg1.cmn;
+	unsigned int i;
+
+	s->msg1.header = le32_encode_bits(HTT_STATS_TX_PDEV_CMN_TAG, HTT_TLV_TAG) |
+			 le32_encode_bits(sizeof(s->msg1.cmn), HTT_TLV_LEN);
+	/* distinct values so a field read from the wrong offset shows up */
+	for (i = 0; i < sizeof(s->msg1.cmn) / sizeof(u32); i++)
+		words[i] = cpu_to_le32(1000 + i * 7);
+	s->msg1.cmn.mac_id__word = cpu_to_le32(HTT_STATS_TEST_PDEV_ID);
+
+	s->msg2.header = le32_encode_bits(HTT_STATS_TX_PDEV_SIFS_TAG, HTT_TLV_TAG) |
+			 le32_encode_bits(sizeof(s->msg2.sifs_status), HTT_TLV_LEN);
+	for (i = 0; i < HTT_STATS_TEST_SIFS; i++)
+		s->msg2.sifs_status[i] = cpu_to_le32(10 * (i + 1));
+}
+
+static int htt_stats_test_init(struct kunit *test)
+{
+	struct htt_stats_test_ctx *ctx;
+
+	ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	/* only ab->dev is looked at, for the parse errors */
+	ctx->ab = kvzalloc(sizeof(*ctx->ab), GFP_KERNEL);
+	ctx->text = htt_stats_test_req(false);
+	ctx->bin = htt_stats_test_req(true);
+	if (!ctx->ab || !ctx->text || !ctx->bin) {
+		kvfree(ctx->ab);
+		kvfree(ctx->text);
+		kvfree(ctx->bin);
+		return -ENOMEM;
+	}
+
+	htt_stats_test_fill(&ctx->stream);
+	test->priv = ctx;
+
+	return 0;
+}
+
+static void htt_stats_test_exit(struct kunit *test)
+{
+	struct htt_stats_test_ctx *ctx = test->priv;
+
+	kvfree(ctx->bin);
+	kvfree(ctx->text);
+	kvfree(ctx->ab);
+}
+
+static bool htt_stats_test_add(struct htt_stats_test_ctx *ctx,
+			       struct debug_htt_stats_req *stats_req,
+			       const void *msg, u32 len, bool done)
+{
+	return ath12k_htt_stats_msg_add(ctx->ab, stats_req, msg, len, done);
+}
+
+static u32 htt_stats_test_le32(const void *p)
+{
+	__le32 v;
+
+	memcpy(&v, p, sizeof(v));
+
+	return le32_to_cpu(v);
+}
+
+static const struct ath12k_htt_stats_bin_hdr *
+htt_stats_test_hdr(struct debug_htt_stats_req *stats_req)
+{
+	return (const struct ath12k_htt_stats_bin_hdr *)stats_req->buf;
+}
+
+static void bin_matches_text(struct kunit *test)
+{
+	struct htt_stats_test_ctx *ctx = test->priv;
+	struct htt_stats_test_stream *s = &ctx->stream;
+	const struct ath12k_htt_stats_bin_hdr *hdr;
+	const char *text = (const char *)ctx->text->buf;
+	const char *sifs;
+	const u8 *tlv, *end;
+	char needle[64];
+	unsigned int i;
+
+	KUNIT_EXPECT_FALSE(test, htt_stats_test_add(ctx, ctx->text, &s->msg1,
+						    sizeof(s->msg1), false));
+	KUNIT_EXPECT_TRUE(test, htt_stats_test_add(ctx, ctx->text, &s->msg2,
+						   sizeof(s->msg2), true));
+	KUNIT_EXPECT_FALSE(test, htt_stats_test_add(ctx, ctx->bin, &s->msg1,
+						    sizeof(s->msg1), false));
+	KUNIT_EXPECT_TRUE(test, htt_stats_test_add(ctx, ctx->bin, &s->msg2,
+						   sizeof(s->msg2), true));
+	ath12k_htt_stats_bin_fill_hdr(ctx->bin, false);
+
+	hdr = htt_stats_test_hdr(ctx->bin);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(hdr->magic), ATH12K_HTT_STATS_BIN_MAGIC);
+	KUNIT_EXPECT_EQ(test, le16_to_cpu(hdr->version), ATH12K_HTT_STATS_BIN_VERSION);
+	KUNIT_EXPECT_EQ(test, le16_to_cpu(hdr->hdr_len), sizeof(*hdr));
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(hdr->stats_type),
+			ATH12K_DBG_HTT_EXT_STATS_PDEV_TX);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(hdr->pdev_id), HTT_STATS_TEST_PDEV_ID);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(hdr->flags), 0);
+	KUNIT_ASSERT_EQ(test, le32_to_cpu(hdr->tlv_len), sizeof(*s));
+	KUNIT_EXPECT_MEMEQ(test, ctx->bin->buf + sizeof(*hdr), s, sizeof(*s));
+
+	/* decode the binary TLVs and find each value in the text dump */
+	tlv = ctx->bin->buf + le16_to_cpu(hdr->hdr_len);
+	end = tlv + le32_to_cpu(hdr->tlv_len);
+	while (tlv + sizeof(struct htt_tlv) <= end) {
+		const struct htt_tlv *t = (const struct htt_tlv *)tlv;
+		u16 tag = le32_get_bits(t->header, HTT_TLV_TAG);
+		u16 len = le32_get_bits(t->header, HTT_TLV_LEN);
+
+		KUNIT_ASSERT_TRUE(test, t->value + len <= end);
+
+		switch (tag) {
+		case HTT_STATS_TX_PDEV_CMN_TAG:
+			KUNIT_ASSERT_EQ(test, len, sizeof(s->msg1.cmn));
+			snprintf(needle, sizeof(needle), "\nmac_id = %u\n",
+				 u32_get_bits(htt_stats_test_le32(t->value),
+					      ATH12K_HTT_STATS_MAC_ID));
+			KUNIT_EXPECT_NOT_NULL_MSG(test, strstr(text, needle), "%s", needle);
+
+			for (i = 0; i < ARRAY_SIZE(htt_stats_test_fields); i++) {
+				const struct htt_stats_test_field *f =
+					&htt_stats_test_fields[i];
+
+				snprintf(needle, sizeof(needle), "\n%s = %u\n", f->name,
+					 htt_stats_test_le32(t->value + f->offset));
+				KUNIT_EXPECT_NOT_NULL_MSG(test, strstr(text, needle),
+							  "%s", needle);
+			}
+			break;
+		case HTT_STATS_TX_PDEV_SIFS_TAG:
+			KUNIT_ASSERT_EQ(test, len, sizeof(s->msg2.sifs_status));
+			sifs = strstr(text, "\nsifs_status = ");
+			KUNIT_ASSERT_NOT_NULL(test, sifs);
+
+			for (i = 0; i < len / sizeof(__le32); i++) {
+				snprintf(needle, sizeof(needle), " %u:%u", i,
+					 htt_stats_test_le32(t->value + i * sizeof(__le32)));
+				KUNIT_EXPECT_NOT_NULL_MSG(test, strstr(sifs, needle),
+							  "%s", needle);
+			}
+			break;
+		default:
+			KUNIT_FAIL(test, "unexpected tag %u", tag);
+		}
+
+		tlv = t->value + len;
+	}
+	KUNIT_EXPECT_PTR_EQ(test, tlv, end);
+}
+
+static void bin_replays_to_text(struct kunit *test)
+{
+	struct htt_stats_test_ctx *ctx = test->priv;
+	struct htt_stats_test_stream *s = &ctx->stream;
+	struct debug_htt_stats_req *replay;
+
+	replay = htt_stats_test_req(false);
+	KUNIT_ASSERT_NOT_NULL(test, replay);
+
+	htt_stats_test_add(ctx, ctx->text, &s->msg1, sizeof(s->msg1), false);
+	htt_stats_test_add(ctx, ctx->text, &s->msg2, sizeof(s->msg2), true);
+	htt_stats_test_add(ctx, ctx->bin, &s->msg1, sizeof(s->msg1), false);
+	htt_stats_test_add(ctx, ctx->bin, &s->msg2, sizeof(s->msg2), true);
+	ath12k_htt_stats_bin_fill_hdr(ctx->bin, false);
+
+	/* a collector formatting the binary payload gets the text dump back */
+	htt_stats_test_add(ctx, replay,
+			   ctx->bin->buf + sizeof(struct ath12k_htt_stats_bin_hdr),
+			   le32_to_cpu(htt_stats_test_hdr(ctx->bin)->tlv_len), true);
+
+	KUNIT_EXPECT_EQ(test, replay->buf_len, ctx->text->buf_len);
+	KUNIT_EXPECT_MEMEQ(test, replay->buf, ctx->text->buf, ctx->text->buf_len);
+
+	kvfree(replay);
+}
+
+static void late_message(struct kunit *test)
+{
+	struct htt_stats_test_ctx *ctx = test->priv;
+	struct htt_stats_test_stream *s = &ctx->stream;
+	u32 bin_len, text_len;
+
+	htt_stats_test_add(ctx, ctx->bin, &s->msg1, sizeof(s->msg1), true);
+	htt_stats_test_add(ctx, ctx->text, &s->msg1, sizeof(s->msg1), true);
+	ath12k_htt_stats_bin_fill_hdr(ctx->bin, false);
+	bin_len = ctx->bin->buf_len;
+	text_len = ctx->text->buf_len;
+
+	/* arrives while the reader copies out the completed request */
+	KUNIT_EXPECT_FALSE(test, htt_stats_test_add(ctx, ctx->bin, &s->msg2,
+						    sizeof(s->msg2), true));
+	KUNIT_EXPECT_FALSE(test, htt_stats_test_add(ctx, ctx->text, &s->msg2,
+						    sizeof(s->msg2), true));
+
+	KUNIT_EXPECT_EQ(test, ctx->bin->buf_len, bin_len);
+	KUNIT_EXPECT_EQ(test, ctx->text->buf_len, text_len);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(htt_stats_test_hdr(ctx->bin)->tlv_len),
+			sizeof(s->msg1));
+}
+
+static void timed_out(struct kunit *test)
+{
+	struct htt_stats_test_ctx *ctx = test->priv;
+	struct htt_stats_test_stream *s = &ctx->stream;
+	const struct ath12k_htt_stats_bin_hdr *hdr = htt_stats_test_hdr(ctx->bin);
+
+	KUNIT_EXPECT_FALSE(test, htt_stats_test_add(ctx, ctx->bin, &s->msg1,
+						    sizeof(s->msg1), false));
+
+	/* what ath12k_debugfs_htt_stats_req() does on timeout */
+	ctx->bin->done = true;
+	ath12k_htt_stats_bin_fill_hdr(ctx->bin, true);
+
+	/* the rest of the reply shows up after the reader gave up */
+	KUNIT_EXPECT_FALSE(test, htt_stats_test_add(ctx, ctx->bin, &s->msg2,
+						    sizeof(s->msg2), true));
+
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(hdr->flags),
+			ATH12K_HTT_STATS_BIN_FLAG_TIMEOUT);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(hdr->tlv_len), sizeof(s->msg1));
+	KUNIT_EXPECT_EQ(test, ctx->bin->buf_len, sizeof(*hdr) + sizeof(s->msg1));
+}
+
+static void truncated(struct kunit *test)
+{
+	struct htt_stats_test_ctx *ctx = test->priv;
+	struct htt_stats_test_stream *s = &ctx->stream;
+	const struct ath12k_htt_stats_bin_hdr *hdr = htt_stats_test_hdr(ctx->bin);
+	u32 full = ATH12K_HTT_STATS_BUF_SIZE - sizeof(s->msg2) - 1;
+
+	/* room for the second message but not the first */
+	ctx->bin->buf_len = full;
+
+	htt_stats_test_add(ctx, ctx->bin, &s->msg1, sizeof(s->msg1), false);
+	KUNIT_EXPECT_EQ(test, ctx->bin->buf_len, full);
+	htt_stats_test_add(ctx, ctx->bin, &s->msg2, sizeof(s->msg2), true);
+	KUNIT_EXPECT_EQ(test, ctx->bin->buf_len, full + sizeof(s->msg2));
+
+	ath12k_htt_stats_bin_fill_hdr(ctx->bin, false);
+	KUNIT_EXPECT_EQ(test, le32_to_cpu(hdr->flags),
+			ATH12K_HTT_STATS_BIN_FLAG_TRUNCATED);
+	KUNIT_EXPECT_MEMEQ(test, ctx->bin->buf + full, &s->msg2, sizeof(s->msg2));
+}
+
+static struct kunit_case htt_stats_test_cases[] = {
+	KUNIT_CASE(bin_matches_text),
+	KUNIT_CASE(bin_replays_to_text),
+	KUNIT_CASE(late_message),
+	KUNIT_CASE(timed_out),
+	KUNIT_CASE(truncated),
+	{}
+};
+
+static struct kunit_suite htt_stats_test_suite = {
+	.name = "ath12k-htt-stats",
+	.init = htt_stats_test_init,
+	.exit = htt_stats_test_exit,
+	.test_cases = htt_stats_test_cases,
+};
+
+kunit_test_suite(htt_stats_test_suite);
@@ -0,0 +1,8 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * This is just module boilerplate for the ath12k kunit module.
+ */
+#include <linux/module.h>
+
+MODULE_LICENSE("Dual BSD/GPL");
+MODULE_DESCRIPTION("tests for ath12k");
@@ -0,0 +1,311 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * KUnit tests for the link peer lookup indexes
+ *
+ * The peers live in a bare struct ath12k_dp, so only the id, ML id, address
+ * and AST indexes and the dp->peers fallback are exercised.
+ */
+#include <linux/etherdevice.h>
+#include <linux/timekeeping.h>
+#include <kunit/test.h>
+#include "util.h"
+#include "../core.h"
+#include "../dp_peer.h"
+
+MODULE_IMPORT_NS("EXPORTED_FOR_KUNIT_TESTING");
+
+static int peer_test_init(struct kunit *test)
+{
+	struct ath12k_dp *dp;
+
+	dp = kvzalloc(sizeof(*dp), GFP_KERNEL);
+	if (!dp)
+		return -ENOMEM;
+
+	spin_lock_init(&dp->dp_lock);
+	INIT_LIST_HEAD(&dp->peers);
+	hash_init(dp->peers_by_addr);
+	hash_init(dp->peers_by_ast);
+
+	test->priv = dp;
+
+	return 0;
+}
+
+static void peer_test_exit(struct kunit *test)
+{
+	/* the peers themselves are kunit allocations */
+	kvfree(test->priv);
+}
+
+static void peer_test_addr(u8 *addr, int i)
+{
+	eth_zero_addr(addr);
+	addr[0] = 0x02;
+	addr[4] = i >> 8;
+	addr[5] = i & 0xff;
+}
+
+static struct ath12k_dp_link_peer *
+peer_test_add(struct kunit *test, int peer_id, int vdev_id, u16 ast_hash)
+{
+	struct ath12k_dp *dp = test->priv;
+	struct ath12k_dp_link_peer *peer;
+
+	peer = kunit_kzalloc(test, sizeof(*peer), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, peer);
+
+	peer->peer_id = peer_id;
+	peer->vdev_id = vdev_id;
+	peer->pdev_idx = vdev_id % 3;
+	peer->ast_hash = ast_hash;
+	peer->ml_id = ATH12K_MLO_PEER_ID_INVALID;
+	peer_test_addr(peer->addr, peer_id);
+
+	spin_lock_bh(&dp->dp_lock);
+	list_add(&peer->list, &dp->peers);
+	ath12k_dp_link_peer_index(dp, peer);
+	spin_unlock_bh(&dp->dp_lock);
+
+	return peer;
+}
+
+static void peer_test_del(struct kunit *test, struct ath12k_dp_link_peer *peer)
+{
+	struct ath12k_dp *dp = test->priv;
+
+	spin_lock_bh(&dp->dp_lock);
+	ath12k_dp_link_peer_unindex(peer);
+	list_del(&peer->list);
+	spin_unlock_bh(&dp->dp_lock);
+}
+
+static void lookup(struct kunit *test)
+{
+	struct ath12k_dp *dp = test->priv;
+	struct ath12k_dp_link_peer *peers[64];
+	u8 addr[ETH_ALEN];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(peers); i++)
+		peers[i] = peer_test_add(test, i * 31, i % 8, 0x100 + i);
+
+	spin_lock_bh(&dp->dp_lock);
+	for (i = 0; i < ARRAY_SIZE(peers); i++) {
+		peer_test_addr(addr, i * 31);
+
+		KUNIT_EXPECT_PTR_EQ(test, peers[i],
+				    ath12k_dp_link_peer_find_by_id(dp, i * 31));
+		KUNIT_EXPECT_PTR_EQ(test, peers[i],
+				    ath12k_dp_link_peer_find_by_vdev_id_and_addr(dp, i % 8,
+										 addr));
+		KUNIT_EXPECT_PTR_EQ(test, peers[i],
+				    ath12k_dp_link_peer_find_by_pdev_idx(dp, (i % 8) % 3,
+									 addr));
+		KUNIT_EXPECT_PTR_EQ(test, peers[i],
+				    ath12k_dp_link_peer_find_by_ast(dp, 0x100 + i));
+
+		/* right address on the wrong vdev */
+		KUNIT_EXPECT_NULL(test,
+				  ath12k_dp_link_peer_find_by_vdev_id_and_addr(dp, 8, addr));
+	}
+
+	KUNIT_EXPECT_NULL(test, ath12k_dp_link_peer_find_by_id(dp, 1));
+	KUNIT_EXPECT_NULL(test, ath12k_dp_link_peer_find_by_id(dp,
+								ATH12K_PEER_ID_INVALID));
+	KUNIT_EXPECT_NULL(test, ath12k_dp_link_peer_find_by_ast(dp, 0x42));
+	spin_unlock_bh(&dp->dp_lock);
+}
+
+static void same_addr(struct kunit *test)
+{
+	struct ath12k_dp *dp = test->priv;
+	struct ath12k_dp_link_peer *a, *b;
+
+	/* one station associated to two vdevs shares the address */
+	a = peer_test_add(test, 10, 1, 1);
+	b = peer_test_add(test, 11, 2, 2);
+	peer_test_addr(b->addr, 10);
+
+	spin_lock_bh(&dp->dp_lock);
+	ath12k_dp_link_peer_unindex(b);
+	ath12k_dp_link_peer_index(dp, b);
+
+	KUNIT_EXPECT_PTR_EQ(test, a,
+			    ath12k_dp_link_peer_find_by_vdev_id_and_addr(dp, 1, a->addr));
+	KUNIT_EXPECT_PTR_EQ(test, b,
+			    ath12k_dp_link_peer_find_by_vdev_id_and_addr(dp, 2, a->addr));
+	spin_unlock_bh(&dp->dp_lock);
+}
+
+static void delete(struct kunit *test)
+{
+	struct ath12k_dp *dp = test->priv;
+	struct ath12k_dp_link_peer *a, *b;
+	u8 addr[ETH_ALEN];
+
+	a = peer_test_add(test, 7, 0, 7);
+	b = peer_test_add(test, 7 + ARRAY_SIZE(dp->peers_by_id), 0, 7);
+
+	peer_test_del(test, a);
+	/* unindexing twice is allowed */
+	spin_lock_bh(&dp->dp_lock);
+	ath12k_dp_link_peer_unindex(a);
+
+	peer_test_addr(addr, 7);
+	KUNIT_EXPECT_NULL(test, ath12k_dp_link_peer_find_by_id(dp, 7));
+	KUNIT_EXPECT_NULL(test,
+			  ath12k_dp_link_peer_find_by_vdev_id_and_addr(dp, 0, addr));
+	/* the AST bucket still holds the other peer */
+	KUNIT_EXPECT_PTR_EQ(test, b, ath12k_dp_link_peer_find_by_ast(dp, 7));
+	spin_unlock_bh(&dp->dp_lock);
+
+	peer_test_del(test, b);
+
+	spin_lock_bh(&dp->dp_lock);
+	KUNIT_EXPECT_NULL(test, ath12k_dp_link_peer_find_by_ast(dp, 7));
+	KUNIT_EXPECT_TRUE(test, list_empty(&dp->peers));
+	spin_unlock_bh(&dp->dp_lock);
+}
+
+static void remap(struct kunit *test)
+{
+	struct ath12k_dp *dp = test->priv;
+	struct ath12k_dp_link_peer *peer;
+	u16 ml_id = ATH12K_PEER_ML_ID_VALID | 5;
+
+	peer = peer_test_add(test, 20, 3, 0x20);
+
+	spin_lock_bh(&dp->dp_lock);
+	ath12k_dp_link_peer_set_ml_id(dp, peer, ml_id);
+	KUNIT_EXPECT_PTR_EQ(test, peer, ath12k_dp_link_peer_find_by_id(dp, ml_id));
+	KUNIT_EXPECT_PTR_EQ(test, peer,
+			    ath12k_dp_link_peer_find_by_ml_peer_vdev_id(dp, ml_id, 3));
+	KUNIT_EXPECT_NULL(test,
+			  ath12k_dp_link_peer_find_by_ml_peer_vdev_id(dp, ml_id, 4));
+	/* the link peer id keeps working next to the ML id */
+	KUNIT_EXPECT_PTR_EQ(test, peer, ath12k_dp_link_peer_find_by_id(dp, 20));
+
+	ath12k_dp_link_peer_set_ml_id(dp, peer, ATH12K_PEER_ML_ID_VALID | 6);
+	KUNIT_EXPECT_NULL(test, ath12k_dp_link_peer_find_by_id(dp, ml_id));
+	KUNIT_EXPECT_PTR_EQ(test, peer,
+			    ath12k_dp_link_peer_find_by_id(dp, ATH12K_PEER_ML_ID_VALID | 6));
+
+	ath12k_dp_link_peer_set_ml_id(dp, peer, ATH12K_MLO_PEER_ID_INVALID);
+	KUNIT_EXPECT_NULL(test,
+			  ath12k_dp_link_peer_find_by_id(dp, ATH12K_PEER_ML_ID_VALID | 6));
+
+	ath12k_dp_link_peer_set_ast_hash(dp, peer, 0x21);
+	KUNIT_EXPECT_NULL(test, ath12k_dp_link_peer_find_by_ast(dp, 0x20));
+	KUNIT_EXPECT_PTR_EQ(test, peer, ath12k_dp_link_peer_find_by_ast(dp, 0x21));
+	spin_unlock_bh(&dp->dp_lock);
+}
+
+static void out_of_range(struct kunit *test)
+{
+	struct ath12k_dp *dp = test->priv;
+	struct ath12k_dp_link_peer *peer, *ml_peer;
+	u16 ml_id = ATH12K_PEER_ML_ID_VALID | (DP_MAX_PEER_ID + 1);
+
+	/* ids past the tables are only on dp->peers and must still be found */
+	peer = peer_test_add(test, DP_MAX_PEER_ID + 1, 0, 1);
+	ml_peer = peer_test_add(test, 0, 0, 2);
+
+	spin_lock_bh(&dp->dp_lock);
+	ath12k_dp_link_peer_set_ml_id(dp, ml_peer, ml_id);
+
+	KUNIT_EXPECT_TRUE(test, hlist_unhashed(&peer->id_node));
+	KUNIT_EXPECT_TRUE(test, hlist_unhashed(&ml_peer->ml_id_node));
+
+	KUNIT_EXPECT_PTR_EQ(test, peer,
+			    ath12k_dp_link_peer_find_by_id(dp, DP_MAX_PEER_ID + 1));
+	KUNIT_EXPECT_PTR_EQ(test, ml_peer, ath12k_dp_link_peer_find_by_id(dp, ml_id));
+	KUNIT_EXPECT_NULL(test, ath12k_dp_link_peer_find_by_id(dp, DP_MAX_PEER_ID + 2));
+	KUNIT_EXPECT_NULL(test, ath12k_dp_link_peer_find_by_id(dp, -1));
+	spin_unlock_bh(&dp->dp_lock);
+
+	peer_test_del(test, peer);
+	peer_test_del(test, ml_peer);
+}
+
+static const struct bench_peers_case {
+	const char *desc;
+	unsigned int n;
+} bench_peers_cases[] = {
+	{ .desc = "512 peers", .n = 512 },
+	{ .desc = "2048 peers", .n = 2048 },
+};
+
+KUNIT_ARRAY_PARAM_DESC(bench_peers, bench_peers_cases, desc);
+
+static struct ath12k_dp_link_peer *
+bench_list_find(struct ath12k_dp *dp, int peer_id)
+{
+	struct ath12k_dp_link_peer *peer;
+
+	list_for_each_entry(peer, &dp->peers, list)
+		if (peer->peer_id == peer_id)
+			return peer;
+
+	return NULL;
+}
+
+static void bench_find_by_id(struct kunit *test)
+{
+	const struct bench_peers_case *params = test->param_value;
+	const unsigned int n = params->n;
+	struct ath12k_dp *dp = test->priv;
+	struct ath12k_dp_link_peer *peer;
+	u64 start, indexed, walked;
+	unsigned int i, misses = 0;
+	int id;
+
+	for (i = 0; i < n; i++)
+		peer_test_add(test, i, i % 16, i);
+
+	spin_lock_bh(&dp->dp_lock);
+
+	start = ktime_get_ns();
+	for (i = 0; i < ATH12K_BENCH_ITERATIONS; i++) {
+		id = (i * 7919) % n;
+		peer = ath12k_dp_link_peer_find_by_id(dp, id);
+		if (!peer || peer->peer_id != id)
+			misses++;
+	}
+	indexed = ktime_get_ns() - start;
+
+	start = ktime_get_ns();
+	for (i = 0; i < ATH12K_BENCH_ITERATIONS; i++) {
+		id = (i * 7919) % n;
+		peer = bench_list_find(dp, id);
+		if (!peer || peer->peer_id != id)
+			misses++;
+	}
+	walked = ktime_get_ns() - start;
+
+	spin_unlock_bh(&dp->dp_lock);
+
+	KUNIT_EXPECT_EQ(test, misses, 0);
+	ath12k_bench_report(test, "find_by_id", indexed, ATH12K_BENCH_ITERATIONS);
+	ath12k_bench_report(test, "find_by_id_list_walk", walked,
+			    ATH12K_BENCH_ITERATIONS);
+}
+
+static struct kunit_case peer_test_cases[] = {
+	KUNIT_CASE(lookup),
+	KUNIT_CASE(same_addr),
+	KUNIT_CASE(delete),
+	KUNIT_CASE(remap),
+	KUNIT_CASE(out_of_range),
+	KUNIT_CASE_PARAM(bench_find_by_id, bench_peers_gen_params),
+	{}
+};
+
+static struct kunit_suite peer_test_suite = {
+	.name = "ath12k-peer",
+	.init = peer_test_init,
+	.exit = peer_test_exit,
+	.test_cases = peer_test_cases,
+};
+
+kunit_test_suite(peer_test_suite);
@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * KUnit tests for the pktlog ring shared with userspace
+ */
+#include <linux/vmalloc.h>
+#include <kunit/test.h>
+#include "../core.h"
+#include "../pktlog.h"
+
+MODULE_IMPORT_NS("EXPORTED_FOR_KUNIT_TESTING");
+
+#define PKTLOG_TEST_RING_SIZE	64
+#define PKTLOG_TEST_HDR_SIZE	8
+
+static int pktlog_test_init(struct kunit *test)
+{
+	struct ath12k_pktlog *pl;
+
+	pl = kunit_kzalloc(test, sizeof(*pl), GFP_KERNEL);
+	if (!pl)
+		return -ENOMEM;
+
+	pl->buf = vzalloc(ATH12K_PKTLOG_DATA_OFFSET + PKTLOG_TEST_RING_SIZE);
+	if (!pl->buf)
+		return -ENOMEM;
+
+	spin_lock_init(&pl->lock);
+	pl->ring_size = PKTLOG_TEST_RING_SIZE;
+	pl->hdr_size = PKTLOG_TEST_HDR_SIZE;
+	pl->buf->size = PKTLOG_TEST_RING_SIZE;
+
+	test->priv = pl;
+
+	return 0;
+}
+
+static void pktlog_test_exit(struct kunit *test)
+{
+	struct ath12k_pktlog *pl = test->priv;
+
+	vfree(pl->buf);
+}
+
+static u8 *pktlog_test_data(struct ath12k_pktlog *pl)
+{
+	return (u8 *)pl->buf + ATH12K_PKTLOG_DATA_OFFSET;
+}
+
+/* a record of PKTLOG_TEST_HDR_SIZE header bytes and len payload bytes */
+static bool pktlog_test_write(struct ath12k_pktlog *pl, u8 fill, u16 len)
+{
+	u8 hdr[PKTLOG_TEST_HDR_SIZE], payload[PKTLOG_TEST_RING_SIZE];
+	struct ath12k_pktlog_hdr_arg arg = {
+		.pktlog_hdr = hdr,
+		.payload = payload,
+		.payload_size = len,
+	};
+
+	memset(hdr, fill, sizeof(hdr));
+	memset(payload, fill + 1, len);
+
+	return ath12k_pktlog_ring_write(pl, &arg);
+}
+
+static void ring_used(struct kunit *test)
+{
+	KUNIT_EXPECT_EQ(test, ath12k_pktlog_ring_used(0, 0, 16), 0);
+	KUNIT_EXPECT_EQ(test, ath12k_pktlog_ring_used(5, 2, 16), 3);
+	KUNIT_EXPECT_EQ(test, ath12k_pktlog_ring_used(15, 0, 16), 15);
+	/* head wrapped behind the reader */
+	KUNIT_EXPECT_EQ(test, ath12k_pktlog_ring_used(2, 5, 16), 13);
+	KUNIT_EXPECT_EQ(test, ath12k_pktlog_ring_used(0, 15, 16), 1);
+}
+
+static void ring_put(struct kunit *test)
+{
+	static const u8 src[] = "ABCDEFGH";
+	u8 data[16];
+
+	memset(data, '.', sizeof(data));
+
+	/* fits before the end */
+	KUNIT_EXPECT_EQ(test, ath12k_pktlog_ring_put(data, 16, 2, src, 4), 6);
+	KUNIT_EXPECT_MEMEQ(test, data + 2, "ABCD", 4);
+
+	/* ends exactly at the end of the ring */
+	KUNIT_EXPECT_EQ(test, ath12k_pktlog_ring_put(data, 16, 12, src, 4), 0);
+	KUNIT_EXPECT_MEMEQ(test, data + 12, "ABCD", 4);
+
+	/* split across the end */
+	memset(data, '.', sizeof(data));
+	KUNIT_EXPECT_EQ(test, ath12k_pktlog_ring_put(data, 16, 12, src, 8), 4);
+	KUNIT_EXPECT_MEMEQ(test, data + 12, "ABCD", 4);
+	KUNIT_EXPECT_MEMEQ(test, data, "EFGH", 4);
+	KUNIT_EXPECT_EQ(test, data[4], '.');
+
+	KUNIT_EXPECT_EQ(test, ath12k_pktlog_ring_put(data, 16, 7, src, 0), 7);
+}
+
+static void write_wraparound(struct kunit *test)
+{
+	struct ath12k_pktlog *pl = test->priv;
+	u8 *data = pktlog_test_data(pl);
+	int i;
+
+	/* 24 byte records: 0..23, 24..47 */
+	KUNIT_EXPECT_TRUE(test, pktlog_test_write(pl, 0x10, 16));
+	KUNIT_EXPECT_TRUE(test, pktlog_test_write(pl, 0x20, 16));
+	KUNIT_EXPECT_EQ(test, pl->buf->head, 48);
+
+	/* the reader consumed both, the next record wraps to 8 */
+	pl->buf->tail = 48;
+	KUNIT_EXPECT_TRUE(test, pktlog_test_write(pl, 0x30, 16));
+	KUNIT_EXPECT_EQ(test, pl->head, 8);
+	KUNIT_EXPECT_EQ(test, pl->buf->head, 8);
+
+	for (i = 48; i < 56; i++)
+		KUNIT_EXPECT_EQ(test, data[i], 0x30);
+	for (i = 56; i < 64; i++)
+		KUNIT_EXPECT_EQ(test, data[i], 0x31);
+	for (i = 0; i < 8; i++)
+		KUNIT_EXPECT_EQ(test, data[i], 0x31);
+
+	KUNIT_EXPECT_EQ(test, pl->overrun, 0);
+}
+
+static void write_overrun(struct kunit *test)
+{
+	struct ath12k_pktlog *pl = test->priv;
+
+	KUNIT_EXPECT_TRUE(test, pktlog_test_write(pl, 0x10, 16));
+	KUNIT_EXPECT_TRUE(test, pktlog_test_write(pl, 0x20, 16));
+
+	/* 15 bytes left, the record is dropped whole and counted */
+	KUNIT_EXPECT_FALSE(test, pktlog_test_write(pl, 0x30, 16));
+	KUNIT_EXPECT_EQ(test, pl->overrun, 1);
+	KUNIT_EXPECT_EQ(test, pl->buf->overrun, 1);
+	KUNIT_EXPECT_EQ(test, pl->buf->head, 48);
+
+	/* one byte always stays free so a full ring is not read as empty */
+	KUNIT_EXPECT_TRUE(test, pktlog_test_write(pl, 0x40, 7));
+	KUNIT_EXPECT_EQ(test, pl->buf->head, 63);
+	KUNIT_EXPECT_FALSE(test, pktlog_test_write(pl, 0x50, 0));
+	KUNIT_EXPECT_EQ(test, pl->overrun, 2);
+
+	/* a tail outside of the ring, as userspace may write it */
+	pl->buf->tail = PKTLOG_TEST_RING_SIZE;
+	KUNIT_EXPECT_FALSE(test, pktlog_test_write(pl, 0x60, 0));
+	KUNIT_EXPECT_EQ(test, pl->overrun, 3);
+	KUNIT_EXPECT_EQ(test, pl->buf->overrun, 3);
+
+	/* userspace may also clobber the shared overrun counter */
+	pl->buf->overrun = 0;
+	pl->buf->tail = 63;
+	KUNIT_EXPECT_TRUE(test, pktlog_test_write(pl, 0x70, 16));
+	KUNIT_EXPECT_EQ(test, pl->buf->overrun, 0);
+	KUNIT_EXPECT_FALSE(test, pktlog_test_write(pl, 0x80, 60));
+	KUNIT_EXPECT_EQ(test, pl->buf->overrun, 4);
+}
+
+static void write_stopped(struct kunit *test)
+{
+	struct ath12k_pktlog *pl = test->priv;
+	struct ath12k_pktlog_buf *buf = pl->buf;
+
+	/* pktlog was stopped and the buffer released */
+	pl->buf = NULL;
+	KUNIT_EXPECT_FALSE(test, pktlog_test_write(pl, 0x10, 16));
+	KUNIT_EXPECT_EQ(test, pl->overrun, 0);
+	pl->buf = buf;
+}
+
+static struct kunit_case pktlog_test_cases[] = {
+	KUNIT_CASE(ring_used),
+	KUNIT_CASE(ring_put),
+	KUNIT_CASE(write_wraparound),
+	KUNIT_CASE(write_overrun),
+	KUNIT_CASE(write_stopped),
+	{}
+};
+
+static struct kunit_suite pktlog_test_suite = {
+	.name = "ath12k-pktlog",
+	.init = pktlog_test_init,
+	.exit = pktlog_test_exit,
+	.test_cases = pktlog_test_cases,
+};
+
+kunit_test_suite(pktlog_test_suite);
@@ -0,0 +1,222 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * KUnit tests for the REO command pool and the cache flush FIFO
+ */
+#include <kunit/test.h>
+#include "../core.h"
+#include "../dp_rx.h"
+
+static void reo_test_handler(struct ath12k_dp *dp, void *ctx,
+			     enum hal_reo_cmd_status status)
+{
+}
+
+static void reo_test_other_handler(struct ath12k_dp *dp, void *ctx,
+				   enum hal_reo_cmd_status status)
+{
+}
+
+static int reo_test_init(struct kunit *test)
+{
+	struct ath12k_dp *dp;
+	int ret;
+
+	dp = kvzalloc(sizeof(*dp), GFP_KERNEL);
+	if (!dp)
+		return -ENOMEM;
+
+	spin_lock_init(&dp->reo_cmd_lock);
+	INIT_LIST_HEAD(&dp->reo_cmd_list);
+
+	ret = ath12k_dp_rx_reo_cmd_pool_alloc(dp);
+	if (ret) {
+		kvfree(dp);
+		return ret;
+	}
+
+	test->priv = dp;
+
+	return 0;
+}
+
+static void reo_test_exit(struct kunit *test)
+{
+	struct ath12k_dp *dp = test->priv;
+	struct ath12k_dp_rx_reo_cmd *cmd, *tmp;
+
+	list_for_each_entry_safe(cmd, tmp, &dp->reo_cmd_list, list) {
+		list_del(&cmd->list);
+		kfree(cmd);
+	}
+
+	ath12k_dp_rx_reo_cmd_pool_free(dp);
+	kvfree(dp);
+}
+
+static int reo_test_queued(struct ath12k_dp *dp)
+{
+	struct ath12k_dp_rx_reo_cmd *cmd;
+	int n = 0;
+
+	list_for_each_entry(cmd, &dp->reo_cmd_list, list)
+		n++;
+
+	return n;
+}
+
+static void reo_test_track(struct kunit *test, int cmd_num, u8 tid,
+			   void (*cb)(struct ath12k_dp *dp, void *ctx,
+				      enum hal_reo_cmd_status status))
+{
+	struct ath12k_dp_rx_tid rx_tid = { .tid = tid };
+
+	KUNIT_ASSERT_EQ(test, 0,
+			ath12k_dp_rx_reo_cmd_track(test->priv, cmd_num, &rx_tid, cb));
+}
+
+static void reo_test_expect(struct kunit *test, int cmd_num, u8 tid)
+{
+	struct ath12k_dp_rx_reo_cmd cmd = {};
+
+	KUNIT_ASSERT_TRUE(test,
+			  ath12k_dp_rx_reo_cmd_complete(test->priv, cmd_num, &cmd));
+	KUNIT_EXPECT_EQ(test, cmd.cmd_num, cmd_num);
+	KUNIT_EXPECT_EQ(test, cmd.data.tid, tid);
+}
+
+static void track_complete(struct kunit *test)
+{
+	struct ath12k_dp *dp = test->priv;
+	struct ath12k_dp_rx_reo_cmd cmd = {};
+
+	reo_test_track(test, 1, 3, reo_test_handler);
+	reo_test_track(test, DP_REO_CMD_RING_SIZE, 4, reo_test_other_handler);
+
+	KUNIT_ASSERT_TRUE(test, ath12k_dp_rx_reo_cmd_complete(dp, 1, &cmd));
+	KUNIT_EXPECT_PTR_EQ(test, cmd.handler, reo_test_handler);
+	KUNIT_EXPECT_EQ(test, cmd.data.tid, 3);
+
+	KUNIT_ASSERT_TRUE(test, ath12k_dp_rx_reo_cmd_complete(dp, DP_REO_CMD_RING_SIZE,
+							      &cmd));
+	KUNIT_EXPECT_PTR_EQ(test, cmd.handler, reo_test_other_handler);
+	KUNIT_EXPECT_EQ(test, cmd.data.tid, 4);
+
+	/* a status without a pending command, or a duplicate one */
+	KUNIT_EXPECT_FALSE(test, ath12k_dp_rx_reo_cmd_complete(dp, 1, &cmd));
+	KUNIT_EXPECT_FALSE(test, ath12k_dp_rx_reo_cmd_complete(dp, 2, &cmd));
+	KUNIT_EXPECT_TRUE(test, list_empty(&dp->reo_cmd_list));
+}
+
+static void invalid_cmd_num(struct kunit *test)
+{
+	struct ath12k_dp *dp = test->priv;
+	struct ath12k_dp_rx_reo_cmd cmd = {};
+
+	reo_test_track(test, 1, 1, reo_test_handler);
+
+	KUNIT_EXPECT_FALSE(test, ath12k_dp_rx_reo_cmd_complete(dp, 0, &cmd));
+	KUNIT_EXPECT_FALSE(test, ath12k_dp_rx_reo_cmd_complete(dp, -1, &cmd));
+	KUNIT_EXPECT_FALSE(test,
+			   ath12k_dp_rx_reo_cmd_complete(dp, DP_REO_CMD_RING_SIZE + 1,
+							 &cmd));
+
+	/* the valid command is untouched */
+	reo_test_expect(test, 1, 1);
+}
+
+static void overflow(struct kunit *test)
+{
+	struct ath12k_dp *dp = test->priv;
+	struct ath12k_dp_rx_reo_cmd cmd = {};
+
+	/* statuses for 5 and 6 got lost, the ring wrapped and reused both */
+	reo_test_track(test, 5, 1, reo_test_handler);
+	reo_test_track(test, 5, 2, reo_test_handler);
+	reo_test_track(test, 6, 10, reo_test_handler);
+	reo_test_track(test, 6, 11, reo_test_handler);
+	reo_test_track(test, 5, 3, reo_test_handler);
+
+	KUNIT_EXPECT_EQ(test, reo_test_queued(dp), 3);
+
+	/* each number completes oldest first, other numbers stay queued */
+	reo_test_expect(test, 6, 10);
+	reo_test_expect(test, 5, 1);
+	reo_test_expect(test, 6, 11);
+	reo_test_expect(test, 5, 2);
+	reo_test_expect(test, 5, 3);
+
+	KUNIT_EXPECT_FALSE(test, ath12k_dp_rx_reo_cmd_complete(dp, 5, &cmd));
+	KUNIT_EXPECT_FALSE(test, ath12k_dp_rx_reo_cmd_complete(dp, 6, &cmd));
+	KUNIT_EXPECT_TRUE(test, list_empty(&dp->reo_cmd_list));
+
+	/* the slot is usable again once drained */
+	reo_test_track(test, 5, 4, reo_test_handler);
+	KUNIT_EXPECT_TRUE(test, list_empty(&dp->reo_cmd_list));
+	reo_test_expect(test, 5, 4);
+}
+
+static void cache_flush_fifo(struct kunit *test)
+{
+	struct ath12k_dp *dp = test->priv;
+	struct ath12k_dp_rx_reo_cache_flush_elem *elem;
+	struct ath12k_dp_rx_tid rx_tid = {};
+	int i, next = 0;
+
+	spin_lock_bh(&dp->reo_cmd_lock);
+
+	KUNIT_EXPECT_NULL(test, ath12k_dp_rx_reo_cache_flush_peek(dp));
+
+	for (i = 0; i < ATH12K_DP_RX_REO_CACHE_FLUSH_RING_SIZE; i++) {
+		rx_tid.tid = i;
+		KUNIT_EXPECT_TRUE(test,
+				  ath12k_dp_rx_reo_cache_flush_enqueue(dp, &rx_tid));
+	}
+
+	/* full, the caller frees this one itself */
+	rx_tid.tid = 0xff;
+	KUNIT_EXPECT_FALSE(test, ath12k_dp_rx_reo_cache_flush_enqueue(dp, &rx_tid));
+
+	/* drain part of it and refill so the FIFO wraps */
+	for (i = 0; i < 10; i++) {
+		elem = ath12k_dp_rx_reo_cache_flush_peek(dp);
+		KUNIT_EXPECT_NOT_NULL(test, elem);
+		if (!elem)
+			break;
+		KUNIT_EXPECT_EQ(test, elem->data.tid, next++);
+		ath12k_dp_rx_reo_cache_flush_pop(dp);
+	}
+
+	for (i = 0; i < 10; i++) {
+		rx_tid.tid = ATH12K_DP_RX_REO_CACHE_FLUSH_RING_SIZE + i;
+		KUNIT_EXPECT_TRUE(test,
+				  ath12k_dp_rx_reo_cache_flush_enqueue(dp, &rx_tid));
+	}
+	KUNIT_EXPECT_FALSE(test, ath12k_dp_rx_reo_cache_flush_enqueue(dp, &rx_tid));
+
+	while ((elem = ath12k_dp_rx_reo_cache_flush_peek(dp))) {
+		KUNIT_EXPECT_EQ(test, elem->data.tid, next++);
+		ath12k_dp_rx_reo_cache_flush_pop(dp);
+	}
+
+	KUNIT_EXPECT_EQ(test, next, ATH12K_DP_RX_REO_CACHE_FLUSH_RING_SIZE + 10);
+	KUNIT_EXPECT_EQ(test, dp->reo_cmd_cache_flush_count, 0);
+
+	spin_unlock_bh(&dp->reo_cmd_lock);
+}
+
+static struct kunit_case reo_cmd_test_cases[] = {
+	KUNIT_CASE(track_complete),
+	KUNIT_CASE(invalid_cmd_num),
+	KUNIT_CASE(overflow),
+	KUNIT_CASE(cache_flush_fifo),
+	{}
+};
+
+static struct kunit_suite reo_cmd_test_suite = {
+	.name = "ath12k-reo-cmd",
+	.init = reo_test_init,
+	.exit = reo_test_exit,
+	.test_cases = reo_cmd_test_cases,
+};
+
+kunit_test_suite(reo_cmd_test_suite);
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: BSD-3-Clause-Clear */
+/*
+ * Shared helpers for the ath12k kunit tests
+ */
+#ifndef _ATH12K_TESTS_UTIL_H
+#define _ATH12K_TESTS_UTIL_H
+
+#include <linux/math64.h>
+#include <kunit/test.h>
+
+#define ATH12K_BENCH_ITERATIONS	4096
+
+/*
+ * Benchmarks report the mean cost as a KTAP diagnostic line of the form
+ *
+ *	# <case>: bench <name> <ns> ns/op <iterations> iterations
+ *
+ * the same format the mac80211 benchmarks use, so CI can scrape both.
+ */
+static inline void ath12k_bench_report(struct kunit *test, const char *name,
+				       u64 total_ns, unsigned int iterations)
+{
+	kunit_info(test, "bench %s %llu ns/op %u iterations\n", name,
+		   div_u64(total_ns, iterations), iterations);
+}
+
+#endif /* _ATH12K_TESTS_UTIL_H */
@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * KUnit tests for the top level WMI TLV table
+ */
+#include <linux/timekeeping.h>
+#include <kunit/test.h>
+#include <kunit/skbuff.h>
+#include "util.h"
+#include "../core.h"
+#include "../wmi.h"
+
+MODULE_IMPORT_NS("EXPORTED_FOR_KUNIT_TESTING");
+
+static int wmi_test_init(struct kunit *test)
+{
+	/* only ab->dev is looked at, for the parse warnings */
+	test->priv = kvzalloc(sizeof(struct ath12k_base), GFP_KERNEL);
+
+	return test->priv ? 0 : -ENOMEM;
+}
+
+static void wmi_test_exit(struct kunit *test)
+{
+	kvfree(test->priv);
+}
+
+static void *wmi_test_put_tlv(struct sk_buff *skb, u16 tag, u16 len, u8 fill)
+{
+	struct wmi_tlv *tlv;
+
+	tlv = skb_put(skb, sizeof(*tlv) + len);
+	tlv->header = le32_encode_bits(tag, WMI_TLV_TAG) |
+		      le32_encode_bits(len, WMI_TLV_LEN);
+	memset(tlv->value, fill, len);
+
+	return tlv->value;
+}
+
+static void lookup(struct kunit *test)
+{
+	struct ath12k_wmi_tlv_tb tb;
+	struct sk_buff *skb;
+	void *ev, *bytes;
+
+	skb = kunit_zalloc_skb(test, 512, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, skb);
+
+	ev = wmi_test_put_tlv(skb, WMI_TAG_MUEDCA_PARAMS_CONFIG_EVENT,
+			      sizeof(struct wmi_pdev_update_muedca_event), 1);
+	bytes = wmi_test_put_tlv(skb, WMI_TAG_ARRAY_BYTE, 6, 2);
+	/* empty arrays are common and still present */
+	wmi_test_put_tlv(skb, WMI_TAG_ARRAY_UINT32, 0, 0);
+
+	KUNIT_ASSERT_EQ(test, 0, ath12k_wmi_tlv_parse_tb(test->priv, skb, &tb));
+	KUNIT_EXPECT_EQ(test, tb.num, 3);
+	KUNIT_EXPECT_PTR_EQ(test, ev,
+			    ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_MUEDCA_PARAMS_CONFIG_EVENT));
+	KUNIT_EXPECT_PTR_EQ(test, bytes, ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_ARRAY_BYTE));
+	KUNIT_EXPECT_NOT_NULL(test, ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_ARRAY_UINT32));
+	KUNIT_EXPECT_NULL(test, ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_ARRAY_STRUCT));
+}
+
+static void repeated_tag(struct kunit *test)
+{
+	struct ath12k_wmi_tlv_tb tb;
+	struct sk_buff *skb;
+	void *last;
+
+	skb = kunit_zalloc_skb(test, 128, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, skb);
+
+	wmi_test_put_tlv(skb, WMI_TAG_ARRAY_UINT32, 8, 1);
+	wmi_test_put_tlv(skb, WMI_TAG_ARRAY_BYTE, 4, 2);
+	last = wmi_test_put_tlv(skb, WMI_TAG_ARRAY_UINT32, 4, 3);
+
+	/* like a full tag table, the last TLV of a tag wins */
+	KUNIT_ASSERT_EQ(test, 0, ath12k_wmi_tlv_parse_tb(test->priv, skb, &tb));
+	KUNIT_EXPECT_EQ(test, tb.num, 2);
+	KUNIT_EXPECT_PTR_EQ(test, last, ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_ARRAY_UINT32));
+}
+
+static void malformed(struct kunit *test)
+{
+	struct ath12k_wmi_tlv_tb tb;
+	struct sk_buff *skb;
+	struct wmi_tlv *tlv;
+
+	/* shorter than the policy of its tag */
+	skb = kunit_zalloc_skb(test, 128, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, skb);
+	wmi_test_put_tlv(skb, WMI_TAG_MUEDCA_PARAMS_CONFIG_EVENT, 4, 0);
+	KUNIT_EXPECT_EQ(test, -EINVAL, ath12k_wmi_tlv_parse_tb(test->priv, skb, &tb));
+
+	/* length past the end of the event */
+	skb = kunit_zalloc_skb(test, 128, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, skb);
+	wmi_test_put_tlv(skb, WMI_TAG_ARRAY_BYTE, 8, 0);
+	tlv = (struct wmi_tlv *)skb->data;
+	tlv->header = le32_encode_bits(WMI_TAG_ARRAY_BYTE, WMI_TLV_TAG) |
+		      le32_encode_bits(100, WMI_TLV_LEN);
+	KUNIT_EXPECT_EQ(test, -EINVAL, ath12k_wmi_tlv_parse_tb(test->priv, skb, &tb));
+
+	/* trailing bytes that cannot hold a header */
+	skb = kunit_zalloc_skb(test, 128, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, skb);
+	wmi_test_put_tlv(skb, WMI_TAG_ARRAY_BYTE, 8, 0);
+	skb_put_zero(skb, 2);
+	KUNIT_EXPECT_EQ(test, -EINVAL, ath12k_wmi_tlv_parse_tb(test->priv, skb, &tb));
+}
+
+static void too_many_tags(struct kunit *test)
+{
+	struct ath12k_wmi_tlv_tb tb;
+	struct sk_buff *skb;
+	int i;
+
+	skb = kunit_zalloc_skb(test, 512, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, skb);
+
+	/* tags past the policy table, so any length is accepted */
+	for (i = 0; i <= ATH12K_WMI_TLV_TB_MAX; i++)
+		wmi_test_put_tlv(skb, WMI_TAG_MAX + i, 4, i);
+
+	/* the extra tag is warned about and dropped, the event still parses */
+	KUNIT_ASSERT_EQ(test, 0, ath12k_wmi_tlv_parse_tb(test->priv, skb, &tb));
+	KUNIT_EXPECT_EQ(test, tb.num, ATH12K_WMI_TLV_TB_MAX);
+	KUNIT_EXPECT_NOT_NULL(test, ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_MAX));
+	KUNIT_EXPECT_NOT_NULL(test,
+			      ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_MAX +
+						    ATH12K_WMI_TLV_TB_MAX - 1));
+	KUNIT_EXPECT_NULL(test,
+			  ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_MAX + ATH12K_WMI_TLV_TB_MAX));
+
+	/* a repeat of a kept tag still replaces it once the table is full */
+	wmi_test_put_tlv(skb, WMI_TAG_MAX, 4, 0xff);
+	KUNIT_ASSERT_EQ(test, 0, ath12k_wmi_tlv_parse_tb(test->priv, skb, &tb));
+	KUNIT_EXPECT_EQ(test, tb.num, ATH12K_WMI_TLV_TB_MAX);
+	KUNIT_EXPECT_PTR_EQ(test, skb_tail_pointer(skb) - 4,
+			    ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_MAX));
+}
+
+static void bench_parse(struct kunit *test)
+{
+	struct ath12k_wmi_tlv_tb tb;
+	struct sk_buff *skb;
+	unsigned int i, failed = 0;
+	u64 start;
+
+	skb = kunit_zalloc_skb(test, 512, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, skb);
+
+	/* shaped like a typical event: a fixed struct and a few arrays */
+	wmi_test_put_tlv(skb, WMI_TAG_MUEDCA_PARAMS_CONFIG_EVENT,
+			 sizeof(struct wmi_pdev_update_muedca_event), 0);
+	wmi_test_put_tlv(skb, WMI_TAG_ARRAY_STRUCT, 64, 0);
+	wmi_test_put_tlv(skb, WMI_TAG_ARRAY_UINT32, 32, 0);
+	wmi_test_put_tlv(skb, WMI_TAG_ARRAY_BYTE, 48, 0);
+
+	start = ktime_get_ns();
+	for (i = 0; i < ATH12K_BENCH_ITERATIONS; i++) {
+		if (ath12k_wmi_tlv_parse_tb(test->priv, skb, &tb) ||
+		    !ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_MUEDCA_PARAMS_CONFIG_EVENT))
+			failed++;
+	}
+	ath12k_bench_report(test, "wmi_tlv_parse_tb", ktime_get_ns() - start,
+			    ATH12K_BENCH_ITERATIONS);
+
+	KUNIT_EXPECT_EQ(test, failed, 0);
+}
+
+static struct kunit_case wmi_test_cases[] = {
+	KUNIT_CASE(lookup),
+	KUNIT_CASE(repeated_tag),
+	KUNIT_CASE(malformed),
+	KUNIT_CASE(too_many_tags),
+	KUNIT_CASE(bench_parse),
+	{}
+};
+
+static struct kunit_suite wmi_test_suite = {
+	.name = "ath12k-wmi",
+	.init = wmi_test_init,
+	.exit = wmi_test_exit,
+	.test_cases = wmi_test_cases,
+};
+
+kunit_test_suite(wmi_test_suite);
@@ -164,16 +164,18 @@ static int ath12k_wifi7_dp_op_device_init(struct ath12k_dp *dp)
 	int i;
 
 	INIT_LIST_HEAD(&dp->reo_cmd_list);
-	INIT_LIST_HEAD(&dp->reo_cmd_cache_flush_list);
 	INIT_LIST_HEAD(&dp->reo_cmd_update_rx_queue_list);
 	spin_lock_init(&dp->reo_cmd_update_rx_queue_lock);
 	spin_lock_init(&dp->reo_cmd_lock);
 
-	ret = ath12k_hif_ext_irq_setup(dp->ab, ath12k_wifi7_dp_service_srng, dp);
+	ret = ath12k_dp_rx_reo_cmd_pool_alloc(dp);
 	if (ret)
 		return ret;
 
-	dp->reo_cmd_cache_flush_count = 0;
+	ret = ath12k_hif_ext_irq_setup(dp->ab, ath12k_wifi7_dp_service_srng, dp);
+	if (ret)
+		goto fail_reo_cmd_pool_free;
+
 	dp->idle_link_rbm =
 			ath12k_hal_get_idle_link_rbm(&ab->hal, ab->device_id);
 
@@ -286,6 +288,9 @@ fail_link_desc_cleanup:
 fail_irq_cleanup:
 	ath12k_hif_ext_irq_cleanup(dp->ab);
 
+fail_reo_cmd_pool_free:
+	ath12k_dp_rx_reo_cmd_pool_free(dp);
+
 	return ret;
 
 }
@@ -308,6 +313,7 @@ static void ath12k_wifi7_dp_op_device_deinit(struct ath12k_dp *dp)
 	ath12k_dp_srng_common_cleanup(ab);
 
 	ath12k_dp_rx_reo_cmd_list_cleanup(ab);
+	ath12k_dp_rx_reo_cmd_pool_free(dp);
 
 	ath12k_dp_mon_rx_free(dp);
 	ath12k_nss_plugin_unregister_ops(ab);
@@ -6,6 +6,7 @@
 #include <linux/ieee80211.h>
 #include <linux/kernel.h>
 #include <linux/skbuff.h>
+#include <linux/jhash.h>
 #include <crypto/hash.h>
 #include "../core.h"
 #include "hal.h"
@@ -113,7 +114,6 @@ int ath12k_wifi7_dp_reo_cmd_send(struct ath12k_base *ab,
 					    enum hal_reo_cmd_status status))
 {
 	struct ath12k_dp *dp = ath12k_ab_to_dp(ab);
-	struct ath12k_dp_rx_reo_cmd *dp_cmd;
 	struct hal_srng *cmd_ring;
 	int cmd_num;
 
@@ -135,24 +135,7 @@ int ath12k_wifi7_dp_reo_cmd_send(struct ath12k_base *ab,
 	if (!cb)
 		return 0;
 
-	/* Can this be optimized so that we keep the pending command list only
-	 * for tid delete command to free up the resource on the command status
-	 * indication?
-	 */
-	dp_cmd = kzalloc(sizeof(*dp_cmd), GFP_ATOMIC);
-
-	if (!dp_cmd)
-		return -ENOMEM;
-
-	memcpy(&dp_cmd->data, rx_tid, sizeof(*rx_tid));
-	dp_cmd->cmd_num = cmd_num;
-	dp_cmd->handler = cb;
-
-	spin_lock_bh(&dp->reo_cmd_lock);
-	list_add_tail(&dp_cmd->list, &dp->reo_cmd_list);
-	spin_unlock_bh(&dp->reo_cmd_lock);
-
-	return 0;
+	return ath12k_dp_rx_reo_cmd_track(dp, cmd_num, rx_tid, cb);
 }
 
 int ath12k_wifi7_dp_reo_cache_flush(struct ath12k_base *ab,
@@ -218,7 +201,7 @@ void ath12k_wifi7_dp_rx_tid_del_func(struct ath12k_dp *dp, void *ctx,
 {
 	struct ath12k_base *ab = dp->ab;
 	struct ath12k_dp_rx_tid *rx_tid = ctx, *update_rx_tid;
-	struct ath12k_dp_rx_reo_cache_flush_elem *elem, *tmp;
+	struct ath12k_dp_rx_reo_cache_flush_elem *elem;
 	struct dp_reo_update_rx_queue_elem *qelem, *qtmp;
 
 	if (status == HAL_REO_CMD_DRAIN) {
@@ -255,45 +238,42 @@ void ath12k_wifi7_dp_rx_tid_del_func(struct ath12k_dp *dp, void *ctx,
 	}
 	spin_unlock_bh(&dp->reo_cmd_update_rx_queue_lock);
 
-	elem = kzalloc(sizeof(*elem), GFP_ATOMIC);
-	if (!elem)
-		goto free_desc;
+	spin_lock_bh(&dp->reo_cmd_lock);
 
-	elem->ts = jiffies;
-	memcpy(&elem->data, rx_tid, sizeof(*rx_tid));
+	/* Descriptors keep piling up only while cache flushes fail, free the
+	 * new one right away rather than growing the queue.
+	 */
+	if (!ath12k_dp_rx_reo_cache_flush_enqueue(dp, rx_tid)) {
+		spin_unlock_bh(&dp->reo_cmd_lock);
+		goto free_desc;
+	}
 
-	spin_lock_bh(&dp->reo_cmd_lock);
-	list_add_tail(&elem->list, &dp->reo_cmd_cache_flush_list);
-	dp->reo_cmd_cache_flush_count++;
+	/* Flush and invalidate aged REO desc from HW cache, oldest first */
+	while ((elem = ath12k_dp_rx_reo_cache_flush_peek(dp))) {
+		if (dp->reo_cmd_cache_flush_count <= ATH12K_DP_RX_REO_DESC_FREE_THRES &&
+		    !time_after(jiffies, elem->ts +
+				msecs_to_jiffies(ATH12K_DP_RX_REO_DESC_FREE_TIMEOUT_MS)))
+			break;
 
-	/* Flush and invalidate aged REO desc from HW cache */
-	list_for_each_entry_safe(elem, tmp, &dp->reo_cmd_cache_flush_list,
-				 list) {
-		if (dp->reo_cmd_cache_flush_count > ATH12K_DP_RX_REO_DESC_FREE_THRES ||
-		    time_after(jiffies, elem->ts +
-			       msecs_to_jiffies(ATH12K_DP_RX_REO_DESC_FREE_TIMEOUT_MS))) {
-			/* Unlock the reo_cmd_lock before using ath12k_dp_reo_cmd_send()
-			 * within ath12k_wifi7_dp_reo_cache_flush. The reo_cmd_cache_flush_list
-			 * is used in only two contexts, one is in this function called
-			 * from napi and the other in ath12k_dp_free during core destroy.
-			 * Before dp_free, the irqs would be disabled and would wait to
-			 * synchronize. Hence there wouldn’t be any race against add or
-			 * delete to this list. Hence unlock-lock is safe here.
+		/* Unlock the reo_cmd_lock before using ath12k_dp_reo_cmd_send()
+		 * within ath12k_wifi7_dp_reo_cache_flush. The flush queue
+		 * is used in only two contexts, one is in this function called
+		 * from napi and the other in ath12k_dp_free during core destroy.
+		 * Before dp_free, the irqs would be disabled and would wait to
+		 * synchronize. Hence there wouldn’t be any race against add or
+		 * delete to this queue. Hence unlock-lock is safe here.
+		 */
+		spin_unlock_bh(&dp->reo_cmd_lock);
+		if (ath12k_wifi7_dp_reo_cache_flush(dp->ab, &elem->data)) {
+			/* In failure case, just update the timestamp
+			 * for flush cache elem and continue
 			 */
-			spin_unlock_bh(&dp->reo_cmd_lock);
-			if (ath12k_wifi7_dp_reo_cache_flush(dp->ab, &elem->data)) {
-				/* In failure case, just update the timestamp
-				 * for flush cache elem and continue
-				 */
-				spin_lock_bh(&dp->reo_cmd_lock);
-				elem->ts = jiffies;
-				break;
-			}
 			spin_lock_bh(&dp->reo_cmd_lock);
-			list_del(&elem->list);
-			dp->reo_cmd_cache_flush_count--;
-			kfree(elem);
+			elem->ts = jiffies;
+			break;
 		}
+		spin_lock_bh(&dp->reo_cmd_lock);
+		ath12k_dp_rx_reo_cache_flush_pop(dp);
 	}
 	spin_unlock_bh(&dp->reo_cmd_lock);
 
@@ -1873,14 +1853,17 @@ static int ath12k_wifi7_dp_rx_h_defrag(struct ath12k_pdev_dp *dp_pdev,
 	bool is_decrypted = false;
 	int msdu_len = 0;
 	int extra_space;
+	int i;
 	u32 flags, hal_rx_desc_sz = ab->hal.hal_desc_sz;
 
-	first_frag = skb_peek(&rx_tid->rx_frags);
-	last_frag = skb_peek_tail(&rx_tid->rx_frags);
+	/* Caller has verified that slots 0..last_frag_no are all populated */
+	first_frag = rx_tid->rx_frags[0];
+	last_frag = rx_tid->rx_frags[rx_tid->last_frag_no];
 	if (!first_frag || !last_frag)
 		return -EINVAL;
 
-	skb_queue_walk(&rx_tid->rx_frags, skb) {
+	for (i = 0; i <= rx_tid->last_frag_no; i++) {
+		skb = rx_tid->rx_frags[i];
 		flags = 0;
 		hdr = (struct ieee80211_hdr *)(skb->data + hal_rx_desc_sz);
 
@@ -1911,11 +1894,14 @@ static int ath12k_wifi7_dp_rx_h_defrag(struct ath12k_pdev_dp *dp_pdev,
 	    (pskb_expand_head(first_frag, 0, extra_space, GFP_ATOMIC) < 0))
 		return -ENOMEM;
 
-	__skb_unlink(first_frag, &rx_tid->rx_frags);
-	while ((skb = __skb_dequeue(&rx_tid->rx_frags))) {
+	rx_tid->rx_frags[0] = NULL;
+	for (i = 1; i <= rx_tid->last_frag_no; i++) {
+		skb = rx_tid->rx_frags[i];
 		skb_put_data(first_frag, skb->data, skb->len);
 		dev_kfree_skb_any(skb);
+		rx_tid->rx_frags[i] = NULL;
 	}
+	rx_tid->rx_frag_bitmap = 0;
 
 	hdr = (struct ieee80211_hdr *)(first_frag->data + hal_rx_desc_sz);
 	hdr->frame_control &= ~__cpu_to_le16(IEEE80211_FCTL_MOREFRAGS);
@@ -2081,34 +2067,6 @@ err_unmap_dma:
 	return ret;
 }
 
-static int ath12k_wifi7_dp_rx_h_cmp_frags(struct ath12k_base *ab,
-					  struct sk_buff *a, struct sk_buff *b)
-{
-	int frag1, frag2;
-
-	frag1 = ath12k_wifi7_dp_rx_h_frag_no(ab, a);
-	frag2 = ath12k_wifi7_dp_rx_h_frag_no(ab, b);
-
-	return frag1 - frag2;
-}
-
-static void ath12k_wifi7_dp_rx_h_sort_frags(struct ath12k_base *ab,
-					    struct sk_buff_head *frag_list,
-					    struct sk_buff *cur_frag)
-{
-	struct sk_buff *skb;
-	int cmp;
-
-	skb_queue_walk(frag_list, skb) {
-		cmp = ath12k_wifi7_dp_rx_h_cmp_frags(ab, skb, cur_frag);
-		if (cmp < 0)
-			continue;
-		__skb_queue_before(frag_list, skb, cur_frag);
-		return;
-	}
-	__skb_queue_tail(frag_list, cur_frag);
-}
-
 static u64 ath12k_wifi7_dp_rx_h_get_pn(struct ath12k_dp *dp, struct sk_buff *skb)
 {
 	struct ieee80211_hdr *hdr;
@@ -2135,11 +2093,12 @@ ath12k_wifi7_dp_rx_h_defrag_validate_incr_pn(struct ath12k_pdev_dp *dp_pdev,
 					     enum hal_encrypt_type encrypt_type)
 {
 	struct ath12k_dp *dp = dp_pdev->dp;
-	struct sk_buff *first_frag, *skb;
+	struct sk_buff *first_frag;
 	u64 last_pn;
 	u64 cur_pn;
+	int i;
 
-	first_frag = skb_peek(&rx_tid->rx_frags);
+	first_frag = rx_tid->rx_frags[0];
 	if (!first_frag)
 		return false;
 
@@ -2150,11 +2109,8 @@ ath12k_wifi7_dp_rx_h_defrag_validate_incr_pn(struct ath12k_pdev_dp *dp_pdev,
 		return true;
 
 	last_pn = ath12k_wifi7_dp_rx_h_get_pn(dp, first_frag);
-	skb_queue_walk(&rx_tid->rx_frags, skb) {
-		if (skb == first_frag)
-			continue;
-
-		cur_pn = ath12k_wifi7_dp_rx_h_get_pn(dp, skb);
+	for (i = 1; i <= rx_tid->last_frag_no; i++) {
+		cur_pn = ath12k_wifi7_dp_rx_h_get_pn(dp, rx_tid->rx_frags[i]);
 		if (cur_pn != last_pn + 1)
 			return false;
 		last_pn = cur_pn;
@@ -2176,7 +2132,7 @@ static int ath12k_wifi7_dp_rx_frag_h_mpdu(struct ath12k_pdev_dp *dp_pdev,
 	u16 seqno, frag_no;
 	u8 tid = rx_desc_data->tid;
 	int ret = 0;
-	bool more_frags;
+	bool more_frags, complete;
 	enum hal_encrypt_type enctype;
 
 	frag_no = ath12k_wifi7_dp_rx_h_frag_no(ab, msdu);
@@ -2217,33 +2173,21 @@ static int ath12k_wifi7_dp_rx_frag_h_mpdu(struct ath12k_pdev_dp *dp_pdev,
 
 	rx_tid = &peer->rx_tid[tid];
 
-	if ((!skb_queue_empty(&rx_tid->rx_frags) && seqno != rx_tid->cur_sn) ||
-	    skb_queue_empty(&rx_tid->rx_frags)) {
-		/* Flush stored fragments and start a new sequence */
-		ath12k_dp_rx_frags_cleanup(rx_tid, true);
-		rx_tid->cur_sn = seqno;
-	}
-
-	if (rx_tid->rx_frag_bitmap & BIT(frag_no)) {
-		/* Fragment already present */
-		ret = -EINVAL;
+	ret = ath12k_dp_rx_frag_insert(rx_tid, msdu, seqno, frag_no, more_frags);
+	if (ret < 0)
 		goto out_unlock;
-	}
 
-	if ((!rx_tid->rx_frag_bitmap || frag_no > __fls(rx_tid->rx_frag_bitmap)))
-		__skb_queue_tail(&rx_tid->rx_frags, msdu);
-	else
-		ath12k_wifi7_dp_rx_h_sort_frags(ab, &rx_tid->rx_frags, msdu);
-
-	rx_tid->rx_frag_bitmap |= BIT(frag_no);
-	if (!more_frags)
-		rx_tid->last_frag_no = frag_no;
+	complete = ret;
+	ret = 0;
 
 	if (frag_no == 0) {
 		rx_tid->dst_ring_desc = kmemdup(ring_desc,
 						sizeof(*rx_tid->dst_ring_desc),
 						GFP_ATOMIC);
 		if (!rx_tid->dst_ring_desc) {
+			/* the caller frees msdu, so it must not stay in its slot */
+			rx_tid->rx_frags[frag_no] = NULL;
+			rx_tid->rx_frag_bitmap &= ~BIT(frag_no);
 			ret = -ENOMEM;
 			goto out_unlock;
 		}
@@ -2252,8 +2196,7 @@ static int ath12k_wifi7_dp_rx_frag_h_mpdu(struct ath12k_pdev_dp *dp_pdev,
 						    HAL_WBM_REL_BM_ACT_PUT_IN_IDLE);
 	}
 
-	if (!rx_tid->last_frag_no ||
-	    rx_tid->rx_frag_bitmap != GENMASK(rx_tid->last_frag_no, 0)) {
+	if (!complete) {
 		mod_timer(&rx_tid->frag_timer, jiffies +
 					       ATH12K_DP_RX_FRAGMENT_TIMEOUT_MS);
 		goto out_unlock;
@@ -3586,8 +3529,7 @@ void ath12k_wifi7_dp_rx_process_reo_status(struct ath12k_dp *dp)
 	struct ath12k_base *ab = dp->ab;
 	struct hal_tlv_64_hdr *hdr;
 	struct hal_srng *srng;
-	struct ath12k_dp_rx_reo_cmd *cmd, *tmp;
-	bool found = false;
+	struct ath12k_dp_rx_reo_cmd cmd;
 	u16 tag;
 	struct hal_reo_status reo_status;
 
@@ -3636,23 +3578,10 @@ void ath12k_wifi7_dp_rx_process_reo_status(struct ath12k_dp *dp)
 			continue;
 		}
 
-		spin_lock_bh(&dp->reo_cmd_lock);
-		list_for_each_entry_safe(cmd, tmp, &dp->reo_cmd_list, list) {
-			if (reo_status.uniform_hdr.cmd_num == cmd->cmd_num) {
-				found = true;
-				list_del(&cmd->list);
-				break;
-			}
-		}
-		spin_unlock_bh(&dp->reo_cmd_lock);
-
-		if (found) {
-			cmd->handler(dp, (void *)&cmd->data,
-				     reo_status.uniform_hdr.cmd_status);
-			kfree(cmd);
-		}
-
-		found = false;
+		if (ath12k_dp_rx_reo_cmd_complete(dp, reo_status.uniform_hdr.cmd_num,
+						  &cmd))
+			cmd.handler(dp, (void *)&cmd.data,
+				    reo_status.uniform_hdr.cmd_status);
 	}
 
 	ath12k_hal_srng_access_end(ab, srng);
@@ -3665,6 +3594,7 @@ int ath12k_wifi7_dp_rx_fst_attach(struct ath12k_dp *dp, struct dp_rx_fst *fst)
 	struct ath12k_base *ab = dp->ab;
 
 	fst->num_entries = 0;
+	hash_init(fst->flow_map);
 
 	fst->base = kcalloc(HAL_RX_FLOW_SEARCH_TABLE_SIZE,
 			    sizeof(struct dp_rx_fse), GFP_KERNEL);
@@ -3734,29 +3664,59 @@ ath12k_dp_rx_flow_get_fse(struct dp_rx_fst *fst, u32 flow_hash)
 	return &fse[idx];
 }
 
+static inline u32
+ath12k_dp_rx_flow_map_key(const struct hal_flow_tuple_info *tuple_info)
+{
+	return jhash2((const u32 *)tuple_info,
+		      sizeof(*tuple_info) / sizeof(u32), 0);
+}
+
+VISIBLE_IF_ATH12K_KUNIT struct dp_rx_fse *
+ath12k_dp_rx_flow_map_find(struct dp_rx_fst *fst,
+			   const struct hal_flow_tuple_info *tuple_info)
+{
+	struct dp_rx_fse *fse;
+
+	hash_for_each_possible(fst->flow_map, fse, node,
+			       ath12k_dp_rx_flow_map_key(tuple_info)) {
+		if (!memcmp(&fse->tuple_info, tuple_info, sizeof(*tuple_info)))
+			return fse;
+	}
+
+	return NULL;
+}
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_dp_rx_flow_map_find);
+
+VISIBLE_IF_ATH12K_KUNIT void
+ath12k_dp_rx_flow_map_add(struct dp_rx_fst *fst, struct dp_rx_fse *fse)
+{
+	hash_add(fst->flow_map, &fse->node,
+		 ath12k_dp_rx_flow_map_key(&fse->tuple_info));
+}
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_dp_rx_flow_map_add);
+
 struct dp_rx_fse *
 ath12k_dp_rx_flow_find_entry_by_tuple(struct ath12k_base *ab,
 				      struct dp_rx_fst *fst,
 				      struct rx_flow_info *flow_info,
 				      struct hal_rx_flow *flow)
 {
-	u32 flow_hash;
-	u32 flow_idx;
-	int status;
+	struct dp_rx_fse *fse;
 
-	flow_hash = ath12k_dp_rx_flow_compute_flow_hash(ab, fst, flow_info, flow);
+	memcpy(&flow->tuple_info, &flow_info->flow_tuple_info,
+	       sizeof(struct hal_flow_tuple_info));
 
-	status = ath12k_wifi7_hal_rx_find_flow_from_tuple(ab, fst->hal_rx_fst,
-							  flow_hash,
-							  &flow_info->flow_tuple_info,
-							  &flow_idx);
-	if (status != 0) {
-		ath12k_dbg(ab, ATH12K_DBG_DP_FST, "Could not find tuple with hash %u", flow_hash);
+	/* Valid entries are mirrored on the host, no need to hash the
+	 * tuple and probe the HW table skid by skid.
+	 */
+	fse = ath12k_dp_rx_flow_map_find(fst, &flow->tuple_info);
+	if (!fse) {
+		ath12k_dbg(ab, ATH12K_DBG_DP_FST, "Could not find tuple in flow table");
 		ath12k_wifi7_dp_rx_flow_dump_entry(ab->dp, flow_info);
 		return NULL;
 	}
 
-	return ath12k_dp_rx_flow_get_fse(fst, flow_idx);
+	return fse;
 }
 
 ssize_t ath12k_wifi7_dp_dump_fst_table(struct ath12k_dp *dp, char *buf, int size)
@@ -3806,8 +3766,26 @@ ath12k_wifi7_dp_rx_flow_alloc_entry(struct ath12k_base *ab,
 	struct dp_rx_fse *fse;
 	u32 flow_hash;
 	u32 flow_idx;
+	u32 skid;
 	int status;
 
+	fse = ath12k_dp_rx_flow_map_find(fst, &flow_info->flow_tuple_info);
+	if (fse) {
+		memcpy(&flow->tuple_info, &flow_info->flow_tuple_info,
+		       sizeof(struct hal_flow_tuple_info));
+
+		if (ath12k_wifi7_dp_rx_check_if_flow_to_be_updated(fse, flow_info)) {
+			ath12k_dbg(ab, ATH12K_DBG_DP_FST,
+				   "Flow entry to be updated - hash %u",
+				   fse->flow_hash);
+			return fse;
+		}
+
+		ath12k_dbg(ab, ATH12K_DBG_DP_FST,
+			   "Flow already exists in FST %u", fse->flow_id);
+		return NULL;
+	}
+
 	flow_hash = ath12k_dp_rx_flow_compute_flow_hash(ab, fst, flow_info, flow);
 
 	status = ath12k_wifi7_hal_rx_flow_insert_entry(ab, fst->hal_rx_fst, flow_hash,
@@ -3835,10 +3813,19 @@ ath12k_wifi7_dp_rx_flow_alloc_entry(struct ath12k_base *ab,
 		return NULL;
 	}
 
+	skid = (flow_idx - flow_hash) & (fst->hal_rx_fst->max_entries - 1);
+	if (skid) {
+		fst->flow_collisions++;
+		fst->flow_max_skid = max(fst->flow_max_skid, skid);
+	}
+
 	fse = ath12k_dp_rx_flow_get_fse(fst, flow_idx);
 	fse->flow_hash = flow_hash;
 	fse->flow_id = flow_idx;
 	fse->is_valid = true;
+	memcpy(&fse->tuple_info, &flow_info->flow_tuple_info,
+	       sizeof(struct hal_flow_tuple_info));
+	ath12k_dp_rx_flow_map_add(fst, fse);
 
 	return fse;
 }
@@ -3891,6 +3878,7 @@ int ath12k_wifi7_dp_rx_flow_add_entry(struct ath12k_dp *dp,
 							  fse->flow_id, &flow);
 	if (!fse->hal_fse) {
 		ath12k_err(ab, "Unable to alloc FSE entry");
+		hash_del(&fse->node);
 		fse->is_valid = false;
 		return -EEXIST;
 	}
@@ -3924,6 +3912,7 @@ int ath12k_wifi7_dp_rx_flow_delete_entry(struct ath12k_dp *dp,
 	ath12k_wifi7_hal_rx_flow_delete_entry(ab, fse->hal_fse);
 
 	/* mark the FSE entry as invalid */
+	hash_del(&fse->node);
 	fse->is_valid = false;
 
 	/* Decrement number of valid entries in table */
@@ -3953,6 +3942,7 @@ int ath12k_wifi7_dp_rx_flow_delete_all_entries(struct ath12k_dp *dp)
 
 		ath12k_wifi7_hal_rx_flow_delete_entry(ab, fse->hal_fse);
 
+		hash_del(&fse->node);
 		fse->is_valid = false;
 
 		fst->num_entries--;
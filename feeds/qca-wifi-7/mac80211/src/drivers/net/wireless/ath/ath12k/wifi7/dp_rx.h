@@ -13,6 +13,8 @@
 #include "hal.h"
 
 struct dp_rx_fse {
+	struct hlist_node node;
+	struct hal_flow_tuple_info tuple_info;
 	struct hal_rx_fse *hal_fse;
 	u32 flow_hash;
 	u32 flow_id;
@@ -99,4 +101,11 @@ void ath12k_dp_rx_tid_del_func(struct ath12k_dp *dp, void *ctx,
 			       enum hal_reo_cmd_status status);
 void ath12k_wifi7_dp_rx_ring_free(struct ath12k_base *ab);
 int ath12k_wifi7_dp_rx_ring_setup(struct ath12k_base *ab);
+
+#if IS_ENABLED(CPTCFG_ATH12K_KUNIT_TEST)
+struct dp_rx_fse *
+ath12k_dp_rx_flow_map_find(struct dp_rx_fst *fst,
+			   const struct hal_flow_tuple_info *tuple_info);
+void ath12k_dp_rx_flow_map_add(struct dp_rx_fst *fst, struct dp_rx_fse *fse);
+#endif
 #endif
@@ -20,14 +20,10 @@
 
 struct ath12k_tx_sw_metadata {
 	struct sk_buff *skb;
-	struct sk_buff *skb_ext_desc;
 	u64 paddr : 40,
 	    len   : 16,
 	    mac_id: 5,
 	    flags : 3;
-	u64 paddr_ext_desc : 40,
-	    ext_desc_len   : 16,
-	    rsvd2          : 8;
 } __packed __aligned(32);
 
 static_assert(sizeof(struct ath12k_tx_sw_metadata) == 32, "size of struct ath12k_tx_sw_metadata is not 64 bytes!");
@@ -782,26 +778,19 @@ out:
 #define HTT_META_DATA_ALIGNMENT 0x8
 
 /* Preparing HTT Metadata when utilized with ext MSDU */
-static int ath12k_wifi7_dp_prepare_htt_metadata(struct sk_buff *skb)
-{
-	struct hal_tx_msdu_metadata *desc_ext;
-	u8 htt_desc_size;
-	/* Size rounded of multiple of 8 bytes */
-	u8 htt_desc_size_aligned;
-
-	htt_desc_size = sizeof(struct hal_tx_msdu_metadata);
-	htt_desc_size_aligned = ALIGN(htt_desc_size, HTT_META_DATA_ALIGNMENT);
-
-	desc_ext = ath12k_dp_metadata_align_skb(skb, htt_desc_size_aligned);
-	if (!desc_ext)
-		return -ENOMEM;
+/* Size rounded of multiple of 8 bytes */
+#define ATH12K_WIFI7_HTT_METADATA_SIZE \
+	ALIGN(sizeof(struct hal_tx_msdu_metadata), HTT_META_DATA_ALIGNMENT)
 
+/* The HTT metadata directly follows the extension descriptor in its slot */
+static int ath12k_wifi7_dp_prepare_htt_metadata(struct hal_tx_msdu_metadata *desc_ext)
+{
 	desc_ext->info0 = le32_encode_bits(1, HAL_TX_MSDU_METADATA_INFO0_ENCRYPT_FLAG) |
 			  le32_encode_bits(0, HAL_TX_MSDU_METADATA_INFO0_ENCRYPT_TYPE) |
 			  le32_encode_bits(1,
 					   HAL_TX_MSDU_METADATA_INFO0_HOST_TX_DESC_POOL);
 
-	return 0;
+	return ATH12K_WIFI7_HTT_METADATA_SIZE;
 }
 
 bool ath12k_mac_tx_check_max_limit(struct ath12k_pdev_dp *dp_pdev, struct sk_buff *skb)
@@ -1052,7 +1041,7 @@ ath12k_wifi7_dp_tx(struct ath12k_pdev_dp *dp_pdev,
 	struct ath12k_skb_cb *skb_cb = ATH12K_SKB_CB(skb);
 	struct hal_tcl_data_cmd *hal_tcl_desc;
 	struct hal_tx_msdu_ext_desc *msg;
-	struct sk_buff *skb_ext_desc = NULL;
+	dma_addr_t paddr_ext_desc;
 	struct ethhdr *eth = NULL;
 	struct hal_srng *tcl_ring;
 	struct ieee80211_hdr *hdr = NULL;
@@ -1285,51 +1274,28 @@ skip_htt_metadata:
 	tx_desc->paddr = ti.paddr;
 	tx_desc->len = ti.data_len;
 
-	tx_desc->paddr_ext_desc = 0;
-
 	if (msdu_ext_desc) {
-		skb_ext_desc = dev_alloc_skb(sizeof(struct hal_tx_msdu_ext_desc));
-		if (!skb_ext_desc) {
+		BUILD_BUG_ON(sizeof(*msg) + ATH12K_WIFI7_HTT_METADATA_SIZE >
+			     ATH12K_TX_EXT_DESC_SIZE);
+
+		msg = ath12k_dp_tx_ext_desc_get(dp, tx_desc, ti.ring_id,
+						&paddr_ext_desc);
+		if (!msg) {
+			dp->device_stats.tx_err.ext_desc_na[ti.ring_id]++;
 			err = DP_TX_ENQ_DROP_EXT_DESC_NA;
 			goto fail_unmap_dma;
 		}
 
-		skb_put(skb_ext_desc, sizeof(struct hal_tx_msdu_ext_desc));
-		memset(skb_ext_desc->data, 0, skb_ext_desc->len);
-
-		msg = (struct hal_tx_msdu_ext_desc *)skb_ext_desc->data;
+		/* points the ext desc at the data buffer held in ti */
 		ath12k_wifi7_hal_tx_cmd_ext_desc_setup(ab, msg, &ti);
+		ti.paddr = paddr_ext_desc;
+		ti.data_len = sizeof(*msg);
 
-		if (add_htt_metadata) {
-			ret = ath12k_wifi7_dp_prepare_htt_metadata(skb_ext_desc);
-			if (ret < 0) {
-				ath12k_dbg(ab, ATH12K_DBG_DP_TX,
-					   "Failed to add HTT meta data, dropping packet\n");
-				err = DP_TX_ENQ_DROP_HTT_MDATA_ERR;
-				goto fail_free_ext_skb;
-			}
-		}
-#ifndef CONFIG_IO_COHERENCY
-		ti.paddr = dma_map_single(dp->dev, skb_ext_desc->data,
-					  skb_ext_desc->len, DMA_TO_DEVICE);
-		ret = dma_mapping_error(dp->dev, ti.paddr);
-		if (ret) {
-			err = DP_TX_ENQ_DROP_DMA_ERR;
-			goto fail_free_ext_skb;
-		}
-#else
-		ti.paddr = virt_to_phys(skb_ext_desc->data);
-		if (!ti.paddr) {
-			err = DP_TX_ENQ_DROP_DMA_ERR;
-			goto fail_free_ext_skb;
-		}
-#endif
-		ti.data_len = skb_ext_desc->len;
-		ti.type = HAL_TCL_DESC_TYPE_EXT_DESC;
+		if (add_htt_metadata)
+			ti.data_len +=
+				ath12k_wifi7_dp_prepare_htt_metadata((void *)(msg + 1));
 
-		tx_desc->paddr_ext_desc = ti.paddr;
-		tx_desc->ext_desc_len = ti.data_len;
-		tx_desc->skb_ext_desc = skb_ext_desc;
+		ti.type = HAL_TCL_DESC_TYPE_EXT_DESC;
 	}
 
 	hal_ring_id = tx_ring->tcl_data_ring.ring_id;
@@ -1350,7 +1316,7 @@ skip_htt_metadata:
 						 ATH_TX_DESC_NA_ERR);
 		}
 		err = DP_TX_ENQ_DROP_TCL_DESC_NA;
-		goto fail_unmap_dma_ext;
+		goto fail_unmap_dma;
 	}
 
 	spin_lock_bh(&arvif->link_stats_lock);
@@ -1453,21 +1419,14 @@ skip_htt_metadata:
 
 	return DP_TX_ENQ_SUCCESS;
 
-fail_unmap_dma_ext:
-	if (tx_desc->paddr_ext_desc)
-		ath12k_core_dma_unmap_single(dp->dev, tx_desc->paddr_ext_desc,
-					     tx_desc->ext_desc_len,
-					     DMA_TO_DEVICE);
-fail_free_ext_skb:
-	if (skb_ext_desc)
-		kfree_skb(skb_ext_desc);
-
 fail_unmap_dma:
-	ath12k_core_dma_unmap_single(dp->dev, ti.paddr, ti.data_len, DMA_TO_DEVICE);
+	ath12k_core_dma_unmap_single(dp->dev, tx_desc->paddr, tx_desc->len,
+				     DMA_TO_DEVICE);
 
 fail_remove_tx_buf:
+	/* also returns any ext desc slot, which lives in the ti.ring_id pool */
 	if (tx_desc)
-		ath12k_dp_tx_release_txbuf(dp, tx_desc, ring_id);
+		ath12k_dp_tx_release_txbuf(dp, tx_desc, ti.ring_id);
 
 	spin_lock_bh(&arvif->link_stats_lock);
 	arvif->link_stats.tx_dropped++;
@@ -1490,15 +1449,9 @@ static void ath12k_wifi7_dp_tx_free_txbuf(struct ath12k_dp *dp,
 					  struct ath12k_tx_sw_metadata *sw_metadata)
 {
 	struct ath12k_pdev_dp *dp_pdev;
-	struct sk_buff *skb_ext_desc = sw_metadata->skb_ext_desc;
 	u8 pdev_id = ath12k_hw_mac_id_to_pdev_id(dp->hw_params, sw_metadata->mac_id);
 
 	ath12k_core_dma_unmap_single(dp->dev, sw_metadata->paddr, sw_metadata->len, DMA_TO_DEVICE);
-	if (sw_metadata->paddr_ext_desc) {
-		ath12k_core_dma_unmap_single(dp->dev, sw_metadata->paddr_ext_desc,
-					     sw_metadata->ext_desc_len, DMA_TO_DEVICE);
-		dev_kfree_skb_any(skb_ext_desc);
-	}
 
 	rcu_read_lock();
 
@@ -1532,7 +1485,6 @@ ath12k_wifi7_dp_tx_htt_tx_complete_buf(struct ath12k_dp *dp,
 	struct ath12k_vif *ahvif;
 	struct ath12k_dp_link_peer *peer;
 	struct ath12k_base *ab = dp->ab;
-	struct sk_buff *skb_ext_desc = sw_metadata->skb_ext_desc;
 	struct ath12k_pdev_dp *dp_pdev;
 	struct ethhdr *eth;
 	struct ieee80211_hdr *hdr;
@@ -1543,11 +1495,6 @@ ath12k_wifi7_dp_tx_htt_tx_complete_buf(struct ath12k_dp *dp,
 	pdev_id = ath12k_hw_mac_id_to_pdev_id(dp->hw_params, sw_metadata->mac_id);
 
 	ath12k_core_dma_unmap_single(dp->dev, sw_metadata->paddr, sw_metadata->len, DMA_TO_DEVICE);
-	if (sw_metadata->paddr_ext_desc) {
-		ath12k_core_dma_unmap_single(dp->dev, sw_metadata->paddr_ext_desc,
-					     sw_metadata->ext_desc_len, DMA_TO_DEVICE);
-		dev_kfree_skb_any(skb_ext_desc);
-	}
 
 	rcu_read_lock();
 	dp_pdev = ath12k_dp_to_dp_pdev(dp, pdev_id);
@@ -1915,7 +1862,6 @@ static void ath12k_wifi7_dp_tx_complete_msdu(struct ath12k_pdev_dp *dp_pdev,
 	struct ieee80211_vif *vif;
 	struct ath12k_vif *ahvif;
 	struct ath12k_dp_link_peer *link_peer;
-	struct sk_buff *skb_ext_desc = sw_metadata->skb_ext_desc;
 	struct ath12k *ar;
 	struct ath12k_dp_peer *peer = NULL;
 	u8 link_id = 0;
@@ -1931,11 +1877,6 @@ static void ath12k_wifi7_dp_tx_complete_msdu(struct ath12k_pdev_dp *dp_pdev,
 
 	if (sw_metadata->skb)
 		ath12k_core_dma_unmap_single(dp->dev, sw_metadata->paddr, sw_metadata->len, DMA_TO_DEVICE);
-	if (sw_metadata->paddr_ext_desc) {
-		ath12k_core_dma_unmap_single(dp->dev, sw_metadata->paddr_ext_desc,
-					     sw_metadata->ext_desc_len, DMA_TO_DEVICE);
-		dev_kfree_skb_any(skb_ext_desc);
-	}
 
 	if (sw_metadata->flags & DP_TX_DESC_FLAG_FAST)
 		return;
@@ -2270,13 +2211,8 @@ int ath12k_wifi7_dp_tx_completion_handler(struct ath12k_dp *dp, int ring_id, int
 		sw_metadata->len = tx_desc->len;
 		sw_metadata->flags = tx_desc->flags;
 
-		if (unlikely(!(sw_metadata->flags & DP_TX_DESC_FLAG_FAST))) {
-			sw_metadata->skb_ext_desc = tx_desc->skb_ext_desc;
-			sw_metadata->paddr_ext_desc = tx_desc->paddr_ext_desc;
-			tx_desc->skb_ext_desc = NULL;
-			tx_desc->paddr_ext_desc = 0;
-			sw_metadata->ext_desc_len = tx_desc->ext_desc_len;
-		}
+		if (unlikely(!(sw_metadata->flags & DP_TX_DESC_FLAG_FAST)))
+			ath12k_dp_tx_ext_desc_put_nolock(dp, tx_desc, ring_id);
 
 		sw_metadata->mac_id = tx_desc->mac_id;
 		pdev_tx_comp_cnt[sw_metadata->mac_id]++;
@@ -1234,6 +1234,7 @@ u32 ath12k_wifi7_hal_flow_toeplitz_hash(struct ath12k_base *ab,
 
 	return hash;
 }
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_wifi7_hal_flow_toeplitz_hash);
 
 u32 ath12k_wifi7_hal_rx_get_trunc_hash(struct hal_rx_fst *fst, u32 hash)
 {
@@ -1274,45 +1275,6 @@ void *ath12k_wifi7_hal_rx_flow_get_tuple_info(struct ath12k_base *ab,
 	return hal_fse;
 }
 
-int ath12k_wifi7_hal_rx_find_flow_from_tuple(struct ath12k_base *ab,
-					     struct hal_rx_fst *fst,
-					     u32 flow_hash,
-					     void *flow_tuple_info,
-					     u32 *flow_idx)
-{
-	int i;
-	void *hal_fse = NULL;
-	u32 hal_hash = 0;
-	struct hal_flow_tuple_info hal_tuple_info = { 0 };
-
-	for (i = 0; i < fst->max_skid_length; i++) {
-		hal_hash = ath12k_wifi7_hal_rx_get_trunc_hash(fst, (flow_hash + i));
-
-		hal_fse = ath12k_wifi7_hal_rx_flow_get_tuple_info(ab, fst, hal_hash,
-								  &hal_tuple_info);
-		if (!hal_fse)
-			continue;
-
-		/* Find the matching flow entry in HW FST */
-		if (!memcmp(&hal_tuple_info, flow_tuple_info,
-			    sizeof(struct hal_flow_tuple_info)))
-			break;
-	}
-
-	if (i == fst->max_skid_length) {
-		ath12k_dbg(ab, ATH12K_DBG_DP_FST, "Max skid length reached for hash %u",
-			   flow_hash);
-		return -ERANGE;
-	}
-
-	*flow_idx = hal_hash;
-	ath12k_dbg(ab, ATH12K_DBG_DP_FST,
-		   "flow_hash = %u, skid_entry = %d, flow_addr = %pK flow_idx = %d",
-		   flow_hash, i, hal_fse, *flow_idx);
-
-	return 0;
-}
-
 ssize_t ath12k_wifi7_hal_rx_dump_fst_table(struct ath12k_base *ab,
 					   struct hal_rx_fst *fst,
 					   char *buf, int size)
@@ -1415,6 +1377,7 @@ ath12k_wifi7_hal_rx_fst_attach(struct ath12k_base *ab)
 
 	return fst;
 }
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_wifi7_hal_rx_fst_attach);
 
 void ath12k_wifi7_hal_rx_fst_detach(struct ath12k_base *ab, struct hal_rx_fst *fst)
 {
@@ -1427,6 +1390,7 @@ void ath12k_wifi7_hal_rx_fst_detach(struct ath12k_base *ab, struct hal_rx_fst *f
 					      fst->base_vaddr, fst->base_paddr);
 	kfree(fst);
 }
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_wifi7_hal_rx_fst_detach);
 
 int ath12k_wifi7_hal_rx_flow_insert_entry(struct ath12k_base *ab,
 					  struct hal_rx_fst *fst,
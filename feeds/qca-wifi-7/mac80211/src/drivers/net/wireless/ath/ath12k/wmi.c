@@ -438,40 +438,44 @@ ath12k_wmi_tlv_iter(struct ath12k_base *ab, const void *ptr, size_t len,
 static int ath12k_wmi_tlv_iter_parse(struct ath12k_base *ab, u16 tag, u16 len,
 				     const void *ptr, void *data)
 {
-	const void **tb = data;
+	struct ath12k_wmi_tlv_tb *tb = data;
+	int i;
 
-	if (tag < WMI_TAG_MAX)
-		tb[tag] = ptr;
+	/* as with a full tag table, the last TLV of a given tag wins */
+	for (i = 0; i < tb->num; i++) {
+		if (tb->tag[i] == tag) {
+			tb->ptr[i] = ptr;
+			return 0;
+		}
+	}
 
-	return 0;
-}
+	if (tb->num == ARRAY_SIZE(tb->tag)) {
+		ath12k_warn(ab, "wmi tlv parse: too many tags, ignoring tag %u\n",
+			    tag);
+		return 0;
+	}
 
-static int ath12k_wmi_tlv_parse(struct ath12k_base *ar, const void **tb,
-				const void *ptr, size_t len)
-{
-	return ath12k_wmi_tlv_iter(ar, ptr, len, ath12k_wmi_tlv_iter_parse,
-				   (void *)tb);
+	tb->tag[tb->num] = tag;
+	tb->ptr[tb->num] = ptr;
+	tb->num++;
+
+	return 0;
 }
 
-static const void **
-ath12k_wmi_tlv_parse_alloc(struct ath12k_base *ab,
-			   struct sk_buff *skb, gfp_t gfp)
+/* Parse the top level TLVs of an event into tb, which is small enough to
+ * live on the stack of the event handler. Use ath12k_wmi_tlv_tb_get() to
+ * fetch a TLV by tag.
+ */
+VISIBLE_IF_ATH12K_KUNIT
+int ath12k_wmi_tlv_parse_tb(struct ath12k_base *ab, struct sk_buff *skb,
+			    struct ath12k_wmi_tlv_tb *tb)
 {
-	const void **tb;
-	int ret;
-
-	tb = kcalloc(WMI_TAG_MAX, sizeof(*tb), gfp);
-	if (!tb)
-		return ERR_PTR(-ENOMEM);
-
-	ret = ath12k_wmi_tlv_parse(ab, tb, skb->data, skb->len);
-	if (ret) {
-		kfree(tb);
-		return ERR_PTR(ret);
-	}
+	tb->num = 0;
 
-	return tb;
+	return ath12k_wmi_tlv_iter(ab, skb->data, skb->len,
+				   ath12k_wmi_tlv_iter_parse, tb);
 }
+EXPORT_SYMBOL_IF_ATH12K_KUNIT(ath12k_wmi_tlv_parse_tb);
 
 static int ath12k_wmi_cmd_send_nowait(struct ath12k_wmi_pdev *wmi, struct sk_buff *skb,
 				      u32 cmd_id)
@@ -6720,23 +6724,22 @@ static void
 ath12k_wmi_pdev_update_muedca_params_status_event(struct ath12k_base *ab,
 						  struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_pdev_update_muedca_event *ev;
 	struct ieee80211_mu_edca_param_set *params;
 	struct ath12k *ar;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_MUEDCA_PARAMS_CONFIG_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_MUEDCA_PARAMS_CONFIG_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch pdev update muedca params ev");
-		goto mem_free;
+		return;
 	}
 
 	rcu_read_lock();
@@ -6784,8 +6787,6 @@ ath12k_wmi_pdev_update_muedca_params_status_event(struct ath12k_base *ab,
 	kfree(params);
 unlock:
 	rcu_read_unlock();
-mem_free:
-	kfree(tb);
 }
 
 
@@ -7541,27 +7542,24 @@ err:
 static int ath12k_pull_vdev_start_resp_tlv(struct ath12k_base *ab, struct sk_buff *skb,
 					   struct wmi_vdev_start_resp_event *vdev_rsp)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_vdev_start_resp_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_VDEV_START_RESPONSE_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_VDEV_START_RESPONSE_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch vdev start resp ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
 	*vdev_rsp = *ev;
 
-	kfree(tb);
 	return 0;
 }
 
@@ -8177,7 +8175,7 @@ static int ath12k_pull_reg_chan_list_ext_update_ev(struct ath12k_base *ab,
 						   struct sk_buff *skb,
 						   struct ath12k_reg_info *reg_info)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_reg_chan_list_cc_ext_event *ev;
 	struct ath12k_wmi_reg_rule_ext_params *ext_wmi_reg_rule;
 	u32 num_2g_reg_rules, num_5g_reg_rules;
@@ -8189,17 +8187,15 @@ static int ath12k_pull_reg_chan_list_ext_update_ev(struct ath12k_base *ab,
 
 	ath12k_dbg(ab, ATH12K_DBG_WMI, "processing regulatory ext channel list\n");
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_REG_CHAN_LIST_CC_EXT_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_REG_CHAN_LIST_CC_EXT_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch reg chan list ext update ev\n");
-		kfree(tb);
 		return -EPROTO;
 	}
 
@@ -8249,7 +8245,6 @@ static int ath12k_pull_reg_chan_list_ext_update_ev(struct ath12k_base *ab,
 	if (num_2g_reg_rules > MAX_REG_RULES || num_5g_reg_rules > MAX_REG_RULES) {
 		ath12k_warn(ab, "Num reg rules for 2G/5G exceeds max limit (num_2g_reg_rules: %d num_5g_reg_rules: %d max_rules: %d)\n",
 			    num_2g_reg_rules, num_5g_reg_rules, MAX_REG_RULES);
-		kfree(tb);
 		return -EINVAL;
 	}
 
@@ -8259,7 +8254,6 @@ static int ath12k_pull_reg_chan_list_ext_update_ev(struct ath12k_base *ab,
 		if (num_6g_reg_rules_ap[i] > MAX_6GHZ_REG_RULES) {
 			ath12k_warn(ab, "Num 6G reg rules for AP mode(%d) exceeds max limit (num_6g_reg_rules_ap: %d, max_rules: %d)\n",
 				    i, num_6g_reg_rules_ap[i], MAX_6GHZ_REG_RULES);
-			kfree(tb);
 			return -EINVAL;
 		}
 
@@ -8284,7 +8278,6 @@ static int ath12k_pull_reg_chan_list_ext_update_ev(struct ath12k_base *ab,
 		    num_6g_reg_rules_cl[WMI_REG_VLP_AP][i] >  MAX_6GHZ_REG_RULES) {
 			ath12k_warn(ab, "Num 6g client reg rules exceeds max limit, for client(type: %d)\n",
 				    i);
-			kfree(tb);
 			return -EINVAL;
 		}
 	}
@@ -8323,14 +8316,12 @@ static int ath12k_pull_reg_chan_list_ext_update_ev(struct ath12k_base *ab,
 			    ev->dfs_region, ev->country_id, ev->domain_code);
 		if (phy_id >= ab->num_radios) {
 			ath12k_warn(ab, "Invalid phy_id %d\n", phy_id);
-			kfree(tb);
 			return -EINVAL;
 		}
 
 		ar = ab->pdevs[phy_id].ar;
 		if (!ar) {
 			ath12k_warn(ab, "ar is NULL for phy_id %d\n", phy_id);
-			kfree(tb);
 			return -EINVAL;
 		}
 		/* Reset to the previous country */
@@ -8340,7 +8331,6 @@ static int ath12k_pull_reg_chan_list_ext_update_ev(struct ath12k_base *ab,
 		else
 			ath12k_warn(ab, "Cannot queue work, workqueue unavailable or device not registered\n");
 
-		kfree(tb);
 		return -EINVAL;
 	}
 
@@ -8421,7 +8411,6 @@ static int ath12k_pull_reg_chan_list_ext_update_ev(struct ath12k_base *ab,
 						      ext_wmi_reg_rule);
 
 		if (!reg_info->reg_rules_2g_ptr) {
-			kfree(tb);
 			ath12k_warn(ab, "Unable to Allocate memory for 2g rules\n");
 			return -ENOMEM;
 		}
@@ -8468,13 +8457,11 @@ static int ath12k_pull_reg_chan_list_ext_update_ev(struct ath12k_base *ab,
 						      ext_wmi_reg_rule);
 
 		if (!reg_info->reg_rules_5g_ptr) {
-			kfree(tb);
 			ath12k_warn(ab, "Unable to Allocate memory for 5g rules\n");
 			return -ENOMEM;
 		}
 	}
 
-
 	/* We have adjusted the number of 5 GHz reg rules above. But still those
 	 * many rules needs to be adjusted in ext_wmi_reg_rule.
 	 *
@@ -8489,7 +8476,6 @@ static int ath12k_pull_reg_chan_list_ext_update_ev(struct ath12k_base *ab,
 						      ext_wmi_reg_rule);
 
 		if (!reg_info->reg_rules_6g_ap_ptr[i]) {
-			kfree(tb);
 			ath12k_warn(ab, "Unable to Allocate memory for 6g ap rules\n");
 			return -ENOMEM;
 		}
@@ -8511,7 +8497,6 @@ static int ath12k_pull_reg_chan_list_ext_update_ev(struct ath12k_base *ab,
 							      ext_wmi_reg_rule);
 
 			if (!reg_info->reg_rules_6g_client_ptr[j][i]) {
-				kfree(tb);
 				ath12k_warn(ab, "Unable to Allocate memory for 6g client rules\n");
 				return -ENOMEM;
 			}
@@ -8551,28 +8536,25 @@ static int ath12k_pull_reg_chan_list_ext_update_ev(struct ath12k_base *ab,
 
 	ath12k_dbg(ab, ATH12K_DBG_WMI, "processed regulatory ext channel list\n");
 
-	kfree(tb);
 	return 0;
 }
 
 static int ath12k_pull_peer_del_resp_ev(struct ath12k_base *ab, struct sk_buff *skb,
 					struct wmi_peer_delete_resp_event *peer_del_resp)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_peer_delete_resp_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_PEER_DELETE_RESP_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_PEER_DELETE_RESP_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch peer delete resp ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
@@ -8582,7 +8564,6 @@ static int ath12k_pull_peer_del_resp_ev(struct ath12k_base *ab, struct sk_buff *
 	ether_addr_copy(peer_del_resp->peer_macaddr.addr,
 			ev->peer_macaddr.addr);
 
-	kfree(tb);
 	return 0;
 }
 
@@ -8590,27 +8571,24 @@ static int ath12k_pull_vdev_del_resp_ev(struct ath12k_base *ab,
 					struct sk_buff *skb,
 					u32 *vdev_id)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_vdev_delete_resp_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_VDEV_DELETE_RESP_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_VDEV_DELETE_RESP_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch vdev delete resp ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
 	*vdev_id = le32_to_cpu(ev->vdev_id);
 
-	kfree(tb);
 	return 0;
 }
 
@@ -8618,55 +8596,49 @@ static int ath12k_pull_bcn_tx_status_ev(struct ath12k_base *ab,
 					struct sk_buff *skb,
 					u32 *vdev_id, u32 *tx_status)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_bcn_tx_status_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_OFFLOAD_BCN_TX_STATUS_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_OFFLOAD_BCN_TX_STATUS_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch bcn tx status ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
 	*vdev_id = le32_to_cpu(ev->vdev_id);
 	*tx_status = le32_to_cpu(ev->tx_status);
 
-	kfree(tb);
 	return 0;
 }
 
 static int ath12k_pull_vdev_stopped_param_tlv(struct ath12k_base *ab, struct sk_buff *skb,
 					      u32 *vdev_id)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_vdev_stopped_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_VDEV_STOPPED_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_VDEV_STOPPED_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch vdev stop ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
 	*vdev_id = le32_to_cpu(ev->vdev_id);
 
-	kfree(tb);
 	return 0;
 }
 
@@ -9089,21 +9061,19 @@ static int ath12k_pull_mgmt_tx_compl_param_tlv(struct ath12k_base *ab,
 					       struct sk_buff *skb,
 					       struct wmi_mgmt_tx_compl_event *param)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_mgmt_tx_compl_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_MGMT_TX_COMPL_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_MGMT_TX_COMPL_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch mgmt tx compl ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
@@ -9113,7 +9083,6 @@ static int ath12k_pull_mgmt_tx_compl_param_tlv(struct ath12k_base *ab,
 	param->ppdu_id = ev->ppdu_id;
 	param->ack_rssi = ev->ack_rssi;
 
-	kfree(tb);
 	return 0;
 }
 
@@ -9156,27 +9125,24 @@ static int ath12k_pull_offchan_tx_compl_param_tlv(struct ath12k_base *ab,
 						  struct wmi_offchan_data_tx_compl_event
 						  *params)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_offchan_data_tx_compl_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_OFFCHAN_DATA_TX_COMPL_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_OFFCHAN_DATA_TX_COMPL_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch offchan tx compl ev\n");
-		kfree(tb);
 		return -EPROTO;
 	}
 
 	*params = *ev;
 
-	kfree(tb);
 	return 0;
 }
 
@@ -9348,21 +9314,19 @@ ath12k_wmi_event_scan_type_str(enum wmi_scan_event_type type,
 static int ath12k_pull_scan_ev(struct ath12k_base *ab, struct sk_buff *skb,
 			       struct wmi_scan_event *scan_evt_param)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_scan_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_SCAN_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_SCAN_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch scan ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
@@ -9374,28 +9338,25 @@ static int ath12k_pull_scan_ev(struct ath12k_base *ab, struct sk_buff *skb,
 	scan_evt_param->vdev_id = ev->vdev_id;
 	scan_evt_param->tsf_timestamp = ev->tsf_timestamp;
 
-	kfree(tb);
 	return 0;
 }
 
 static int ath12k_pull_peer_sta_kickout_ev(struct ath12k_base *ab, struct sk_buff *skb,
 					   struct wmi_peer_sta_kickout_arg *arg)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_peer_sta_kickout_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_PEER_STA_KICKOUT_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_PEER_STA_KICKOUT_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch peer sta kickout ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
@@ -9403,28 +9364,25 @@ static int ath12k_pull_peer_sta_kickout_ev(struct ath12k_base *ab, struct sk_buf
 	arg->reason = ev->reason;
 	arg->rssi = ev->rssi;
 
-	kfree(tb);
 	return 0;
 }
 
 static int ath12k_pull_roam_ev(struct ath12k_base *ab, struct sk_buff *skb,
 			       struct wmi_roam_event *roam_ev)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_roam_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_ROAM_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_ROAM_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch roam ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
@@ -9432,7 +9390,6 @@ static int ath12k_pull_roam_ev(struct ath12k_base *ab, struct sk_buff *skb,
 	roam_ev->reason = ev->reason;
 	roam_ev->rssi = ev->rssi;
 
-	kfree(tb);
 	return 0;
 }
 
@@ -9462,21 +9419,19 @@ exit:
 static int ath12k_pull_chan_info_ev(struct ath12k_base *ab, struct sk_buff *skb,
 				    struct wmi_chan_info_event *ch_info_ev)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_chan_info_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_CHAN_INFO_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_CHAN_INFO_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch chan info ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
@@ -9493,7 +9448,6 @@ static int ath12k_pull_chan_info_ev(struct ath12k_base *ab, struct sk_buff *skb,
 	ch_info_ev->mac_clk_mhz = ev->mac_clk_mhz;
 	ch_info_ev->vdev_id = ev->vdev_id;
 
-	kfree(tb);
 	return 0;
 }
 
@@ -9501,21 +9455,19 @@ static int
 ath12k_pull_pdev_bss_chan_info_ev(struct ath12k_base *ab, struct sk_buff *skb,
 				  struct wmi_pdev_bss_chan_info_event *bss_ch_info_ev)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_pdev_bss_chan_info_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_PDEV_BSS_CHAN_INFO_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_PDEV_BSS_CHAN_INFO_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch pdev bss chan info ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
@@ -9533,7 +9485,6 @@ ath12k_pull_pdev_bss_chan_info_ev(struct ath12k_base *ab, struct sk_buff *skb,
 	bss_ch_info_ev->rx_bss_cycle_count_low = ev->rx_bss_cycle_count_low;
 	bss_ch_info_ev->rx_bss_cycle_count_high = ev->rx_bss_cycle_count_high;
 
-	kfree(tb);
 	return 0;
 }
 
@@ -9541,21 +9492,19 @@ static int
 ath12k_pull_vdev_install_key_compl_ev(struct ath12k_base *ab, struct sk_buff *skb,
 				      struct wmi_vdev_install_key_complete_arg *arg)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_vdev_install_key_compl_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_VDEV_INSTALL_KEY_COMPLETE_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_VDEV_INSTALL_KEY_COMPLETE_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch vdev install key compl ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
@@ -9565,28 +9514,25 @@ ath12k_pull_vdev_install_key_compl_ev(struct ath12k_base *ab, struct sk_buff *sk
 	arg->key_flags = le32_to_cpu(ev->key_flags);
 	arg->status = le32_to_cpu(ev->status);
 
-	kfree(tb);
 	return 0;
 }
 
 static int ath12k_pull_peer_assoc_conf_ev(struct ath12k_base *ab, struct sk_buff *skb,
 					  struct wmi_peer_assoc_conf_arg *peer_assoc_conf)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_peer_assoc_conf_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_PEER_ASSOC_CONF_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_PEER_ASSOC_CONF_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch peer assoc conf ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
@@ -9594,7 +9540,6 @@ static int ath12k_pull_peer_assoc_conf_ev(struct ath12k_base *ab, struct sk_buff
 	peer_assoc_conf->macaddr = ev->peer_macaddr.addr;
 	peer_assoc_conf->status = le32_to_cpu(ev->status);
 
-	kfree(tb);
 	return 0;
 }
 
@@ -9609,19 +9554,17 @@ static int ath12k_reg_11d_new_cc_event(struct ath12k_base *ab, struct sk_buff *s
 	const struct wmi_11d_new_cc_event *ev;
 	struct ath12k *ar;
 	struct ath12k_pdev *pdev;
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	int ret, i;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_11D_NEW_COUNTRY_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_11D_NEW_COUNTRY_EVENT);
 	if (!ev) {
-		kfree(tb);
 		ath12k_warn(ab, "failed to fetch 11d new cc ev");
 		return -EPROTO;
 	}
@@ -9634,8 +9577,6 @@ static int ath12k_reg_11d_new_cc_event(struct ath12k_base *ab, struct sk_buff *s
 		   ab->new_alpha2[0],
 		   ab->new_alpha2[1]);
 
-	kfree(tb);
-
 	for (i = 0; i < ab->num_radios; i++) {
 		pdev = &ab->pdevs[i];
 		ar = pdev->ar;
@@ -11662,21 +11603,19 @@ free:
 static void ath12k_pdev_ctl_failsafe_check_event(struct ath12k_base *ab,
 						 struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_pdev_ctl_failsafe_chk_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_PDEV_CTL_FAILSAFE_CHECK_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_PDEV_CTL_FAILSAFE_CHECK_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch pdev ctl failsafe check ev");
-		kfree(tb);
 		return;
 	}
 
@@ -11690,8 +11629,6 @@ static void ath12k_pdev_ctl_failsafe_check_event(struct ath12k_base *ab,
 	if (ev->ctl_failsafe_status != 0)
 		ath12k_warn(ab, "pdev ctl failsafe failure status %d",
 			    ev->ctl_failsafe_status);
-
-	kfree(tb);
 }
 
 void ath12k_debug_print_dcs_wlan_intf_stats(struct ath12k_base *ab,
@@ -12134,24 +12071,22 @@ static void
 ath12k_wmi_pdev_csa_switch_count_status_event(struct ath12k_base *ab,
 					      struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct ath12k_wmi_pdev_csa_event *ev;
 	const u32 *vdev_ids;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_PDEV_CSA_SWITCH_COUNT_STATUS_EVENT];
-	vdev_ids = tb[WMI_TAG_ARRAY_UINT32];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_PDEV_CSA_SWITCH_COUNT_STATUS_EVENT);
+	vdev_ids = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_ARRAY_UINT32);
 
 	if (!ev || !vdev_ids) {
 		ath12k_warn(ab, "failed to fetch pdev csa switch count ev");
-		kfree(tb);
 		return;
 	}
 
@@ -12161,8 +12096,6 @@ ath12k_wmi_pdev_csa_switch_count_status_event(struct ath12k_base *ab,
 		   ev->num_vdevs);
 
 	ath12k_wmi_process_csa_switch_count_event(ab, ev, vdev_ids);
-
-	kfree(tb);
 }
 
 static void
@@ -12409,22 +12342,19 @@ ath12k_wmi_dcs_interference_event(struct ath12k_base *ab,
 static void ath12k_tm_wmi_event_segmented(struct ath12k_base *ab, u32 cmd_id,
 					  struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	int ret;
 	u16 length;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
 
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse ftm event tlv: %d\n", ret);
 		return;
 	}
 
 	length = skb->len - TLV_HDR_SIZE;
-	ath12k_tm_process_event(ab, cmd_id, tb, length);
-	kfree(tb);
-	tb = NULL;
+	ath12k_tm_process_event(ab, cmd_id, &tb, length);
 }
 
 static void
@@ -12433,20 +12363,18 @@ ath12k_wmi_pdev_temperature_event(struct ath12k_base *ab,
 {
 	const struct wmi_pdev_temperature_event *ev;
 	struct ath12k *ar;
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-	       ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 	   ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 	   return;
 	}
 
-	ev = tb[WMI_TAG_PDEV_TEMPERATURE_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_PDEV_TEMPERATURE_EVENT);
 	if (!ev) {
 	    ath12k_warn(ab, "failed to fetch pdev temp ev");
-	    kfree(tb);
 	    return;
 	}
 
@@ -12464,7 +12392,6 @@ ath12k_wmi_pdev_temperature_event(struct ath12k_base *ab,
 
 	ath12k_thermal_event_temperature(ar, ev->temp);
 exit:
-	kfree(tb);
 	rcu_read_unlock();
 }
 
@@ -12513,22 +12440,21 @@ static void ath12k_wmi_thermal_throt_stats_event(struct ath12k_base *ab,
 						 struct sk_buff *skb)
 {
 	struct ath12k *ar;
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	int ret;
 	const struct wmi_therm_throt_stats_event *ev;
 	struct wmi_therm_throt_level_stats_info *stats;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_err(ab, "failed to parse tlv: %d\n", ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_THERM_THROT_STATS_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_THERM_THROT_STATS_EVENT);
 	if (!ev) {
 		ath12k_err(ab, "failed to fetch thermal throt stats ev");
-		goto err;
+		return;
 	}
 
 	/* Print debug only if DUT temperature is not in optimal range as this
@@ -12540,7 +12466,7 @@ static void ath12k_wmi_thermal_throt_stats_event(struct ath12k_base *ab,
 
 	ar = ath12k_mac_get_ar_by_pdev_id(ab, ev->pdev_id);
 	if (!ar)
-		goto err;
+		return;
 
 	stats = ar->tt_level_stats;
 	memcpy(&ar->tt_current_state, ev, sizeof(struct wmi_therm_throt_stats_event));
@@ -12549,62 +12475,53 @@ static void ath12k_wmi_thermal_throt_stats_event(struct ath12k_base *ab,
 				  stats);
 
 	ath12k_thermal_event_throt_level(ar, ev->level);
-
-err:
-	kfree(tb);
 }
 
 static void ath12k_fils_discovery_event(struct ath12k_base *ab,
 					struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_fils_discovery_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab,
 			    "failed to parse FILS discovery event tlv %d\n",
 			    ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_HOST_SWFDA_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_HOST_SWFDA_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch FILS discovery event\n");
-		kfree(tb);
 		return;
 	}
 
 	ath12k_warn(ab,
 		    "FILS discovery frame expected from host for vdev_id: %u, transmission scheduled at %u, next TBTT: %u\n",
 		    ev->vdev_id, ev->fils_tt, ev->tbtt);
-
-	kfree(tb);
 }
 
 static void ath12k_probe_resp_tx_status_event(struct ath12k_base *ab,
 					      struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_probe_resp_tx_status_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab,
 			    "failed to parse probe response transmission status event tlv: %d\n",
 			    ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_OFFLOAD_PRB_RSP_TX_STATUS_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_OFFLOAD_PRB_RSP_TX_STATUS_EVENT);
 	if (!ev) {
 		ath12k_warn(ab,
 			    "failed to fetch probe response transmission status event");
-		kfree(tb);
 		return;
 	}
 
@@ -12612,28 +12529,25 @@ static void ath12k_probe_resp_tx_status_event(struct ath12k_base *ab,
 		ath12k_warn(ab,
 			    "Probe response transmission failed for vdev_id %u, status %u\n",
 			    ev->vdev_id, ev->tx_status);
-
-	kfree(tb);
 }
 
 static int ath12k_wmi_p2p_noa_event(struct ath12k_base *ab,
 				    struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_p2p_noa_event *ev;
 	const struct ath12k_wmi_p2p_noa_info *noa;
 	struct ath12k *ar;
 	int ret, vdev_id;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse P2P NoA TLV: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_P2P_NOA_EVENT];
-	noa = tb[WMI_TAG_P2P_NOA_INFO];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_P2P_NOA_EVENT);
+	noa = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_P2P_NOA_INFO);
 
 	if (!ev || !noa) {
 		ret = -EPROTO;
@@ -12662,7 +12576,6 @@ static int ath12k_wmi_p2p_noa_event(struct ath12k_base *ab,
 unlock:
 	rcu_read_unlock();
 out:
-	kfree(tb);
 	return ret;
 }
 
@@ -12670,21 +12583,18 @@ static void ath12k_rfkill_state_change_event(struct ath12k_base *ab,
 					     struct sk_buff *skb)
 {
 	const struct wmi_rfkill_state_change_event *ev;
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_RFKILL_EVENT];
-	if (!ev) {
-		kfree(tb);
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_RFKILL_EVENT);
+	if (!ev)
 		return;
-	}
 
 	ath12k_dbg(ab, ATH12K_DBG_MAC,
 		   "wmi tlv rfkill state change gpio %d type %d radio_state %d\n",
@@ -12697,7 +12607,6 @@ static void ath12k_rfkill_state_change_event(struct ath12k_base *ab,
 	spin_unlock_bh(&ab->base_lock);
 
 	queue_work(ab->workqueue, &ab->rfkill_work);
-	kfree(tb);
 }
 
 static void
@@ -12729,119 +12638,103 @@ ath12k_wmi_diag_event(struct ath12k_base *ab, struct sk_buff *skb)
 static void ath12k_wmi_twt_enable_event(struct ath12k_base *ab,
 					struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_twt_enable_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse wmi twt enable status event tlv: %d\n",
 			    ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_TWT_ENABLE_COMPLETE_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_TWT_ENABLE_COMPLETE_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch twt enable wmi event\n");
-		goto exit;
+		return;
 	}
 
 	ath12k_dbg(ab, ATH12K_DBG_MAC, "wmi twt enable event pdev id %u status %u\n",
 		   le32_to_cpu(ev->pdev_id),
 		   le32_to_cpu(ev->status));
-
-exit:
-	kfree(tb);
 }
 
 static void ath12k_wmi_twt_disable_event(struct ath12k_base *ab,
 					 struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_twt_disable_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse wmi twt disable status event tlv: %d\n",
 			    ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_TWT_DISABLE_COMPLETE_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_TWT_DISABLE_COMPLETE_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch twt disable wmi event\n");
-		goto exit;
+		return;
 	}
 
 	ath12k_dbg(ab, ATH12K_DBG_MAC, "wmi twt disable event pdev id %d status %u\n",
 		   le32_to_cpu(ev->pdev_id),
 		   le32_to_cpu(ev->status));
-
-exit:
-	kfree(tb);
 }
 
 static void ath12k_wmi_twt_btwt_invite_sta_compl_event(struct ath12k_base *ab,
 						       struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_twt_btwt_invite_sta_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse wmi btwt invite sta event tlv: %d\n",
 			    ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_TWT_BTWT_INVITE_STA_COMPLETE_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_TWT_BTWT_INVITE_STA_COMPLETE_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch btwt invite sta event\n");
-		goto exit;
+		return;
 	}
 
 	ath12k_info(ab, "wmi btwt invite sta event vdev id %u peer %pM dialog %d status %u\n",
 		   le32_to_cpu(ev->vdev_id), ev->peer_macaddr.addr,
 		   le32_to_cpu(ev->dialog_id),
 		   le32_to_cpu(ev->status));
-
-exit:
-	kfree(tb);
 }
 
 static void ath12k_wmi_twt_btwt_remove_sta_compl_event(struct ath12k_base *ab,
 						       struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_twt_btwt_remove_sta_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse wmi btwt remove sta event tlv: %d\n",
 			    ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_TWT_BTWT_REMOVE_STA_COMPLETE_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_TWT_BTWT_REMOVE_STA_COMPLETE_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch btwt remove sta event\n");
-		goto exit;
+		return;
 	}
 
 	ath12k_info(ab, "wmi btwt remove sta event vdev id %u peer %pM dialog %d status %u\n",
 		   le32_to_cpu(ev->vdev_id), ev->peer_macaddr.addr,
 		   le32_to_cpu(ev->dialog_id),
 		   le32_to_cpu(ev->status));
-
-exit:
-	kfree(tb);
 }
 
 static int ath12k_wmi_wow_wakeup_host_parse(struct ath12k_base *ab,
@@ -12911,20 +12804,18 @@ static void ath12k_wmi_gtk_offload_status_event(struct ath12k_base *ab,
 	struct ath12k_link_vif *arvif;
 	__be64 replay_ctr_be;
 	u64 replay_ctr;
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_GTK_OFFLOAD_STATUS_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_GTK_OFFLOAD_STATUS_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch gtk offload status ev");
-		kfree(tb);
 		return;
 	}
 
@@ -12934,7 +12825,6 @@ static void ath12k_wmi_gtk_offload_status_event(struct ath12k_base *ab,
 		rcu_read_unlock();
 		ath12k_warn(ab, "failed to get arvif for vdev_id:%d\n",
 			    le32_to_cpu(ev->vdev_id));
-		kfree(tb);
 		return;
 	}
 
@@ -12950,8 +12840,6 @@ static void ath12k_wmi_gtk_offload_status_event(struct ath12k_base *ab,
 				   (void *)&replay_ctr_be, GFP_ATOMIC);
 
 	rcu_read_unlock();
-
-	kfree(tb);
 }
 
 static void ath12k_wmi_event_mlo_setup_complete(struct ath12k_base *ab,
@@ -12961,21 +12849,19 @@ static void ath12k_wmi_event_mlo_setup_complete(struct ath12k_base *ab,
 	struct ath12k *ar = NULL;
 	struct ath12k_pdev *pdev;
 	u32 max_ml_peer_ids;
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	int ret, i;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse mlo setup complete event tlv: %d\n",
 			    ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_MLO_SETUP_COMPLETE_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_MLO_SETUP_COMPLETE_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch mlo setup complete event\n");
-		kfree(tb);
 		return;
 	}
 
@@ -12994,7 +12880,7 @@ skip_lookup:
 	if (!ar) {
 		ath12k_warn(ab, "invalid pdev_id %d status %u in setup complete event\n",
 			    ev->pdev_id, ev->status);
-		goto out;
+		return;
 	}
 
 	ar->mlo_setup_status = le32_to_cpu(ev->status);
@@ -13008,9 +12894,6 @@ skip_lookup:
 	if (ab->hw_params->hal_ops->hal_get_tqm_scratch_reg)
 		ab->hw_params->hal_ops->hal_get_tqm_scratch_reg(ab, &ar->delta_tqm);
 	complete(&ar->mlo_setup_done);
-
-out:
-	kfree(tb);
 }
 
 static void ath12k_wmi_event_teardown_complete(struct ath12k_base *ab,
@@ -13022,25 +12905,21 @@ static void ath12k_wmi_event_teardown_complete(struct ath12k_base *ab,
 	struct ath12k_pdev *pdev;
 	struct ath12k_hw *ah;
 	struct ath12k *ar = NULL;
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	int i, j, ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse teardown complete event tlv: %d\n", ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_MLO_TEARDOWN_COMPLETE];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_MLO_TEARDOWN_COMPLETE);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch teardown complete event\n");
-		kfree(tb);
 		return;
 	}
 
-	kfree(tb);
-
 	if (ev->pdev_id > ab->num_radios)
 		return;
 
@@ -14009,21 +13888,19 @@ ath12k_pull_peer_create_conf_ev(struct ath12k_base *ab,
 				struct sk_buff *skb,
 				struct ath12k_wmi_peer_create_conf_arg *arg)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct ath12k_wmi_peer_create_conf_ev *ev;
 	long int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
-		ath12k_warn(ab, "failed to parse tlv: %ld\n", ret);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
+		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return ret;
 	}
 
-	ev = tb[WMI_TAG_PEER_CREATE_RESP_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_PEER_CREATE_RESP_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch peer create response ev");
-		kfree(tb);
 		return -EPROTO;
 	}
 
@@ -14031,7 +13908,6 @@ ath12k_pull_peer_create_conf_ev(struct ath12k_base *ab,
 	ether_addr_copy(arg->mac_addr, ev->peer_macaddr.addr);
 	arg->status = __le32_to_cpu(ev->status);
 
-	kfree(tb);
 	return 0;
 }
 
@@ -14335,23 +14211,22 @@ static const char *ath12k_wmi_twt_add_dialog_event_status(u32 status)
 static void ath12k_wmi_twt_add_dialog_event(struct ath12k_base *ab,
 					    struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_twt_add_dialog_event *ev;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab,
 			    "failed to parse wmi twt add dialog status event tlv: %d\n",
 			    ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_TWT_ADD_DIALOG_COMPLETE_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_TWT_ADD_DIALOG_COMPLETE_EVENT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch twt add dialog wmi event\n");
-		goto exit;
+		return;
 	}
 
 	if (ev->status)
@@ -14359,9 +14234,6 @@ static void ath12k_wmi_twt_add_dialog_event(struct ath12k_base *ab,
 			    "wmi add twt dialog event vdev %d dialog id %d status %s\n",
 			    ev->vdev_id, ev->dialog_id,
 			    ath12k_wmi_twt_add_dialog_event_status(ev->status));
-
-exit:
-	kfree(tb);
 }
 
 static void ath12k_wmi_suspend_event(struct ath12k_base *ab, struct sk_buff *skb)
@@ -14369,25 +14241,24 @@ static void ath12k_wmi_suspend_event(struct ath12k_base *ab, struct sk_buff *skb
 	struct ath12k *ar = NULL;
 	const struct wmi_suspend_resp_event *ev;
 	struct ath12k_pdev *pdev;
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
+	int ret;
 	u32 pdev_id, i;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ath12k_warn(ab, "failed to parse tlv: %ld\n", PTR_ERR(tb));
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
+		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return;
 	}
 
-	ev = tb[WMI_PDEV_SUSPEND_EVENT_FIXED_PARAM];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_PDEV_SUSPEND_EVENT_FIXED_PARAM);
 
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch pdev suspend resp ev");
-		kfree(tb);
 		return;
 	}
 
 	pdev_id = le32_to_cpu(ev->pdev_id);
-	kfree(tb);
 	ath12k_dbg(ab, ATH12K_DBG_WMI, "WMI suspend event received for pdev_id %d\n", pdev_id);
 
 	if (ev->pdev_id > ab->num_radios)
@@ -14416,25 +14287,24 @@ static void ath12k_wmi_pdev_resume_event(struct ath12k_base *ab, struct sk_buff
 	const struct wmi_pdev_resume_resp_event *ev;
 	struct ath12k *ar = NULL;
 	struct ath12k_pdev *pdev;
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
+	int ret;
 	u32 pdev_id, i;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ath12k_warn(ab, "failed to parse tlv: %ld\n", PTR_ERR(tb));
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
+		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_PDEV_RESUME_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_PDEV_RESUME_EVENT);
 
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch pdev resume resp ev");
-		kfree(tb);
 		return;
 	}
 
 	pdev_id = le32_to_cpu(ev->pdev_id);
-	kfree(tb);
 	ath12k_dbg(ab, ATH12K_DBG_WMI, "WMI resume event received for pdev_id %d\n", pdev_id);
 
 	if (ev->pdev_id > ab->num_radios)
@@ -14464,20 +14334,19 @@ ath12k_wmi_obss_color_collision_event(struct ath12k_base *ab, struct sk_buff *sk
 	const struct wmi_obss_color_collision_event *ev;
 	struct ath12k_link_vif *arvif;
 	struct ath12k *ar;
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_OBSS_COLOR_COLLISION_EVT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_OBSS_COLOR_COLLISION_EVT);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch obss color collision ev");
-		goto exit;
+		return;
 	}
 
 	rcu_read_lock();
@@ -14501,7 +14370,7 @@ ath12k_wmi_obss_color_collision_event(struct ath12k_base *ab, struct sk_buff *sk
 		ath12k_dbg(ab, ATH12K_DBG_WMI,
 				"OBSS color collision detected vdev:%d, event:%d, bitmap:%08llx\n",
 				ev->vdev_id, ev->evt_type, ev->obss_color_bitmap);
-		goto exit;
+		return;
 	case WMI_BSS_COLOR_COLLISION_DISABLE:
 	case WMI_BSS_COLOR_FREE_SLOT_TIMER_EXPIRY:
 	case WMI_BSS_COLOR_FREE_SLOT_AVAILABLE:
@@ -14512,8 +14381,6 @@ ath12k_wmi_obss_color_collision_event(struct ath12k_base *ab, struct sk_buff *sk
 
 unlock:
 	rcu_read_unlock();
-exit:
-	kfree(tb);
 }
 
 static int
@@ -15203,24 +15070,22 @@ static void ath12k_wmi_parse_cfr_capture_event(struct ath12k_base *ab,
 static void ath12k_process_ocac_complete_event(struct ath12k_base *ab,
 					       struct sk_buff *skb)
 {
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	const struct wmi_vdev_adfs_ocac_complete_event_fixed_param *ev;
 	struct ath12k *ar;
 	u32 vdev_id, status;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_VDEV_ADFS_OCAC_COMPLETE_EVENT];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_VDEV_ADFS_OCAC_COMPLETE_EVENT);
 
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch ocac completed ev");
-		kfree(tb);
 		return;
 	}
 
@@ -15239,7 +15104,7 @@ static void ath12k_process_ocac_complete_event(struct ath12k_base *ab,
 	if (!ar) {
 		ath12k_warn(ab, "OCAC complete event in invalid vdev %d\n",
 			    ev->vdev_id);
-		goto exit;
+		return;
 	}
 
 	ath12k_dbg(ar->ab, ATH12K_DBG_WMI,"aDFS ocac complete event in vdev %d\n",
@@ -15251,8 +15116,6 @@ static void ath12k_process_ocac_complete_event(struct ath12k_base *ab,
 		memset(&ar->agile_chandef, 0, sizeof(struct cfg80211_chan_def));
 		ar->agile_chandef.chan = NULL;
 	}
-exit:
-	kfree(tb);
 }
 
 static void ath12k_wmi_tid_to_link_map_event(struct ath12k_base *ab,
@@ -15262,21 +15125,19 @@ static void ath12k_wmi_tid_to_link_map_event(struct ath12k_base *ab,
 	struct ath12k_link_vif *arvif;
 	u16 mapping_switch_tsf;
 	u32 status_type;
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	u32 vdev_id;
 	int ret;
 
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return;
 	}
 
-	ev = tb[WMI_TAG_MLO_TID_TO_LINK_MAPPING_EVENT_FIXED_PARAM];
+	ev = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_MLO_TID_TO_LINK_MAPPING_EVENT_FIXED_PARAM);
 	if (!ev) {
 		ath12k_warn(ab, "failed to fetch TID to link mapping ev");
-		kfree(tb);
 		return;
 	}
 
@@ -15300,7 +15161,6 @@ static void ath12k_wmi_tid_to_link_map_event(struct ath12k_base *ab,
 
 unlock:
 	rcu_read_unlock();
-	kfree(tb);
 }
 
 static int ath12k_wmi_tlv_mlo_3_link_tlt_evt_parse(struct ath12k_base *ab,
@@ -15532,7 +15392,7 @@ ath12k_wmi_pktlog_decode_info(struct ath12k_base *ab,
                                   struct sk_buff *skb)
 {
 	struct ath12k *ar;
-	const void **tb;
+	struct ath12k_wmi_tlv_tb tb;
 	int ret;
 	u32 pdev_id;
 	struct ath12k_pktlog *pktlog;
@@ -15542,16 +15402,14 @@ ath12k_wmi_pktlog_decode_info(struct ath12k_base *ab,
 		ath12k_warn(ab, "firmware doesn't support pktlog decode info support\n");
 		return;
 	}
-	tb = ath12k_wmi_tlv_parse_alloc(ab, skb, GFP_ATOMIC);
-	if (IS_ERR(tb)) {
-		ret = PTR_ERR(tb);
+	ret = ath12k_wmi_tlv_parse_tb(ab, skb, &tb);
+	if (ret) {
 		ath12k_warn(ab, "failed to parse tlv: %d\n", ret);
 		return;
 	}
-	pktlog_info = tb[WMI_TAG_PDEV_PKTLOG_DECODE_INFO];
+	pktlog_info = ath12k_wmi_tlv_tb_get(&tb, WMI_TAG_PDEV_PKTLOG_DECODE_INFO);
 	if (!pktlog_info) {
 		ath12k_warn(ab, "failed to fetch pktlog debug info");
-		kfree(tb);
 		return;
 	}
 
@@ -15568,14 +15426,12 @@ ath12k_wmi_pktlog_decode_info(struct ath12k_base *ab,
 	ar = ath12k_mac_get_ar_by_pdev_id(ab, pdev_id);
 	if (!ar) {
 		ath12k_warn(ab, "invalid pdev id in pktlog decode info %d", pdev_id);
-		kfree(tb);
 		return;
 	}
 	pktlog = &ar->debug.pktlog;
 	pktlog->fw_version_record = 1;
 	if (pktlog->buf == NULL) {
 		ath12k_warn(ab, "failed to initialize, start pktlog\n");
-		kfree(tb);
 		return;
 	}
 	pktlog->buf->bufhdr.magic_num = PKTLOG_MAGIC_NUM_FW_VERSION_SUPPORT;
@@ -15584,7 +15440,6 @@ ath12k_wmi_pktlog_decode_info(struct ath12k_base *ab,
 	pktlog->buf->bufhdr.pktlog_defs_json_version = pktlog_info->pktlog_defs_json_version;
 	ath12k_dbg(ab, ATH12K_DBG_WMI,
 		   "pktlog new magic_num: 0x%x\n", pktlog->buf->bufhdr.magic_num);
-	kfree(tb);
 }
 
 static void ath12k_wmi_op_rx(struct ath12k_base *ab, struct sk_buff *skb)
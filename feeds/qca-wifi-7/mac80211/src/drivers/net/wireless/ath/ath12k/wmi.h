@@ -89,6 +89,28 @@ struct wmi_tlv {
 	u8 value[];
 } __packed;
 
+/* Distinct top level tags kept per event; events carry far fewer than this */
+#define ATH12K_WMI_TLV_TB_MAX 16
+
+/* Top level TLVs of an event, filled on the handler's stack */
+struct ath12k_wmi_tlv_tb {
+	u8 num;
+	u16 tag[ATH12K_WMI_TLV_TB_MAX];
+	const void *ptr[ATH12K_WMI_TLV_TB_MAX];
+};
+
+static inline const void *
+ath12k_wmi_tlv_tb_get(const struct ath12k_wmi_tlv_tb *tb, u16 tag)
+{
+	int i;
+
+	for (i = 0; i < tb->num; i++)
+		if (tb->tag[i] == tag)
+			return tb->ptr[i];
+
+	return NULL;
+}
+
 struct wmi_vdev_ch_power_info {
         u32 tlv_header;
         u32 chan_cfreq; /* Channel center frequency (MHz) */
@@ -9305,4 +9327,9 @@ int ath12k_wmi_ap_tid_to_link_map_config(struct ath12k *ar,
 int ath12k_wmi_atf_send_group_config(struct ath12k *ar);
 int ath12k_wmi_atf_send_peer_config(struct ath12k *ar,
 				    struct ath12k_atf_peer_params *peer_param);
+
+#if IS_ENABLED(CPTCFG_ATH12K_KUNIT_TEST)
+int ath12k_wmi_tlv_parse_tb(struct ath12k_base *ab, struct sk_buff *skb,
+			    struct ath12k_wmi_tlv_tb *tb);
+#endif
 #endif
@@ -481,9 +481,17 @@ static const struct mcs_group airtime_mcs_groups[] = {
 	EHT_GROUP_RANGE(EHT_GI_32, BW_320),
 };
 
-static u32
-ieee80211_calc_legacy_rate_duration(u16 bitrate, bool short_pre,
-				    bool cck, int len)
+/*
+ * Legacy rate durations are computed as (len * 80) / bitrate. Dividing by
+ * multiplying with a reciprocal scaled by 2^33 gives the exact same result
+ * as long as len * 80 * bitrate < 2^33, i.e. for any len up to U16_MAX and
+ * bitrates up to 163.8 Mbps.
+ */
+#define LEGACY_RECIP_SHIFT	33
+#define LEGACY_RECIP_MIN_RATE	10
+#define LEGACY_RECIP_MAX_RATE	1638
+
+static u32 ieee80211_calc_legacy_overhead(bool short_pre, bool cck)
 {
 	u32 duration;
 
@@ -497,11 +505,79 @@ ieee80211_calc_legacy_rate_duration(u16 bitrate, bool short_pre,
 		duration = 20 + 16; /* premable + SIFS */
 	}
 
+	return duration;
+}
+
+VISIBLE_IF_MAC80211_KUNIT u32
+ieee80211_calc_legacy_rate_duration(u16 bitrate, bool short_pre,
+				    bool cck, int len)
+{
+	u32 duration = ieee80211_calc_legacy_overhead(short_pre, cck);
+
 	len <<= 3;
 	duration += (len * 10) / bitrate;
 
 	return duration;
 }
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(ieee80211_calc_legacy_rate_duration);
+
+static u32
+ieee80211_calc_legacy_airtime(struct ieee80211_local *local,
+			      struct ieee80211_supported_band *sband,
+			      int rate_idx, bool short_pre, int len)
+{
+	const struct ieee80211_legacy_airtime *la;
+	const struct ieee80211_rate *rate;
+
+	la = &local->legacy_airtime[sband->band][rate_idx];
+	if (likely(la->recip && len >= 0 && len <= U16_MAX))
+		return la->overhead[short_pre] +
+		       (u32)(((u64)len * 80 * la->recip) >> LEGACY_RECIP_SHIFT);
+
+	rate = &sband->bitrates[rate_idx];
+	return ieee80211_calc_legacy_rate_duration(rate->bitrate, short_pre,
+						   rate->flags &
+						   IEEE80211_RATE_MANDATORY_B,
+						   len);
+}
+
+void ieee80211_airtime_init(struct ieee80211_local *local)
+{
+	struct ieee80211_supported_band *sband;
+	int band, i;
+
+	for (band = 0; band < NUM_NL80211_BANDS; band++) {
+		sband = local->hw.wiphy->bands[band];
+		if (!sband)
+			continue;
+
+		for (i = 0; i < sband->n_bitrates &&
+			    i < IEEE80211_LEGACY_AIRTIME_RATES; i++) {
+			struct ieee80211_legacy_airtime *la;
+			const struct ieee80211_rate *rate;
+			bool cck;
+
+			la = &local->legacy_airtime[band][i];
+			rate = &sband->bitrates[i];
+			cck = rate->flags & IEEE80211_RATE_MANDATORY_B;
+
+			la->overhead[0] = ieee80211_calc_legacy_overhead(false,
+									 cck);
+			la->overhead[1] = ieee80211_calc_legacy_overhead(true,
+									 cck);
+
+			if (rate->bitrate < LEGACY_RECIP_MIN_RATE ||
+			    rate->bitrate > LEGACY_RECIP_MAX_RATE) {
+				la->recip = 0;
+				continue;
+			}
+
+			la->recip = DIV_ROUND_UP_ULL(1ULL << LEGACY_RECIP_SHIFT,
+						     rate->bitrate);
+		}
+	}
+}
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(ieee80211_airtime_init);
 
 static u32 ieee80211_get_rate_duration(struct ieee80211_hw *hw,
 				       struct ieee80211_rx_status *status,
@@ -582,6 +658,16 @@ static u32 ieee80211_get_rate_duration(struct ieee80211_hw *hw,
 }
 
 
+/*
+ * Scale a per-AVG_PKT_SIZE duration in 1024 * usec to usec for len bytes.
+ * Slow rates overflow 32 bits for A-MSDU sized frames, so use a 64 bit
+ * product.
+ */
+static inline u32 ieee80211_scale_rate_duration(u32 duration, int len)
+{
+	return ((u64)duration * len) >> (ilog2(AVG_PKT_SIZE) + 10);
+}
+
 u32 ieee80211_calc_rx_airtime(struct ieee80211_hw *hw,
 			      struct ieee80211_rx_status *status,
 			      int len)
@@ -590,9 +676,7 @@ u32 ieee80211_calc_rx_airtime(struct ieee80211_hw *hw,
 	u32 duration, overhead = 0;
 
 	if (status->encoding == RX_ENC_LEGACY) {
-		const struct ieee80211_rate *rate;
 		bool sp = status->enc_flags & RX_ENC_FLAG_SHORTPRE;
-		bool cck;
 
 		/* on 60GHz or sub-1GHz band, there are no legacy rates */
 		if (WARN_ON_ONCE(status->band == NL80211_BAND_60GHZ ||
@@ -604,22 +688,15 @@ u32 ieee80211_calc_rx_airtime(struct ieee80211_hw *hw,
 		if (!sband || status->rate_idx >= sband->n_bitrates)
 			return 0;
 
-		rate = &sband->bitrates[status->rate_idx];
-		cck = rate->flags & IEEE80211_RATE_MANDATORY_B;
-
-		return ieee80211_calc_legacy_rate_duration(rate->bitrate, sp,
-							   cck, len);
+		return ieee80211_calc_legacy_airtime(hw_to_local(hw), sband,
+						     status->rate_idx, sp, len);
 	}
 
 	duration = ieee80211_get_rate_duration(hw, status, &overhead);
 	if (!duration)
 		return 0;
 
-	duration *= len;
-	duration /= AVG_PKT_SIZE;
-	duration /= 1024;
-
-	return duration + overhead;
+	return ieee80211_scale_rate_duration(duration, len) + overhead;
 }
 EXPORT_SYMBOL_GPL(ieee80211_calc_rx_airtime);
 
@@ -762,10 +839,9 @@ u32 ieee80211_calc_expected_tx_airtime(struct ieee80211_hw *hw,
 	struct ieee80211_supported_band *sband;
 	struct ieee80211_chanctx_conf *conf;
 	int rateidx;
-	bool cck, short_pream;
+	bool short_pream;
 	u32 basic_rates;
 	u8 band = 0;
-	u16 rate;
 
 	len += 38; /* Ethernet header length */
 
@@ -811,9 +887,7 @@ u32 ieee80211_calc_expected_tx_airtime(struct ieee80211_hw *hw,
 		else
 			agg_shift = 6;
 
-		duration *= len;
-		duration /= AVG_PKT_SIZE;
-		duration /= 1024;
+		duration = ieee80211_scale_rate_duration(duration, len);
 		duration += (overhead >> agg_shift);
 
 		return max_t(u32, duration, 4);
@@ -833,8 +907,7 @@ u32 ieee80211_calc_expected_tx_airtime(struct ieee80211_hw *hw,
 	short_pream = vif->bss_conf.use_short_preamble;
 
 	rateidx = basic_rates ? ffs(basic_rates) - 1 : 0;
-	rate = sband->bitrates[rateidx].bitrate;
-	cck = sband->bitrates[rateidx].flags & IEEE80211_RATE_MANDATORY_B;
 
-	return ieee80211_calc_legacy_rate_duration(rate, short_pream, cck, len);
+	return ieee80211_calc_legacy_airtime(hw_to_local(hw), sband, rateidx,
+					     short_pream, len);
 }
@@ -2643,7 +2643,7 @@ static int ieee80211_change_station(struct wiphy *wiphy,
 		if (test_sta_flag(sta, WLAN_STA_AUTHORIZED))
 			ieee80211_vif_dec_num_mcast(sta->sdata);
 
-		sta->sdata = vlansdata;
+		sta_info_move_sdata(sta, vlansdata);
 		ieee80211_check_fast_rx(sta);
 		ieee80211_check_fast_xmit(sta);
 
@@ -3768,8 +3768,8 @@ int __ieee80211_request_smps_mgd(struct ieee80211_sub_if_data *sdata,
 	ap = sdata->vif.cfg.ap_addr;
 
 	rcu_read_lock();
-	list_for_each_entry_rcu(sta, &sdata->local->sta_list, list) {
-		if (!sta->sta.tdls || sta->sdata != sdata || !sta->uploaded ||
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
+		if (!sta->sta.tdls || !sta->uploaded ||
 		    !test_sta_flag(sta, WLAN_STA_AUTHORIZED))
 			continue;
 
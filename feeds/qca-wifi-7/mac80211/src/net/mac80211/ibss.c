@@ -642,11 +642,10 @@ static int ieee80211_sta_active_ibss(struct ieee80211_sub_if_data *sdata)
 
 	rcu_read_lock();
 
-	list_for_each_entry_rcu(sta, &local->sta_list, list) {
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
 		unsigned long last_active = ieee80211_sta_last_active(sta, -1);
 
-		if (sta->sdata == sdata &&
-		    time_is_after_jiffies(last_active +
+		if (time_is_after_jiffies(last_active +
 					  IEEE80211_IBSS_MERGE_INTERVAL)) {
 			active++;
 			break;
@@ -1241,12 +1240,9 @@ static void ieee80211_ibss_sta_expire(struct ieee80211_sub_if_data *sdata)
 
 	lockdep_assert_wiphy(local->hw.wiphy);
 
-	list_for_each_entry_safe(sta, tmp, &local->sta_list, list) {
+	list_for_each_entry_safe(sta, tmp, &sdata->sta_list, sdata_list) {
 		unsigned long last_active = ieee80211_sta_last_active(sta, -1);
 
-		if (sdata != sta->sdata)
-			continue;
-
 		if (time_is_before_jiffies(last_active + exp_time) ||
 		    (time_is_before_jiffies(last_active + exp_rsn) &&
 		     sta->sta_state != IEEE80211_STA_AUTHORIZED)) {
@@ -1188,6 +1188,12 @@ struct ieee80211_sub_if_data {
 	/* keys */
 	struct list_head key_list;
 
+	/*
+	 * stations on this interface, a subset of local->sta_list with
+	 * the same locking (wiphy mutex for writes, RCU for reads)
+	 */
+	struct list_head sta_list;
+
 	/* count for keys needing tailroom space allocation */
 	int crypto_tx_tailroom_needed_cnt;
 	int crypto_tx_tailroom_pending_dec;
@@ -1513,6 +1519,19 @@ struct ieee80211_tasklet_data {
 	struct ieee80211_local *local;
 };
 
+/* cfg80211 limits bands to 32 bitrates */
+#define IEEE80211_LEGACY_AIRTIME_RATES	32
+
+/**
+ * struct ieee80211_legacy_airtime - precomputed legacy rate airtime
+ * @recip: 2^33 / bitrate, or 0 if the rate needs a real division
+ * @overhead: preamble, PLCP and SIFS time in usec, indexed by short preamble
+ */
+struct ieee80211_legacy_airtime {
+	u32 recip;
+	u16 overhead[2];
+};
+
 struct ieee80211_local {
 	/* embed the driver visible part.
 	 * don't cast (use the static inlines below), but we keep
@@ -1532,6 +1551,9 @@ struct ieee80211_local {
 	spinlock_t handle_wake_tx_queue_lock;
 
 	u16 airtime_flags;
+	/* per band and bitrate index, see ieee80211_airtime_init() */
+	struct ieee80211_legacy_airtime
+		legacy_airtime[NUM_NL80211_BANDS][IEEE80211_LEGACY_AIRTIME_RATES];
 	u32 aql_txq_limit_low[IEEE80211_NUM_ACS];
 	u32 aql_txq_limit_high[IEEE80211_NUM_ACS];
 	u32 aql_threshold;
@@ -3008,6 +3030,7 @@ u8 *ieee80211_get_bssid(struct ieee80211_hdr *hdr, size_t len,
 
 extern const struct ethtool_ops ieee80211_ethtool_ops;
 
+void ieee80211_airtime_init(struct ieee80211_local *local);
 u32 ieee80211_calc_expected_tx_airtime(struct ieee80211_hw *hw,
 				       struct ieee80211_vif *vif,
 				       struct ieee80211_sta *pubsta,
@@ -3068,6 +3091,12 @@ int ieee80211_calc_chandef_subchan_offset(const struct cfg80211_chan_def *ap,
 void ieee80211_rearrange_tpe_psd(struct ieee80211_parsed_tpe_psd *psd,
 				 const struct cfg80211_chan_def *ap,
 				 const struct cfg80211_chan_def *used);
+bool ieee80211_sta_manage_reorder_buf(struct ieee80211_sub_if_data *sdata,
+				      struct tid_ampdu_rx *tid_agg_rx,
+				      struct sk_buff *skb,
+				      struct sk_buff_head *frames);
+u32 ieee80211_calc_legacy_rate_duration(u16 bitrate, bool short_pre,
+					bool cck, int len);
 #else
 #define EXPORT_SYMBOL_IF_MAC80211_KUNIT(sym)
 #define VISIBLE_IF_MAC80211_KUNIT static
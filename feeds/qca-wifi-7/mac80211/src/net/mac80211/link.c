@@ -606,10 +606,7 @@ static int _ieee80211_set_active_links(struct ieee80211_sub_if_data *sdata,
 						  BSS_CHANGED_HE_OBSS_PD |
 						  BSS_CHANGED_HE_BSS_COLOR);
 	}
-	list_for_each_entry(sta, &local->sta_list, list) {
-		if (sdata != sta->sdata)
-			continue;
-
+	list_for_each_entry(sta, &sdata->sta_list, sdata_list) {
 		/* this is very temporary, but do it anyway */
 		__ieee80211_sta_recalc_aggregates(sta,
 						  old_active | active_links);
@@ -623,10 +620,7 @@ static int _ieee80211_set_active_links(struct ieee80211_sub_if_data *sdata,
 	ret = ieee80211_key_switch_links(sdata, rem, add);
 	WARN_ON_ONCE(ret);
 
-	list_for_each_entry(sta, &local->sta_list, list) {
-		if (sdata != sta->sdata)
-			continue;
-
+	list_for_each_entry(sta, &sdata->sta_list, sdata_list) {
 		__ieee80211_sta_recalc_aggregates(sta, active_links);
 
 		ret = drv_change_sta_links(local, sdata, &sta->sta,
@@ -1714,6 +1714,8 @@ int ieee80211_register_hw(struct ieee80211_hw *hw)
 
 	local->hw.conf.flags = IEEE80211_CONF_IDLE;
 
+	ieee80211_airtime_init(local);
+
 	ieee80211_led_init(local);
 
 	result = ieee80211_txq_setup_flows(local);
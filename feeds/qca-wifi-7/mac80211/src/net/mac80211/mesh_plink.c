@@ -92,7 +92,6 @@ static inline void mesh_plink_fsm_restart(struct sta_info *sta)
  */
 static u64 mesh_set_short_slot_time(struct ieee80211_sub_if_data *sdata)
 {
-	struct ieee80211_local *local = sdata->local;
 	struct ieee80211_supported_band *sband;
 	struct sta_info *sta;
 	u32 erp_rates = 0;
@@ -120,9 +119,8 @@ static u64 mesh_set_short_slot_time(struct ieee80211_sub_if_data *sdata)
 		goto out;
 
 	rcu_read_lock();
-	list_for_each_entry_rcu(sta, &local->sta_list, list) {
-		if (sdata != sta->sdata ||
-		    sta->mesh->plink_state != NL80211_PLINK_ESTAB)
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
+		if (sta->mesh->plink_state != NL80211_PLINK_ESTAB)
 			continue;
 
 		short_slot = false;
@@ -158,7 +156,6 @@ out:
  */
 static u64 mesh_set_ht_prot_mode(struct ieee80211_sub_if_data *sdata)
 {
-	struct ieee80211_local *local = sdata->local;
 	struct sta_info *sta;
 	u16 ht_opmode;
 	bool non_ht_sta = false, ht20_sta = false;
@@ -173,9 +170,8 @@ static u64 mesh_set_ht_prot_mode(struct ieee80211_sub_if_data *sdata)
 	}
 
 	rcu_read_lock();
-	list_for_each_entry_rcu(sta, &local->sta_list, list) {
-		if (sdata != sta->sdata ||
-		    sta->mesh->plink_state != NL80211_PLINK_ESTAB)
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
+		if (sta->mesh->plink_state != NL80211_PLINK_ESTAB)
 			continue;
 
 		if (sta->sta.deflink.bandwidth > IEEE80211_STA_RX_BW_20)
@@ -847,15 +843,11 @@ static inline void mesh_plink_timer_set(struct sta_info *sta, u32 timeout)
 static bool llid_in_use(struct ieee80211_sub_if_data *sdata,
 			u16 llid)
 {
-	struct ieee80211_local *local = sdata->local;
 	bool in_use = false;
 	struct sta_info *sta;
 
 	rcu_read_lock();
-	list_for_each_entry_rcu(sta, &local->sta_list, list) {
-		if (sdata != sta->sdata)
-			continue;
-
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
 		if (!memcmp(&sta->mesh->llid, &llid, sizeof(llid))) {
 			in_use = true;
 			break;
@@ -93,10 +93,7 @@ u64 ieee80211_mps_local_status_update(struct ieee80211_sub_if_data *sdata)
 	enum nl80211_mesh_power_mode nonpeer_pm;
 
 	rcu_read_lock();
-	list_for_each_entry_rcu(sta, &sdata->local->sta_list, list) {
-		if (sdata != sta->sdata)
-			continue;
-
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
 		switch (sta->mesh->plink_state) {
 		case NL80211_PLINK_OPN_SNT:
 		case NL80211_PLINK_OPN_RCVD:
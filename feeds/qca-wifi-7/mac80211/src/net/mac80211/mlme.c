@@ -6667,10 +6667,7 @@ static void ieee80211_ml_reconf_work(struct wiphy *wiphy,
 		   "MLO Reconfiguration: work: valid=0x%x, removed=0x%lx\n",
 		   sdata->vif.valid_links, sdata->u.mgd.removed_links);
 
-	list_for_each_entry(sta, &local->sta_list, list) {
-		if (sdata != sta->sdata)
-			continue;
-
+	list_for_each_entry(sta, &sdata->sta_list, sdata_list) {
 		if (drv_check_removed_link_is_primary(local, sta,
 						      sdata->u.mgd.removed_links)) {
 			__ieee80211_disconnect(sdata);
@@ -6731,10 +6728,7 @@ static void ieee80211_ml_reconf_work(struct wiphy *wiphy,
 
 out:
 	if (!ret) {
-		list_for_each_entry(sta, &local->sta_list, list) {
-			if (sdata != sta->sdata)
-				continue;
-
+		list_for_each_entry(sta, &sdata->sta_list, sdata_list) {
 			for_each_set_bit(link_id, &sdata->u.mgd.removed_links,
 					 IEEE80211_MLD_MAX_NUM_LINKS)
 				ieee80211_sta_remove_link(sta, link_id, false);
@@ -1055,7 +1055,7 @@ minstrel_ht_refill_sample_rates(struct minstrel_ht_sta *mi)
  *  - as long as the max prob rate has a probability of more than 75%, pick
  *    higher throughput rates, even if the probability is a bit lower
  */
-static void
+VISIBLE_IF_MAC80211_KUNIT void
 minstrel_ht_update_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 {
 	struct minstrel_mcs_group_data *mg;
@@ -1192,6 +1192,7 @@ minstrel_ht_update_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 	mi->last_stats_update = jiffies;
 	mi->sample_time = jiffies;
 }
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(minstrel_ht_update_stats);
 
 static bool
 minstrel_ht_txstat_valid(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
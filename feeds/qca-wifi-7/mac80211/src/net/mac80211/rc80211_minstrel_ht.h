@@ -199,4 +199,9 @@ void minstrel_ht_add_sta_debugfs(void *priv, void *priv_sta, struct dentry *dir)
 int minstrel_ht_get_tp_avg(struct minstrel_ht_sta *mi, int group, int rate,
 			   int prob_avg);
 
+#if IS_ENABLED(CPTCFG_MAC80211_KUNIT_TEST)
+void minstrel_ht_update_stats(struct minstrel_priv *mp,
+			      struct minstrel_ht_sta *mi);
+#endif
+
 #endif
@@ -1452,10 +1452,11 @@ static void ieee80211_sta_reorder_release(struct ieee80211_sub_if_data *sdata,
  * rcu_read_lock protection. It returns false if the frame
  * can be processed immediately, true if it was consumed.
  */
-static bool ieee80211_sta_manage_reorder_buf(struct ieee80211_sub_if_data *sdata,
-					     struct tid_ampdu_rx *tid_agg_rx,
-					     struct sk_buff *skb,
-					     struct sk_buff_head *frames)
+VISIBLE_IF_MAC80211_KUNIT bool
+ieee80211_sta_manage_reorder_buf(struct ieee80211_sub_if_data *sdata,
+				 struct tid_ampdu_rx *tid_agg_rx,
+				 struct sk_buff *skb,
+				 struct sk_buff_head *frames)
 {
 	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *) skb->data;
 	struct ieee80211_rx_status *status = IEEE80211_SKB_RXCB(skb);
@@ -1546,6 +1547,7 @@ static bool ieee80211_sta_manage_reorder_buf(struct ieee80211_sub_if_data *sdata
 	spin_unlock(&tid_agg_rx->reorder_lock);
 	return ret;
 }
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(ieee80211_sta_manage_reorder_buf);
 
 /*
  * Reorder MPDUs from A-MPDUs, keeping them on a buffer. Returns
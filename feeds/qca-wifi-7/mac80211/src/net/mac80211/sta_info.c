@@ -339,10 +339,8 @@ struct sta_info *sta_info_get_by_idx(struct ieee80211_sub_if_data *sdata,
 	struct sta_info *sta;
 	int i = 0;
 
-	list_for_each_entry_rcu(sta, &local->sta_list, list,
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list,
 				lockdep_is_held(&local->hw.wiphy->mtx)) {
-		if (sdata != sta->sdata)
-			continue;
 		if (i < idx) {
 			++i;
 			continue;
@@ -352,6 +350,23 @@ struct sta_info *sta_info_get_by_idx(struct ieee80211_sub_if_data *sdata,
 
 	return NULL;
 }
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(sta_info_get_by_idx);
+
+void sta_info_move_sdata(struct sta_info *sta,
+			 struct ieee80211_sub_if_data *sdata)
+{
+	lockdep_assert_wiphy(sta->local->hw.wiphy);
+
+	/*
+	 * Readers may still be walking the old interface's list through
+	 * this entry, let them finish before linking it into the new one.
+	 */
+	list_del_rcu(&sta->sdata_list);
+	synchronize_net();
+	list_add_tail_rcu(&sta->sdata_list, &sdata->sta_list);
+
+	sta->sdata = sdata;
+}
 
 static void sta_info_free_link(struct link_sta_info *link_sta)
 {
@@ -882,14 +897,12 @@ static int sta_info_insert_drv_state(struct ieee80211_local *local,
 static void
 ieee80211_recalc_p2p_go_ps_allowed(struct ieee80211_sub_if_data *sdata)
 {
-	struct ieee80211_local *local = sdata->local;
 	bool allow_p2p_go_ps = sdata->vif.p2p;
 	struct sta_info *sta;
 
 	rcu_read_lock();
-	list_for_each_entry_rcu(sta, &local->sta_list, list) {
-		if (sdata != sta->sdata ||
-		    !test_sta_flag(sta, WLAN_STA_ASSOC))
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
+		if (!test_sta_flag(sta, WLAN_STA_ASSOC))
 			continue;
 		if (!sta->sta.support_p2p_ps) {
 			allow_p2p_go_ps = false;
@@ -947,6 +960,7 @@ static int sta_info_insert_finish(struct sta_info *sta) __acquires(RCU)
 	}
 
 	list_add_tail_rcu(&sta->list, &local->sta_list);
+	list_add_tail_rcu(&sta->sdata_list, &sdata->sta_list);
 
 	/* update channel context before notifying the driver about state
 	 * change, this enables driver using the updated channel context right away.
@@ -1010,6 +1024,7 @@ static int sta_info_insert_finish(struct sta_info *sta) __acquires(RCU)
 		link_sta_info_hash_del(local, &sta->deflink);
 	sta_info_hash_del(local, sta);
 	list_del_rcu(&sta->list);
+	list_del_rcu(&sta->sdata_list);
  out_drop_sta:
 	local->num_sta--;
 	synchronize_net();
@@ -1353,6 +1368,7 @@ static int __must_check __sta_info_destroy_part1(struct sta_info *sta)
 	}
 
 	list_del_rcu(&sta->list);
+	list_del_rcu(&sta->sdata_list);
 	sta->removed = true;
 
 	if (sta->uploaded)
@@ -1651,10 +1667,36 @@ void sta_info_stop(struct ieee80211_local *local)
 }
 
 
+static int __sta_info_flush_sdata(struct ieee80211_sub_if_data *sdata,
+				  int link_id,
+				  struct sta_info *do_not_flush_sta,
+				  struct list_head *free_list)
+{
+	struct sta_info *sta, *tmp;
+	int ret = 0;
+
+	list_for_each_entry_safe(sta, tmp, &sdata->sta_list, sdata_list) {
+		if (sta == do_not_flush_sta)
+			continue;
+
+		if (link_id >= 0 && sta->sta.valid_links &&
+		    !(sta->sta.valid_links & BIT(link_id)))
+			continue;
+
+		if (!WARN_ON(__sta_info_destroy_part1(sta)))
+			list_add(&sta->free_list, free_list);
+
+		ret++;
+	}
+
+	return ret;
+}
+
 int __sta_info_flush(struct ieee80211_sub_if_data *sdata, bool vlans,
 		     int link_id, struct sta_info *do_not_flush_sta)
 {
 	struct ieee80211_local *local = sdata->local;
+	struct ieee80211_sub_if_data *vlan;
 	struct sta_info *sta, *tmp;
 	LIST_HEAD(free_list);
 	int ret = 0;
@@ -1665,22 +1707,18 @@ int __sta_info_flush(struct ieee80211_sub_if_data *sdata, bool vlans,
 	WARN_ON(vlans && sdata->vif.type != NL80211_IFTYPE_AP);
 	WARN_ON(vlans && !sdata->bss);
 
-	list_for_each_entry_safe(sta, tmp, &local->sta_list, list) {
-		if (sdata != sta->sdata &&
-		    (!vlans || sdata->bss != sta->sdata->bss))
-			continue;
-
-		if (sta == do_not_flush_sta)
-			continue;
-
-		if (link_id >= 0 && sta->sta.valid_links &&
-		    !(sta->sta.valid_links & BIT(link_id)))
-			continue;
+	ret = __sta_info_flush_sdata(sdata, link_id, do_not_flush_sta,
+				     &free_list);
 
-		if (!WARN_ON(__sta_info_destroy_part1(sta)))
-			list_add(&sta->free_list, &free_list);
+	if (vlans && sdata->bss) {
+		list_for_each_entry(vlan, &local->interfaces, list) {
+			if (vlan == sdata || vlan->bss != sdata->bss)
+				continue;
 
-		ret++;
+			ret += __sta_info_flush_sdata(vlan, link_id,
+						      do_not_flush_sta,
+						      &free_list);
+		}
 	}
 
 	if (!list_empty(&free_list)) {
@@ -1709,12 +1747,9 @@ void ieee80211_sta_expire(struct ieee80211_sub_if_data *sdata,
 
 	lockdep_assert_wiphy(local->hw.wiphy);
 
-	list_for_each_entry_safe(sta, tmp, &local->sta_list, list) {
+	list_for_each_entry_safe(sta, tmp, &sdata->sta_list, sdata_list) {
 		unsigned long last_active = ieee80211_sta_last_active(sta, -1);
 
-		if (sdata != sta->sdata)
-			continue;
-
 		if (time_is_before_jiffies(last_active + exp_time)) {
 			sta_dbg(sta->sdata, "expiring inactive STA %pM\n",
 				sta->sta.addr);
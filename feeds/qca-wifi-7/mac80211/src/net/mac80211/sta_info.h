@@ -653,6 +653,7 @@ struct ieee80211_sta_removed_link_stats {
  * mac80211 is communicating with.
  *
  * @list: global linked list entry
+ * @sdata_list: linked list entry in the station list of @sdata
  * @free_list: list entry for keeping track of stations to free
  * @hash_node: hash node for rhashtable
  * @addr: station's MAC address - duplicated from public part to
@@ -728,6 +729,7 @@ struct ieee80211_sta_removed_link_stats {
 struct sta_info {
 	/* General information, mostly static */
 	struct list_head list, free_list;
+	struct list_head sdata_list;
 	struct rcu_head rcu_head;
 	struct rhlist_head hash_node;
 	u8 addr[ETH_ALEN];
@@ -939,6 +941,12 @@ link_sta_info_get_bss(struct ieee80211_sub_if_data *sdata, const u8 *addr);
  */
 struct sta_info *sta_info_get_by_idx(struct ieee80211_sub_if_data *sdata,
 				     int idx);
+/*
+ * Move an inserted STA to another interface of the same BSS (AP_VLAN),
+ * may sleep.
+ */
+void sta_info_move_sdata(struct sta_info *sta,
+			 struct ieee80211_sub_if_data *sdata);
 /*
  * Create a new STA info, caller owns returned structure
  * until sta_info_insert().
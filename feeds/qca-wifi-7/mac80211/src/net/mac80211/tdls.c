@@ -1363,8 +1363,8 @@ static int iee80211_tdls_have_ht_peers(struct ieee80211_sub_if_data *sdata)
 	bool result = false;
 
 	rcu_read_lock();
-	list_for_each_entry_rcu(sta, &sdata->local->sta_list, list) {
-		if (!sta->sta.tdls || sta->sdata != sdata || !sta->uploaded ||
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
+		if (!sta->sta.tdls || !sta->uploaded ||
 		    !test_sta_flag(sta, WLAN_STA_AUTHORIZED) ||
 		    !test_sta_flag(sta, WLAN_STA_TDLS_PEER_AUTH) ||
 		    !sta->sta.deflink.ht_cap.ht_supported)
@@ -2040,8 +2040,8 @@ void ieee80211_teardown_tdls_peers(struct ieee80211_link_data *link)
 	u16 reason = WLAN_REASON_TDLS_TEARDOWN_UNSPECIFIED;
 
 	rcu_read_lock();
-	list_for_each_entry_rcu(sta, &sdata->local->sta_list, list) {
-		if (!sta->sta.tdls || sta->sdata != sdata || !sta->uploaded ||
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
+		if (!sta->sta.tdls || !sta->uploaded ||
 		    !test_sta_flag(sta, WLAN_STA_AUTHORIZED))
 			continue;
 
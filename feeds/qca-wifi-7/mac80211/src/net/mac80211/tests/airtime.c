@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit tests for airtime estimation
+ */
+#include <kunit/test.h>
+#include "util.h"
+
+MODULE_IMPORT_NS("EXPORTED_FOR_KUNIT_TESTING");
+
+static const int legacy_lens[] = { 0, 1, 14, 100, 1500, 2346, 7935, 11454,
+				   U16_MAX };
+
+static void legacy_table(struct kunit *test)
+{
+	struct t_sdata *t_sdata = T_SDATA(test);
+	struct ieee80211_hw *hw = &t_sdata->local.hw;
+	int band, i, sp, l;
+
+	ieee80211_airtime_init(&t_sdata->local);
+
+	for (band = NL80211_BAND_2GHZ; band <= NL80211_BAND_5GHZ; band++) {
+		struct ieee80211_supported_band *sband = hw->wiphy->bands[band];
+
+		for (i = 0; i < sband->n_bitrates; i++) {
+			const struct ieee80211_rate *rate = &sband->bitrates[i];
+			bool cck = rate->flags & IEEE80211_RATE_MANDATORY_B;
+
+			for (sp = 0; sp <= 1; sp++) {
+				struct ieee80211_rx_status status = {
+					.encoding = RX_ENC_LEGACY,
+					.band = band,
+					.rate_idx = i,
+					.enc_flags = sp ? RX_ENC_FLAG_SHORTPRE : 0,
+				};
+
+				for (l = 0; l < ARRAY_SIZE(legacy_lens); l++) {
+					int len = legacy_lens[l];
+
+					KUNIT_EXPECT_EQ_MSG(test,
+							    ieee80211_calc_rx_airtime(hw, &status, len),
+							    ieee80211_calc_legacy_rate_duration(rate->bitrate,
+												sp, cck, len),
+							    "band %d bitrate %d sp %d len %d",
+							    band, rate->bitrate, sp, len);
+				}
+			}
+		}
+	}
+}
+
+static const int mcs_lens[] = { 64, 1500, 11454, U16_MAX };
+
+/*
+ * The MCS durations are precomputed per group from bits per symbol, check
+ * them against the PHY rate cfg80211 reports for the same rate. Allow 5%
+ * for the rounding of the table and of the cfg80211 rates.
+ */
+static void t_check_mcs(struct kunit *test, struct ieee80211_hw *hw,
+			struct ieee80211_rx_status *status,
+			struct rate_info *ri, int streams)
+{
+	u32 bitrate = cfg80211_calculate_bitrate(ri);
+	int l;
+
+	KUNIT_ASSERT_NE(test, bitrate, 0);
+
+	for (l = 0; l < ARRAY_SIZE(mcs_lens); l++) {
+		int len = mcs_lens[l];
+		u32 expected = div_u64((u64)len * 80, bitrate);
+		u32 airtime = ieee80211_calc_rx_airtime(hw, status, len);
+		s64 data = (s64)airtime - (36 + (streams << 2));
+
+		KUNIT_EXPECT_GT_MSG(test, airtime, 0,
+				    "enc %d bw %d mcs %d nss %d",
+				    status->encoding, status->bw,
+				    status->rate_idx, status->nss);
+		KUNIT_EXPECT_LE_MSG(test, abs(data - expected),
+				    expected / 20 + 1,
+				    "enc %d bw %d mcs %d nss %d len %d",
+				    status->encoding, status->bw,
+				    status->rate_idx, status->nss, len);
+	}
+}
+
+static const enum rate_info_bw mcs_bws[] = {
+	RATE_INFO_BW_20, RATE_INFO_BW_40, RATE_INFO_BW_80, RATE_INFO_BW_160,
+	RATE_INFO_BW_320,
+};
+
+static void mcs_table(struct kunit *test)
+{
+	struct t_sdata *t_sdata = T_SDATA(test);
+	struct ieee80211_hw *hw = &t_sdata->local.hw;
+	struct ieee80211_rx_status status;
+	struct rate_info ri;
+	int bw, gi, nss, mcs;
+
+	/* HT, streams are part of the MCS index */
+	for (bw = 0; bw <= 1; bw++) {
+		for (gi = 0; gi <= 1; gi++) {
+			for (mcs = 0; mcs < 32; mcs++) {
+				status = (struct ieee80211_rx_status) {
+					.encoding = RX_ENC_HT,
+					.bw = mcs_bws[bw],
+					.rate_idx = mcs,
+					.enc_flags = gi ? RX_ENC_FLAG_SHORT_GI : 0,
+				};
+				ri = (struct rate_info) {
+					.flags = RATE_INFO_FLAGS_MCS |
+						 (gi ? RATE_INFO_FLAGS_SHORT_GI : 0),
+					.bw = mcs_bws[bw],
+					.mcs = mcs,
+				};
+				t_check_mcs(test, hw, &status, &ri, (mcs >> 3) + 1);
+			}
+		}
+	}
+
+	for (bw = 0; bw <= 3; bw++) {
+		for (gi = 0; gi <= 1; gi++) {
+			for (nss = 1; nss <= 4; nss++) {
+				for (mcs = 0; mcs <= 9; mcs++) {
+					status = (struct ieee80211_rx_status) {
+						.encoding = RX_ENC_VHT,
+						.bw = mcs_bws[bw],
+						.nss = nss,
+						.rate_idx = mcs,
+						.enc_flags = gi ? RX_ENC_FLAG_SHORT_GI : 0,
+					};
+					ri = (struct rate_info) {
+						.flags = RATE_INFO_FLAGS_VHT_MCS |
+							 (gi ? RATE_INFO_FLAGS_SHORT_GI : 0),
+						.bw = mcs_bws[bw],
+						.nss = nss,
+						.mcs = mcs,
+					};
+					t_check_mcs(test, hw, &status, &ri, nss);
+				}
+			}
+		}
+	}
+
+	for (bw = 0; bw <= 3; bw++) {
+		for (gi = 0; gi <= 2; gi++) {
+			for (nss = 1; nss <= 8; nss++) {
+				for (mcs = 0; mcs <= 11; mcs++) {
+					status = (struct ieee80211_rx_status) {
+						.encoding = RX_ENC_HE,
+						.bw = mcs_bws[bw],
+						.nss = nss,
+						.rate_idx = mcs,
+						.he_gi = gi,
+					};
+					ri = (struct rate_info) {
+						.flags = RATE_INFO_FLAGS_HE_MCS,
+						.bw = mcs_bws[bw],
+						.nss = nss,
+						.mcs = mcs,
+						.he_gi = gi,
+					};
+					t_check_mcs(test, hw, &status, &ri, nss);
+				}
+			}
+		}
+	}
+
+	for (bw = 0; bw <= 4; bw++) {
+		for (gi = 0; gi <= 2; gi++) {
+			for (nss = 1; nss <= 8; nss++) {
+				for (mcs = 0; mcs <= 13; mcs++) {
+					status = (struct ieee80211_rx_status) {
+						.encoding = RX_ENC_EHT,
+						.bw = mcs_bws[bw],
+						.nss = nss,
+						.rate_idx = mcs,
+						.eht.gi = gi,
+					};
+					ri = (struct rate_info) {
+						.flags = RATE_INFO_FLAGS_EHT_MCS,
+						.bw = mcs_bws[bw],
+						.nss = nss,
+						.mcs = mcs,
+						.eht_gi = gi,
+					};
+					t_check_mcs(test, hw, &status, &ri, nss);
+				}
+			}
+		}
+	}
+}
+
+static struct kunit_case airtime_test_cases[] = {
+	KUNIT_CASE(legacy_table),
+	KUNIT_CASE(mcs_table),
+	{}
+};
+
+static struct kunit_suite airtime = {
+	.name = "mac80211-airtime",
+	.test_cases = airtime_test_cases,
+};
+
+kunit_test_suite(airtime);
@@ -0,0 +1,522 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit microbenchmarks for mac80211 rx/tx hot paths
+ *
+ * Each case runs an operation on synthetic input and reports the mean cost
+ * as a KTAP diagnostic line of the form
+ *
+ *	# <case>: bench <name> <ns> ns/op <iterations> iterations
+ *
+ * so that CI can scrape and track the numbers across runs. The cases only
+ * fail if the synthetic input is not handled as expected.
+ */
+#include <linux/ip.h>
+#include <linux/timekeeping.h>
+#include <kunit/test.h>
+#include "util.h"
+#include "../sta_info.h"
+#include "../wme.h"
+#include "../rc80211_minstrel_ht.h"
+
+MODULE_IMPORT_NS("EXPORTED_FOR_KUNIT_TESTING");
+
+#define BENCH_ITERATIONS	4096
+
+static void bench_report(struct kunit *test, const char *name,
+			 u64 total_ns, unsigned int iterations)
+{
+	kunit_info(test, "bench %s %llu ns/op %u iterations\n", name,
+		   div_u64(total_ns, iterations), iterations);
+}
+
+static void bench_put_elem(struct sk_buff *skb, u8 eid, u8 len)
+{
+	skb_put_u8(skb, eid);
+	skb_put_u8(skb, len);
+	skb_put_zero(skb, len);
+}
+
+static void bench_put_ext_elem(struct sk_buff *skb, u8 eid, u8 len)
+{
+	skb_put_u8(skb, WLAN_EID_EXTENSION);
+	skb_put_u8(skb, len + 1);
+	skb_put_u8(skb, eid);
+	skb_put_zero(skb, len);
+}
+
+static void parse_elems(struct kunit *test)
+{
+	static const u8 rsn[] = {
+		0x01, 0x00,			/* version */
+		0x00, 0x0f, 0xac, 0x04,		/* group cipher CCMP */
+		0x01, 0x00,
+		0x00, 0x0f, 0xac, 0x04,		/* pairwise CCMP */
+		0x01, 0x00,
+		0x00, 0x0f, 0xac, 0x08,		/* AKM SAE */
+		0xc0, 0x00,			/* capabilities */
+	};
+	static const u8 wmm[] = {
+		0x00, 0x50, 0xf2, 0x02, 0x01, 0x01, 0x00, 0x00,
+		0x03, 0xa4, 0x00, 0x00, 0x27, 0xa4, 0x00, 0x00,
+		0x42, 0x43, 0x5e, 0x00, 0x62, 0x32, 0x2f, 0x00,
+	};
+	struct ieee802_11_elems *elems;
+	struct sk_buff *skb;
+	u64 start, total;
+	int i;
+
+	skb = alloc_skb(1024, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, skb);
+
+	/* roughly what a Wi-Fi 6 AP puts into its beacons */
+	skb_put_u8(skb, WLAN_EID_SSID);
+	skb_put_u8(skb, 8);
+	skb_put_data(skb, "kunit-ap", 8);
+	skb_put_u8(skb, WLAN_EID_SUPP_RATES);
+	skb_put_u8(skb, 8);
+	skb_put_data(skb, "\x8c\x12\x98\x24\xb0\x48\x60\x6c", 8);
+	bench_put_elem(skb, WLAN_EID_DS_PARAMS, 1);
+	bench_put_elem(skb, WLAN_EID_TIM, 4);
+	bench_put_elem(skb, WLAN_EID_COUNTRY, 6);
+	skb_put_u8(skb, WLAN_EID_RSN);
+	skb_put_u8(skb, sizeof(rsn));
+	skb_put_data(skb, rsn, sizeof(rsn));
+	bench_put_elem(skb, WLAN_EID_HT_CAPABILITY,
+		       sizeof(struct ieee80211_ht_cap));
+	bench_put_elem(skb, WLAN_EID_HT_OPERATION,
+		       sizeof(struct ieee80211_ht_operation));
+	bench_put_elem(skb, WLAN_EID_EXT_CAPABILITY, 10);
+	bench_put_elem(skb, WLAN_EID_VHT_CAPABILITY,
+		       sizeof(struct ieee80211_vht_cap));
+	bench_put_elem(skb, WLAN_EID_VHT_OPERATION,
+		       sizeof(struct ieee80211_vht_operation));
+	bench_put_ext_elem(skb, WLAN_EID_EXT_HE_CAPABILITY,
+			   sizeof(struct ieee80211_he_cap_elem) + 4);
+	bench_put_ext_elem(skb, WLAN_EID_EXT_HE_OPERATION,
+			   sizeof(struct ieee80211_he_operation));
+	bench_put_ext_elem(skb, WLAN_EID_EXT_HE_MU_EDCA,
+			   sizeof(struct ieee80211_mu_edca_param_set));
+	skb_put_u8(skb, WLAN_EID_VENDOR_SPECIFIC);
+	skb_put_u8(skb, sizeof(wmm));
+	skb_put_data(skb, wmm, sizeof(wmm));
+
+	start = ktime_get_ns();
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		elems = ieee802_11_parse_elems(skb->data, skb->len, false, NULL);
+		if (IS_ERR_OR_NULL(elems))
+			break;
+		kfree(elems);
+	}
+	total = ktime_get_ns() - start;
+
+	KUNIT_EXPECT_EQ(test, i, BENCH_ITERATIONS);
+	bench_report(test, "parse_elems", total, i);
+
+	kfree_skb(skb);
+}
+
+#define BENCH_AMSDU_SUBFRAMES	4
+#define BENCH_AMSDU_PAYLOAD	1500
+
+static struct sk_buff *bench_build_amsdu(void)
+{
+	struct sk_buff *skb;
+	struct ethhdr *eth;
+	int i;
+
+	skb = alloc_skb(BENCH_AMSDU_SUBFRAMES * (ETH_HLEN + BENCH_AMSDU_PAYLOAD + 4),
+			GFP_KERNEL);
+	if (!skb)
+		return NULL;
+
+	for (i = 0; i < BENCH_AMSDU_SUBFRAMES; i++) {
+		unsigned int pad;
+
+		eth = skb_put(skb, ETH_HLEN);
+		eth_broadcast_addr(eth->h_dest);
+		eth->h_dest[0] = 0x02;
+		eth_zero_addr(eth->h_source);
+		eth->h_source[0] = 0x02;
+		eth->h_source[5] = i;
+		eth->h_proto = htons(BENCH_AMSDU_PAYLOAD);
+
+		skb_put_data(skb, rfc1042_header, sizeof(rfc1042_header));
+		put_unaligned_be16(ETH_P_IP, skb_put(skb, 2));
+		skb_put_zero(skb, BENCH_AMSDU_PAYLOAD - sizeof(rfc1042_header) - 2);
+
+		/* all but the last subframe are padded to 4 bytes */
+		pad = (4 - (ETH_HLEN + BENCH_AMSDU_PAYLOAD)) & 3;
+		if (i < BENCH_AMSDU_SUBFRAMES - 1)
+			skb_put_zero(skb, pad);
+	}
+
+	return skb;
+}
+
+static void amsdu_deagg(struct kunit *test)
+{
+	struct sk_buff_head input, list;
+	struct sk_buff *skb;
+	unsigned int count = 0;
+	u64 start, total = 0;
+	int i;
+
+	__skb_queue_head_init(&input);
+	__skb_queue_head_init(&list);
+
+	/* build all input up front so only the deaggregation is timed */
+	for (i = 0; i < BENCH_ITERATIONS / 16; i++) {
+		skb = bench_build_amsdu();
+		if (!skb)
+			break;
+		__skb_queue_tail(&input, skb);
+	}
+
+	while ((skb = __skb_dequeue(&input))) {
+		start = ktime_get_ns();
+		ieee80211_amsdu_to_8023s(skb, &list, NULL,
+					 NL80211_IFTYPE_STATION, 0,
+					 NULL, NULL, 0);
+		total += ktime_get_ns() - start;
+
+		KUNIT_EXPECT_EQ(test, skb_queue_len(&list),
+				BENCH_AMSDU_SUBFRAMES);
+		__skb_queue_purge(&list);
+		count++;
+	}
+
+	KUNIT_ASSERT_GT(test, count, 0);
+	bench_report(test, "amsdu_deagg", total, count);
+}
+
+#define BENCH_REORDER_BUF_SIZE	64
+
+static void bench_reorder_timer(struct timer_list *t)
+{
+}
+
+static struct sk_buff *bench_build_qos_data(u16 sn)
+{
+	struct ieee80211_qos_hdr *hdr;
+	struct sk_buff *skb;
+
+	skb = alloc_skb(sizeof(*hdr) + 64, GFP_KERNEL);
+	if (!skb)
+		return NULL;
+
+	hdr = skb_put_zero(skb, sizeof(*hdr));
+	hdr->frame_control = cpu_to_le16(IEEE80211_FTYPE_DATA |
+					 IEEE80211_STYPE_QOS_DATA |
+					 IEEE80211_FCTL_FROMDS);
+	hdr->seq_ctrl = cpu_to_le16(IEEE80211_SN_TO_SEQ(sn));
+	skb_put_zero(skb, 64);
+
+	return skb;
+}
+
+static void reorder_release(struct kunit *test)
+{
+	struct t_sdata *t_sdata = T_SDATA(test);
+	struct sk_buff_head input, frames;
+	struct tid_ampdu_rx *tid_agg_rx;
+	unsigned int released = 0;
+	struct sk_buff *skb;
+	u64 start, total;
+	int i;
+
+	tid_agg_rx = kunit_kzalloc(test, sizeof(*tid_agg_rx), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, tid_agg_rx);
+	tid_agg_rx->reorder_buf =
+		kunit_kcalloc(test, BENCH_REORDER_BUF_SIZE,
+			      sizeof(struct sk_buff_head), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, tid_agg_rx->reorder_buf);
+	tid_agg_rx->reorder_time =
+		kunit_kcalloc(test, BENCH_REORDER_BUF_SIZE,
+			      sizeof(unsigned long), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, tid_agg_rx->reorder_time);
+
+	for (i = 0; i < BENCH_REORDER_BUF_SIZE; i++)
+		__skb_queue_head_init(&tid_agg_rx->reorder_buf[i]);
+	spin_lock_init(&tid_agg_rx->reorder_lock);
+	timer_setup(&tid_agg_rx->reorder_timer, bench_reorder_timer, 0);
+	tid_agg_rx->buf_size = BENCH_REORDER_BUF_SIZE;
+
+	__skb_queue_head_init(&input);
+	__skb_queue_head_init(&frames);
+
+	/* swap every pair of sequence numbers: the first frame of a pair is
+	 * buffered and the second one releases both
+	 */
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		skb = bench_build_qos_data(i ^ 1);
+		if (!skb) {
+			__skb_queue_purge(&input);
+			KUNIT_FAIL(test, "failed to allocate input frames");
+			return;
+		}
+		__skb_queue_tail(&input, skb);
+	}
+
+	rcu_read_lock();
+	start = ktime_get_ns();
+	while ((skb = __skb_dequeue(&input))) {
+		if (!ieee80211_sta_manage_reorder_buf(t_sdata->sdata, tid_agg_rx,
+						      skb, &frames))
+			kfree_skb(skb);
+
+		released += skb_queue_len(&frames);
+		__skb_queue_purge(&frames);
+	}
+	total = ktime_get_ns() - start;
+	rcu_read_unlock();
+
+	del_timer_sync(&tid_agg_rx->reorder_timer);
+
+	KUNIT_EXPECT_EQ(test, released, BENCH_ITERATIONS);
+	KUNIT_EXPECT_EQ(test, tid_agg_rx->stored_mpdu_num, 0);
+	bench_report(test, "reorder_release", total, BENCH_ITERATIONS);
+}
+
+static void select_queue(struct kunit *test)
+{
+	struct t_sdata *t_sdata = T_SDATA(test);
+	struct sta_info *sta;
+	struct sk_buff *skb;
+	struct ethhdr *eth;
+	struct iphdr *iph;
+	u64 start, total;
+	/* not a valid AC, so a loop that never ran cannot pass */
+	u16 ac = IEEE80211_NUM_ACS;
+	int i;
+
+	sta = kunit_kzalloc(test, sizeof(*sta), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, sta);
+	sta->sta.wme = true;
+	sta->reserved_tid = IEEE80211_TID_UNRESERVED;
+	t_sdata->sdata->control_port_protocol = cpu_to_be16(ETH_P_PAE);
+
+	skb = alloc_skb(ETH_HLEN + sizeof(*iph), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, skb);
+
+	eth = skb_put_zero(skb, ETH_HLEN);
+	eth->h_dest[0] = 0x02;
+	eth->h_proto = htons(ETH_P_IP);
+	skb_set_network_header(skb, ETH_HLEN);
+	iph = skb_put_zero(skb, sizeof(*iph));
+	iph->version = 4;
+	iph->ihl = 5;
+	iph->tos = 0x88; /* AF41, maps to AC_VI rather than the default AC_BE */
+	skb->protocol = htons(ETH_P_IP);
+
+	rcu_read_lock();
+	start = ktime_get_ns();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		ac = ieee80211_select_queue(t_sdata->sdata, sta, skb);
+	total = ktime_get_ns() - start;
+	rcu_read_unlock();
+
+	KUNIT_EXPECT_EQ(test, ac, IEEE80211_AC_VI);
+	bench_report(test, "select_queue", total, BENCH_ITERATIONS);
+
+	kfree_skb(skb);
+}
+
+static void airtime_estimate(struct kunit *test)
+{
+	struct t_sdata *t_sdata = T_SDATA(test);
+	struct ieee80211_hw *hw = &t_sdata->local.hw;
+	struct ieee80211_rx_status status[] = {
+		{
+			.encoding = RX_ENC_LEGACY,
+			.band = NL80211_BAND_2GHZ,
+			.rate_idx = 11, /* 54 Mbps */
+		},
+		{
+			.encoding = RX_ENC_HT,
+			.bw = RATE_INFO_BW_40,
+			.rate_idx = 15,
+			.enc_flags = RX_ENC_FLAG_SHORT_GI,
+		},
+		{
+			.encoding = RX_ENC_VHT,
+			.bw = RATE_INFO_BW_80,
+			.nss = 2,
+			.rate_idx = 9,
+		},
+		{
+			.encoding = RX_ENC_HE,
+			.bw = RATE_INFO_BW_160,
+			.nss = 4,
+			.rate_idx = 11,
+			.he_gi = NL80211_RATE_INFO_HE_GI_0_8,
+		},
+		{
+			.encoding = RX_ENC_EHT,
+			.bw = RATE_INFO_BW_320,
+			.nss = 4,
+			.rate_idx = 13,
+			.eht.gi = NL80211_RATE_INFO_EHT_GI_0_8,
+		},
+	};
+	u64 start, total, sum = 0;
+	int i;
+
+	ieee80211_airtime_init(&t_sdata->local);
+
+	start = ktime_get_ns();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		sum += ieee80211_calc_rx_airtime(hw,
+						 &status[i % ARRAY_SIZE(status)],
+						 1500);
+	total = ktime_get_ns() - start;
+
+	KUNIT_EXPECT_GT(test, sum, 0);
+	bench_report(test, "airtime_estimate", total, BENCH_ITERATIONS);
+}
+
+#define BENCH_SWEEP_VIFS	16
+#define BENCH_SWEEP_STAS	64
+
+static void sta_sweep(struct kunit *test)
+{
+	struct t_sdata *t_sdata = T_SDATA(test);
+	struct ieee80211_local *local = &t_sdata->local;
+	struct ieee80211_sub_if_data *vifs[BENCH_SWEEP_VIFS];
+	struct ieee80211_sub_if_data *sdata;
+	struct sta_info *sta;
+	unsigned int seen = 0, other = 0;
+	u64 start, total_sdata = 0, total_global = 0;
+	int i, v;
+
+	INIT_LIST_HEAD(&local->sta_list);
+
+	for (v = 0; v < BENCH_SWEEP_VIFS; v++) {
+		sdata = kunit_kzalloc(test, sizeof(*sdata), GFP_KERNEL);
+		KUNIT_ASSERT_NOT_NULL(test, sdata);
+		sdata->local = local;
+		INIT_LIST_HEAD(&sdata->sta_list);
+		vifs[v] = sdata;
+	}
+
+	/* interleave the interfaces like clients associating over time */
+	for (i = 0; i < BENCH_SWEEP_STAS; i++) {
+		for (v = 0; v < BENCH_SWEEP_VIFS; v++) {
+			sta = kunit_kzalloc(test, sizeof(*sta), GFP_KERNEL);
+			KUNIT_ASSERT_NOT_NULL(test, sta);
+			sta->local = local;
+			sta->sdata = vifs[v];
+			list_add_tail_rcu(&sta->list, &local->sta_list);
+			list_add_tail_rcu(&sta->sdata_list, &vifs[v]->sta_list);
+		}
+	}
+
+	rcu_read_lock();
+	for (i = 0; i < BENCH_ITERATIONS / BENCH_SWEEP_VIFS; i++) {
+		sdata = vifs[i % BENCH_SWEEP_VIFS];
+
+		start = ktime_get_ns();
+		list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
+			if (sta->sdata != sdata)
+				other++;
+			seen++;
+		}
+		total_sdata += ktime_get_ns() - start;
+
+		/* the filtered walk over all stations that this replaces */
+		start = ktime_get_ns();
+		list_for_each_entry_rcu(sta, &local->sta_list, list) {
+			if (sta->sdata != sdata)
+				continue;
+			seen--;
+		}
+		total_global += ktime_get_ns() - start;
+	}
+
+	for (v = 0; v < BENCH_SWEEP_VIFS; v++) {
+		sta = sta_info_get_by_idx(vifs[v], BENCH_SWEEP_STAS - 1);
+		KUNIT_EXPECT_TRUE(test, sta && sta->sdata == vifs[v]);
+		KUNIT_EXPECT_NULL(test,
+				  sta_info_get_by_idx(vifs[v], BENCH_SWEEP_STAS));
+	}
+	rcu_read_unlock();
+
+	KUNIT_EXPECT_EQ(test, other, 0);
+	KUNIT_EXPECT_EQ(test, seen, 0);
+	bench_report(test, "sta_sweep_sdata", total_sdata,
+		     BENCH_ITERATIONS / BENCH_SWEEP_VIFS);
+	bench_report(test, "sta_sweep_global", total_global,
+		     BENCH_ITERATIONS / BENCH_SWEEP_VIFS);
+}
+
+#if IS_ENABLED(CPTCFG_MAC80211_RC_MINSTREL)
+static void minstrel_ht_update(struct kunit *test)
+{
+	struct t_sdata *t_sdata = T_SDATA(test);
+	struct minstrel_rate_stats *mrs;
+	struct ieee80211_sta *sta;
+	struct minstrel_ht_sta *mi;
+	struct minstrel_priv *mp;
+	u64 start, total = 0;
+	int i, group, rate;
+
+	mp = kunit_kzalloc(test, sizeof(*mp), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, mp);
+	mi = kunit_kzalloc(test, sizeof(*mi), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, mi);
+	sta = kunit_kzalloc(test, sizeof(*sta), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, sta);
+
+	mp->hw = &t_sdata->local.hw;
+#ifdef CPTCFG_MAC80211_DEBUGFS
+	mp->fixed_rate_idx = (u32)-1;
+#endif
+	sta->deflink.ht_cap.ht_supported = true;
+	mi->sta = sta;
+	mi->avg_ampdu_len = MINSTREL_FRAC(8, 1);
+
+	/* an HT peer supporting every MCS of every HT group */
+	for (group = MINSTREL_HT_GROUP_0; group < MINSTREL_CCK_GROUP; group++)
+		mi->supported[group] = 0xff;
+
+	for (i = 0; i < BENCH_ITERATIONS / 16; i++) {
+		/* feed a new sampling interval so every pass does full work */
+		for (group = MINSTREL_HT_GROUP_0; group < MINSTREL_CCK_GROUP;
+		     group++) {
+			for (rate = 0; rate < 8; rate++) {
+				mrs = &mi->groups[group].rates[rate];
+				mrs->attempts = 64;
+				mrs->success = 64 - (7 - rate) * 6 - (i & 7);
+			}
+		}
+		mi->ampdu_len = 32;
+		mi->ampdu_packets = 4;
+
+		start = ktime_get_ns();
+		minstrel_ht_update_stats(mp, mi);
+		total += ktime_get_ns() - start;
+	}
+
+	KUNIT_EXPECT_NE(test, mi->max_tp_rate[0], 0);
+	bench_report(test, "minstrel_ht_update", total, i);
+}
+#endif
+
+static struct kunit_case bench_test_cases[] = {
+	KUNIT_CASE(parse_elems),
+	KUNIT_CASE(amsdu_deagg),
+	KUNIT_CASE(reorder_release),
+	KUNIT_CASE(select_queue),
+	KUNIT_CASE(sta_sweep),
+	KUNIT_CASE(airtime_estimate),
+#if IS_ENABLED(CPTCFG_MAC80211_RC_MINSTREL)
+	KUNIT_CASE(minstrel_ht_update),
+#endif
+	{}
+};
+
+static struct kunit_suite bench = {
+	.name = "mac80211-bench",
+	.test_cases = bench_test_cases,
+};
+
+kunit_test_suite(bench);
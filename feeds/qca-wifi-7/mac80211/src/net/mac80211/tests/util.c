@@ -210,6 +210,7 @@ int t_sdata_init(struct kunit_resource *resource, void *ctx)
 	strscpy(t_sdata->sdata->name, "kunit");
 
 	t_sdata->sdata->local = &t_sdata->local;
+	INIT_LIST_HEAD(&t_sdata->sdata->sta_list);
 	t_sdata->sdata->local->hw.wiphy = t_sdata->wiphy;
 	t_sdata->sdata->wdev.wiphy = t_sdata->wiphy;
 	t_sdata->sdata->vif.type = NL80211_IFTYPE_STATION;
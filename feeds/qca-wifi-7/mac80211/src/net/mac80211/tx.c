@@ -450,19 +450,21 @@ static void purge_old_ps_buffers(struct ieee80211_local *local)
 	 * Drop one frame from each station from the lowest-priority
 	 * AC that has frames at all.
 	 */
-	list_for_each_entry_rcu(sta, &local->sta_list, list) {
-		int ac;
-
-		for (ac = IEEE80211_AC_BK; ac >= IEEE80211_AC_VO; ac--) {
-			skb = skb_dequeue(&sta->ps_tx_buf[ac]);
-			total += skb_queue_len(&sta->ps_tx_buf[ac]);
-			if (skb) {
-				if (!tid_stats_disable)
-					ieee80211_tx_drop_stats(sdata, 0,
-								TX_DROP_QUEUE_PURGE);
-				purged++;
-				ieee80211_free_txskb(&local->hw, skb);
-				break;
+	list_for_each_entry_rcu(sdata, &local->interfaces, list) {
+		list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
+			int ac;
+
+			for (ac = IEEE80211_AC_BK; ac >= IEEE80211_AC_VO; ac--) {
+				skb = skb_dequeue(&sta->ps_tx_buf[ac]);
+				total += skb_queue_len(&sta->ps_tx_buf[ac]);
+				if (skb) {
+					if (!tid_stats_disable)
+						ieee80211_tx_drop_stats(sdata, 0,
+									TX_DROP_QUEUE_PURGE);
+					purged++;
+					ieee80211_free_txskb(&local->hw, skb);
+					break;
+				}
 			}
 		}
 	}
@@ -3559,15 +3561,23 @@ void ieee80211_check_fast_xmit_all(struct ieee80211_local *local)
 void ieee80211_check_fast_xmit_iface(struct ieee80211_sub_if_data *sdata)
 {
 	struct ieee80211_local *local = sdata->local;
+	struct ieee80211_sub_if_data *iter;
 	struct sta_info *sta;
 
 	rcu_read_lock();
 
-	list_for_each_entry_rcu(sta, &local->sta_list, list) {
-		if (sdata != sta->sdata &&
-		    (!sta->sdata->bss || sta->sdata->bss != sdata->bss))
-			continue;
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list)
 		ieee80211_check_fast_xmit(sta);
+
+	/* the AP and its VLANs share the BSS configuration */
+	if (sdata->bss) {
+		list_for_each_entry_rcu(iter, &local->interfaces, list) {
+			if (iter == sdata || iter->bss != sdata->bss)
+				continue;
+
+			list_for_each_entry_rcu(sta, &iter->sta_list, sdata_list)
+				ieee80211_check_fast_xmit(sta);
+		}
 	}
 
 	rcu_read_unlock();
@@ -4764,17 +4774,13 @@ ieee80211_convert_to_unicast(struct sk_buff *skb, struct net_device *dev,
 			     struct sk_buff_head *queue)
 {
 	struct ieee80211_sub_if_data *sdata = IEEE80211_DEV_TO_SUB_IF(dev);
-	struct ieee80211_local *local = sdata->local;
 	const struct ethhdr *eth = (struct ethhdr *)skb->data;
 	struct sta_info *sta, *first = NULL;
 	struct sk_buff *cloned_skb;
 
 	rcu_read_lock();
 
-	list_for_each_entry_rcu(sta, &local->sta_list, list) {
-		if (sdata != sta->sdata)
-			/* AP-VLAN mismatch */
-			continue;
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
 		if (unlikely(ether_addr_equal(eth->h_source, sta->sta.addr)))
 			/* do not send back to source */
 			continue;
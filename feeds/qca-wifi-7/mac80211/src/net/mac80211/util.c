@@ -344,10 +344,7 @@ static void __ieee80211_wake_txqs(struct ieee80211_sub_if_data *sdata, int ac)
 	if (sdata->vif.type == NL80211_IFTYPE_AP)
 		ps = &sdata->bss->ps;
 
-	list_for_each_entry_rcu(sta, &local->sta_list, list) {
-		if (sdata != sta->sdata)
-			continue;
-
+	list_for_each_entry_rcu(sta, &sdata->sta_list, sdata_list) {
 		for (i = 0; i < ARRAY_SIZE(sta->sta.txq); i++) {
 			struct ieee80211_txq *txq = sta->sta.txq[i];
 
@@ -806,11 +803,8 @@ void __ieee80211_flush_queues(struct ieee80211_local *local,
 		/* Purge the queues, so the frames on them won't be
 		 * sent during __ieee80211_wake_queue()
 		 */
-		list_for_each_entry(sta, &local->sta_list, list) {
-			if (sdata != sta->sdata)
-				continue;
+		list_for_each_entry(sta, &sdata->sta_list, sdata_list)
 			ieee80211_purge_sta_txqs(sta);
-		}
 	}
 
 	drv_flush(local, sdata, queues, drop);
@@ -1887,10 +1881,10 @@ static void ieee80211_reconfig_stations(struct ieee80211_sub_if_data *sdata)
 	lockdep_assert_wiphy(local->hw.wiphy);
 
 	/* add STAs back */
-	list_for_each_entry(sta, &local->sta_list, list) {
+	list_for_each_entry(sta, &sdata->sta_list, sdata_list) {
 		enum ieee80211_sta_state state;
 
-		if (!sta->uploaded || sta->sdata != sdata)
+		if (!sta->uploaded)
 			continue;
 
 		for (state = IEEE80211_STA_NOTEXIST;
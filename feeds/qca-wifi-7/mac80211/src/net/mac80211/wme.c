@@ -183,6 +183,7 @@ u16 ieee80211_select_queue(struct ieee80211_sub_if_data *sdata,
  downgrade:
 	return ieee80211_downgrade_queue(sdata, sta, skb);
 }
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(ieee80211_select_queue);
 
 /**
  * ieee80211_set_qos_hdr - Fill in the QoS header if there is one.
@@ -60,6 +60,10 @@
  * if the driver uses something other than the IEs, e.g. private
  * data stored in the BSS struct, since the beacon IEs are
  * also linked into the probe response struct.
+ *
+ * The @bss_list is kept sorted by the BSS timestamp (ts), oldest
+ * first, so expiry only needs to look at the head of the list
+ * instead of walking all entries.
  */
 
 /*
@@ -482,6 +486,28 @@ cfg80211_add_nontrans_list(struct cfg80211_bss *trans_bss,
 	return 0;
 }
 
+/*
+ * Add a BSS that is not on the list yet at its position by timestamp.
+ * New timestamps are almost always the most recent ones, so this is
+ * expected to stop at the tail right away.
+ */
+static void cfg80211_bss_list_add(struct cfg80211_registered_device *rdev,
+				  struct cfg80211_internal_bss *bss)
+{
+	struct cfg80211_internal_bss *pos;
+
+	lockdep_assert_held(&rdev->bss_lock);
+
+	list_for_each_entry_reverse(pos, &rdev->bss_list, list) {
+		if (!time_before(bss->ts, pos->ts)) {
+			list_add(&bss->list, &pos->list);
+			return;
+		}
+	}
+
+	list_add(&bss->list, &rdev->bss_list);
+}
+
 static void __cfg80211_bss_expire(struct cfg80211_registered_device *rdev,
 				  unsigned long expire_time)
 {
@@ -491,9 +517,10 @@ static void __cfg80211_bss_expire(struct cfg80211_registered_device *rdev,
 	lockdep_assert_held(&rdev->bss_lock);
 
 	list_for_each_entry_safe(bss, tmp, &rdev->bss_list, list) {
-		if (atomic_read(&bss->hold))
-			continue;
+		/* sorted by age, everything after this is newer */
 		if (!time_after(expire_time, bss->ts))
+			break;
+		if (atomic_read(&bss->hold))
 			continue;
 
 		if (__cfg80211_unlink_bss(rdev, bss))
@@ -511,6 +538,7 @@ static bool cfg80211_bss_expire_oldest(struct cfg80211_registered_device *rdev)
 
 	lockdep_assert_held(&rdev->bss_lock);
 
+	/* the list is sorted by age, take the first entry that can go */
 	list_for_each_entry(bss, &rdev->bss_list, list) {
 		if (atomic_read(&bss->hold))
 			continue;
@@ -519,9 +547,8 @@ static bool cfg80211_bss_expire_oldest(struct cfg80211_registered_device *rdev)
 		    !bss->pub.hidden_beacon_bss)
 			continue;
 
-		if (oldest && time_before(oldest->ts, bss->ts))
-			continue;
 		oldest = bss;
+		break;
 	}
 
 	if (WARN_ON(!oldest))
@@ -1384,16 +1411,19 @@ void cfg80211_bss_age(struct cfg80211_registered_device *rdev,
 	struct cfg80211_internal_bss *bss;
 	unsigned long age_jiffies = msecs_to_jiffies(age_secs * MSEC_PER_SEC);
 
+	/* shifting all entries by the same amount keeps bss_list sorted */
 	spin_lock_bh(&rdev->bss_lock);
 	list_for_each_entry(bss, &rdev->bss_list, list)
 		bss->ts -= age_jiffies;
 	spin_unlock_bh(&rdev->bss_lock);
 }
+EXPORT_SYMBOL_IF_CFG80211_KUNIT(cfg80211_bss_age);
 
 void cfg80211_bss_expire(struct cfg80211_registered_device *rdev)
 {
 	__cfg80211_bss_expire(rdev, jiffies - IEEE80211_SCAN_RESULT_EXPIRE);
 }
+EXPORT_SYMBOL_IF_CFG80211_KUNIT(cfg80211_bss_expire);
 
 void cfg80211_bss_flush(struct wiphy *wiphy)
 {
@@ -1718,7 +1748,7 @@ static void cfg80211_insert_bss(struct cfg80211_registered_device *rdev,
 
 	if (!rb_insert_bss(rdev, bss))
 		return;
-	list_add_tail(&bss->list, &rdev->bss_list);
+	cfg80211_bss_list_add(rdev, bss);
 	rdev->bss_entries++;
 }
 
@@ -1953,7 +1983,11 @@ cfg80211_update_known_bss(struct cfg80211_registered_device *rdev,
 	if (signal_valid)
 		known->pub.signal = new->pub.signal;
 	known->pub.capability = new->pub.capability;
-	known->ts = new->ts;
+	if (known->ts != new->ts) {
+		known->ts = new->ts;
+		list_del(&known->list);
+		cfg80211_bss_list_add(rdev, known);
+	}
 	known->ts_boottime = new->ts_boottime;
 	known->parent_tsf = new->parent_tsf;
 	known->pub.chains = new->pub.chains;
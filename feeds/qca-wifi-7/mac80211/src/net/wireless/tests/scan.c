@@ -840,6 +840,152 @@ static void test_cfg80211_parse_colocated_ap(struct kunit *test)
 	cfg80211_free_coloc_ap_list(&coloc_ap_list);
 }
 
+#define BSS_EXPIRY_NUM_BSS	10000
+
+static struct cfg80211_bss *t_inform_bss_n(struct wiphy *wiphy,
+					   struct ieee80211_channel *chan,
+					   unsigned int n)
+{
+	struct cfg80211_inform_bss inform_bss = {
+		.chan = chan,
+		.signal = -50,
+	};
+	static const u8 input[] = {
+		[0] = WLAN_EID_SSID,
+		[1] = 4,
+		[2] = 'T', 'E', 'S', 'T'
+	};
+	u8 bssid[ETH_ALEN] = { 0x02, 0x00 };
+
+	put_unaligned_be32(n, &bssid[2]);
+
+	return cfg80211_inform_bss_data(wiphy, &inform_bss,
+					CFG80211_BSS_FTYPE_BEACON, bssid, 0,
+					0, 100, input, sizeof(input),
+					GFP_KERNEL);
+}
+
+static bool t_bss_present(struct wiphy *wiphy, unsigned int n)
+{
+	struct cfg80211_bss *bss;
+	u8 bssid[ETH_ALEN] = { 0x02, 0x00 };
+
+	put_unaligned_be32(n, &bssid[2]);
+
+	bss = cfg80211_get_bss(wiphy, NULL, bssid, NULL, 0,
+			       IEEE80211_BSS_TYPE_ANY, IEEE80211_PRIVACY_ANY);
+	cfg80211_put_bss(wiphy, bss);
+
+	return bss;
+}
+
+static void test_bss_expire_oldest_at_cap(struct kunit *test)
+{
+	struct inform_bss ctx = {
+		.test = test,
+	};
+	struct wiphy *wiphy = T_WIPHY(test, ctx);
+	struct cfg80211_registered_device *rdev = wiphy_to_rdev(wiphy);
+	struct cfg80211_internal_bss *ibss, *prev = NULL;
+	struct ieee80211_channel *chan;
+	struct cfg80211_bss *bss, *held;
+	unsigned int at_cap = 0;
+	u64 start, cap_ns = 0;
+	int i;
+
+	chan = ieee80211_get_channel_khz(wiphy, MHZ_TO_KHZ(2412));
+	KUNIT_ASSERT_NOT_NULL(test, chan);
+
+	/* the held entry must survive even though it is the oldest */
+	held = t_inform_bss_n(wiphy, chan, 0);
+	KUNIT_ASSERT_NOT_NULL(test, held);
+	cfg80211_hold_bss(bss_from_pub(held));
+
+	for (i = 1; i < BSS_EXPIRY_NUM_BSS; i++) {
+		unsigned int entries = rdev->bss_entries;
+		u64 delta;
+
+		start = ktime_get_ns();
+		bss = t_inform_bss_n(wiphy, chan, i);
+		delta = ktime_get_ns() - start;
+		KUNIT_ASSERT_NOT_NULL(test, bss);
+		cfg80211_put_bss(wiphy, bss);
+
+		/* no growth means the limit was hit and the oldest went out */
+		if (rdev->bss_entries == entries) {
+			cap_ns += delta;
+			at_cap++;
+		}
+	}
+
+	KUNIT_EXPECT_LE(test, rdev->bss_entries, BSS_EXPIRY_NUM_BSS);
+	KUNIT_EXPECT_TRUE(test, t_bss_present(wiphy, 0));
+	KUNIT_EXPECT_TRUE(test, t_bss_present(wiphy, BSS_EXPIRY_NUM_BSS - 1));
+	if (rdev->bss_entries < BSS_EXPIRY_NUM_BSS) {
+		/* oldest entry that was not held went first */
+		KUNIT_EXPECT_FALSE(test, t_bss_present(wiphy, 1));
+	}
+
+	/* the list must stay ordered by age */
+	spin_lock_bh(&rdev->bss_lock);
+	list_for_each_entry(ibss, &rdev->bss_list, list) {
+		if (prev)
+			KUNIT_EXPECT_FALSE(test, time_before(ibss->ts, prev->ts));
+		prev = ibss;
+	}
+	spin_unlock_bh(&rdev->bss_lock);
+
+	if (at_cap)
+		kunit_info(test, "bench bss_insert_at_cap %llu ns/op %u iterations\n",
+			   div_u64(cap_ns, at_cap), at_cap);
+
+	cfg80211_unhold_bss(bss_from_pub(held));
+	cfg80211_put_bss(wiphy, held);
+}
+
+static void test_bss_expire_keeps_newer(struct kunit *test)
+{
+	struct inform_bss ctx = {
+		.test = test,
+	};
+	struct wiphy *wiphy = T_WIPHY(test, ctx);
+	struct cfg80211_registered_device *rdev = wiphy_to_rdev(wiphy);
+	struct ieee80211_channel *chan;
+	struct cfg80211_bss *bss;
+	int i;
+
+	chan = ieee80211_get_channel_khz(wiphy, MHZ_TO_KHZ(2412));
+	KUNIT_ASSERT_NOT_NULL(test, chan);
+
+	for (i = 0; i < 8; i++) {
+		bss = t_inform_bss_n(wiphy, chan, i);
+		KUNIT_ASSERT_NOT_NULL(test, bss);
+		cfg80211_put_bss(wiphy, bss);
+	}
+
+	/* age all eight, then refresh the second half and entry 0 */
+	cfg80211_bss_age(rdev, 60);
+	for (i = 4; i < 8; i++) {
+		bss = t_inform_bss_n(wiphy, chan, i);
+		KUNIT_ASSERT_NOT_NULL(test, bss);
+		cfg80211_put_bss(wiphy, bss);
+	}
+	bss = t_inform_bss_n(wiphy, chan, 0);
+	KUNIT_ASSERT_NOT_NULL(test, bss);
+	cfg80211_put_bss(wiphy, bss);
+
+	spin_lock_bh(&rdev->bss_lock);
+	cfg80211_bss_expire(rdev);
+	spin_unlock_bh(&rdev->bss_lock);
+
+	KUNIT_EXPECT_EQ(test, rdev->bss_entries, 5);
+	KUNIT_EXPECT_TRUE(test, t_bss_present(wiphy, 0));
+	for (i = 1; i < 4; i++)
+		KUNIT_EXPECT_FALSE(test, t_bss_present(wiphy, i));
+	for (i = 4; i < 8; i++)
+		KUNIT_EXPECT_TRUE(test, t_bss_present(wiphy, i));
+}
+
 static struct kunit_case gen_new_ie_test_cases[] = {
 	KUNIT_CASE_PARAM(test_gen_new_ie, gen_new_ie_gen_params),
 	KUNIT_CASE(test_gen_new_ie_malformed),
@@ -866,6 +1012,19 @@ static struct kunit_suite inform_bss = {
 
 kunit_test_suite(inform_bss);
 
+static struct kunit_case bss_expiry_test_cases[] = {
+	KUNIT_CASE(test_bss_expire_keeps_newer),
+	KUNIT_CASE_SLOW(test_bss_expire_oldest_at_cap),
+	{}
+};
+
+static struct kunit_suite bss_expiry = {
+	.name = "cfg80211-bss-expiry",
+	.test_cases = bss_expiry_test_cases,
+};
+
+kunit_test_suite(bss_expiry);
+
 static struct kunit_case scan_6ghz_cases[] = {
 	KUNIT_CASE_PARAM(test_cfg80211_parse_colocated_ap,
 			 cfg80211_parse_colocated_ap_gen_params),
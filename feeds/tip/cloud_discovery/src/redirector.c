@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Redirector lookups over a libcurl multi handle driven by the caller's event
+ * loop. The same easy handle is used for every lookup, so its connection and
+ * TLS session are reused as long as the server keeps them open.
+ *
+ * Failed lookups back off exponentially with full jitter: a random delay
+ * between 1 second and backoff * 2^attempts, capped at backoff_max. Devices
+ * that reboot together therefore spread their retries. A successful answer
+ * is cached for cache_ttl seconds.
+ */
+#include <sys/random.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "redirector.h"
+
+static time_t
+redirector_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec;
+}
+
+static size_t
+redirector_write_cb(char *data, size_t size, size_t nmemb, void *priv)
+{
+	struct redirector *r = priv;
+	size_t len = size * nmemb;
+	char *body;
+
+	if (r->len + len > REDIRECTOR_BODY_MAX)
+		return 0;
+
+	body = realloc(r->body, r->len + len + 1);
+	if (!body)
+		return 0;
+
+	memcpy(body + r->len, data, len);
+	r->len += len;
+	body[r->len] = 0;
+	r->body = body;
+
+	return len;
+}
+
+static int
+redirector_socket_cb(CURL *curl, curl_socket_t fd, int what, void *priv,
+		     void *data)
+{
+	struct redirector *r = priv;
+	int events = 0;
+
+	if (what == CURL_POLL_IN || what == CURL_POLL_INOUT)
+		events |= REDIRECTOR_IN;
+	if (what == CURL_POLL_OUT || what == CURL_POLL_INOUT)
+		events |= REDIRECTOR_OUT;
+
+	data = r->ops->watch(r, fd, events, data);
+	if (what != CURL_POLL_REMOVE)
+		curl_multi_assign(r->multi, fd, data);
+
+	return 0;
+}
+
+static int
+redirector_timer_cb(CURLM *multi, long ms, void *priv)
+{
+	struct redirector *r = priv;
+
+	r->ops->timer(r, ms);
+
+	return 0;
+}
+
+unsigned int
+redirector_backoff_delay(struct redirector *r)
+{
+	unsigned int shift = r->attempts < 6 ? r->attempts : 6;
+	unsigned int backoff = r->backoff << shift;
+	unsigned int rnd;
+
+	if (backoff > r->backoff_max)
+		backoff = r->backoff_max;
+
+	/* not seeded from the clock, devices that boot together share it */
+	if (getrandom(&rnd, sizeof(rnd), GRND_NONBLOCK) != sizeof(rnd))
+		rnd = random();
+
+	return rnd % backoff + 1;
+}
+
+static void
+redirector_backoff(struct redirector *r)
+{
+	r->next = redirector_now() + redirector_backoff_delay(r);
+	r->attempts++;
+}
+
+static void
+redirector_done(struct redirector *r, CURLcode res)
+{
+	char *body = r->body;
+	long status = 0;
+
+	r->busy = false;
+	r->body = NULL;
+	r->len = 0;
+
+	curl_easy_getinfo(r->curl, CURLINFO_RESPONSE_CODE, &status);
+	curl_multi_remove_handle(r->multi, r->curl);
+
+	if (res == CURLE_OK && (status < 200 || status > 299))
+		snprintf(r->error, sizeof(r->error), "HTTP status %ld", status);
+	else if (res == CURLE_OK && !body)
+		snprintf(r->error, sizeof(r->error), "empty reply");
+	else if (res != CURLE_OK && !r->error[0])
+		snprintf(r->error, sizeof(r->error), "%s", curl_easy_strerror(res));
+
+	if (res != CURLE_OK || r->error[0]) {
+		free(body);
+		redirector_backoff(r);
+		r->ops->complete(r, NULL, r->error);
+		return;
+	}
+
+	r->attempts = 0;
+	r->next = 0;
+
+	free(r->cache);
+	r->cache = NULL;
+	if (r->cache_ttl) {
+		r->cache = strdup(body);
+		r->cache_expires = redirector_now() + r->cache_ttl;
+	}
+
+	r->ops->complete(r, body, NULL);
+	free(body);
+}
+
+static void
+redirector_check_done(struct redirector *r)
+{
+	CURLMsg *msg;
+	int pending;
+
+	while ((msg = curl_multi_info_read(r->multi, &pending))) {
+		if (msg->msg != CURLMSG_DONE || msg->easy_handle != r->curl)
+			continue;
+
+		/* complete() may start the next lookup */
+		redirector_done(r, msg->data.result);
+		return;
+	}
+}
+
+void
+redirector_socket_event(struct redirector *r, int fd, int events)
+{
+	int flags = 0, running;
+
+	if (events & REDIRECTOR_IN)
+		flags |= CURL_CSELECT_IN;
+	if (events & REDIRECTOR_OUT)
+		flags |= CURL_CSELECT_OUT;
+
+	curl_multi_socket_action(r->multi, fd, flags, &running);
+	redirector_check_done(r);
+}
+
+void
+redirector_timeout(struct redirector *r)
+{
+	int running;
+
+	curl_multi_socket_action(r->multi, CURL_SOCKET_TIMEOUT, 0, &running);
+	redirector_check_done(r);
+}
+
+int
+redirector_init(struct redirector *r, const struct redirector_ops *ops)
+{
+	memset(r, 0, sizeof(*r));
+	r->ops = ops;
+	r->connect_timeout = 10;
+	r->timeout = 30;
+	r->cache_ttl = 60 * 60;
+	r->backoff = 30;
+	r->backoff_max = 30 * 60;
+
+	r->multi = curl_multi_init();
+	r->curl = curl_easy_init();
+	if (!r->multi || !r->curl) {
+		redirector_free(r);
+		return -ENOMEM;
+	}
+
+	curl_multi_setopt(r->multi, CURLMOPT_SOCKETFUNCTION, redirector_socket_cb);
+	curl_multi_setopt(r->multi, CURLMOPT_SOCKETDATA, r);
+	curl_multi_setopt(r->multi, CURLMOPT_TIMERFUNCTION, redirector_timer_cb);
+	curl_multi_setopt(r->multi, CURLMOPT_TIMERDATA, r);
+
+	curl_easy_setopt(r->curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(r->curl, CURLOPT_WRITEFUNCTION, redirector_write_cb);
+	curl_easy_setopt(r->curl, CURLOPT_WRITEDATA, r);
+	curl_easy_setopt(r->curl, CURLOPT_ERRORBUFFER, r->error);
+	curl_easy_setopt(r->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+	/* the redirector is not necessarily signed by the operational CA */
+	curl_easy_setopt(r->curl, CURLOPT_SSL_VERIFYPEER, 0L);
+	curl_easy_setopt(r->curl, CURLOPT_SSL_VERIFYHOST, 0L);
+
+	return 0;
+}
+
+void
+redirector_free(struct redirector *r)
+{
+	if (r->busy)
+		curl_multi_remove_handle(r->multi, r->curl);
+	if (r->curl)
+		curl_easy_cleanup(r->curl);
+	if (r->multi)
+		curl_multi_cleanup(r->multi);
+
+	free(r->cert);
+	free(r->key);
+	free(r->cacert);
+	free(r->cache);
+	free(r->body);
+	memset(r, 0, sizeof(*r));
+}
+
+static int
+redirector_set_file(char **dest, const char *path)
+{
+	char *val = NULL;
+
+	if (path) {
+		val = strdup(path);
+		if (!val)
+			return -ENOMEM;
+	}
+
+	free(*dest);
+	*dest = val;
+
+	return 0;
+}
+
+int
+redirector_set_files(struct redirector *r, const char *cert, const char *key,
+		     const char *cacert)
+{
+	if (redirector_set_file(&r->cert, cert) ||
+	    redirector_set_file(&r->key, key) ||
+	    redirector_set_file(&r->cacert, cacert))
+		return -ENOMEM;
+
+	return 0;
+}
+
+int
+redirector_fetch(struct redirector *r, const char *url)
+{
+	CURLMcode err;
+
+	if (r->busy)
+		return -EBUSY;
+
+	if (redirector_retry_in(r))
+		return -EAGAIN;
+
+	curl_easy_setopt(r->curl, CURLOPT_URL, url);
+	curl_easy_setopt(r->curl, CURLOPT_SSLCERT, r->cert);
+	curl_easy_setopt(r->curl, CURLOPT_SSLKEY, r->key);
+	curl_easy_setopt(r->curl, CURLOPT_CAINFO, r->cacert);
+	curl_easy_setopt(r->curl, CURLOPT_CONNECTTIMEOUT, r->connect_timeout);
+	curl_easy_setopt(r->curl, CURLOPT_TIMEOUT, r->timeout);
+	/* retries and cache refreshes are often further apart than the default 118s */
+	curl_easy_setopt(r->curl, CURLOPT_MAXAGE_CONN, (long)r->backoff_max);
+
+	r->error[0] = 0;
+	r->busy = true;
+
+	err = curl_multi_add_handle(r->multi, r->curl);
+	if (err != CURLM_OK) {
+		r->busy = false;
+		snprintf(r->error, sizeof(r->error), "%s", curl_multi_strerror(err));
+		return -EIO;
+	}
+
+	return 0;
+}
+
+const char *
+redirector_cached(struct redirector *r)
+{
+	if (r->cache && redirector_now() >= r->cache_expires)
+		redirector_invalidate(r);
+
+	return r->cache;
+}
+
+void
+redirector_invalidate(struct redirector *r)
+{
+	free(r->cache);
+	r->cache = NULL;
+}
+
+/* the answer could not be used, treat it like a failed lookup */
+void
+redirector_reject(struct redirector *r)
+{
+	redirector_invalidate(r);
+	redirector_backoff(r);
+}
+
+unsigned int
+redirector_retry_in(struct redirector *r)
+{
+	time_t now = redirector_now();
+
+	return r->next > now ? r->next - now : 0;
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef __REDIRECTOR_H
+#define __REDIRECTOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include <curl/curl.h>
+
+#define REDIRECTOR_BODY_MAX	(64 * 1024)
+
+#define REDIRECTOR_IN		(1 << 0)
+#define REDIRECTOR_OUT		(1 << 1)
+
+struct redirector;
+
+/*
+ * Hooks into the event loop of the caller. watch() is called whenever the
+ * events of interest on a socket change, events is 0 once the socket is no
+ * longer used. It returns the per socket data passed back on the next call
+ * for the same socket. timer() arms the timeout, -1 cancels it.
+ */
+struct redirector_ops {
+	void *(*watch)(struct redirector *r, int fd, int events, void *data);
+	void (*timer)(struct redirector *r, long ms);
+	/* body is NULL if the lookup failed */
+	void (*complete)(struct redirector *r, const char *body, const char *error);
+};
+
+struct redirector {
+	const struct redirector_ops *ops;
+
+	CURLM *multi;
+	/* kept across lookups, along with its connection and TLS session */
+	CURL *curl;
+
+	/* options */
+	char *cert;
+	char *key;
+	char *cacert;
+	long connect_timeout;
+	long timeout;
+	unsigned int cache_ttl;
+	unsigned int backoff;
+	unsigned int backoff_max;
+
+	/* backoff state, times are CLOCK_MONOTONIC seconds */
+	bool busy;
+	unsigned int attempts;
+	time_t next;
+
+	char *cache;
+	time_t cache_expires;
+
+	/* the lookup in flight */
+	char *body;
+	size_t len;
+	char error[CURL_ERROR_SIZE];
+};
+
+int redirector_init(struct redirector *r, const struct redirector_ops *ops);
+void redirector_free(struct redirector *r);
+int redirector_set_files(struct redirector *r, const char *cert, const char *key,
+			 const char *cacert);
+
+int redirector_fetch(struct redirector *r, const char *url);
+const char *redirector_cached(struct redirector *r);
+void redirector_invalidate(struct redirector *r);
+void redirector_reject(struct redirector *r);
+unsigned int redirector_retry_in(struct redirector *r);
+unsigned int redirector_backoff_delay(struct redirector *r);
+
+void redirector_socket_event(struct redirector *r, int fd, int events);
+void redirector_timeout(struct redirector *r);
+
+#endif
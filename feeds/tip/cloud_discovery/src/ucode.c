@@ -0,0 +1,388 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * ucode binding of the redirector lookup, driven by the uloop of the daemon:
+ *
+ *	let lookup = redirector.lookup({ cert, key, cacert, ... });
+ *	lookup.fetch(url, (body, error) => { ... });
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libubox/uloop.h>
+#include <libubox/utils.h>
+
+#include <ucode/module.h>
+
+#include "redirector.h"
+
+#define REGISTRY_KEY	"redirector.callbacks"
+
+struct uc_redirector {
+	struct redirector r;
+	struct uloop_timeout timer;
+	uc_vm_t *vm;
+	/* index of the pending callback in the registry array */
+	size_t slot;
+};
+
+struct uc_redirector_sock {
+	struct uloop_fd fd;
+	struct uc_redirector *u;
+};
+
+static uc_resource_type_t *lookup_type;
+static int last_error;
+
+static uc_value_t *
+uc_redirector_registry(uc_vm_t *vm)
+{
+	uc_value_t *reg = uc_vm_registry_get(vm, REGISTRY_KEY);
+
+	if (!reg) {
+		reg = ucv_array_new(vm);
+		uc_vm_registry_set(vm, REGISTRY_KEY, reg);
+	}
+
+	return reg;
+}
+
+static void
+uc_redirector_fd_cb(struct uloop_fd *fd, unsigned int events)
+{
+	struct uc_redirector_sock *s = container_of(fd, struct uc_redirector_sock, fd);
+	int ev = 0;
+
+	if (events & ULOOP_READ)
+		ev |= REDIRECTOR_IN;
+	if (events & ULOOP_WRITE)
+		ev |= REDIRECTOR_OUT;
+
+	/* may free s */
+	redirector_socket_event(&s->u->r, fd->fd, ev);
+}
+
+static void *
+uc_redirector_watch(struct redirector *r, int fd, int events, void *data)
+{
+	struct uc_redirector *u = container_of(r, struct uc_redirector, r);
+	struct uc_redirector_sock *s = data;
+	unsigned int flags = 0;
+
+	if (!events) {
+		if (s) {
+			uloop_fd_delete(&s->fd);
+			free(s);
+		}
+		return NULL;
+	}
+
+	if (!s) {
+		s = calloc(1, sizeof(*s));
+		if (!s)
+			return NULL;
+		s->u = u;
+		s->fd.fd = fd;
+		s->fd.cb = uc_redirector_fd_cb;
+	}
+
+	if (events & REDIRECTOR_IN)
+		flags |= ULOOP_READ;
+	if (events & REDIRECTOR_OUT)
+		flags |= ULOOP_WRITE;
+	uloop_fd_add(&s->fd, flags);
+
+	return s;
+}
+
+static void
+uc_redirector_timer(struct redirector *r, long ms)
+{
+	struct uc_redirector *u = container_of(r, struct uc_redirector, r);
+
+	if (ms < 0)
+		uloop_timeout_cancel(&u->timer);
+	else
+		uloop_timeout_set(&u->timer, ms);
+}
+
+static void
+uc_redirector_timeout_cb(struct uloop_timeout *t)
+{
+	struct uc_redirector *u = container_of(t, struct uc_redirector, timer);
+
+	redirector_timeout(&u->r);
+}
+
+static void
+uc_redirector_complete(struct redirector *r, const char *body, const char *error)
+{
+	struct uc_redirector *u = container_of(r, struct uc_redirector, r);
+	uc_vm_t *vm = u->vm;
+	uc_value_t *reg = uc_redirector_registry(vm);
+	uc_value_t *cb = ucv_get(ucv_array_get(reg, u->slot));
+
+	ucv_array_set(reg, u->slot, NULL);
+
+	if (!ucv_is_callable(cb)) {
+		ucv_put(cb);
+		return;
+	}
+
+	uc_vm_stack_push(vm, cb);
+	uc_vm_stack_push(vm, body ? ucv_string_new(body) : NULL);
+	uc_vm_stack_push(vm, error ? ucv_string_new(error) : NULL);
+
+	if (uc_vm_call(vm, false, 2) == EXCEPTION_NONE)
+		ucv_put(uc_vm_stack_pop(vm));
+	else
+		uloop_end();
+}
+
+static const struct redirector_ops uc_redirector_ops = {
+	.watch = uc_redirector_watch,
+	.timer = uc_redirector_timer,
+	.complete = uc_redirector_complete,
+};
+
+static void
+uc_redirector_free(void *ptr)
+{
+	struct uc_redirector *u = ptr;
+
+	if (!u)
+		return;
+
+	uloop_timeout_cancel(&u->timer);
+	redirector_free(&u->r);
+	free(u);
+}
+
+static const char *
+uc_redirector_opt_string(uc_value_t *opts, const char *name)
+{
+	uc_value_t *val = ucv_object_get(opts, name, NULL);
+
+	return ucv_type(val) == UC_STRING ? ucv_string_get(val) : NULL;
+}
+
+static bool
+uc_redirector_opt_int(uc_value_t *opts, const char *name, int64_t *val)
+{
+	uc_value_t *v = ucv_object_get(opts, name, NULL);
+
+	if (ucv_type(v) != UC_INTEGER || ucv_int64_get(v) < 0)
+		return false;
+
+	*val = ucv_int64_get(v);
+
+	return true;
+}
+
+/* only the options that are set are changed */
+static int
+uc_redirector_configure(struct redirector *r, uc_value_t *opts)
+{
+	const char *cert, *key, *cacert;
+	int64_t val;
+
+	if (ucv_type(opts) != UC_OBJECT)
+		return EINVAL;
+
+	cert = uc_redirector_opt_string(opts, "cert");
+	key = uc_redirector_opt_string(opts, "key");
+	cacert = uc_redirector_opt_string(opts, "cacert");
+	if ((cert || key || cacert) &&
+	    redirector_set_files(r, cert ? cert : r->cert, key ? key : r->key,
+				 cacert ? cacert : r->cacert))
+		return ENOMEM;
+
+	if (uc_redirector_opt_int(opts, "connect_timeout", &val))
+		r->connect_timeout = val;
+	if (uc_redirector_opt_int(opts, "timeout", &val))
+		r->timeout = val;
+	if (uc_redirector_opt_int(opts, "cache", &val))
+		r->cache_ttl = val;
+	if (uc_redirector_opt_int(opts, "backoff", &val) && val > 0)
+		r->backoff = val;
+	if (uc_redirector_opt_int(opts, "backoff_max", &val) && val > 0)
+		r->backoff_max = val;
+
+	return 0;
+}
+
+static uc_value_t *
+uc_redirector_lookup(uc_vm_t *vm, size_t nargs)
+{
+	uc_value_t *opts = uc_fn_arg(0);
+	uc_value_t *reg = uc_redirector_registry(vm);
+	struct uc_redirector *u;
+	int err;
+
+	u = calloc(1, sizeof(*u));
+	if (!u) {
+		last_error = ENOMEM;
+		return NULL;
+	}
+
+	err = redirector_init(&u->r, &uc_redirector_ops);
+	if (err) {
+		last_error = -err;
+		free(u);
+		return NULL;
+	}
+
+	u->vm = vm;
+	u->timer.cb = uc_redirector_timeout_cb;
+	u->slot = ucv_array_length(reg);
+	ucv_array_push(reg, NULL);
+
+	if (opts) {
+		err = uc_redirector_configure(&u->r, opts);
+		if (err) {
+			last_error = err;
+			uc_redirector_free(u);
+			return NULL;
+		}
+	}
+
+	return ucv_resource_new(lookup_type, u);
+}
+
+static uc_value_t *
+uc_redirector_error(uc_vm_t *vm, size_t nargs)
+{
+	uc_value_t *ret;
+
+	if (!last_error)
+		return NULL;
+
+	ret = ucv_string_new(strerror(last_error));
+	last_error = 0;
+
+	return ret;
+}
+
+static uc_value_t *
+uc_redirector_set(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_redirector *u = uc_fn_thisval("redirector.lookup");
+	int err;
+
+	if (!u)
+		return NULL;
+
+	err = uc_redirector_configure(&u->r, uc_fn_arg(0));
+	if (err) {
+		last_error = err;
+		return ucv_boolean_new(false);
+	}
+
+	return ucv_boolean_new(true);
+}
+
+static uc_value_t *
+uc_redirector_fetch(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_redirector *u = uc_fn_thisval("redirector.lookup");
+	uc_value_t *url = uc_fn_arg(0);
+	uc_value_t *cb = uc_fn_arg(1);
+	int err;
+
+	if (!u)
+		return NULL;
+
+	if (ucv_type(url) != UC_STRING || !ucv_is_callable(cb)) {
+		last_error = EINVAL;
+		return NULL;
+	}
+
+	err = redirector_fetch(&u->r, ucv_string_get(url));
+	if (err) {
+		last_error = -err;
+		return ucv_boolean_new(false);
+	}
+
+	ucv_array_set(uc_redirector_registry(vm), u->slot, ucv_get(cb));
+
+	return ucv_boolean_new(true);
+}
+
+static uc_value_t *
+uc_redirector_cached(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_redirector *u = uc_fn_thisval("redirector.lookup");
+	const char *cache;
+
+	if (!u)
+		return NULL;
+
+	cache = redirector_cached(&u->r);
+
+	return cache ? ucv_string_new(cache) : NULL;
+}
+
+static uc_value_t *
+uc_redirector_invalidate(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_redirector *u = uc_fn_thisval("redirector.lookup");
+
+	if (!u)
+		return NULL;
+
+	redirector_invalidate(&u->r);
+
+	return ucv_boolean_new(true);
+}
+
+static uc_value_t *
+uc_redirector_reject(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_redirector *u = uc_fn_thisval("redirector.lookup");
+
+	if (!u)
+		return NULL;
+
+	redirector_reject(&u->r);
+
+	return ucv_uint64_new(redirector_retry_in(&u->r));
+}
+
+static uc_value_t *
+uc_redirector_status(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_redirector *u = uc_fn_thisval("redirector.lookup");
+	uc_value_t *ret;
+
+	if (!u)
+		return NULL;
+
+	ret = ucv_object_new(vm);
+	ucv_object_add(ret, "busy", ucv_boolean_new(u->r.busy));
+	ucv_object_add(ret, "attempts", ucv_uint64_new(u->r.attempts));
+	ucv_object_add(ret, "retry_in", ucv_uint64_new(redirector_retry_in(&u->r)));
+	ucv_object_add(ret, "cached", ucv_boolean_new(!!redirector_cached(&u->r)));
+
+	return ret;
+}
+
+static const uc_function_list_t lookup_fns[] = {
+	{ "set",		uc_redirector_set },
+	{ "fetch",		uc_redirector_fetch },
+	{ "cached",		uc_redirector_cached },
+	{ "invalidate",		uc_redirector_invalidate },
+	{ "reject",		uc_redirector_reject },
+	{ "status",		uc_redirector_status },
+};
+
+static const uc_function_list_t global_fns[] = {
+	{ "lookup",	uc_redirector_lookup },
+	{ "error",	uc_redirector_error },
+};
+
+void uc_module_init(uc_vm_t *vm, uc_value_t *scope)
+{
+	curl_global_init(CURL_GLOBAL_DEFAULT);
+	lookup_type = uc_type_declare(vm, "redirector.lookup", lookup_fns, uc_redirector_free);
+	uc_function_list_register(scope, global_fns);
+}
@@ -0,0 +1,628 @@
+// Runs redirector lookups against a stub HTTPS redirector on 127.0.0.1 that
+// requires a client certificate, with a poll() loop standing in for uloop.
+// Checks that lookups share one connection, the cache, the backoff after
+// failures and the distribution of the backoff delays.
+//
+// The certificates are made with the openssl command in a scratch directory.
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include "../src/redirector.c"
+
+#define SERIAL		"e0e1e2e3e4e5"
+#define ENDPOINT_BODY	"{\"controller_endpoint\":\"gw.example.com:15002\"}"
+#define REUSE_LOOKUPS	20
+#define DRAWS		20000
+
+enum stub_mode {
+	STUB_OK,
+	STUB_EMPTY,
+	STUB_ERROR,
+	STUB_SILENT,
+};
+
+static struct {
+	SSL_CTX *ctx;
+	int fd;
+	int port;
+	pthread_t thread;
+
+	volatile int mode;
+	volatile int stop;
+
+	pthread_mutex_t lock;
+	int connections;
+	int handshakes;
+	int requests;
+	char client_cn[64];
+	char path[128];
+} stub = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static struct {
+	int done;
+	int failed;
+	char body[256];
+	char error[CURL_ERROR_SIZE];
+} result;
+
+/* the sockets curl asked to watch, standing in for uloop_fd */
+struct watch {
+	int fd;
+	int events;
+};
+
+static struct watch watches[8];
+static struct timespec deadline;
+static bool timer_armed;
+static int failures;
+
+static void check(int cond, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("%s: ", cond ? "ok" : "FAIL");
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf("\n");
+
+	if (!cond)
+		failures++;
+}
+
+static int run(const char *fmt, ...)
+{
+	char cmd[1024];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(cmd, sizeof(cmd), fmt, ap);
+	va_end(ap);
+
+	return system(cmd);
+}
+
+static long elapsed_ms(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) * 1000 +
+	       (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static int make_certs(const char *dir)
+{
+	static const char *key = "-newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes";
+
+	return run("(cd %s && "
+		   "openssl req -x509 %s -keyout ca.key -out ca.pem -subj /CN=test-ca -days 1 && "
+		   "openssl req %s -keyout server.key -out server.csr -subj /CN=127.0.0.1 && "
+		   "openssl x509 -req -in server.csr -CA ca.pem -CAkey ca.key -CAcreateserial "
+		   "-out server.pem -days 1 && "
+		   "openssl req %s -keyout client.key -out client.csr -subj /CN=device && "
+		   "openssl x509 -req -in client.csr -CA ca.pem -CAkey ca.key -CAcreateserial "
+		   "-out client.pem -days 1) >/dev/null 2>&1", dir, key, key, key);
+}
+
+static void stub_count(int *counter)
+{
+	pthread_mutex_lock(&stub.lock);
+	(*counter)++;
+	pthread_mutex_unlock(&stub.lock);
+}
+
+static int stub_read_request(SSL *ssl, char *buf, size_t size)
+{
+	size_t len = 0;
+	int n;
+
+	while (len < size - 1) {
+		n = SSL_read(ssl, buf + len, size - 1 - len);
+		if (n <= 0)
+			return -1;
+
+		len += n;
+		buf[len] = 0;
+		if (strstr(buf, "\r\n\r\n"))
+			return 0;
+	}
+
+	return -1;
+}
+
+static void stub_reply(SSL *ssl, int status, const char *body)
+{
+	char buf[512];
+	int len;
+
+	len = snprintf(buf, sizeof(buf),
+		       "HTTP/1.1 %d %s\r\n"
+		       "Content-Type: application/json\r\n"
+		       "Content-Length: %zu\r\n"
+		       "\r\n%s",
+		       status, status == 200 ? "OK" : "Internal Server Error",
+		       strlen(body), body);
+	SSL_write(ssl, buf, len);
+}
+
+static void *stub_conn(void *arg)
+{
+	struct timeval tv = { .tv_sec = 10 };
+	int fd = (intptr_t)arg;
+	char buf[1024], path[128];
+	X509 *peer;
+	SSL *ssl;
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	ssl = SSL_new(stub.ctx);
+	SSL_set_fd(ssl, fd);
+	if (SSL_accept(ssl) <= 0)
+		goto out;
+
+	stub_count(&stub.handshakes);
+
+	peer = SSL_get1_peer_certificate(ssl);
+	if (peer) {
+		pthread_mutex_lock(&stub.lock);
+		X509_NAME_get_text_by_NID(X509_get_subject_name(peer), NID_commonName,
+					  stub.client_cn, sizeof(stub.client_cn));
+		pthread_mutex_unlock(&stub.lock);
+		X509_free(peer);
+	}
+
+	/* serve requests until the client closes the connection */
+	while (!stub.stop && !stub_read_request(ssl, buf, sizeof(buf))) {
+		if (sscanf(buf, "GET %127s HTTP/1.1", path) != 1)
+			break;
+
+		pthread_mutex_lock(&stub.lock);
+		stub.requests++;
+		strcpy(stub.path, path);
+		pthread_mutex_unlock(&stub.lock);
+
+		switch (stub.mode) {
+		case STUB_OK:
+			stub_reply(ssl, 200, ENDPOINT_BODY);
+			break;
+		case STUB_EMPTY:
+			stub_reply(ssl, 200, "{}");
+			break;
+		case STUB_ERROR:
+			stub_reply(ssl, 500, "{}");
+			break;
+		case STUB_SILENT:
+			break;
+		}
+	}
+
+out:
+	SSL_free(ssl);
+	close(fd);
+
+	return NULL;
+}
+
+static void *stub_serve(void *arg)
+{
+	struct pollfd pfd = { .fd = stub.fd, .events = POLLIN };
+	pthread_t thread;
+	int fd;
+
+	while (!stub.stop) {
+		if (poll(&pfd, 1, 50) <= 0)
+			continue;
+
+		fd = accept(stub.fd, NULL, NULL);
+		if (fd < 0)
+			continue;
+
+		stub_count(&stub.connections);
+		if (pthread_create(&thread, NULL, stub_conn, (void *)(intptr_t)fd)) {
+			close(fd);
+			continue;
+		}
+		pthread_detach(thread);
+	}
+
+	return NULL;
+}
+
+static int stub_start(const char *dir)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t len = sizeof(addr);
+	char path[256];
+
+	stub.ctx = SSL_CTX_new(TLS_server_method());
+	if (!stub.ctx)
+		return -1;
+
+	snprintf(path, sizeof(path), "%s/server.pem", dir);
+	if (SSL_CTX_use_certificate_file(stub.ctx, path, SSL_FILETYPE_PEM) != 1)
+		return -1;
+
+	snprintf(path, sizeof(path), "%s/server.key", dir);
+	if (SSL_CTX_use_PrivateKey_file(stub.ctx, path, SSL_FILETYPE_PEM) != 1)
+		return -1;
+
+	/* like the redirector, only devices with a certificate get an answer */
+	snprintf(path, sizeof(path), "%s/ca.pem", dir);
+	if (SSL_CTX_load_verify_locations(stub.ctx, path, NULL) != 1)
+		return -1;
+	SSL_CTX_set_verify(stub.ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+
+	stub.fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (stub.fd < 0 || bind(stub.fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(stub.fd, 8) || getsockname(stub.fd, (struct sockaddr *)&addr, &len))
+		return -1;
+
+	stub.port = ntohs(addr.sin_port);
+
+	return pthread_create(&stub.thread, NULL, stub_serve, NULL);
+}
+
+static void *test_watch(struct redirector *r, int fd, int events, void *data)
+{
+	struct watch *w = data;
+	int i;
+
+	if (!events) {
+		if (w)
+			w->fd = -1;
+		return NULL;
+	}
+
+	for (i = 0; !w && i < (int)(sizeof(watches) / sizeof(watches[0])); i++)
+		if (watches[i].fd < 0)
+			w = &watches[i];
+
+	if (w) {
+		w->fd = fd;
+		w->events = events;
+	}
+
+	return w;
+}
+
+static void test_timer(struct redirector *r, long ms)
+{
+	timer_armed = ms >= 0;
+	if (!timer_armed)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += ms / 1000;
+	deadline.tv_nsec += (ms % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+}
+
+static void test_complete(struct redirector *r, const char *body, const char *error)
+{
+	result.done = 1;
+	result.failed = !body;
+	snprintf(result.body, sizeof(result.body), "%s", body ? body : "");
+	snprintf(result.error, sizeof(result.error), "%s", error ? error : "");
+}
+
+static const struct redirector_ops test_ops = {
+	.watch = test_watch,
+	.timer = test_timer,
+	.complete = test_complete,
+};
+
+/* what uloop does while a lookup is in flight */
+static void run_loop(struct redirector *r)
+{
+	struct pollfd pfds[sizeof(watches) / sizeof(watches[0])];
+	struct timespec start;
+	int i, n, timeout;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (!result.done && elapsed_ms(&start) < 10000) {
+		timeout = 100;
+		if (timer_armed) {
+			timeout = -elapsed_ms(&deadline);
+			if (timeout < 0)
+				timeout = 0;
+			if (timeout > 100)
+				timeout = 100;
+		}
+
+		for (i = n = 0; i < (int)(sizeof(watches) / sizeof(watches[0])); i++) {
+			if (watches[i].fd < 0)
+				continue;
+
+			pfds[n].fd = watches[i].fd;
+			pfds[n].events = (watches[i].events & REDIRECTOR_IN ? POLLIN : 0) |
+					 (watches[i].events & REDIRECTOR_OUT ? POLLOUT : 0);
+			pfds[n].revents = 0;
+			n++;
+		}
+
+		poll(pfds, n, timeout);
+
+		for (i = 0; i < n; i++) {
+			int events = 0;
+
+			if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR))
+				events |= REDIRECTOR_IN;
+			if (pfds[i].revents & POLLOUT)
+				events |= REDIRECTOR_OUT;
+			if (events)
+				redirector_socket_event(r, pfds[i].fd, events);
+		}
+
+		if (timer_armed && elapsed_ms(&deadline) >= 0) {
+			timer_armed = false;
+			redirector_timeout(r);
+		}
+	}
+}
+
+static int lookup(struct redirector *r, const char *url)
+{
+	int err;
+
+	memset(&result, 0, sizeof(result));
+	err = redirector_fetch(r, url);
+	if (err)
+		return err;
+
+	run_loop(r);
+
+	return result.done ? 0 : -ETIMEDOUT;
+}
+
+static int stub_get(int *counter)
+{
+	int val;
+
+	pthread_mutex_lock(&stub.lock);
+	val = *counter;
+	pthread_mutex_unlock(&stub.lock);
+
+	return val;
+}
+
+static unsigned int backoff_cap(struct redirector *r, unsigned int attempts)
+{
+	unsigned int cap = r->backoff << (attempts < 6 ? attempts : 6);
+
+	return cap < r->backoff_max ? cap : r->backoff_max;
+}
+
+static void test_lookup(struct redirector *r, const char *url)
+{
+	const char *cached;
+	int i, ok = 0;
+
+	check(!lookup(r, url) && !result.failed && !strcmp(result.body, ENDPOINT_BODY),
+	      "lookup returns the answer (%s)", result.failed ? result.error : result.body);
+	check(!strcmp(stub.path, "/v1/devices/" SERIAL) && !strcmp(stub.client_cn, "device"),
+	      "request for %s with the client certificate of %s", stub.path, stub.client_cn);
+
+	cached = redirector_cached(r);
+	check(cached && !strcmp(cached, ENDPOINT_BODY) && !redirector_retry_in(r),
+	      "answer cached");
+
+	r->cache_expires = redirector_now() - 1;
+	check(!redirector_cached(r), "cache expires after cache_ttl");
+
+	check(!lookup(r, url) && redirector_cached(r), "lookup after expiry cached again");
+	redirector_invalidate(r);
+	check(!redirector_cached(r), "cache dropped on invalidate");
+
+	r->cache_ttl = 0;
+	check(!lookup(r, url) && !result.failed && !redirector_cached(r),
+	      "nothing cached without a cache_ttl");
+	r->cache_ttl = 60 * 60;
+
+	for (i = 0; i < REUSE_LOOKUPS; i++)
+		ok += !lookup(r, url) && !result.failed;
+
+	check(ok == REUSE_LOOKUPS && stub_get(&stub.requests) == REUSE_LOOKUPS + 3,
+	      "%d more lookups answered, %d requests", ok, stub_get(&stub.requests));
+	check(stub_get(&stub.connections) == 1 && stub_get(&stub.handshakes) == 1,
+	      "all lookups on one connection (%d connections, %d handshakes)",
+	      stub_get(&stub.connections), stub_get(&stub.handshakes));
+
+	check(!redirector_fetch(r, url) && redirector_fetch(r, url) == -EBUSY,
+	      "no second lookup while one is in flight");
+	memset(&result, 0, sizeof(result));
+	run_loop(r);
+}
+
+static void test_backoff(struct redirector *r, const char *url)
+{
+	int requests, i, ok = 1;
+	unsigned int retry;
+
+	stub.mode = STUB_ERROR;
+	check(!lookup(r, url) && result.failed && !strcmp(result.error, "HTTP status 500"),
+	      "server error reported (%s)", result.error);
+
+	retry = redirector_retry_in(r);
+	check(r->attempts == 1 && retry <= r->backoff, "first retry within %us (in %us)",
+	      r->backoff, retry);
+
+	requests = stub_get(&stub.requests);
+	check(redirector_fetch(r, url) == -EAGAIN && stub_get(&stub.requests) == requests,
+	      "no lookup while backing off");
+
+	for (i = 1; i < 10; i++) {
+		r->next = 0;
+		lookup(r, url);
+
+		retry = redirector_retry_in(r);
+		if (!result.failed || retry > backoff_cap(r, i) || r->attempts != i + 1)
+			ok = 0;
+	}
+	check(ok, "retries back off up to %us", r->backoff_max);
+	check(stub_get(&stub.connections) == 1, "errors keep the connection");
+
+	stub.mode = STUB_OK;
+	r->next = 0;
+	check(!lookup(r, url) && !result.failed && !r->attempts && !redirector_retry_in(r),
+	      "backoff reset after a successful lookup");
+
+	/* an answer the daemon cannot use */
+	stub.mode = STUB_EMPTY;
+	redirector_invalidate(r);
+	lookup(r, url);
+	redirector_reject(r);
+	retry = redirector_retry_in(r);
+	check(!result.failed && !redirector_cached(r) && r->attempts == 1 && retry <= r->backoff,
+	      "rejected answer dropped from the cache and backed off (%us)", retry);
+	stub.mode = STUB_OK;
+}
+
+/* full jitter: uniform between 1 and the cap of the attempt */
+static void test_distribution(struct redirector *r)
+{
+	unsigned int attempts;
+
+	for (attempts = 0; attempts <= 8; attempts++) {
+		unsigned int cap = backoff_cap(r, attempts), min = -1, max = 0, d;
+		int buckets[10] = {}, i, uniform = 1;
+		double mean = 0, expect = (cap + 1) / 2.0;
+
+		r->attempts = attempts;
+		for (i = 0; i < DRAWS; i++) {
+			d = redirector_backoff_delay(r);
+			if (d < min)
+				min = d;
+			if (d > max)
+				max = d;
+			mean += d;
+			buckets[(d - 1) * 10 / cap]++;
+		}
+		mean /= DRAWS;
+
+		for (i = 0; i < 10; i++)
+			if (buckets[i] < DRAWS / 10 * 0.9 || buckets[i] > DRAWS / 10 * 1.1)
+				uniform = 0;
+
+		check(min >= 1 && max <= cap && max > cap * 0.95 && mean > expect * 0.97 &&
+		      mean < expect * 1.03 && uniform && r->attempts == attempts,
+		      "attempt %u: delays %u-%us, mean %.1fs, cap %us", attempts, min, max,
+		      mean, cap);
+	}
+
+	r->attempts = 0;
+}
+
+static void test_failures(struct redirector *r, const char *url, const char *dir)
+{
+	struct sockaddr_in addr = { .sin_family = AF_INET };
+	socklen_t len = sizeof(addr);
+	struct timespec start;
+	char path[256], closed[128];
+	int handshakes, fd;
+	long ms;
+
+	/* the server accepts the request and never answers */
+	stub.mode = STUB_SILENT;
+	r->timeout = 1;
+	r->next = 0;
+	redirector_invalidate(r);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	lookup(r, url);
+	ms = elapsed_ms(&start);
+	check(result.failed && r->attempts == 1 && ms >= 900 && ms < 2500,
+	      "lookup times out after %ld ms (%s)", ms, result.error);
+	stub.mode = STUB_OK;
+	r->timeout = 2;
+
+	/* the handshake fails without a client certificate */
+	handshakes = stub_get(&stub.handshakes);
+	snprintf(path, sizeof(path), "%s/ca.pem", dir);
+	redirector_set_files(r, NULL, NULL, path);
+	r->next = 0;
+	lookup(r, url);
+	check(result.failed && stub_get(&stub.handshakes) == handshakes,
+	      "no answer without a client certificate (%s)", result.error);
+
+	/* nothing listens on the port of a closed socket */
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+	getsockname(fd, (struct sockaddr *)&addr, &len);
+	close(fd);
+	snprintf(closed, sizeof(closed), "https://127.0.0.1:%d/v1/devices/" SERIAL,
+		 ntohs(addr.sin_port));
+
+	r->next = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	lookup(r, closed);
+	check(result.failed && r->attempts == 3 && elapsed_ms(&start) < 1000,
+	      "connection refused reported (%s)", result.error);
+}
+
+int main(void)
+{
+	char dir[] = "/tmp/redirector-test-XXXXXX";
+	char url[128], cert[256], key[256], ca[256];
+	struct redirector r;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(watches) / sizeof(watches[0]); i++)
+		watches[i].fd = -1;
+
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		return 1;
+	}
+
+	if (make_certs(dir) || stub_start(dir)) {
+		fprintf(stderr, "Failed to set up the stub redirector\n");
+		run("rm -rf %s", dir);
+		return 1;
+	}
+
+	curl_global_init(CURL_GLOBAL_DEFAULT);
+
+	snprintf(url, sizeof(url), "https://127.0.0.1:%d/v1/devices/" SERIAL, stub.port);
+	snprintf(cert, sizeof(cert), "%s/client.pem", dir);
+	snprintf(key, sizeof(key), "%s/client.key", dir);
+	snprintf(ca, sizeof(ca), "%s/ca.pem", dir);
+
+	if (redirector_init(&r, &test_ops) || redirector_set_files(&r, cert, key, ca)) {
+		fprintf(stderr, "Failed to set up the lookup\n");
+		return 1;
+	}
+	r.connect_timeout = 2;
+	r.timeout = 2;
+
+	test_lookup(&r, url);
+	test_backoff(&r, url);
+	test_distribution(&r);
+	test_failures(&r, url, dir);
+
+	redirector_free(&r);
+	stub.stop = 1;
+	pthread_join(stub.thread, NULL);
+	run("rm -rf %s", dir);
+
+	return failures ? 1 : 0;
+}
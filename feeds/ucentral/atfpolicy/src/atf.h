@@ -15,6 +15,9 @@
 #define ATF_AVG_WEIGHT_FACTOR	3
 #define ATF_AVG_WEIGHT_DIV	4
 
+#define ATF_POLL_INTERVAL_MIN	1000
+#define ATF_POLL_INTERVAL_MAX	8000
+
 #define MAC_ADDR_FMT "%02x:%02x:%02x:%02x:%02x:%02x"
 #define MAC_ADDR_DATA(_a) \
 	((const uint8_t *)(_a))[0], \
@@ -39,15 +42,37 @@ struct atf_config {
 	int weight_normal;
 	int weight_prio;
 	int weight_bulk;
+
+	int weight_hysteresis;
 };
 
+struct nl_msg;
+
 struct atf_interface {
 	struct avl_node avl;
 
 	char ifname[IFNAMSIZ + 1];
 	uint32_t ubus_obj;
 
+	int ifindex;
+	struct nl_msg *sta_msg;
+	bool active;
+
 	struct avl_tree stations;
+
+	bool weight_pending;
+	bool weight_legacy;
+
+	uint64_t weight_applied;
+	uint64_t weight_suppressed;
+	uint64_t weight_calls;
+};
+
+enum atf_class {
+	ATF_CLASS_NONE,
+	ATF_CLASS_NORMAL,
+	ATF_CLASS_BULK,
+	ATF_CLASS_PRIO,
 };
 
 struct atf_stats {
@@ -62,13 +87,19 @@ struct atf_station {
 	uint8_t stats_idx;
 	struct atf_stats stats[2];
 
+	uint32_t tx_packets;
+	uint32_t rx_packets;
+
 	uint16_t avg_bulk;
 	uint16_t avg_prio;
 
+	enum atf_class class;
 	int weight;
+	bool weight_pending;
 };
 
 extern struct atf_config config;
+extern struct avl_tree interfaces;
 extern int debug_flag;
 
 void reset_config(void);
@@ -77,12 +108,13 @@ struct atf_interface *atf_interface_get(const char *ifname);
 void atf_interface_sta_update(struct atf_interface *iface);
 struct atf_station *atf_interface_sta_get(struct atf_interface *iface, uint8_t *macaddr);
 void atf_interface_sta_changed(struct atf_interface *iface, struct atf_station *sta);
+void atf_interface_sta_commit(struct atf_interface *iface);
 void atf_interface_sta_flush(struct atf_interface *iface);
-void atf_interface_update_all(void);
+bool atf_interface_update_all(void);
 
 int atf_ubus_init(void);
 void atf_ubus_stop(void);
-void atf_ubus_set_sta_weight(struct atf_interface *iface, struct atf_station *sta);
+bool atf_ubus_set_sta_weights(struct atf_interface *iface);
 
 int atf_nl80211_init(void);
 int atf_nl80211_interface_update(struct atf_interface *iface);
@@ -9,13 +9,30 @@
 
 #include "atf.h"
 
-static AVL_TREE(interfaces, avl_strcmp, false, NULL);
+AVL_TREE(interfaces, avl_strcmp, false, NULL);
 
 #ifndef container_of_safe
 #define container_of_safe(ptr, type, member) \
 	(ptr ? container_of(ptr, type, member) : NULL)
 #endif
 
+void reset_config(void)
+{
+	memset(&config, 0, sizeof(config));
+
+	config.voice_queue_weight = 4;
+	config.min_pkt_thresh = 100;
+
+	config.bulk_percent_thresh = (50 << ATF_AVG_SCALE) / 100;
+	config.prio_percent_thresh = (30 << ATF_AVG_SCALE) / 100;
+
+	config.weight_normal = 256;
+	config.weight_bulk = 128;
+	config.weight_prio = 512;
+
+	config.weight_hysteresis = (5 << ATF_AVG_SCALE) / 100;
+}
+
 static int avl_macaddr_cmp(const void *k1, const void *k2, void *ptr)
 {
 	return memcmp(k1, k2, 6);
@@ -61,22 +78,79 @@ void atf_interface_sta_flush(struct atf_interface *iface)
 	}
 }
 
+static enum atf_class
+atf_sta_class(struct atf_station *sta, int prio_offset, int bulk_offset)
+{
+	if (sta->avg_prio > config.prio_percent_thresh + prio_offset)
+		return ATF_CLASS_PRIO;
+	else if (sta->avg_prio > config.bulk_percent_thresh + bulk_offset)
+		return ATF_CLASS_BULK;
+	else
+		return ATF_CLASS_NORMAL;
+}
+
+/*
+ * A station that already has a class only leaves it once its average is
+ * more than the hysteresis band past one of the edges of that class. The
+ * edges of the other classes are not widened, so a class narrower than
+ * twice the band can still be entered and left.
+ */
+static enum atf_class
+atf_sta_class_hyst(struct atf_station *sta)
+{
+	int hyst = config.weight_hysteresis;
+
+	switch (sta->class) {
+	case ATF_CLASS_PRIO:
+		return atf_sta_class(sta, -hyst, 0);
+	case ATF_CLASS_BULK:
+		return atf_sta_class(sta, hyst, -hyst);
+	case ATF_CLASS_NORMAL:
+		return atf_sta_class(sta, hyst, hyst);
+	default:
+		return atf_sta_class(sta, 0, 0);
+	}
+}
+
+static int atf_class_weight(enum atf_class class)
+{
+	switch (class) {
+	case ATF_CLASS_PRIO:
+		return config.weight_prio;
+	case ATF_CLASS_BULK:
+		return config.weight_bulk;
+	default:
+		return config.weight_normal;
+	}
+}
+
 void atf_interface_sta_changed(struct atf_interface *iface, struct atf_station *sta)
 {
+	enum atf_class class;
 	int weight;
 
-	if (sta->avg_prio > config.prio_percent_thresh)
-		weight = config.weight_prio;
-	else if (sta->avg_prio > config.bulk_percent_thresh)
-		weight = config.weight_bulk;
-	else
-		weight = config.weight_normal;
+	class = atf_sta_class_hyst(sta);
+	if (class != atf_sta_class(sta, 0, 0))
+		iface->weight_suppressed++;
+
+	sta->class = class;
 
+	/* also picks up weights changed by a config update */
+	weight = atf_class_weight(class);
 	if (sta->weight == weight)
 		return;
 
 	sta->weight = weight;
-	atf_ubus_set_sta_weight(iface, sta);
+	sta->weight_pending = true;
+	iface->weight_pending = true;
+}
+
+void atf_interface_sta_commit(struct atf_interface *iface)
+{
+	if (!iface->weight_pending)
+		return;
+
+	iface->weight_pending = !atf_ubus_set_sta_weights(iface);
 }
 
 struct atf_interface *atf_interface_get(const char *ifname)
@@ -99,10 +173,15 @@ struct atf_interface *atf_interface_get(const char *ifname)
 	return iface;
 }
 
-void atf_interface_update_all(void)
+bool atf_interface_update_all(void)
 {
 	struct atf_interface *iface, *tmp;
+	bool active = false;
 
-	avl_for_each_element_safe(&interfaces, iface, avl, tmp)
+	avl_for_each_element_safe(&interfaces, iface, avl, tmp) {
 		atf_nl80211_interface_update(iface);
+		active |= iface->active;
+	}
+
+	return active;
 }
@@ -13,25 +13,17 @@
 struct atf_config config;
 int debug_flag;
 
-void reset_config(void)
+static void atf_update_cb(struct uloop_timeout *t)
 {
-	memset(&config, 0, sizeof(config));
-
-	config.voice_queue_weight = 4;
-	config.min_pkt_thresh = 100;
-
-	config.bulk_percent_thresh = (50 << ATF_AVG_SCALE) / 100;
-	config.prio_percent_thresh = (30 << ATF_AVG_SCALE) / 100;
+	static int interval = ATF_POLL_INTERVAL_MIN;
 
-	config.weight_normal = 256;
-	config.weight_bulk = 128;
-	config.weight_prio = 512;
-}
+	/* back off while no station is passing traffic */
+	if (atf_interface_update_all())
+		interval = ATF_POLL_INTERVAL_MIN;
+	else if (interval < ATF_POLL_INTERVAL_MAX)
+		interval *= 2;
 
-static void atf_update_cb(struct uloop_timeout *t)
-{
-	atf_interface_update_all();
-	uloop_timeout_set(t, 1000);
+	uloop_timeout_set(t, interval);
 }
 
 int main(int argc, char **argv)
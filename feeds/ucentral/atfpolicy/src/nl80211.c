@@ -132,6 +132,20 @@ atf_sta_cb(struct nl_msg *msg, void *arg)
 	if (!sta)
 		return NL_SKIP;
 
+	if (sinfo[NL80211_STA_INFO_TX_PACKETS] && sinfo[NL80211_STA_INFO_RX_PACKETS]) {
+		uint32_t tx = nla_get_u32(sinfo[NL80211_STA_INFO_TX_PACKETS]);
+		uint32_t rx = nla_get_u32(sinfo[NL80211_STA_INFO_RX_PACKETS]);
+
+		/* idle station, the TID counters have not moved either */
+		if (tx == sta->tx_packets && rx == sta->rx_packets)
+			return NL_SKIP;
+
+		sta->tx_packets = tx;
+		sta->rx_packets = rx;
+	}
+
+	iface->active = true;
+
 	stats = &sta->stats[sta->stats_idx];
 	memset(stats, 0, sizeof(*stats));
 	nla_for_each_nested(cur, sinfo[NL80211_STA_INFO_TID_STATS], rem)
@@ -144,28 +158,63 @@ atf_sta_cb(struct nl_msg *msg, void *arg)
 	return NL_SKIP;
 }
 
+static struct nl_msg *
+atf_nl80211_sta_msg(struct atf_interface *iface, int ifindex)
+{
+	struct nl_msg *msg = iface->sta_msg;
+
+	if (msg && iface->ifindex == ifindex)
+		goto out;
+
+	if (msg)
+		nlmsg_free(msg);
+
+	iface->sta_msg = NULL;
+	msg = unl_genl_msg(&unl, NL80211_CMD_GET_STATION, true);
+	if (!msg)
+		return NULL;
+
+	NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, ifindex);
+	iface->sta_msg = msg;
+	iface->ifindex = ifindex;
+
+out:
+	/*
+	 * The dump request is kept across polls, unl_genl_request drops one
+	 * reference and the sequence number needs to be assigned again.
+	 */
+	nlmsg_get(msg);
+	nlmsg_hdr(msg)->nlmsg_seq = NL_AUTO_SEQ;
+
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
 int atf_nl80211_interface_update(struct atf_interface *iface)
 {
 	struct nl_msg *msg;
 	int ifindex;
 
+	iface->active = false;
+
 	ifindex = if_nametoindex(iface->ifname);
 	if (!ifindex)
 		return -1;
 
-	atf_interface_sta_update(iface);
+	msg = atf_nl80211_sta_msg(iface, ifindex);
+	if (!msg)
+		return -1;
 
-	msg = unl_genl_msg(&unl, NL80211_CMD_GET_STATION, true);
-	NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, ifindex);
+	atf_interface_sta_update(iface);
 	unl_genl_request(&unl, msg, atf_sta_cb, iface);
 
 	atf_interface_sta_flush(iface);
+	atf_interface_sta_commit(iface);
 
 	return 0;
-
-nla_put_failure:
-	nlmsg_free(msg);
-	return -1;
 }
 
 int atf_nl80211_init(void)
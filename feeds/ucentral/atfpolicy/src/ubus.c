@@ -21,6 +21,7 @@ enum {
 	ATF_CONFIG_WEIGHT_NORMAL,
 	ATF_CONFIG_WEIGHT_PRIO,
 	ATF_CONFIG_WEIGHT_BULK,
+	ATF_CONFIG_WEIGHT_HYSTERESIS,
 	__ATF_CONFIG_MAX
 };
 
@@ -32,6 +33,7 @@ static const struct blobmsg_policy atf_config_policy[__ATF_CONFIG_MAX] = {
 	[ATF_CONFIG_WEIGHT_NORMAL] = { "weight_normal", BLOBMSG_TYPE_INT32 },
 	[ATF_CONFIG_WEIGHT_PRIO] = { "weight_prio", BLOBMSG_TYPE_INT32 },
 	[ATF_CONFIG_WEIGHT_BULK] = { "weight_bulk", BLOBMSG_TYPE_INT32 },
+	[ATF_CONFIG_WEIGHT_HYSTERESIS] = { "weight_hysteresis", BLOBMSG_TYPE_INT32 },
 };
 
 static int
@@ -44,14 +46,16 @@ atf_ubus_config(struct ubus_context *ctx, struct ubus_object *obj,
 	static const struct {
 		int id;
 		int *field;
+		bool percent;
 	} field_map[] = {
 		{ ATF_CONFIG_VO_Q_WEIGHT, &config.voice_queue_weight },
 		{ ATF_CONFIG_MIN_PKT_THRESH, &config.min_pkt_thresh },
-		{ ATF_CONFIG_BULK_PERCENT_THR, &config.bulk_percent_thresh },
-		{ ATF_CONFIG_PRIO_PERCENT_THR, &config.prio_percent_thresh },
+		{ ATF_CONFIG_BULK_PERCENT_THR, &config.bulk_percent_thresh, true },
+		{ ATF_CONFIG_PRIO_PERCENT_THR, &config.prio_percent_thresh, true },
 		{ ATF_CONFIG_WEIGHT_NORMAL, &config.weight_normal },
 		{ ATF_CONFIG_WEIGHT_PRIO, &config.weight_prio },
 		{ ATF_CONFIG_WEIGHT_BULK, &config.weight_bulk },
+		{ ATF_CONFIG_WEIGHT_HYSTERESIS, &config.weight_hysteresis, true },
 	};
 	bool reset = false;
 	int i;
@@ -66,16 +70,50 @@ atf_ubus_config(struct ubus_context *ctx, struct ubus_object *obj,
 		reset_config();
 
 	for (i = 0; i < ARRAY_SIZE(field_map); i++) {
-		if ((cur = tb[field_map[i].id]) != NULL)
-			*(field_map[i].field) = blobmsg_get_u32(cur);
+		int val;
+
+		if ((cur = tb[field_map[i].id]) == NULL)
+			continue;
+
+		/* percentages are compared against the scaled averages */
+		val = blobmsg_get_u32(cur);
+		if (field_map[i].percent)
+			val = (val << ATF_AVG_SCALE) / 100;
+
+		*(field_map[i].field) = val;
 	}
 
 	return 0;
 }
 
+static int
+atf_ubus_status(struct ubus_context *ctx, struct ubus_object *obj,
+		struct ubus_request_data *req, const char *method,
+		struct blob_attr *msg)
+{
+	struct atf_interface *iface;
+	void *c, *i;
+
+	blob_buf_init(&b, 0);
+	c = blobmsg_open_table(&b, "interfaces");
+	avl_for_each_element(&interfaces, iface, avl) {
+		i = blobmsg_open_table(&b, iface->ifname);
+		blobmsg_add_u32(&b, "stations", iface->stations.count);
+		blobmsg_add_u64(&b, "weight_applied", iface->weight_applied);
+		blobmsg_add_u64(&b, "weight_suppressed", iface->weight_suppressed);
+		blobmsg_add_u64(&b, "weight_calls", iface->weight_calls);
+		blobmsg_close_table(&b, i);
+	}
+	blobmsg_close_table(&b, c);
+
+	ubus_send_reply(ctx, req, b.head);
+
+	return 0;
+}
 
 static const struct ubus_method atf_methods[] = {
 	UBUS_METHOD("config", atf_ubus_config, atf_config_policy),
+	UBUS_METHOD_NOARG("status", atf_ubus_status),
 };
 
 static struct ubus_object_type atf_object_type =
@@ -110,14 +148,81 @@ atf_ubus_lookup_cb(struct ubus_context *ctx, struct ubus_object_data *obj,
 		atf_ubus_add_interface(ctx, obj->path);
 }
 
-void atf_ubus_set_sta_weight(struct atf_interface *iface, struct atf_station *sta)
+static int
+atf_ubus_set_sta_weight(struct atf_interface *iface, struct atf_station *sta)
 {
+	int ret;
+
 	D("set sta "MAC_ADDR_FMT" weight=%d", MAC_ADDR_DATA(sta->macaddr), sta->weight);
 	blob_buf_init(&b, 0);
 	blobmsg_printf(&b, "sta", MAC_ADDR_FMT, MAC_ADDR_DATA(sta->macaddr));
 	blobmsg_add_u32(&b, "weight", sta->weight);
-	if (ubus_invoke(&conn.ctx, iface->ubus_obj, "update_airtime", b.head, NULL, NULL, 100))
+	iface->weight_calls++;
+	ret = ubus_invoke(&conn.ctx, iface->ubus_obj, "update_airtime", b.head, NULL, NULL, 100);
+	if (ret)
 		D("set airtime weight failed");
+
+	return ret;
+}
+
+static int
+atf_ubus_set_sta_weights_batch(struct atf_interface *iface)
+{
+	struct atf_station *sta;
+	char addr[18];
+	void *c;
+
+	blob_buf_init(&b, 0);
+	c = blobmsg_open_table(&b, "stations");
+	avl_for_each_element(&iface->stations, sta, avl) {
+		if (!sta->weight_pending)
+			continue;
+
+		D("set sta "MAC_ADDR_FMT" weight=%d", MAC_ADDR_DATA(sta->macaddr), sta->weight);
+		snprintf(addr, sizeof(addr), MAC_ADDR_FMT, MAC_ADDR_DATA(sta->macaddr));
+		blobmsg_add_u32(&b, addr, sta->weight);
+	}
+	blobmsg_close_table(&b, c);
+
+	iface->weight_calls++;
+	return ubus_invoke(&conn.ctx, iface->ubus_obj, "update_airtime", b.head, NULL, NULL, 100);
+}
+
+/*
+ * Returns false if any weight could not be applied. Those stations keep
+ * weight_pending set and are retried on the next commit.
+ */
+bool atf_ubus_set_sta_weights(struct atf_interface *iface)
+{
+	struct atf_station *sta;
+	bool done = true;
+	int ret;
+
+	if (!iface->weight_legacy) {
+		ret = atf_ubus_set_sta_weights_batch(iface);
+		/* older hostapd versions require sta/weight for every call */
+		if (ret == UBUS_STATUS_INVALID_ARGUMENT) {
+			iface->weight_legacy = true;
+		} else if (ret) {
+			D("set airtime weights failed");
+			return false;
+		}
+	}
+
+	avl_for_each_element(&iface->stations, sta, avl) {
+		if (!sta->weight_pending)
+			continue;
+
+		if (iface->weight_legacy && atf_ubus_set_sta_weight(iface, sta)) {
+			done = false;
+			continue;
+		}
+
+		sta->weight_pending = false;
+		iface->weight_applied++;
+	}
+
+	return done;
 }
 
 static void
@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Replays nl80211 station dumps into atfpolicy's poll path and reports the
+ * CPU cost per poll.
+ *
+ *   atf-bench [-s stations] [-n polls] [-a active %] [-w file] [-r file]
+ *
+ * Without -r the dumps are synthesized: every third station is voice heavy,
+ * the others are best effort, and only the given share of stations passes
+ * traffic. -w records the synthesized dumps, -r replays a recording instead.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <unl.h>
+
+#include "atf.h"
+#include "check.h"
+#include "mock_unl.h"
+
+struct atf_config config;
+int debug_flag;
+
+static int weight_updates;
+
+bool atf_ubus_set_sta_weights(struct atf_interface *iface)
+{
+	struct atf_station *sta;
+
+	avl_for_each_element(&iface->stations, sta, avl) {
+		if (!sta->weight_pending)
+			continue;
+
+		sta->weight_pending = false;
+		iface->weight_applied++;
+		weight_updates++;
+	}
+
+	return true;
+}
+
+static bool sim_sta_active(int i, int active)
+{
+	return i % 100 < active;
+}
+
+/* advance the counters of the active stations and build the next dump */
+static int sim_dump(struct mock_sta *stas, int n_stas, int active, struct mock_dump *d)
+{
+	struct nl_msg *msg;
+	int i;
+
+	for (i = 0; i < n_stas; i++) {
+		struct mock_sta *s = &stas[i];
+
+		if (sim_sta_active(i, active)) {
+			if (i % 3 == 0) {
+				s->tid[6] += 40;
+				s->tid[0] += 10;
+			} else {
+				s->tid[0] += 100;
+			}
+			s->tx += 100;
+			s->rx += 20;
+		}
+
+		msg = mock_sta_msg(s);
+		if (!msg || mock_dump_add(d, msg))
+			return -1;
+	}
+
+	return 0;
+}
+
+static uint64_t cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+	const char *record = NULL, *replay = NULL;
+	int n_stas = 256, n_polls = 1000, active = 25;
+	struct mock_dump dump = {};
+	struct atf_interface *iface;
+	struct atf_station *sta;
+	struct mock_sta *stas;
+	FILE *rec = NULL, *rep = NULL;
+	uint64_t start, total = 0;
+	int i, ch, polls = 0;
+	bool weights_ok = true;
+	void *msg;
+
+	while ((ch = getopt(argc, argv, "s:n:a:w:r:")) != -1) {
+		switch (ch) {
+		case 's':
+			n_stas = atoi(optarg);
+			break;
+		case 'n':
+			n_polls = atoi(optarg);
+			break;
+		case 'a':
+			active = atoi(optarg);
+			break;
+		case 'w':
+			record = optarg;
+			break;
+		case 'r':
+			replay = optarg;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-s stations] [-n polls] [-a active %%] "
+				"[-w file] [-r file]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	reset_config();
+	atf_nl80211_init();
+
+	/* the mock does not look at the ifindex, any existing device will do */
+	iface = atf_interface_get("lo");
+
+	stas = calloc(n_stas, sizeof(*stas));
+	if (!iface || !stas)
+		return 1;
+
+	for (i = 0; i < n_stas; i++) {
+		stas[i].macaddr[0] = 0x02;
+		stas[i].macaddr[4] = i >> 8;
+		stas[i].macaddr[5] = i & 0xff;
+	}
+
+	if (record && !(rec = fopen(record, "w"))) {
+		perror(record);
+		return 1;
+	}
+
+	if (replay && !(rep = fopen(replay, "r"))) {
+		perror(replay);
+		return 1;
+	}
+
+	for (i = 0; i < n_polls; i++) {
+		if (rep) {
+			if (mock_dump_read(rep, &dump) <= 0)
+				break;
+		} else if (sim_dump(stas, n_stas, active, &dump)) {
+			return 1;
+		}
+
+		if (rec && mock_dump_write(rec, &dump))
+			return 1;
+
+		mock_reply = &dump;
+		start = cpu_ns();
+		atf_nl80211_interface_update(iface);
+		/* the first poll sees every station for the first time */
+		if (i)
+			total += cpu_ns() - start;
+		polls++;
+
+		mock_dump_free(&dump);
+	}
+
+	if (rec)
+		fclose(rec);
+	if (rep)
+		fclose(rep);
+
+	printf("%d stations, %d polls: %.1f us cpu per poll, %d weight updates\n",
+	       n_stas, polls, polls > 1 ? total / 1000.0 / (polls - 1) : 0.0,
+	       weight_updates);
+
+	check(mock_msg_allocs == 1, "the station dump request is reused");
+	check(mock_requests == polls, "one dump per interface and poll");
+
+	if (!rep && polls > 2) {
+		avl_for_each_element(&iface->stations, sta, avl) {
+			int idx = sta->macaddr[4] << 8 | sta->macaddr[5];
+			int expect = !sim_sta_active(idx, active) ? -1 :
+				     idx % 3 == 0 ? config.weight_prio : config.weight_normal;
+
+			if (sta->weight != expect)
+				weights_ok = false;
+		}
+		check(weights_ok, "active stations are classified, idle ones are not");
+
+		/* nothing moved since the last dump, so nothing is parsed */
+		for (i = 0; i < n_stas; i++)
+			mock_dump_add(&dump, mock_sta_msg(&stas[i]));
+		mock_reply = &dump;
+		atf_nl80211_interface_update(iface);
+		check(!iface->active, "idle stations are skipped");
+		mock_dump_free(&dump);
+	}
+
+	/* an empty dump flushes every station but keeps the request */
+	msg = iface->sta_msg;
+	atf_nl80211_interface_update(iface);
+	check(msg == iface->sta_msg && mock_msg_allocs == 1,
+	      "the request survives an empty poll");
+	check(avl_is_empty(&iface->stations), "stations that left are flushed");
+
+	free(stas);
+
+	return failures ? 1 : 0;
+}
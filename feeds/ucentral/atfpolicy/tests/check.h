@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-2.0+
+#ifndef __ATF_CHECK_H
+#define __ATF_CHECK_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* number of failed checks, the exit status of the test */
+static int failures;
+
+static inline void __attribute__((format(printf, 2, 3)))
+check(bool cond, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("%s: ", cond ? "ok" : "FAIL");
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf("\n");
+
+	if (!cond)
+		failures++;
+}
+
+#endif
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * libubus replacement that plays hostapd's update_airtime method and records
+ * the station weights it was given, instead of talking to ubusd.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <libubus.h>
+
+#include "mock_ubus.h"
+
+#define MOCK_HOSTAPD_STAS	1024
+
+struct mock_hostapd mock_hostapd;
+
+static struct {
+	uint8_t macaddr[6];
+	int weight;
+} weights[MOCK_HOSTAPD_STAS];
+static int n_weights;
+
+void mock_hostapd_reset(enum mock_hostapd_mode mode)
+{
+	memset(&mock_hostapd, 0, sizeof(mock_hostapd));
+	mock_hostapd.mode = mode;
+	n_weights = 0;
+}
+
+int mock_hostapd_weight(const uint8_t *macaddr)
+{
+	int i;
+
+	for (i = 0; i < n_weights; i++)
+		if (!memcmp(weights[i].macaddr, macaddr, 6))
+			return weights[i].weight;
+
+	return -1;
+}
+
+static void mock_hostapd_set(const char *addr, int weight)
+{
+	uint8_t macaddr[6];
+	int i;
+
+	if (sscanf(addr, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &macaddr[0], &macaddr[1],
+		   &macaddr[2], &macaddr[3], &macaddr[4], &macaddr[5]) != 6)
+		return;
+
+	mock_hostapd.updates++;
+	mock_hostapd.last_stations++;
+
+	for (i = 0; i < n_weights; i++)
+		if (!memcmp(weights[i].macaddr, macaddr, 6))
+			break;
+
+	if (i == n_weights) {
+		if (n_weights == MOCK_HOSTAPD_STAS)
+			return;
+		memcpy(weights[n_weights++].macaddr, macaddr, 6);
+	}
+
+	weights[i].weight = weight;
+}
+
+static int mock_update_airtime(struct blob_attr *msg)
+{
+	enum {
+		AIRTIME_STA,
+		AIRTIME_WEIGHT,
+		AIRTIME_STATIONS,
+		__AIRTIME_MAX
+	};
+	static const struct blobmsg_policy policy[__AIRTIME_MAX] = {
+		[AIRTIME_STA] = { "sta", BLOBMSG_TYPE_STRING },
+		[AIRTIME_WEIGHT] = { "weight", BLOBMSG_TYPE_INT32 },
+		[AIRTIME_STATIONS] = { "stations", BLOBMSG_TYPE_TABLE },
+	};
+	struct blob_attr *tb[__AIRTIME_MAX], *cur;
+	int rem;
+
+	mock_hostapd.calls++;
+
+	if (mock_hostapd.mode == MOCK_HOSTAPD_DOWN)
+		return UBUS_STATUS_TIMEOUT;
+
+	blobmsg_parse(policy, __AIRTIME_MAX, tb, blob_data(msg), blob_len(msg));
+
+	if (tb[AIRTIME_STATIONS]) {
+		if (mock_hostapd.mode == MOCK_HOSTAPD_LEGACY)
+			return UBUS_STATUS_INVALID_ARGUMENT;
+
+		mock_hostapd.batch_calls++;
+		mock_hostapd.last_stations = 0;
+		blobmsg_for_each_attr(cur, tb[AIRTIME_STATIONS], rem)
+			mock_hostapd_set(blobmsg_name(cur), blobmsg_get_u32(cur));
+
+		return 0;
+	}
+
+	if (!tb[AIRTIME_STA] || !tb[AIRTIME_WEIGHT])
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	mock_hostapd.last_stations = 0;
+	mock_hostapd_set(blobmsg_get_string(tb[AIRTIME_STA]),
+			 blobmsg_get_u32(tb[AIRTIME_WEIGHT]));
+
+	return 0;
+}
+
+int ubus_invoke_fd(struct ubus_context *ctx, uint32_t obj, const char *method,
+		   struct blob_attr *msg, ubus_data_handler_t cb, void *priv,
+		   int timeout, int fd)
+{
+	if (!strcmp(method, "update_airtime"))
+		return mock_update_airtime(msg);
+
+	return UBUS_STATUS_METHOD_NOT_FOUND;
+}
+
+/* the rest is only reached through atf_ubus_init() and the ubus methods */
+int ubus_lookup_id(struct ubus_context *ctx, const char *path, uint32_t *id)
+{
+	return UBUS_STATUS_NOT_FOUND;
+}
+
+int ubus_lookup(struct ubus_context *ctx, const char *path,
+		ubus_lookup_handler_t cb, void *priv)
+{
+	return 0;
+}
+
+int ubus_add_object(struct ubus_context *ctx, struct ubus_object *obj)
+{
+	return 0;
+}
+
+int ubus_register_event_handler(struct ubus_context *ctx,
+				struct ubus_event_handler *ev,
+				const char *pattern)
+{
+	return 0;
+}
+
+int ubus_send_reply(struct ubus_context *ctx, struct ubus_request_data *req,
+		    struct blob_attr *msg)
+{
+	return 0;
+}
+
+void ubus_auto_connect(struct ubus_auto_conn *conn)
+{
+}
+
+void ubus_shutdown(struct ubus_context *ctx)
+{
+}
@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: GPL-2.0+
+#ifndef __ATF_MOCK_UBUS_H
+#define __ATF_MOCK_UBUS_H
+
+#include <stdint.h>
+
+enum mock_hostapd_mode {
+	/* takes a "stations" table with the weights of several stations */
+	MOCK_HOSTAPD_BATCH,
+	/* only takes sta/weight, rejects tables as invalid */
+	MOCK_HOSTAPD_LEGACY,
+	/* does not answer */
+	MOCK_HOSTAPD_DOWN,
+};
+
+/* what hostapd saw, reset with mock_hostapd_reset() */
+struct mock_hostapd {
+	enum mock_hostapd_mode mode;
+
+	/* update_airtime calls, including the rejected and failed ones */
+	int calls;
+	int batch_calls;
+	/* station weights applied over all calls */
+	int updates;
+	/* stations in the last call that was applied */
+	int last_stations;
+};
+
+extern struct mock_hostapd mock_hostapd;
+
+void mock_hostapd_reset(enum mock_hostapd_mode mode);
+/* the weight hostapd applied last for the station, -1 if none */
+int mock_hostapd_weight(const uint8_t *macaddr);
+
+#endif
@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * unl replacement that answers every request with a prepared or recorded
+ * nl80211 station dump instead of talking to the kernel.
+ */
+#include <linux/nl80211.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unl.h>
+
+#include "mock_unl.h"
+
+struct mock_dump *mock_reply;
+int mock_msg_allocs;
+int mock_requests;
+
+int unl_genl_init(struct unl *unl, const char *family)
+{
+	memset(unl, 0, sizeof(*unl));
+
+	return 0;
+}
+
+struct nl_msg *unl_genl_msg(struct unl *unl, int cmd, bool dump)
+{
+	struct nl_msg *msg;
+
+	msg = nlmsg_alloc();
+	if (!msg)
+		return NULL;
+
+	mock_msg_allocs++;
+	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, GENL_ID_GENERATE, 0,
+		    dump ? NLM_F_DUMP : 0, cmd, 0);
+
+	return msg;
+}
+
+int unl_genl_request(struct unl *unl, struct nl_msg *msg, unl_cb handler, void *arg)
+{
+	int i;
+
+	mock_requests++;
+
+	for (i = 0; mock_reply && i < mock_reply->n_msgs; i++)
+		if (handler(mock_reply->msgs[i], arg) == NL_STOP)
+			break;
+
+	/* like the real one, the request reference is consumed */
+	nlmsg_free(msg);
+
+	return 0;
+}
+
+struct nl_msg *mock_sta_msg(const struct mock_sta *s)
+{
+	struct nlattr *sinfo, *tids, *tid;
+	struct nl_msg *msg;
+	int i;
+
+	msg = nlmsg_alloc();
+	if (!msg)
+		return NULL;
+
+	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, GENL_ID_GENERATE, 0, NLM_F_MULTI,
+		    NL80211_CMD_NEW_STATION, 0);
+	NLA_PUT(msg, NL80211_ATTR_MAC, 6, s->macaddr);
+
+	sinfo = nla_nest_start(msg, NL80211_ATTR_STA_INFO);
+	NLA_PUT_U32(msg, NL80211_STA_INFO_TX_PACKETS, s->tx);
+	NLA_PUT_U32(msg, NL80211_STA_INFO_RX_PACKETS, s->rx);
+
+	tids = nla_nest_start(msg, NL80211_STA_INFO_TID_STATS);
+	for (i = 0; i < 8; i++) {
+		tid = nla_nest_start(msg, i + 1);
+		NLA_PUT_U64(msg, NL80211_TID_STATS_TX_MSDU, s->tid[i]);
+		nla_nest_end(msg, tid);
+	}
+	nla_nest_end(msg, tids);
+	nla_nest_end(msg, sinfo);
+
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+int mock_dump_add(struct mock_dump *d, struct nl_msg *msg)
+{
+	struct nl_msg **msgs;
+
+	msgs = realloc(d->msgs, (d->n_msgs + 1) * sizeof(*msgs));
+	if (!msgs)
+		return -1;
+
+	d->msgs = msgs;
+	d->msgs[d->n_msgs++] = msg;
+
+	return 0;
+}
+
+void mock_dump_free(struct mock_dump *d)
+{
+	int i;
+
+	for (i = 0; i < d->n_msgs; i++)
+		nlmsg_free(d->msgs[i]);
+
+	free(d->msgs);
+	d->msgs = NULL;
+	d->n_msgs = 0;
+}
+
+int mock_dump_write(FILE *f, struct mock_dump *d)
+{
+	struct {
+		struct nlmsghdr hdr;
+		int error;
+	} done = {
+		.hdr = {
+			.nlmsg_len = NLMSG_LENGTH(sizeof(int)),
+			.nlmsg_type = NLMSG_DONE,
+			.nlmsg_flags = NLM_F_MULTI,
+		},
+	};
+	struct nlmsghdr *hdr;
+	int i;
+
+	for (i = 0; i < d->n_msgs; i++) {
+		hdr = nlmsg_hdr(d->msgs[i]);
+		if (fwrite(hdr, NLMSG_ALIGN(hdr->nlmsg_len), 1, f) != 1)
+			return -1;
+	}
+
+	return fwrite(&done, sizeof(done), 1, f) == 1 ? 0 : -1;
+}
+
+/* read the next dump, returns 0 at the end of the recording */
+int mock_dump_read(FILE *f, struct mock_dump *d)
+{
+	struct nlmsghdr hdr, *buf;
+	struct nl_msg *msg;
+	size_t len;
+
+	while (fread(&hdr, sizeof(hdr), 1, f) == 1) {
+		if (hdr.nlmsg_len < sizeof(hdr))
+			return -1;
+
+		len = NLMSG_ALIGN(hdr.nlmsg_len);
+		buf = malloc(len);
+		if (!buf)
+			return -1;
+
+		memcpy(buf, &hdr, sizeof(hdr));
+		if (len > sizeof(hdr) && fread(buf + 1, len - sizeof(hdr), 1, f) != 1) {
+			free(buf);
+			return -1;
+		}
+
+		if (hdr.nlmsg_type == NLMSG_DONE) {
+			free(buf);
+			return 1;
+		}
+
+		msg = nlmsg_convert(buf);
+		free(buf);
+		if (!msg || mock_dump_add(d, msg))
+			return -1;
+	}
+
+	return d->n_msgs ? 1 : 0;
+}
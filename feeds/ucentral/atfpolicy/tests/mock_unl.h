@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-2.0+
+#ifndef __ATF_MOCK_UNL_H
+#define __ATF_MOCK_UNL_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+struct nl_msg;
+
+/* the replies to one NL80211_CMD_GET_STATION dump */
+struct mock_dump {
+	struct nl_msg **msgs;
+	int n_msgs;
+};
+
+/* a station of a synthesized dump, the caller advances its counters */
+struct mock_sta {
+	uint8_t macaddr[6];
+	uint32_t tx, rx;
+	/* TX MSDUs per TID */
+	uint64_t tid[8];
+};
+
+extern struct mock_dump *mock_reply;
+extern int mock_msg_allocs;
+extern int mock_requests;
+
+struct nl_msg *mock_sta_msg(const struct mock_sta *s);
+int mock_dump_add(struct mock_dump *d, struct nl_msg *msg);
+void mock_dump_free(struct mock_dump *d);
+
+/*
+ * Recordings are the raw netlink messages of one or more dumps back to
+ * back, each dump terminated by NLMSG_DONE, as written by mock_dump_write().
+ */
+int mock_dump_write(FILE *f, struct mock_dump *d);
+int mock_dump_read(FILE *f, struct mock_dump *d);
+
+#endif
@@ -0,0 +1,338 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Feeds synthetic TID statistics through atfpolicy's poll path and checks
+ * how the station classes converge and what hostapd is sent for it. Both the
+ * nl80211 dumps and hostapd's update_airtime method are mocked, the rest is
+ * the daemon's own code.
+ *
+ * Every station sends the same number of MSDUs per poll, the given share of
+ * them on the video TID and the rest as best effort, so its average moves
+ * towards that share by a quarter of the distance per poll.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unl.h>
+
+#include "atf.h"
+#include "check.h"
+#include "mock_ubus.h"
+#include "mock_unl.h"
+
+#define SIM_STAS	32
+#define SIM_MSDUS	1000
+#define SIM_MAX_POLLS	30
+
+struct atf_config config;
+int debug_flag;
+
+static struct atf_interface *iface;
+
+static struct {
+	struct mock_sta sta;
+	/* percentage of the MSDUs sent on the video TID */
+	int share;
+} stas[SIM_STAS];
+static int n_stas;
+
+static int pct(int percent)
+{
+	return (percent << ATF_AVG_SCALE) / 100;
+}
+
+static void sim_poll(void)
+{
+	struct mock_dump dump = {};
+	int i;
+
+	for (i = 0; i < n_stas; i++) {
+		struct mock_sta *s = &stas[i].sta;
+
+		s->tid[5] += stas[i].share * SIM_MSDUS / 100;
+		s->tid[0] += (100 - stas[i].share) * SIM_MSDUS / 100;
+		s->tx += SIM_MSDUS;
+		mock_dump_add(&dump, mock_sta_msg(s));
+	}
+
+	mock_reply = &dump;
+	atf_nl80211_interface_update(iface);
+	mock_reply = NULL;
+	mock_dump_free(&dump);
+}
+
+static void sim_polls(int n)
+{
+	while (n-- > 0)
+		sim_poll();
+}
+
+/*
+ * Drops the stations of the previous run and starts over with n new ones,
+ * the given thresholds and a fresh hostapd.
+ */
+static void sim_start(int n, int bulk, int prio, enum mock_hostapd_mode mode)
+{
+	int i;
+
+	/* an empty dump flushes every station */
+	n_stas = 0;
+	sim_poll();
+
+	reset_config();
+	config.bulk_percent_thresh = pct(bulk);
+	config.prio_percent_thresh = pct(prio);
+
+	iface->weight_pending = false;
+	iface->weight_legacy = false;
+	iface->weight_applied = 0;
+	iface->weight_suppressed = 0;
+	iface->weight_calls = 0;
+	mock_hostapd_reset(mode);
+
+	memset(stas, 0, sizeof(stas));
+	n_stas = n;
+	for (i = 0; i < n; i++) {
+		stas[i].sta.macaddr[0] = 0x02;
+		stas[i].sta.macaddr[5] = i;
+	}
+}
+
+static struct atf_station *sim_sta(int i)
+{
+	struct atf_station *sta;
+
+	return avl_find_element(&iface->stations, stas[i].sta.macaddr, sta, avl);
+}
+
+static int hostapd_weight(int i)
+{
+	return mock_hostapd_weight(stas[i].sta.macaddr);
+}
+
+/*
+ * Polls until hostapd has the given weight for station i. Returns the polls
+ * it took, or -1 if it did not get there. *avg is the average the station
+ * had when it changed class.
+ */
+static int sim_poll_until(int i, int weight, int *avg)
+{
+	int n;
+
+	for (n = 1; n <= SIM_MAX_POLLS; n++) {
+		sim_poll();
+		if (hostapd_weight(i) == weight) {
+			*avg = sim_sta(i)->avg_prio;
+			return n;
+		}
+	}
+
+	return -1;
+}
+
+/* stations at 5%, 30% and 80% with bulk above 20% and prio above 40% */
+static void test_convergence(void)
+{
+	static const int shares[] = { 5, 30, 80 };
+	bool classified = true;
+	int expect[3];
+	int i;
+
+	sim_start(SIM_STAS, 20, 40, MOCK_HOSTAPD_BATCH);
+	expect[0] = config.weight_normal;
+	expect[1] = config.weight_bulk;
+	expect[2] = config.weight_prio;
+	for (i = 0; i < n_stas; i++)
+		stas[i].share = shares[i % 3];
+
+	sim_poll();
+	check(mock_hostapd.calls == 1 && mock_hostapd.last_stations == n_stas,
+	      "new stations: one call with all %d weights (%d calls, %d weights)",
+	      n_stas, mock_hostapd.calls, mock_hostapd.last_stations);
+
+	for (i = 0; i < n_stas; i++)
+		if (hostapd_weight(i) != expect[i % 3])
+			classified = false;
+	check(classified, "new stations: every station has the weight of its class");
+
+	sim_polls(10);
+	check(mock_hostapd.calls == 1, "steady traffic: no further calls (%d)",
+	      mock_hostapd.calls);
+	check(iface->weight_applied == n_stas && iface->weight_calls == 1 &&
+	      !iface->weight_suppressed,
+	      "steady traffic: %d applied, %d calls, none suppressed",
+	      (int)iface->weight_applied, (int)iface->weight_calls);
+}
+
+/*
+ * A prio station whose traffic drops to just above the bulk threshold moves
+ * to bulk once its average is 5% below the prio threshold, in one call.
+ */
+static void test_prio_to_bulk(void)
+{
+	int polls, avg = 0, calls;
+
+	sim_start(4, 20, 40, MOCK_HOSTAPD_BATCH);
+	stas[0].share = 80;
+	stas[1].share = 5;
+	stas[2].share = 30;
+	stas[3].share = 80;
+	sim_polls(5);
+	calls = mock_hostapd.calls;
+
+	stas[0].share = 22;
+	polls = sim_poll_until(0, config.weight_bulk, &avg);
+	check(polls > 0, "prio station dropping to 22%%: bulk after %d polls", polls);
+	check(polls > 0 && avg <= pct(40) - config.weight_hysteresis &&
+	      avg > pct(20),
+	      "prio station dropping to 22%%: changed at %d%%, not before 35%%",
+	      (avg * 100) >> ATF_AVG_SCALE);
+	check(iface->weight_suppressed > 0,
+	      "prio station dropping to 22%%: %d polls inside the band suppressed",
+	      (int)iface->weight_suppressed);
+
+	sim_polls(10);
+	check(hostapd_weight(0) == config.weight_bulk &&
+	      mock_hostapd.calls == calls + 1 && mock_hostapd.last_stations == 1,
+	      "prio station dropping to 22%%: one call for the change (%d)",
+	      mock_hostapd.calls - calls);
+	check(hostapd_weight(3) == config.weight_prio,
+	      "prio station dropping to 22%%: the other prio station is left alone");
+}
+
+/* an average that keeps crossing the prio threshold stays inside the band */
+static void test_jitter(void)
+{
+	int i, calls, suppressed;
+
+	sim_start(2, 20, 40, MOCK_HOSTAPD_BATCH);
+	stas[0].share = 30;
+	stas[1].share = 5;
+	sim_polls(5);
+	calls = mock_hostapd.calls;
+	suppressed = iface->weight_suppressed;
+
+	for (i = 0; i < 20; i++) {
+		stas[0].share = i & 1 ? 38 : 44;
+		sim_poll();
+	}
+
+	check(hostapd_weight(0) == config.weight_bulk && mock_hostapd.calls == calls,
+	      "jitter around the prio threshold: stays bulk, no calls (%d)",
+	      mock_hostapd.calls - calls);
+	check(iface->weight_suppressed > suppressed,
+	      "jitter around the prio threshold: %d changes suppressed",
+	      (int)iface->weight_suppressed - suppressed);
+}
+
+/*
+ * With the thresholds closer than twice the band, a station can still move
+ * into the class between them and out of it again on either side.
+ */
+static void test_narrow_class(void)
+{
+	int polls, avg = 0;
+
+	sim_start(1, 20, 28, MOCK_HOSTAPD_BATCH);
+	stas[0].share = 10;
+	sim_polls(5);
+	check(hostapd_weight(0) == config.weight_normal,
+	      "narrow bulk class: starts normal");
+
+	stas[0].share = 27;
+	polls = sim_poll_until(0, config.weight_bulk, &avg);
+	check(polls > 0 && avg > pct(20) + config.weight_hysteresis,
+	      "narrow bulk class: normal to bulk after %d polls at %d%%", polls,
+	      (avg * 100) >> ATF_AVG_SCALE);
+
+	stas[0].share = 36;
+	polls = sim_poll_until(0, config.weight_prio, &avg);
+	check(polls > 0 && avg > pct(28) + config.weight_hysteresis,
+	      "narrow bulk class: bulk to prio after %d polls at %d%%", polls,
+	      (avg * 100) >> ATF_AVG_SCALE);
+
+	/* settle at 36% first, so that the way down passes through bulk */
+	sim_polls(10);
+	stas[0].share = 10;
+	polls = sim_poll_until(0, config.weight_bulk, &avg);
+	check(polls > 0 && avg <= pct(28) - config.weight_hysteresis &&
+	      avg > pct(20),
+	      "narrow bulk class: prio to bulk after %d polls at %d%%", polls,
+	      (avg * 100) >> ATF_AVG_SCALE);
+
+	polls = sim_poll_until(0, config.weight_normal, &avg);
+	check(polls > 0 && avg <= pct(20) - config.weight_hysteresis,
+	      "narrow bulk class: bulk to normal after %d polls at %d%%", polls,
+	      (avg * 100) >> ATF_AVG_SCALE);
+}
+
+/* hostapd without batched updates gets one call per station from then on */
+static void test_legacy(void)
+{
+	int calls, avg;
+
+	sim_start(4, 20, 40, MOCK_HOSTAPD_LEGACY);
+	stas[0].share = 5;
+	stas[1].share = 30;
+	stas[2].share = 80;
+	stas[3].share = 80;
+
+	sim_poll();
+	check(mock_hostapd.calls == 5 && mock_hostapd.updates == 4 &&
+	      !mock_hostapd.batch_calls,
+	      "legacy hostapd: rejected batch, then 4 single calls (%d calls)",
+	      mock_hostapd.calls);
+	check(hostapd_weight(2) == config.weight_prio && iface->weight_applied == 4,
+	      "legacy hostapd: all weights applied");
+
+	calls = mock_hostapd.calls;
+	stas[1].share = 5;
+	sim_poll_until(1, config.weight_normal, &avg);
+	check(mock_hostapd.calls == calls + 1,
+	      "legacy hostapd: a later change is a single call, no batch (%d)",
+	      mock_hostapd.calls - calls);
+}
+
+/* weights that did not reach hostapd are sent again without a class change */
+static void test_retry(void)
+{
+	int calls;
+
+	sim_start(3, 20, 40, MOCK_HOSTAPD_DOWN);
+	stas[0].share = 5;
+	stas[1].share = 30;
+	stas[2].share = 80;
+
+	sim_polls(3);
+	check(mock_hostapd.calls == 3 && !iface->weight_applied,
+	      "hostapd down: retried on every poll (%d calls), nothing applied",
+	      mock_hostapd.calls);
+
+	mock_hostapd.mode = MOCK_HOSTAPD_BATCH;
+	sim_poll();
+	calls = mock_hostapd.calls;
+	check(hostapd_weight(2) == config.weight_prio &&
+	      mock_hostapd.last_stations == 3 && iface->weight_applied == 3,
+	      "hostapd back: all 3 pending weights in one call");
+
+	sim_polls(5);
+	check(mock_hostapd.calls == calls, "hostapd back: nothing left to send");
+}
+
+int main(int argc, char **argv)
+{
+	reset_config();
+	atf_nl80211_init();
+
+	/* the mock does not look at the ifindex, any existing device will do */
+	iface = atf_interface_get("lo");
+	if (!iface)
+		return 1;
+
+	test_convergence();
+	test_prio_to_bulk();
+	test_jitter();
+	test_narrow_class();
+	test_legacy();
+	test_retry();
+
+	return failures ? 1 : 0;
+}
@@ -9,6 +9,30 @@ let log = require("log");
 let hapd_subscriber;
 let device_subscriber;
 let ifaces = {};
+let pending = {};
+let pending_id = 0;
+/* kept out of ifaces, which is returned by the dump method */
+let hostapd_confs = {};
+
+/* issue a ubus call without waiting for the reply, failures are logged */
+function ubus_async(object, method, args, done) {
+	let id = ++pending_id;
+	let req = ubus.defer(object, method, args ?? {}, (rc) => {
+		delete pending[id];
+		if (rc)
+			log.syslog(LOG_ERR, `${object}.${method} failed: ${rc}`);
+		if (done)
+			done(rc);
+	});
+
+	if (!req) {
+		log.syslog(LOG_ERR, `${object}.${method}: ${ubus.error()}`);
+		if (done)
+			done(-1);
+		return;
+	}
+	pending[id] = req;
+}
 
 /* load UCI */
 let config;
@@ -24,29 +48,41 @@ function config_load() {
 
 /* set a wired ports auth state */
 function netifd_handle_iface(name, auth_status, vlan) {
-	let msg = { name, auth_status, auth_vlans: [ ifaces[name].default_vlan + ':u' ]};
-	if (ifaces[name].upstream && vlan)
-		msg.auth_vlans = [ vlan + ':u' ];
-	ubus.call('network.device', 'set_state', msg);
-	if (auth_status && ifaces[name].upstream && vlan) {
-		for (let wan in ifaces[name].wan_ports) {
+	let port = ifaces[name];
+	let auth_vlan = port.default_vlan;
+	if (port.upstream && vlan)
+		auth_vlan = vlan;
+
+	/* netifd already has this state, e.g. for a further client on the port */
+	if (port.authenticated == auth_status && port.auth_vlan == auth_vlan)
+		return;
+
+	let msg = { name, auth_status, auth_vlans: [ auth_vlan + ':u' ]};
+	ubus_async('network.device', 'set_state', msg);
+	if (auth_status && port.upstream && vlan && !port.wan_vlans[vlan]) {
+		for (let wan in port.wan_ports) {
 			let msg = {
 				name: wan,
 				vlan: [ `${vlan}:t` ]
 			};
-			ubus.call('network.interface.up_none', 'add_device', msg);
-			ubus.call('udevstats', 'add_device', { device: wan, vlan });
+			ubus_async('network.interface.up_none', 'add_device', msg);
+			ubus_async('udevstats', 'add_device', { device: wan, vlan });
 		}
+		port.wan_vlans[vlan] = true;
 	}
-	ifaces[name].authenticated = auth_status;
+	port.authenticated = auth_status;
+	port.auth_vlan = auth_vlan;
 }
 
 /* handle events from hostapd */
 function hapd_subscriber_notify_cb(notify) {
 	switch(notify.type) {
 	case 'sta-authorized':
+		let port = ifaces[notify.data.ifname];
+		if (!port)
+			break;
 		log.syslog(LOG_USER, "authenticated station");
-		push(ifaces[notify.data.ifname].lladdr, notify.data.address);
+		port.clients[notify.data.address] = { vlan: notify.data.vlan };
 		netifd_handle_iface(notify.data.ifname, true, notify.data.vlan);
 		break;
 	};
@@ -54,22 +90,98 @@ function hapd_subscriber_notify_cb(notify) {
 	return 0;
 }
 
-/* remove arp and rate limit for a client */
-function flush_iface(name) {
-	/* flush all arp entries */
+function neigh_add(port, neigh) {
+	port.neighs[neigh.lladdr] ??= {};
+	port.neighs[neigh.lladdr][neigh.dst] = neigh.family;
+}
+
+function neigh_del(port, neigh) {
+	let lladdr = neigh.lladdr;
+
+	/* delete notifications may lack the lladdr of an incomplete entry */
+	if (!lladdr)
+		for (let addr, dsts in port.neighs)
+			if (exists(dsts, neigh.dst))
+				lladdr = addr;
+
+	if (!port.neighs[lladdr])
+		return;
+	delete port.neighs[lladdr][neigh.dst];
+	if (!length(port.neighs[lladdr]))
+		delete port.neighs[lladdr];
+}
+
+/* learn the neighbours of a port once, later changes arrive as rtnl events */
+function neigh_load(name) {
+	ifaces[name].neighs = {};
+
 	let neighs = rtnl.request(rtnl.const.RTM_GETNEIGH, rtnl.const.NLM_F_DUMP, { dev: name });
 	for (let neigh in neighs)
-		if (neigh.lladdr in ifaces[name].lladdr) {
-			rtnl.request(rtnl.const.RTM_DELNEIGH, 0, { dst: neigh.dst, dev: neigh.dev, family: neigh.family });
-			ubus.call('ratelimit', 'client_delete', { device: neigh.dev, address: neigh.lladdr });
-		}
-	ifaces[name].lladdr = [];
+		if (neigh.lladdr && neigh.dev == name)
+			neigh_add(ifaces[name], neigh);
+}
+
+/*
+ * remove the arp entries of all authenticated clients of a port, their rate
+ * limits go away with the ratelimit device_delete the callers issue
+ */
+function flush_iface(name) {
+	let port = ifaces[name];
+
+	for (let lladdr in port.clients)
+		for (let dst, family in port.neighs[lladdr])
+			rtnl.request(rtnl.const.RTM_DELNEIGH, 0, { dst, dev: name, family });
+	port.clients = {};
+	port.wan_vlans = {};
 }
 
 /* generate a hostapd configuration */
+function hostapd_config(iface) {
+	let conf = [
+		'driver=wired',
+		'ieee8021x=1',
+		'eap_reauth_period=0',
+		'ctrl_interface=/var/run/hostapd',
+		`interface=${iface}`,
+		`ca_cert=${config.ca}`,
+		`server_cert=${config.cert}`,
+		`private_key=${config.key}`,
+		'dynamic_vlan=1',
+		'vlan_no_bridge=1',
+		'vlan_naming=1',
+	];
+
+	if (config.auth_server_addr) {
+		push(conf,
+			'dynamic_own_ip_addr=1',
+			`auth_server_addr=${config.auth_server_addr}`,
+			`auth_server_port=${config.auth_server_port}`,
+			`auth_server_shared_secret=${config.auth_server_secret}`);
+		if (config.acct_server_addr && config.acct_server_port && config.acct_server_secret)
+			push(conf,
+				`acct_server_addr=${config.acct_server_addr}`,
+				`acct_server_port=${config.acct_server_port}`,
+				`acct_server_shared_secret=${config.acct_server_secret}`);
+		if (config.nas_identifier)
+			push(conf, `nas_identifier=${config.nas_identifier}`);
+		if (config.coa_server_addr && config.coa_server_port && config.coa_server_secret)
+			push(conf,
+				`radius_das_client=${config.coa_server_addr} ${config.coa_server_secret}`,
+				`radius_das_port=${config.coa_server_port}`);
+		if (+config.mac_address_bypass)
+			push(conf, 'macaddr_acl=2');
+	} else {
+		push(conf,
+			'eap_server=1',
+			'eap_user_file=/var/run/hostapd-ieee8021x.eap_user');
+	}
+
+	return join('\n', conf) + '\n';
+}
+
 function hostapd_start(iface) {
 	if (!fs.stat("/sys/class/net/" + iface)) {
-		log.syslog(LOG_ERR, "Interface ${iface} does not exist yet");
+		log.syslog(LOG_ERR, `Interface ${iface} does not exist yet`);
 		return;
 	}
 	if (!config.auth_server_addr) {
@@ -77,44 +189,13 @@ function hostapd_start(iface) {
 		return;
 	}
 
+	/* only rewrite the file when the configuration changed */
 	let path = '/var/run/hostapd-' + iface + '.conf';
-	let file = fs.open(path, 'w+');
-
-	file.write('driver=wired\n');
-	file.write('ieee8021x=1\n');
-	file.write('eap_reauth_period=0\n');
-	file.write('ctrl_interface=/var/run/hostapd\n');
-	file.write('interface=' + iface + '\n');
-	file.write('ca_cert=' + config.ca + '\n');
-	file.write('server_cert=' + config.cert + '\n');
-	file.write('private_key=' + config.key + '\n');
-	file.write('dynamic_vlan=1\n');
-	file.write('vlan_no_bridge=1\n');
-	file.write('vlan_naming=1\n');
-
-	if (config.auth_server_addr) {
-		file.write('dynamic_own_ip_addr=1\n');
-		file.write('auth_server_addr=' + config.auth_server_addr + '\n');
-		file.write('auth_server_port=' + config.auth_server_port + '\n');
-		file.write('auth_server_shared_secret=' + config.auth_server_secret + '\n');
-		if (config.acct_server_addr && config.acct_server_port && config.acct_server_secret + '\n') {
-			file.write('acct_server_addr=' + config.acct_server_addr + '\n');
-			file.write('acct_server_port=' + config.acct_server_port + '\n');
-			file.write('acct_server_shared_secret=' + config.acct_server_secret + '\n');
-		}
-		if (config.nas_identifier)
-			file.write('nas_identifier=${config.nas_identifier}\n');
-		if (config.coa_server_addr && config.coa_server_port && config.coa_server_secret) {
-			file.write('radius_das_client=' + config.coa_server_addr + ' ' + config.coa_server_secret + '\n');
-			file.write('radius_das_port=' + config.coa_server_port + '\n');
-		}
-		if (+config.mac_address_bypass)
-			file.write('macaddr_acl=2\n');
-	} else {
-		file.write('eap_server=1\n');
-		file.write('eap_user_file=/var/run/hostapd-ieee8021x.eap_user\n');
+	let conf = hostapd_config(iface);
+	if (conf != hostapd_confs[iface] || !fs.access(path)) {
+		fs.writefile(path, conf);
+		hostapd_confs[iface] = conf;
 	}
-	file.close();
 
 	/* is hostapd already running ? */
 	/*
@@ -132,7 +213,7 @@ function hostapd_start(iface) {
 	 */
 
 	if (ifaces[iface].hostapd) {
-		log.syslog(LOG_USER, "Remove the config  ${iface}");
+		log.syslog(LOG_USER, `Remove the config  ${iface}`);
 		ubus.call('hostapd', 'config_remove', { iface: iface });
 	}
 	log.syslog(LOG_USER, "Add config (clear the old one) " + iface);
@@ -151,15 +232,16 @@ function device_subscriber_notify_cb(notify) {
 			break;
 
 		/* de-auth all clients */
-		ubus.call(ifaces[notify.data.name].path, 'del_clients');
+		if (ifaces[notify.data.name].path)
+			ubus_async(ifaces[notify.data.name].path, 'del_clients');
 		ifaces[notify.data.name].authenticated = false;
 		flush_iface(notify.data.name);
-		ubus.call('ratelimit', 'device_delete', { device: notify.data.name });
+		ubus_async('ratelimit', 'device_delete', { device: notify.data.name });
 		break;
 	case 'link_up':
 		if (!ifaces[notify.data.name])
 			break;
-		log.syslog(LOG_USER, "starting iface ${notify.data.name}");
+		log.syslog(LOG_USER, `starting iface ${notify.data.name}`);
 		hostapd_start(notify.data.name);
 		break;
 	};
@@ -230,9 +312,13 @@ function prepare_ifaces() {
 		ifaces[port.iface] ??= {};
 		ifaces[port.iface].active = true;
 		ifaces[port.iface].authenticated = false;
+		ifaces[port.iface].auth_vlan = null;
 		ifaces[port.iface].default_vlan = +port.vlan;
 		ifaces[port.iface].wan_ports = port.wan_ports;
-		ifaces[port.iface].lladdr = [];
+		ifaces[port.iface].clients = {};
+		ifaces[port.iface].wan_vlans = {};
+		ifaces[port.iface].mac_auth = {};
+		neigh_load(port.iface);
 	}
 
 	for (let iface, v in ifaces) {
@@ -240,6 +326,7 @@ function prepare_ifaces() {
 			continue;
 		ubus.call('hostapd', 'config_remove', { iface });
 		delete ifaces[iface];
+		delete hostapd_confs[iface];
 		system('ifconfig ' + iface + ' down');
 	}
 }
@@ -255,7 +342,9 @@ function shutdown() {
 	for (let iface, v in ifaces) {
 		log.syslog(LOG_USER, "shutdown");
 		ubus.call('hostapd', 'config_remove', { iface });
-		netifd_handle_iface(iface, false);
+		/* uloop is gone, so these calls have to be synchronous */
+		ubus.call('network.device', 'set_state', { name: iface, auth_status: false, auth_vlans: [ v.default_vlan + ':u' ] });
+		v.authenticated = false;
 		flush_iface(iface);
 		ubus.call('ratelimit', 'device_delete', { device: iface });
 	}
@@ -284,13 +373,37 @@ let ubus_methods = {
 	},
 };
 
-/* handle rtnl events for carrier-down events */
+/* track the neighbours of our ports and trigger MAC auth for new ones */
 function rtnl_cb(msg) {
-	if (msg.cmd != rtnl.const.RTM_NEWNEIGH)
+	let neigh = msg.msg;
+	let port = ifaces[neigh?.dev];
+	if (!port?.neighs)
 		return;
-	if (!ifaces[msg.msg.dev] || ifaces[msg.msg.dev].authenticated)
+
+	switch (msg.cmd) {
+	case rtnl.const.RTM_DELNEIGH:
+		neigh_del(port, neigh);
 		return;
-	ubus.call(ifaces[msg.msg.dev].path, 'mac_auth', { addr: msg.msg.lladdr });
+
+	case rtnl.const.RTM_NEWNEIGH:
+		if (!neigh.lladdr)
+			return;
+		neigh_add(port, neigh);
+		break;
+
+	default:
+		return;
+	}
+
+	if (port.authenticated || !port.path || port.mac_auth[neigh.lladdr])
+		return;
+
+	/* one request per station in flight, the neighbour may update often */
+	let lladdr = neigh.lladdr;
+	port.mac_auth[lladdr] = true;
+	ubus_async(port.path, 'mac_auth', { addr: lladdr }, () => {
+		delete port.mac_auth[lladdr];
+	});
 }
 
 log.openlog("ieee8021x", log.LOG_PID, log.LOG_USER);
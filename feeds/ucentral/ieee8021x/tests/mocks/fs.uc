@@ -0,0 +1,14 @@
+/* none of the ports exist, so hostapd_start() returns before running ifconfig */
+return {
+	stat: function(path) {
+		return null;
+	},
+
+	access: function(path) {
+		return false;
+	},
+
+	writefile: function(path, data) {
+		return length(data);
+	},
+};
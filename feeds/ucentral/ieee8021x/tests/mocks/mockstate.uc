@@ -0,0 +1,26 @@
+/* state shared between the mocked modules and the replay */
+let ports = [];
+for (let i = 1; i <= 8; i++)
+	push(ports, `lan${i}`);
+
+return {
+	ports,
+	vlan: 100,
+	/* "object.method" -> number of ubus calls */
+	calls: {},
+	/* deferred ubus requests not yet replied to */
+	deferred: [],
+	/* { notify, paths } for every ubus subscriber */
+	subscribers: [],
+	/* the methods of the published ieee8021x object */
+	methods: null,
+	rtnl: {
+		listener: null,
+		dumps: 0,
+		deletes: 0,
+		/* notifications the kernel sends back, delivered on the next tick */
+		events: [],
+	},
+	/* called from uloop.run(), set by the replay */
+	run: null,
+};
@@ -0,0 +1,53 @@
+let mock = require('mockstate');
+
+const RTM_NEWNEIGH = 28;
+const RTM_DELNEIGH = 29;
+const RTM_GETNEIGH = 30;
+
+/* a few neighbours per port that never authenticate */
+function dump(dev) {
+	let port = index(mock.ports, dev);
+	let neighs = [];
+
+	for (let i = 0; i < 4; i++)
+		push(neighs, {
+			dev,
+			family: 2,
+			dst: `192.168.${port}.${i + 200}`,
+			lladdr: sprintf('02:ff:00:%02x:00:%02x', port, i),
+		});
+	return neighs;
+}
+
+return {
+	'const': {
+		RTM_NEWNEIGH,
+		RTM_DELNEIGH,
+		RTM_GETNEIGH,
+		NLM_F_DUMP: 0x300,
+		RTNLGRP_NEIGH: 3,
+	},
+
+	request: function(cmd, flags, payload) {
+		switch (cmd) {
+		case RTM_GETNEIGH:
+			mock.rtnl.dumps++;
+			return dump(payload.dev);
+
+		case RTM_DELNEIGH:
+			mock.rtnl.deletes++;
+			push(mock.rtnl.events, {
+				cmd: RTM_DELNEIGH,
+				msg: { dev: payload.dev, dst: payload.dst, family: payload.family },
+			});
+			return true;
+		}
+
+		return null;
+	},
+
+	listener: function(cb, cmds, groups) {
+		mock.rtnl.listener = cb;
+		return {};
+	},
+};
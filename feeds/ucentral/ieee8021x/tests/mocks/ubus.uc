@@ -0,0 +1,56 @@
+let mock = require('mockstate');
+
+function record(object, method) {
+	let key = `${object}.${method}`;
+
+	mock.calls[key] = (mock.calls[key] ?? 0) + 1;
+}
+
+return {
+	connect: function() {
+		return {
+			publish: function(name, methods) {
+				mock.methods = methods;
+				return {};
+			},
+
+			call: function(object, method, args) {
+				record(object, method);
+				return {};
+			},
+
+			defer: function(object, method, args, cb) {
+				record(object, method);
+				push(mock.deferred, { object, method, args, cb });
+				return {};
+			},
+
+			list: function() {
+				let list = [ 'network.device', 'ratelimit' ];
+
+				for (let port in mock.ports)
+					push(list, `hostapd.${port}`);
+				return list;
+			},
+
+			subscriber: function(notify, remove) {
+				let sub = { notify, paths: [] };
+
+				push(mock.subscribers, sub);
+				return {
+					subscribe: function(path) {
+						push(sub.paths, path);
+					},
+				};
+			},
+
+			listener: function(event, cb) {
+				return {};
+			},
+
+			error: function() {
+				return null;
+			},
+		};
+	},
+};
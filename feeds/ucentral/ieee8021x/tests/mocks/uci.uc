@@ -0,0 +1,29 @@
+let mock = require('mockstate');
+
+function main() {
+	return {
+		'.type': 'config',
+		auth_server_addr: '127.0.0.1',
+		auth_server_port: '1812',
+		auth_server_secret: 'secret',
+		ca: '/etc/ieee8021x/ca.pem',
+		cert: '/etc/ieee8021x/cert.pem',
+		key: '/etc/ieee8021x/key.pem',
+	};
+}
+
+return {
+	cursor: function() {
+		return {
+			get_all: function(config, section) {
+				if (section)
+					return main();
+
+				let all = { main: main() };
+				for (let i, port in mock.ports)
+					all[`port${i}`] = { '.type': 'port', iface: port, vlan: `${mock.vlan}` };
+				return all;
+			},
+		};
+	},
+};
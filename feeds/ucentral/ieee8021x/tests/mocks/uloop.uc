@@ -0,0 +1,14 @@
+let mock = require('mockstate');
+
+return {
+	init: function() {
+		return true;
+	},
+
+	run: function() {
+		mock.run();
+	},
+
+	done: function() {
+	},
+};
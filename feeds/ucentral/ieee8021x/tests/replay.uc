@@ -0,0 +1,149 @@
+// Replays auth/deauth events into ieee8021x.uc against mocked ubus, uci,
+// rtnl and uloop modules, checks the calls it makes and reports the time
+// it took to process them.
+
+const EVENTS = 1000;
+const CLIENTS = 16;
+const AF_INET = 2;
+
+unshift(REQUIRE_SEARCH_PATH, sourcepath(0, true) + '/mocks/*.uc');
+
+let mock = require('mockstate');
+let failures = 0;
+
+function check(cond, msg) {
+	if (cond) {
+		print(`ok: ${msg}\n`);
+	} else {
+		print(`FAIL: ${msg}\n`);
+		failures++;
+	}
+}
+
+function subscriber(path) {
+	for (let sub in mock.subscribers)
+		if (index(sub.paths, path) >= 0)
+			return sub.notify;
+	return null;
+}
+
+function calls(method) {
+	let n = 0;
+
+	for (let key, count in mock.calls)
+		if (substr(key, -length(method) - 1) == '.' + method)
+			n += count;
+	return n;
+}
+
+/* what uloop does between two events: rtnl notifications and ubus replies */
+function tick() {
+	while (length(mock.deferred) || length(mock.rtnl.events)) {
+		let events = mock.rtnl.events;
+		let replies = mock.deferred;
+
+		mock.rtnl.events = [];
+		mock.deferred = [];
+		for (let event in events)
+			mock.rtnl.listener(event);
+		for (let reply in replies)
+			reply.cb(0);
+	}
+}
+
+function elapsed_us(start) {
+	let now = clock(true);
+
+	return (now[0] - start[0]) * 1000000 + int((now[1] - start[1]) / 1000);
+}
+
+function replay() {
+	let hapd = subscriber('hostapd.' + mock.ports[0]);
+	let device = subscriber('network.device');
+	let nports = length(mock.ports);
+	let expect = { set_state: 0, mac_auth: 0, deletes: 0, link_down: 0 };
+	let model = {};
+	let dumps = mock.rtnl.dumps;
+
+	check(hapd && device && mock.rtnl.listener, 'daemon subscribed to hostapd, netifd and rtnl');
+	check(dumps == nports, 'one neighbour dump per port at startup');
+	if (!hapd || !device || !mock.rtnl.listener)
+		exit(1);
+
+	for (let port in mock.ports)
+		model[port] = { auth: false, clients: {} };
+
+	let start = clock(true);
+
+	for (let i = 0; i < EVENTS; i++) {
+		let pi = i % nports;
+		let port = mock.ports[pi];
+		let m = model[port];
+
+		if (i % 4 == 3) {
+			/* deauth: the port goes down and all its clients with it */
+			device({ type: 'link_down', data: { name: port } });
+			expect.deletes += length(m.clients);
+			expect.link_down++;
+			m.clients = {};
+			m.auth = false;
+		} else {
+			/* a station shows up, its entry is refreshed before mac_auth returns */
+			let c = int(i / nports) % CLIENTS;
+			let lladdr = sprintf('02:00:00:%02x:00:%02x', pi, c);
+			let neigh = { dev: port, lladdr, dst: `10.${pi}.0.${c + 1}`, family: AF_INET };
+
+			for (let n = 0; n < 2; n++)
+				mock.rtnl.listener({ cmd: 28, msg: neigh });
+			if (!m.auth)
+				expect.mac_auth++;
+
+			hapd({ type: 'sta-authorized', data: { ifname: port, address: lladdr } });
+			if (!m.auth)
+				expect.set_state++;
+			m.auth = true;
+			m.clients[lladdr] = true;
+		}
+
+		tick();
+	}
+
+	let us = elapsed_us(start);
+
+	print(`replay: ${EVENTS} auth/deauth events on ${nports} ports in ${us / 1000.0} ms, ${us / EVENTS} us/event\n`);
+
+	check(mock.rtnl.dumps == dumps, 'no neighbour dumps while replaying');
+	check(mock.rtnl.deletes == expect.deletes,
+	      `${expect.deletes} neighbour deletes, one per authorized client (got ${mock.rtnl.deletes})`);
+	check(mock.calls['network.device.set_state'] == expect.set_state,
+	      `${expect.set_state} set_state calls, only on a change (got ${mock.calls['network.device.set_state']})`);
+	check(calls('mac_auth') == expect.mac_auth,
+	      `${expect.mac_auth} mac_auth calls, one per station in flight (got ${calls('mac_auth')})`);
+	check(calls('del_clients') == expect.link_down &&
+	      mock.calls['ratelimit.device_delete'] == expect.link_down,
+	      `del_clients and device_delete once per link down`);
+	check(!calls('client_delete'), 'no per client ratelimit calls');
+
+	let ifaces = mock.methods.dump.call();
+	let consistent = true;
+	for (let port, m in model) {
+		let iface = ifaces[port];
+
+		if (iface.authenticated != m.auth ||
+		    join(',', sort(keys(iface.clients))) != join(',', sort(keys(m.clients))))
+			consistent = false;
+
+		/* confirmed deletes leave only the neighbours of current clients */
+		for (let lladdr in keys(iface.neighs))
+			if (substr(lladdr, 0, 5) == '02:00' && !m.clients[lladdr])
+				consistent = false;
+	}
+	check(consistent, 'port and client tables match the replayed events');
+
+	if (failures)
+		exit(1);
+}
+
+mock.run = replay;
+
+include('../files/usr/bin/ieee8021x.uc');
@@ -1,11 +1,49 @@
 #!/bin/sh
 
 . /lib/functions.sh
+. /usr/share/libubox/jshn.sh
 
-load() {
-	INTERFACE=$1 ACTION=ifup . /etc/hotplug.d/iface/80-dataplane
+add_program() {
+	local cfg=$1
+	local type program
+
+	config_get type $cfg type ingress
+	config_get program $cfg program
+	[ -n "$program" ] || return
+
+	json_add_object $cfg
+	json_add_string type "$type"
+	json_add_string path "$program"
+	json_close_object
+}
+
+add_program_name() {
+	json_add_string "" "$1"
+}
+
+add_interface() {
+	local cfg=$1
+	local dev
+
+	dev=$(ubus call network.interface.$cfg status 2> /dev/null | jsonfilter -e '@.l3_device')
+	[ -n "$dev" ] || return
+
+	json_add_object $cfg
+	json_add_string device "$dev"
+	json_add_array programs
+	config_list_foreach $cfg program add_program_name
+	json_close_array
+	json_close_object
 }
 
 config_load dataplane
-config_foreach load interface
 
+json_init
+json_add_object programs
+config_foreach add_program program
+json_close_object
+json_add_object interfaces
+config_foreach add_interface interface
+json_close_object
+
+ubus call dataplane config "$(json_dump)"
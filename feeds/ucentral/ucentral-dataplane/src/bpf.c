@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <sys/resource.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dataplane.h"
+
+#ifndef DATAPLANE_PIN_PATH
+#define DATAPLANE_PIN_PATH	"/sys/fs/bpf/dataplane"
+#endif
+
+static const char * const dir_name[__DATAPLANE_DIR_MAX] = {
+	[DATAPLANE_INGRESS] = "in",
+	[DATAPLANE_EGRESS] = "out",
+};
+
+static int stats_fd = -1;
+
+static int dataplane_bpf_pr(enum libbpf_print_level level, const char *format,
+			    va_list args)
+{
+	return vfprintf(stderr, format, args);
+}
+
+int dataplane_bpf_init(void)
+{
+	struct rlimit limit = {
+		.rlim_cur = RLIM_INFINITY,
+		.rlim_max = RLIM_INFINITY,
+	};
+
+	libbpf_set_print(dataplane_bpf_pr);
+	setrlimit(RLIMIT_MEMLOCK, &limit);
+
+	/* run_cnt and run_time_ns are only accounted while this fd is open */
+	stats_fd = bpf_enable_stats(BPF_STATS_RUN_TIME);
+	if (stats_fd < 0)
+		ULOG_WARN("Failed to enable program statistics: %s\n",
+			  strerror(errno));
+
+	return 0;
+}
+
+void dataplane_bpf_done(void)
+{
+	if (stats_fd >= 0)
+		close(stats_fd);
+	stats_fd = -1;
+}
+
+int dataplane_bpf_prog_load(struct dataplane_program *prog)
+{
+	DECLARE_LIBBPF_OPTS(bpf_object_open_opts, opts);
+	struct bpf_program *p, *cur;
+	struct bpf_object *obj;
+	int err;
+
+	obj = bpf_object__open_file(prog->path, &opts);
+	err = libbpf_get_error(obj);
+	if (err) {
+		ULOG_ERR("Failed to open %s: %s\n", prog->path, strerror(-err));
+		return -1;
+	}
+
+	/* like tc, use the first program of the object as classifier */
+	p = bpf_object__next_program(obj, NULL);
+	if (!p) {
+		ULOG_ERR("No program found in %s\n", prog->path);
+		goto error;
+	}
+
+	bpf_object__for_each_program(cur, obj)
+		bpf_program__set_autoload(cur, cur == p);
+	bpf_program__set_type(p, BPF_PROG_TYPE_SCHED_CLS);
+
+	err = bpf_object__load(obj);
+	if (err) {
+		ULOG_ERR("Failed to load %s: %s\n", prog->path, strerror(-err));
+		goto error;
+	}
+
+	if (prog->old_obj)
+		bpf_object__close(prog->old_obj);
+	prog->old_obj = prog->obj;
+	prog->obj = obj;
+	prog->fd = bpf_program__fd(p);
+
+	return 0;
+
+error:
+	bpf_object__close(obj);
+	return -1;
+}
+
+/*
+ * The program arrays are pinned, so that the programs keep running if the
+ * daemon goes away without removing the filters. A restarted daemon picks
+ * the pinned maps up again and replaces the stubs in place.
+ */
+int dataplane_bpf_iface_load(struct dataplane_interface *iface)
+{
+	DECLARE_LIBBPF_OPTS(bpf_object_open_opts, opts);
+	struct bpf_program *p;
+	struct bpf_object *obj;
+	struct bpf_map *map;
+	char name[64];
+	int i, d, err;
+
+	obj = bpf_object__open_file(DATAPLANE_PROG_PATH, &opts);
+	err = libbpf_get_error(obj);
+	if (err) {
+		perror("bpf_object__open_file");
+		return -1;
+	}
+
+	bpf_object__for_each_program(p, obj)
+		bpf_program__set_type(p, BPF_PROG_TYPE_SCHED_CLS);
+
+	for (d = 0; d < __DATAPLANE_DIR_MAX; d++) {
+		char path[128];
+
+		snprintf(name, sizeof(name), "progs_%s", dir_name[d]);
+		map = bpf_object__find_map_by_name(obj, name);
+		if (!map) {
+			fprintf(stderr, "Can't find map %s\n", name);
+			goto error;
+		}
+
+		snprintf(path, sizeof(path), DATAPLANE_PIN_PATH "/%s-%s",
+			 interface_name(iface), name);
+		bpf_map__set_pin_path(map, path);
+	}
+
+	err = bpf_object__load(obj);
+	if (err) {
+		perror("bpf_object__load");
+		goto error;
+	}
+
+	for (d = 0; d < __DATAPLANE_DIR_MAX; d++) {
+		snprintf(name, sizeof(name), "progs_%s", dir_name[d]);
+		iface->dir[d].map = bpf_object__find_map_fd_by_name(obj, name);
+
+		for (i = 0; i < DATAPLANE_MAX_PROGS; i++) {
+			snprintf(name, sizeof(name), "dataplane_%s_%d",
+				 dir_name[d], i);
+			p = bpf_object__find_program_by_name(obj, name);
+			if (!p) {
+				fprintf(stderr, "Can't find program %s\n", name);
+				goto error;
+			}
+
+			iface->dir[d].slot[i].stub_fd = bpf_program__fd(p);
+		}
+	}
+	iface->obj = obj;
+
+	return 0;
+
+error:
+	bpf_object__close(obj);
+	return -1;
+}
+
+void dataplane_bpf_iface_free(struct dataplane_interface *iface)
+{
+	struct bpf_map *map;
+
+	if (!iface->obj)
+		return;
+
+	bpf_object__for_each_map(map, iface->obj)
+		if (bpf_map__is_pinned(map))
+			bpf_map__unpin(map, NULL);
+
+	bpf_object__close(iface->obj);
+	iface->obj = NULL;
+}
+
+int dataplane_bpf_set_slot(struct dataplane_interface *iface,
+			   enum dataplane_dir dir, int idx, int prog_fd)
+{
+	uint32_t key = idx;
+
+	if (prog_fd < 0)
+		return bpf_map_delete_elem(iface->dir[dir].map, &key);
+
+	return bpf_map_update_elem(iface->dir[dir].map, &key, &prog_fd, BPF_ANY);
+}
+
+static void
+dataplane_bpf_tc_init(struct dataplane_interface *iface, enum dataplane_dir dir,
+		      int idx, struct bpf_tc_hook *hook, struct bpf_tc_opts *opts)
+{
+	hook->ifindex = iface->ifindex;
+	hook->attach_point = dir == DATAPLANE_EGRESS ? BPF_TC_EGRESS : BPF_TC_INGRESS;
+	opts->handle = 1;
+	opts->priority = DATAPLANE_PRIO_BASE + idx;
+}
+
+/* replaces any filter left in the slot's place, there is no window without one */
+int dataplane_bpf_attach(struct dataplane_interface *iface,
+			 enum dataplane_dir dir, int idx)
+{
+	DECLARE_LIBBPF_OPTS(bpf_tc_hook, hook);
+	DECLARE_LIBBPF_OPTS(bpf_tc_opts, attach_tc,
+			    .flags = BPF_TC_F_REPLACE,
+			    .prog_fd = iface->dir[dir].slot[idx].stub_fd);
+
+	dataplane_bpf_tc_init(iface, dir, idx, &hook, &attach_tc);
+	bpf_tc_hook_create(&hook);
+
+	return bpf_tc_attach(&hook, &attach_tc);
+}
+
+void dataplane_bpf_detach(struct dataplane_interface *iface,
+			  enum dataplane_dir dir, int idx)
+{
+	DECLARE_LIBBPF_OPTS(bpf_tc_hook, hook);
+	DECLARE_LIBBPF_OPTS(bpf_tc_opts, attach_tc);
+
+	dataplane_bpf_tc_init(iface, dir, idx, &hook, &attach_tc);
+	bpf_tc_detach(&hook, &attach_tc);
+}
+
+int dataplane_bpf_prog_stats(int fd, uint64_t *run_cnt, uint64_t *run_ns)
+{
+	struct bpf_prog_info info = {};
+	uint32_t len = sizeof(info);
+
+	*run_cnt = *run_ns = 0;
+	if (fd < 0 || bpf_obj_get_info_by_fd(fd, &info, &len))
+		return -1;
+
+	*run_cnt = info.run_cnt;
+	*run_ns = info.run_time_ns;
+
+	return 0;
+}
@@ -0,0 +1,292 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libubox/avl-cmp.h>
+
+#include "dataplane.h"
+
+AVL_TREE(programs, avl_strcmp, false, NULL);
+AVL_TREE(interfaces, avl_strcmp, false, NULL);
+
+static bool
+program_file_changed(struct dataplane_program *prog, const struct stat *st)
+{
+	return prog->st_dev != st->st_dev ||
+	       prog->st_ino != st->st_ino ||
+	       prog->st_size != st->st_size ||
+	       prog->st_mtim.tv_sec != st->st_mtim.tv_sec ||
+	       prog->st_mtim.tv_nsec != st->st_mtim.tv_nsec;
+}
+
+static void
+program_free(struct dataplane_program *prog)
+{
+	avl_delete(&programs, &prog->node);
+	if (prog->old_obj)
+		bpf_object__close(prog->old_obj);
+	if (prog->obj)
+		bpf_object__close(prog->obj);
+	free(prog->path);
+	free(prog);
+}
+
+/*
+ * (Re)load the program if its file changed. A program that fails to load
+ * keeps the previous version running, one whose file is gone is dropped
+ * from the chains.
+ */
+void dataplane_program_set(const char *name, const char *path,
+			   enum dataplane_dir dir)
+{
+	struct dataplane_program *prog;
+	char *name_buf;
+	struct stat st;
+
+	prog = avl_find_element(&programs, name, prog, node);
+	if (!prog) {
+		prog = calloc_a(sizeof(*prog), &name_buf, strlen(name) + 1);
+		prog->node.key = strcpy(name_buf, name);
+		prog->fd = -1;
+		avl_insert(&programs, &prog->node);
+	}
+
+	prog->seen = true;
+	prog->dir = dir;
+
+	if (stat(path, &st)) {
+		ULOG_WARN("Program %s: %s: %s\n", name, path, strerror(errno));
+		if (prog->old_obj)
+			bpf_object__close(prog->old_obj);
+		prog->old_obj = prog->obj;
+		prog->obj = NULL;
+		prog->fd = -1;
+		return;
+	}
+
+	if (prog->obj && prog->path && !strcmp(prog->path, path) &&
+	    !program_file_changed(prog, &st))
+		return;
+
+	free(prog->path);
+	prog->path = strdup(path);
+
+	if (dataplane_bpf_prog_load(prog))
+		return;
+
+	prog->st_dev = st.st_dev;
+	prog->st_ino = st.st_ino;
+	prog->st_size = st.st_size;
+	prog->st_mtim = st.st_mtim;
+	ULOG_INFO("Loaded program %s from %s\n", name, path);
+}
+
+static void
+interface_detach(struct dataplane_interface *iface)
+{
+	int d, i;
+
+	for (d = 0; d < __DATAPLANE_DIR_MAX; d++) {
+		for (i = 0; i < iface->dir[d].n_attached; i++)
+			dataplane_bpf_detach(iface, d, i);
+		iface->dir[d].n_attached = 0;
+	}
+}
+
+static void
+interface_free(struct dataplane_interface *iface)
+{
+	if (iface->ifindex)
+		interface_detach(iface);
+	dataplane_bpf_iface_free(iface);
+	avl_delete(&interfaces, &iface->node);
+	free(iface->programs);
+	free(iface);
+}
+
+void dataplane_interface_set(const char *name, const char *device,
+			     struct blob_attr *programs)
+{
+	struct dataplane_interface *iface;
+	char *name_buf;
+	int d, i;
+
+	iface = avl_find_element(&interfaces, name, iface, node);
+	if (!iface) {
+		iface = calloc_a(sizeof(*iface), &name_buf, strlen(name) + 1);
+		iface->node.key = strcpy(name_buf, name);
+		for (d = 0; d < __DATAPLANE_DIR_MAX; d++)
+			for (i = 0; i < DATAPLANE_MAX_PROGS; i++)
+				iface->dir[d].slot[i].prog_fd = -1;
+		avl_insert(&interfaces, &iface->node);
+	}
+
+	iface->seen = true;
+	strncpy(iface->device, device, sizeof(iface->device) - 1);
+
+	if (!blob_attr_equal(iface->programs, programs)) {
+		free(iface->programs);
+		iface->programs = programs ? blob_memdup(programs) : NULL;
+	}
+}
+
+static void
+interface_set_slot(struct dataplane_interface *iface, enum dataplane_dir dir,
+		   int idx, struct dataplane_program *prog)
+{
+	struct dataplane_slot *slot = &iface->dir[dir].slot[idx];
+	int fd = prog ? prog->fd : -1;
+
+	slot->prog = prog;
+	if (slot->prog_fd == fd)
+		return;
+
+	if (dataplane_bpf_set_slot(iface, dir, idx, fd) && fd >= 0) {
+		ULOG_ERR("Interface %s: failed to set program %s: %s\n",
+			 interface_name(iface), program_name(prog),
+			 strerror(errno));
+		return;
+	}
+
+	slot->prog_fd = fd;
+	dataplane_bpf_prog_stats(slot->stub_fd, &slot->base_cnt, &slot->base_ns);
+}
+
+static void
+interface_apply_dir(struct dataplane_interface *iface, enum dataplane_dir dir,
+		    bool fresh)
+{
+	struct dataplane_program *chain[DATAPLANE_MAX_PROGS];
+	struct blob_attr *cur;
+	int i, n = 0, rem;
+
+	blobmsg_for_each_attr(cur, iface->programs, rem) {
+		struct dataplane_program *prog;
+
+		prog = avl_find_element(&programs, blobmsg_get_string(cur),
+					prog, node);
+		if (!prog || prog->dir != dir || prog->fd < 0)
+			continue;
+
+		if (n == DATAPLANE_MAX_PROGS) {
+			ULOG_WARN("Interface %s: more than %d programs\n",
+				  interface_name(iface), DATAPLANE_MAX_PROGS);
+			break;
+		}
+
+		chain[n++] = prog;
+	}
+
+	/*
+	 * Fill the slots before adding filters for them and drop the filters
+	 * before emptying their slots, every replacement is a single map
+	 * update. Filters already added by this process stay, after a fresh
+	 * load every used slot gets one, replacing what a previous instance
+	 * may have left at the same priority.
+	 */
+	for (i = 0; i < n; i++) {
+		interface_set_slot(iface, dir, i, chain[i]);
+		if ((fresh || i >= iface->dir[dir].n_attached) &&
+		    dataplane_bpf_attach(iface, dir, i))
+			ULOG_ERR("Interface %s: failed to attach to %s\n",
+				 interface_name(iface), iface->device);
+	}
+
+	for (i = n; i < iface->dir[dir].n_attached; i++)
+		dataplane_bpf_detach(iface, dir, i);
+	iface->dir[dir].n_attached = n;
+
+	for (i = n; i < DATAPLANE_MAX_PROGS; i++)
+		interface_set_slot(iface, dir, i, NULL);
+}
+
+static void
+interface_apply(struct dataplane_interface *iface)
+{
+	int ifindex = if_nametoindex(iface->device);
+	bool fresh = false;
+	int d, i;
+
+	/* refilled below, the programs may be gone while the device is down */
+	for (d = 0; d < __DATAPLANE_DIR_MAX; d++)
+		for (i = 0; i < DATAPLANE_MAX_PROGS; i++)
+			iface->dir[d].slot[i].prog = NULL;
+
+	if (ifindex != iface->ifindex) {
+		if (iface->ifindex)
+			interface_detach(iface);
+		iface->ifindex = ifindex;
+	}
+
+	if (!iface->ifindex)
+		return;
+
+	if (!iface->obj) {
+		if (dataplane_bpf_iface_load(iface))
+			return;
+
+		/*
+		 * the pinned maps and the filters may still be set up by a
+		 * previous instance, clean up all slots that are not used.
+		 * A prog_fd of -2 never matches, so every slot gets written,
+		 * and the used ones get their filter (re)attached.
+		 */
+		fresh = true;
+		for (d = 0; d < __DATAPLANE_DIR_MAX; d++) {
+			iface->dir[d].n_attached = DATAPLANE_MAX_PROGS;
+			for (i = 0; i < DATAPLANE_MAX_PROGS; i++)
+				iface->dir[d].slot[i].prog_fd = -2;
+		}
+	}
+
+	for (d = 0; d < __DATAPLANE_DIR_MAX; d++)
+		interface_apply_dir(iface, d, fresh);
+}
+
+void dataplane_config_begin(void)
+{
+	struct dataplane_interface *iface;
+	struct dataplane_program *prog;
+
+	avl_for_each_element(&programs, prog, node)
+		prog->seen = false;
+	avl_for_each_element(&interfaces, iface, node)
+		iface->seen = false;
+}
+
+void dataplane_config_end(void)
+{
+	struct dataplane_interface *iface, *itmp;
+	struct dataplane_program *prog, *ptmp;
+
+	avl_for_each_element_safe(&interfaces, iface, node, itmp) {
+		if (iface->seen)
+			interface_apply(iface);
+		else
+			interface_free(iface);
+	}
+
+	/* no slot refers to the replaced or removed programs anymore */
+	avl_for_each_element_safe(&programs, prog, node, ptmp) {
+		if (!prog->seen) {
+			program_free(prog);
+			continue;
+		}
+
+		if (prog->old_obj)
+			bpf_object__close(prog->old_obj);
+		prog->old_obj = NULL;
+	}
+}
+
+void dataplane_done(void)
+{
+	struct dataplane_interface *iface, *itmp;
+	struct dataplane_program *prog, *ptmp;
+
+	avl_for_each_element_safe(&interfaces, iface, node, itmp)
+		interface_free(iface);
+	avl_for_each_element_safe(&programs, prog, node, ptmp)
+		program_free(prog);
+}
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Dispatcher attached to each device. Every slot of the program chain has
+ * its own tc filter running a stub that tail calls into the program array,
+ * so the configured programs can be swapped with a single map update while
+ * the filters stay in place.
+ */
+#define KBUILD_MODNAME "dataplane"
+#include <uapi/linux/bpf.h>
+#include <uapi/linux/pkt_cls.h>
+#include <bpf/bpf_helpers.h>
+#include "dataplane-bpf.h"
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PROG_ARRAY);
+	__uint(key_size, sizeof(uint32_t));
+	__uint(value_size, sizeof(uint32_t));
+	__uint(max_entries, DATAPLANE_MAX_PROGS);
+} progs_in SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PROG_ARRAY);
+	__uint(key_size, sizeof(uint32_t));
+	__uint(value_size, sizeof(uint32_t));
+	__uint(max_entries, DATAPLANE_MAX_PROGS);
+} progs_out SEC(".maps");
+
+/* an empty slot passes the packet on to the next filter */
+#define DATAPLANE_SLOT(_dir, _n)				\
+SEC("tc/" #_dir)						\
+int dataplane_##_dir##_##_n(struct __sk_buff *skb)		\
+{								\
+	bpf_tail_call(skb, &progs_##_dir, _n);			\
+	return TC_ACT_UNSPEC;					\
+}
+
+#define DATAPLANE_SLOTS(_dir)					\
+	DATAPLANE_SLOT(_dir, 0)					\
+	DATAPLANE_SLOT(_dir, 1)					\
+	DATAPLANE_SLOT(_dir, 2)					\
+	DATAPLANE_SLOT(_dir, 3)					\
+	DATAPLANE_SLOT(_dir, 4)					\
+	DATAPLANE_SLOT(_dir, 5)					\
+	DATAPLANE_SLOT(_dir, 6)					\
+	DATAPLANE_SLOT(_dir, 7)
+
+DATAPLANE_SLOTS(in)
+DATAPLANE_SLOTS(out)
+
+char _license[] SEC("license") = "GPL";
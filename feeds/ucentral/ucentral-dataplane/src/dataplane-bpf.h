@@ -0,0 +1,11 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#ifndef __BPF_DATAPLANE_H
+#define __BPF_DATAPLANE_H
+
+/*
+ * number of programs that can be chained per device and direction, needs to
+ * match the stubs generated by DATAPLANE_SLOTS() in dataplane-bpf.c
+ */
+#define DATAPLANE_MAX_PROGS	8
+
+#endif
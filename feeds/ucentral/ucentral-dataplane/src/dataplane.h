@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#ifndef __DATAPLANE_H
+#define __DATAPLANE_H
+
+#include <sys/stat.h>
+#include <net/if.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+#include <libubox/utils.h>
+#include <libubox/avl.h>
+#include <libubox/blobmsg.h>
+#include <libubox/ulog.h>
+
+#include "dataplane-bpf.h"
+
+#ifndef DATAPLANE_PROG_PATH
+#define DATAPLANE_PROG_PATH	"/lib/bpf/dataplane-bpf.o"
+#endif
+
+#define DATAPLANE_PRIO_BASE	0x100
+
+enum dataplane_dir {
+	DATAPLANE_INGRESS,
+	DATAPLANE_EGRESS,
+	__DATAPLANE_DIR_MAX
+};
+
+struct dataplane_program {
+	struct avl_node node;
+
+	char *path;
+	enum dataplane_dir dir;
+	bool seen;
+
+	/* identifies the file the program was loaded from */
+	dev_t st_dev;
+	ino_t st_ino;
+	off_t st_size;
+	struct timespec st_mtim;
+
+	struct bpf_object *obj;
+	/* replaced object, closed once all slots point to the new one */
+	struct bpf_object *old_obj;
+	int fd;
+};
+
+struct dataplane_slot {
+	struct dataplane_program *prog;
+	int prog_fd;
+	int stub_fd;
+
+	/* stub stats at the time the current program was put in the slot */
+	uint64_t base_cnt;
+	uint64_t base_ns;
+};
+
+struct dataplane_interface {
+	struct avl_node node;
+
+	char device[IFNAMSIZ];
+	int ifindex;
+	bool seen;
+
+	struct blob_attr *programs;
+
+	struct bpf_object *obj;
+	struct {
+		int map;
+		int n_attached;
+		struct dataplane_slot slot[DATAPLANE_MAX_PROGS];
+	} dir[__DATAPLANE_DIR_MAX];
+};
+
+extern struct avl_tree programs;
+extern struct avl_tree interfaces;
+
+static inline const char *program_name(struct dataplane_program *prog)
+{
+	return prog->node.key;
+}
+
+static inline const char *interface_name(struct dataplane_interface *iface)
+{
+	return iface->node.key;
+}
+
+int dataplane_bpf_init(void);
+void dataplane_bpf_done(void);
+int dataplane_bpf_prog_load(struct dataplane_program *prog);
+int dataplane_bpf_iface_load(struct dataplane_interface *iface);
+void dataplane_bpf_iface_free(struct dataplane_interface *iface);
+int dataplane_bpf_set_slot(struct dataplane_interface *iface,
+			   enum dataplane_dir dir, int idx, int prog_fd);
+int dataplane_bpf_attach(struct dataplane_interface *iface,
+			 enum dataplane_dir dir, int idx);
+void dataplane_bpf_detach(struct dataplane_interface *iface,
+			  enum dataplane_dir dir, int idx);
+int dataplane_bpf_prog_stats(int fd, uint64_t *run_cnt, uint64_t *run_ns);
+
+void dataplane_config_begin(void);
+void dataplane_program_set(const char *name, const char *path,
+			   enum dataplane_dir dir);
+void dataplane_interface_set(const char *name, const char *device,
+			     struct blob_attr *programs);
+void dataplane_config_end(void);
+void dataplane_done(void);
+
+int dataplane_ubus_init(void);
+void dataplane_ubus_stop(void);
+
+#endif
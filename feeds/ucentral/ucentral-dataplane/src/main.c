@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <stdio.h>
+#include <unistd.h>
+
+#include <libubox/uloop.h>
+
+#include "dataplane.h"
+
+static int usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [options]\n"
+		"Options:\n"
+		"\n", progname);
+
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int ret = 2;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "")) != -1) {
+		switch (ch) {
+		default:
+			return usage(argv[0]);
+		}
+	}
+
+	ulog_open(ULOG_SYSLOG, LOG_DAEMON, "dataplane");
+	uloop_init();
+
+	if (dataplane_bpf_init())
+		return 1;
+
+	if (dataplane_ubus_init())
+		goto out;
+
+	ret = 0;
+	uloop_run();
+
+	dataplane_ubus_stop();
+
+out:
+	dataplane_done();
+	dataplane_bpf_done();
+	uloop_done();
+
+	return ret;
+}
@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <string.h>
+
+#include <libubus.h>
+
+#include "dataplane.h"
+
+static struct blob_buf b;
+
+static const char * const dir_name[__DATAPLANE_DIR_MAX] = {
+	[DATAPLANE_INGRESS] = "ingress",
+	[DATAPLANE_EGRESS] = "egress",
+};
+
+enum {
+	CONFIG_ATTR_PROGRAMS,
+	CONFIG_ATTR_INTERFACES,
+	__CONFIG_ATTR_MAX,
+};
+
+static const struct blobmsg_policy config_policy[__CONFIG_ATTR_MAX] = {
+	[CONFIG_ATTR_PROGRAMS] = { "programs", BLOBMSG_TYPE_TABLE },
+	[CONFIG_ATTR_INTERFACES] = { "interfaces", BLOBMSG_TYPE_TABLE },
+};
+
+enum {
+	PROG_ATTR_PATH,
+	PROG_ATTR_TYPE,
+	__PROG_ATTR_MAX,
+};
+
+static const struct blobmsg_policy prog_policy[__PROG_ATTR_MAX] = {
+	[PROG_ATTR_PATH] = { "path", BLOBMSG_TYPE_STRING },
+	[PROG_ATTR_TYPE] = { "type", BLOBMSG_TYPE_STRING },
+};
+
+enum {
+	IFACE_ATTR_DEVICE,
+	IFACE_ATTR_PROGRAMS,
+	__IFACE_ATTR_MAX,
+};
+
+static const struct blobmsg_policy iface_policy[__IFACE_ATTR_MAX] = {
+	[IFACE_ATTR_DEVICE] = { "device", BLOBMSG_TYPE_STRING },
+	[IFACE_ATTR_PROGRAMS] = { "programs", BLOBMSG_TYPE_ARRAY },
+};
+
+static int
+dataplane_ubus_config(struct ubus_context *ctx, struct ubus_object *obj,
+		      struct ubus_request_data *req, const char *method,
+		      struct blob_attr *msg)
+{
+	struct blob_attr *tb[__CONFIG_ATTR_MAX];
+	struct blob_attr *cur;
+	int rem;
+
+	blobmsg_parse(config_policy, __CONFIG_ATTR_MAX, tb,
+		      blobmsg_data(msg), blobmsg_len(msg));
+
+	blobmsg_for_each_attr(cur, tb[CONFIG_ATTR_INTERFACES], rem) {
+		struct blob_attr *tb_i[__IFACE_ATTR_MAX];
+
+		blobmsg_parse(iface_policy, __IFACE_ATTR_MAX, tb_i,
+			      blobmsg_data(cur), blobmsg_len(cur));
+		if (!tb_i[IFACE_ATTR_DEVICE] ||
+		    (tb_i[IFACE_ATTR_PROGRAMS] &&
+		     blobmsg_check_array(tb_i[IFACE_ATTR_PROGRAMS], BLOBMSG_TYPE_STRING) < 0))
+			return UBUS_STATUS_INVALID_ARGUMENT;
+	}
+
+	dataplane_config_begin();
+
+	blobmsg_for_each_attr(cur, tb[CONFIG_ATTR_PROGRAMS], rem) {
+		struct blob_attr *tb_p[__PROG_ATTR_MAX];
+		enum dataplane_dir dir = DATAPLANE_INGRESS;
+
+		blobmsg_parse(prog_policy, __PROG_ATTR_MAX, tb_p,
+			      blobmsg_data(cur), blobmsg_len(cur));
+		if (!tb_p[PROG_ATTR_PATH])
+			continue;
+
+		if (tb_p[PROG_ATTR_TYPE] &&
+		    !strcmp(blobmsg_get_string(tb_p[PROG_ATTR_TYPE]), "egress"))
+			dir = DATAPLANE_EGRESS;
+
+		dataplane_program_set(blobmsg_name(cur),
+				      blobmsg_get_string(tb_p[PROG_ATTR_PATH]),
+				      dir);
+	}
+
+	blobmsg_for_each_attr(cur, tb[CONFIG_ATTR_INTERFACES], rem) {
+		struct blob_attr *tb_i[__IFACE_ATTR_MAX];
+
+		blobmsg_parse(iface_policy, __IFACE_ATTR_MAX, tb_i,
+			      blobmsg_data(cur), blobmsg_len(cur));
+		dataplane_interface_set(blobmsg_name(cur),
+					blobmsg_get_string(tb_i[IFACE_ATTR_DEVICE]),
+					tb_i[IFACE_ATTR_PROGRAMS]);
+	}
+
+	dataplane_config_end();
+
+	return 0;
+}
+
+/*
+ * Tail called programs are not accounted on their own, the numbers are
+ * taken from the stub of each slot and include its tail call.
+ */
+static void
+dataplane_dump_slot(struct dataplane_slot *slot, uint64_t *run_cnt,
+		    uint64_t *run_ns)
+{
+	dataplane_bpf_prog_stats(slot->stub_fd, run_cnt, run_ns);
+	*run_cnt -= slot->base_cnt;
+	*run_ns -= slot->base_ns;
+}
+
+static int
+dataplane_ubus_status(struct ubus_context *ctx, struct ubus_object *obj,
+		      struct ubus_request_data *req, const char *method,
+		      struct blob_attr *msg)
+{
+	struct dataplane_interface *iface;
+	struct dataplane_program *prog;
+	uint64_t run_cnt, run_ns;
+	void *c, *i, *a, *s;
+	int d, n;
+
+	blob_buf_init(&b, 0);
+
+	c = blobmsg_open_table(&b, "programs");
+	avl_for_each_element(&programs, prog, node) {
+		uint64_t total_cnt = 0, total_ns = 0;
+
+		avl_for_each_element(&interfaces, iface, node) {
+			for (d = 0; d < __DATAPLANE_DIR_MAX; d++) {
+				for (n = 0; n < iface->dir[d].n_attached; n++) {
+					struct dataplane_slot *slot = &iface->dir[d].slot[n];
+
+					if (slot->prog != prog)
+						continue;
+
+					dataplane_dump_slot(slot, &run_cnt, &run_ns);
+					total_cnt += run_cnt;
+					total_ns += run_ns;
+				}
+			}
+		}
+
+		i = blobmsg_open_table(&b, program_name(prog));
+		blobmsg_add_string(&b, "path", prog->path ? prog->path : "");
+		blobmsg_add_string(&b, "type", dir_name[prog->dir]);
+		blobmsg_add_u8(&b, "loaded", prog->fd >= 0);
+		blobmsg_add_u64(&b, "run_cnt", total_cnt);
+		blobmsg_add_u64(&b, "run_time_ns", total_ns);
+		blobmsg_close_table(&b, i);
+	}
+	blobmsg_close_table(&b, c);
+
+	c = blobmsg_open_table(&b, "interfaces");
+	avl_for_each_element(&interfaces, iface, node) {
+		i = blobmsg_open_table(&b, interface_name(iface));
+		blobmsg_add_string(&b, "device", iface->device);
+		blobmsg_add_u32(&b, "ifindex", iface->ifindex);
+
+		for (d = 0; d < __DATAPLANE_DIR_MAX; d++) {
+			a = blobmsg_open_array(&b, dir_name[d]);
+			for (n = 0; n < iface->dir[d].n_attached; n++) {
+				struct dataplane_slot *slot = &iface->dir[d].slot[n];
+
+				if (!slot->prog)
+					continue;
+
+				dataplane_dump_slot(slot, &run_cnt, &run_ns);
+				s = blobmsg_open_table(&b, NULL);
+				blobmsg_add_string(&b, "program", program_name(slot->prog));
+				blobmsg_add_u64(&b, "run_cnt", run_cnt);
+				blobmsg_add_u64(&b, "run_time_ns", run_ns);
+				blobmsg_close_table(&b, s);
+			}
+			blobmsg_close_array(&b, a);
+		}
+		blobmsg_close_table(&b, i);
+	}
+	blobmsg_close_table(&b, c);
+
+	ubus_send_reply(ctx, req, b.head);
+
+	return 0;
+}
+
+static const struct ubus_method dataplane_methods[] = {
+	UBUS_METHOD("config", dataplane_ubus_config, config_policy),
+	UBUS_METHOD_NOARG("status", dataplane_ubus_status),
+};
+
+static struct ubus_object_type dataplane_object_type =
+	UBUS_OBJECT_TYPE("dataplane", dataplane_methods);
+
+static struct ubus_object dataplane_object = {
+	.name = "dataplane",
+	.type = &dataplane_object_type,
+	.methods = dataplane_methods,
+	.n_methods = ARRAY_SIZE(dataplane_methods),
+};
+
+static void
+ubus_connect_handler(struct ubus_context *ctx)
+{
+	ubus_add_object(ctx, &dataplane_object);
+}
+
+static struct ubus_auto_conn conn;
+
+int dataplane_ubus_init(void)
+{
+	conn.cb = ubus_connect_handler;
+	ubus_auto_connect(&conn);
+
+	return 0;
+}
+
+void dataplane_ubus_stop(void)
+{
+	ubus_auto_shutdown(&conn);
+}
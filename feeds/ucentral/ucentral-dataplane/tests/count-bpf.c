@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Passes every packet on and counts it. Tail called programs are not
+ * accounted in their own run_cnt, so the test reads the count from the map.
+ */
+#define KBUILD_MODNAME "count"
+#include <uapi/linux/bpf.h>
+#include <uapi/linux/pkt_cls.h>
+#include <bpf/bpf_helpers.h>
+
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(key_size, sizeof(uint32_t));
+	__uint(value_size, sizeof(uint64_t));
+	__uint(max_entries, 1);
+} runs SEC(".maps");
+
+SEC("tc")
+int count(struct __sk_buff *skb)
+{
+	uint32_t key = 0;
+	uint64_t *cnt;
+
+	cnt = bpf_map_lookup_elem(&runs, &key);
+	if (cnt)
+		__sync_fetch_and_add(cnt, 1);
+
+	return TC_ACT_UNSPEC;
+}
+
+char _license[] SEC("license") = "GPL";
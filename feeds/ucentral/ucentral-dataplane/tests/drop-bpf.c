@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Drops the frames the test sends, with the local experimental ethertype,
+ * and counts them. Everything else is passed on.
+ */
+#define KBUILD_MODNAME "drop"
+#include <uapi/linux/bpf.h>
+#include <uapi/linux/if_ether.h>
+#include <uapi/linux/pkt_cls.h>
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_endian.h>
+
+#define ETH_P_TEST	0x88b5
+
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(key_size, sizeof(uint32_t));
+	__uint(value_size, sizeof(uint64_t));
+	__uint(max_entries, 1);
+} runs SEC(".maps");
+
+SEC("tc")
+int drop(struct __sk_buff *skb)
+{
+	uint32_t key = 0;
+	uint16_t proto;
+	uint64_t *cnt;
+
+	if (bpf_skb_load_bytes(skb, 2 * ETH_ALEN, &proto, sizeof(proto)) ||
+	    proto != bpf_htons(ETH_P_TEST))
+		return TC_ACT_UNSPEC;
+
+	cnt = bpf_map_lookup_elem(&runs, &key);
+	if (cnt)
+		__sync_fetch_and_add(cnt, 1);
+
+	return TC_ACT_SHOT;
+}
+
+char _license[] SEC("license") = "GPL";
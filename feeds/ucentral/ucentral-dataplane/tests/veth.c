@@ -0,0 +1,409 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Runs the dataplane against a veth pair in a scratch network namespace and
+ * checks the tc filters, the stubs behind them and that the chained programs
+ * see traffic.
+ *
+ * A first instance runs in a child that exits without cleaning up, like a
+ * crashed daemon, and leaves its filters and pinned program arrays behind.
+ * The parent then starts over with a shorter chain on the same device: every
+ * used slot must point to the new instance's stubs and the filters of the
+ * slots no longer used must be gone.
+ *
+ * Last, a sender keeps frames flowing out of the device while the egress
+ * chain is reloaded and its only program is swapped for others that drop
+ * the same frames. Not a single one of them may reach the peer.
+ */
+#define _GNU_SOURCE
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dataplane.h"
+
+#define DEV	"dp0"
+#define PEER	"dp1"
+/* local experimental ethertype */
+#define ETH_P_TEST	0x88b5
+
+static const char *count_path;
+static const char *drop_path;
+static int failures;
+
+static void check(bool cond, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("%s: ", cond ? "ok" : "FAIL");
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf("\n");
+
+	if (!cond)
+		failures++;
+}
+
+/* the config the ubus handler would pass on for the given ingress chain */
+static void apply(const char * const *chain)
+{
+	static struct blob_buf b;
+	void *c;
+
+	blob_buf_init(&b, 0);
+	c = blobmsg_open_array(&b, "programs");
+	for (; *chain; chain++)
+		blobmsg_add_string(&b, NULL, *chain);
+	blobmsg_close_array(&b, c);
+
+	dataplane_config_begin();
+	dataplane_program_set("in0", count_path, DATAPLANE_INGRESS);
+	dataplane_program_set("in1", count_path, DATAPLANE_INGRESS);
+	dataplane_program_set("out0", count_path, DATAPLANE_EGRESS);
+	dataplane_program_set("drop0", drop_path, DATAPLANE_EGRESS);
+	dataplane_program_set("drop1", drop_path, DATAPLANE_EGRESS);
+	dataplane_interface_set("lan", DEV, blob_data(b.head));
+	dataplane_config_end();
+}
+
+static struct dataplane_interface *lan(void)
+{
+	struct dataplane_interface *iface;
+
+	return avl_find_element(&interfaces, "lan", iface, node);
+}
+
+static uint32_t prog_id(int fd)
+{
+	struct bpf_prog_info info = {};
+	uint32_t len = sizeof(info);
+
+	if (fd < 0 || bpf_obj_get_info_by_fd(fd, &info, &len))
+		return 0;
+
+	return info.id;
+}
+
+/* id of the program run by the filter of a slot, 0 if there is none */
+static uint32_t filter_prog_id(enum dataplane_dir dir, int idx)
+{
+	DECLARE_LIBBPF_OPTS(bpf_tc_hook, hook,
+			    .ifindex = if_nametoindex(DEV),
+			    .attach_point = dir == DATAPLANE_EGRESS ?
+					    BPF_TC_EGRESS : BPF_TC_INGRESS);
+	DECLARE_LIBBPF_OPTS(bpf_tc_opts, opts,
+			    .handle = 1,
+			    .priority = DATAPLANE_PRIO_BASE + idx);
+
+	if (bpf_tc_query(&hook, &opts))
+		return 0;
+
+	return opts.prog_id;
+}
+
+static void check_filters(enum dataplane_dir dir, int n, const char *what)
+{
+	struct dataplane_interface *iface = lan();
+	bool attached = true, stale = false;
+	int i;
+
+	for (i = 0; i < DATAPLANE_MAX_PROGS; i++) {
+		uint32_t id = filter_prog_id(dir, i);
+
+		if (i < n && (!iface || !id ||
+			      id != prog_id(iface->dir[dir].slot[i].stub_fd)))
+			attached = false;
+		else if (i >= n && id)
+			stale = true;
+	}
+
+	if (n)
+		check(attached, "%s: %s filters of slots 0-%d run this instance's stubs",
+		      what, dir == DATAPLANE_EGRESS ? "egress" : "ingress", n - 1);
+	check(!stale, "%s: no %s filters from slot %d on", what,
+	      dir == DATAPLANE_EGRESS ? "egress" : "ingress", n);
+}
+
+/*
+ * The kernel only accounts the stub a filter runs, not the program it tail
+ * calls, so the test programs count their runs in a map of their own.
+ */
+static uint64_t prog_runs(const char *name)
+{
+	struct dataplane_program *prog;
+	uint32_t key = 0;
+	uint64_t cnt;
+	int fd;
+
+	prog = avl_find_element(&programs, name, prog, node);
+	if (!prog || !prog->obj)
+		return 0;
+
+	fd = bpf_object__find_map_fd_by_name(prog->obj, "runs");
+	if (fd < 0 || bpf_map_lookup_elem(fd, &key, &cnt))
+		return 0;
+
+	return cnt;
+}
+
+static const unsigned char frame[ETH_ZLEN] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0x02, 0x00, 0x00, 0x00, 0x00, 0x01,
+	ETH_P_TEST >> 8, ETH_P_TEST & 0xff,
+};
+
+static void frame_addr(struct sockaddr_ll *addr, const char *dev)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sll_family = AF_PACKET;
+	addr->sll_protocol = htons(ETH_P_TEST);
+	addr->sll_ifindex = if_nametoindex(dev);
+	addr->sll_halen = ETH_ALEN;
+}
+
+static void send_frame(const char *dev)
+{
+	struct sockaddr_ll addr;
+	int fd;
+
+	fd = socket(AF_PACKET, SOCK_RAW, 0);
+	if (fd < 0)
+		return;
+
+	frame_addr(&addr, dev);
+	sendto(fd, frame, sizeof(frame), 0, (struct sockaddr *)&addr,
+	       sizeof(addr));
+	close(fd);
+}
+
+/* the frame goes through the chain from softirq, give it some time */
+static bool sees_traffic(const char *name, const char *dev)
+{
+	uint64_t cnt = prog_runs(name);
+	int i;
+
+	send_frame(dev);
+	for (i = 0; i < 100; i++) {
+		if (prog_runs(name) > cnt)
+			return true;
+		usleep(10000);
+	}
+
+	return false;
+}
+
+static void first_start(void)
+{
+	static const char * const chain[] = { "in0", "in1", "out0", NULL };
+
+	apply(chain);
+	check_filters(DATAPLANE_INGRESS, 2, "first start");
+	check_filters(DATAPLANE_EGRESS, 1, "first start");
+	check(sees_traffic("in0", PEER) && sees_traffic("in1", PEER),
+	      "first start: ingress chain sees traffic");
+	check(sees_traffic("out0", DEV), "first start: egress chain sees traffic");
+}
+
+static void restart(void)
+{
+	static const char * const chain[] = { "in0", "out0", NULL };
+	static const char * const longer[] = { "in0", "in1", "out0", NULL };
+	uint32_t stale = filter_prog_id(DATAPLANE_INGRESS, 0);
+	uint32_t id;
+
+	check(stale != 0, "previous instance left its filters behind");
+
+	apply(chain);
+	check_filters(DATAPLANE_INGRESS, 1, "restart");
+	check_filters(DATAPLANE_EGRESS, 1, "restart");
+	check(filter_prog_id(DATAPLANE_INGRESS, 0) != stale,
+	      "restart: stale filter replaced");
+	check(sees_traffic("in0", PEER), "restart: ingress chain sees traffic");
+	check(sees_traffic("out0", DEV), "restart: egress chain sees traffic");
+
+	/* the filters of this instance stay in place */
+	id = filter_prog_id(DATAPLANE_INGRESS, 0);
+	apply(chain);
+	check(filter_prog_id(DATAPLANE_INGRESS, 0) == id,
+	      "reload: filter kept");
+
+	apply(longer);
+	check_filters(DATAPLANE_INGRESS, 2, "longer chain");
+	check(sees_traffic("in1", PEER), "longer chain: new slot sees traffic");
+}
+
+static volatile bool sending;
+static unsigned long sent;
+
+static void *sender(void *arg)
+{
+	struct sockaddr_ll addr;
+	int fd;
+
+	fd = socket(AF_PACKET, SOCK_RAW, 0);
+	if (fd < 0)
+		return NULL;
+
+	/* a frame dropped on egress fails with ENOBUFS, count every attempt */
+	frame_addr(&addr, DEV);
+	for (; sending; sent++)
+		sendto(fd, frame, sizeof(frame), 0, (struct sockaddr *)&addr,
+		       sizeof(addr));
+
+	close(fd);
+
+	return NULL;
+}
+
+/* test frames that arrived on the peer since the last call */
+static unsigned int peer_frames(int fd)
+{
+	struct tpacket_stats st = {};
+	socklen_t len = sizeof(st);
+
+	/* includes the frames dropped for a full receive buffer, and resets */
+	if (getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &st, &len))
+		return 0;
+
+	return st.tp_packets;
+}
+
+/* makes the next apply() load the program again, as if its file was replaced */
+static void touch(const char *path)
+{
+	utimensat(AT_FDCWD, path, NULL, 0);
+}
+
+static void filter_under_traffic(void)
+{
+	static const char * const drop0[] = { "in0", "drop0", NULL };
+	static const char * const drop1[] = { "in0", "drop1", NULL };
+	static const char * const pass[] = { "in0", "out0", NULL };
+	struct sockaddr_ll addr;
+	uint64_t dropped;
+	unsigned int leaked;
+	pthread_t thread;
+	int fd, i;
+
+	apply(drop0);
+	check_filters(DATAPLANE_EGRESS, 1, "drop chain");
+
+	fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_TEST));
+	frame_addr(&addr, PEER);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		check(false, "drop chain: listening on the peer");
+		return;
+	}
+	peer_frames(fd);
+
+	sending = true;
+	if (pthread_create(&thread, NULL, sender, NULL)) {
+		check(false, "drop chain: sender started");
+		close(fd);
+		return;
+	}
+
+	for (i = 0; i < 50; i++) {
+		/* unchanged config, reloaded file and a different program */
+		apply(drop0);
+		touch(drop_path);
+		apply(drop0);
+		apply(drop1);
+		touch(drop_path);
+		apply(drop1);
+		apply(drop0);
+	}
+
+	/* give the last program some frames of its own */
+	usleep(50000);
+	sending = false;
+	pthread_join(thread, NULL);
+	/* whatever made it through is on the peer by now */
+	usleep(100000);
+
+	dropped = prog_runs("drop0") + prog_runs("drop1");
+	leaked = peer_frames(fd);
+	check(sent > 0 && dropped > 0,
+	      "drop chain: %lu frames sent across %d reloads, %llu dropped since the last",
+	      sent, 6 * i, (unsigned long long)dropped);
+	check(!leaked, "drop chain: %u unfiltered frames reached the peer", leaked);
+
+	/* the peer does see the frames without the drop program */
+	apply(pass);
+	send_frame(DEV);
+	for (i = 0; i < 100 && !(leaked = peer_frames(fd)); i++)
+		usleep(10000);
+	check(leaked > 0, "pass chain: frames reach the peer");
+
+	close(fd);
+}
+
+static void stop(void)
+{
+	dataplane_done();
+	check_filters(DATAPLANE_INGRESS, 0, "stop");
+	check_filters(DATAPLANE_EGRESS, 0, "stop");
+	check(access("/sys/fs/bpf/dataplane-test/lan-progs_in", F_OK) != 0,
+	      "stop: program arrays unpinned");
+}
+
+int main(int argc, char **argv)
+{
+	int status;
+	pid_t pid;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <count-bpf.o> <drop-bpf.o>\n", argv[0]);
+		return 1;
+	}
+	count_path = argv[1];
+	drop_path = argv[2];
+
+	if (unshare(CLONE_NEWNET)) {
+		perror("unshare");
+		return 1;
+	}
+
+	if (system("ip link add " DEV " type veth peer name " PEER " && "
+		   "ip link set " DEV " up && ip link set " PEER " up")) {
+		fprintf(stderr, "Failed to set up the veth pair\n");
+		return 1;
+	}
+
+	dataplane_bpf_init();
+
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return 1;
+	}
+
+	if (!pid) {
+		/* exits without dataplane_done(), the filters stay */
+		first_start();
+		fflush(stdout);
+		_exit(failures ? 1 : 0);
+	}
+
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status))
+		failures++;
+
+	restart();
+	filter_under_traffic();
+	stop();
+	dataplane_bpf_done();
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,277 @@
+// Runs the ucentral-state daemon against mocked ubus, uci, uloop and fs
+// modules and a fake clock, and checks when its health checks run, how a
+// check that overruns its budget backs off and how remediation escalates.
+
+const RRM_STAMP = '/tmp/rrm_timestamp';
+const RRM_ENABLED = '/etc/rc.d/S99rrmd';
+
+unshift(REQUIRE_SEARCH_PATH, sourcepath(0, true) + '/mocks/*.uc');
+
+let mock = require('mockstate');
+let failures = 0;
+
+function check(cond, msg) {
+	if (cond) {
+		print(`ok: ${msg}\n`);
+	} else {
+		print(`FAIL: ${msg}\n`);
+		failures++;
+	}
+}
+
+function now() {
+	return int(mock.now / 1000);
+}
+
+/* moves the fake clock ahead, firing the timers that fall due on the way */
+function advance(ms) {
+	let end = mock.now + ms;
+
+	while (true) {
+		let next;
+
+		for (let t in mock.timers)
+			if (t.due != null && t.due <= end && (!next || t.due < next.due))
+				next = t;
+		if (!next)
+			break;
+
+		if (mock.now < next.due)
+			mock.now = next.due;
+		next.due = next.periodic ? next.due + next.delay : null;
+		next.cb();
+	}
+
+	if (mock.now < end)
+		mock.now = end;
+}
+
+/* the times of the ubus calls to object.method made since the given time */
+function calls(key, since) {
+	return map(filter(mock.calls[key] ?? [], (c) => c.time >= since), (c) => c.time);
+}
+
+function commands(cmd, since) {
+	return map(filter(mock.commands, (c) => c.cmd == cmd && c.time >= since), (c) => c.time);
+}
+
+function gaps(times) {
+	let ret = [];
+
+	for (let i = 1; i < length(times); i++)
+		push(ret, times[i] - times[i - 1]);
+	return ret;
+}
+
+function logged(msg, since) {
+	for (let i = since; i < length(mock.log); i++)
+		if (index(mock.log[i], msg) >= 0)
+			return true;
+	return false;
+}
+
+function health() {
+	return mock.methods.health.call({ args: {} });
+}
+
+function scheduling() {
+	let start = mock.now;
+
+	mock.files[RRM_ENABLED] = '';
+	mock.files[RRM_STAMP] = `${now()}`;
+
+	advance(4999);
+	check(!length(calls('network.wireless.status', start)), 'no check runs before the first is due');
+
+	advance(1);
+	check(length(calls('network.wireless.status', start)) == 1 && !length(calls('list.rrm', start)),
+	      'wifi check runs 5s after startup');
+
+	advance(5000);
+	check(length(calls('list.rrm', start)) == 1, 'rrm check runs 5s after the wifi check');
+
+	advance(590000);
+	let wifi = calls('network.wireless.status', start);
+	let rrm = calls('list.rrm', start);
+	check(length(wifi) == 20 && length(uniq(gaps(wifi))) == 1 && gaps(wifi)[0] == 30000,
+	      `wifi check runs every 30s (${length(wifi)} runs in 10 minutes)`);
+	check(length(rrm) == 10 && length(uniq(gaps(rrm))) == 1 && gaps(rrm)[0] == 60000,
+	      `rrm check runs every 60s (${length(rrm)} runs in 10 minutes)`);
+
+	check(length(filter(mock.timers, (t) => t.due != null && !t.periodic)) == 1,
+	      'a single timer drives all checks');
+	check(!length(mock.processes), 'no health.uc spawned by the daemon');
+
+	let h = health();
+	check(h.checks.wifi.healthy && h.checks.rrm.healthy && h.checks.wifi.runs == 20 &&
+	      h.checks.rrm.runs == 10 && h.checks.rrm.result.chanutil === true,
+	      'health method reports both checks as healthy');
+	check(!length(filter(mock.commands, (c) => index(c.cmd, 'restart') >= 0)) &&
+	      !length(calls('network.wireless.down', start)),
+	      'no remediation while healthy');
+}
+
+function backoff() {
+	let start = mock.now;
+
+	/* every run of the wifi check overruns its 100ms budget */
+	mock.wireless_delay = 150;
+	advance(1200000);
+
+	let wifi = calls('network.wireless.status', start);
+	let g = gaps(wifi);
+	check(length(g) >= 5 && g[0] == 60150 && g[1] == 120150 && g[2] == 240150 &&
+	      g[3] == 240150 && g[4] == 240150,
+	      `interval doubles on every overrun, up to 8 times (gaps ${g})`);
+
+	let h = health();
+	check(h.checks.wifi.overruns == length(wifi) && h.checks.wifi.interval == 240 &&
+	      h.checks.wifi.latency == 150, 'health method reports the overruns and the interval');
+
+	let rrm = gaps(calls('list.rrm', start));
+	check(length(filter(rrm, (gap) => gap < 60000 || gap > 60150)) == 0,
+	      'rrm check keeps its interval meanwhile');
+
+	/* back within budget */
+	mock.wireless_delay = 0;
+	start = mock.now;
+	advance(300000);
+
+	g = gaps(calls('network.wireless.status', start));
+	check(length(g) && length(uniq(g)) == 1 && g[0] == 30000,
+	      `interval reset once the check runs within budget (gaps ${g})`);
+	check(health().checks.wifi.interval == 30, 'health method reports the reset interval');
+}
+
+function remediation() {
+	let start = mock.now;
+	let log = length(mock.log);
+
+	/* rrmd does not count as running for this part */
+	delete mock.files[RRM_ENABLED];
+
+	/* rrmd just finished a round, so radios are left alone */
+	mock.files[RRM_STAMP] = `${now()}`;
+	mock.hostapd.wlan1 = 'DISABLED';
+	advance(120000);
+	check(!length(calls('network.wireless.down', start)) &&
+	      !length(commands('/etc/init.d/network restart', start)) &&
+	      logged('RRM with Channel utilization may still be in progress', log),
+	      'no remediation while rrmd may be switching channels');
+	check(!health().checks.wifi.healthy && health().checks.wifi.result.radios.radio1,
+	      'health method reports the failed radio');
+
+	delete mock.files[RRM_STAMP];
+	start = mock.now;
+	advance(12030000);
+
+	let down = calls('network.wireless.down', start);
+	let restarts = commands('/etc/init.d/network restart', start);
+	check(length(down) == 1 && mock.calls['network.wireless.down'][0].args.device == 'radio1' &&
+	      length(calls('network.wireless.up', start)) == 1,
+	      'radio restart first, only on the failing radio');
+	check(length(restarts) && restarts[0] - down[0] == 300000,
+	      'network restart 5 minutes after the radio restart');
+
+	let g = map(gaps(restarts), (gap) => gap / 1000);
+	check(length(g) == 6 && g[0] == 300 && g[1] == 600 && g[2] == 1200 && g[3] == 2400 &&
+	      g[4] == 3600 && g[5] == 3600,
+	      `network restarts back off up to an hour (gaps ${g}s)`);
+
+	let r = health().remediation['wifi.radio1'];
+	check(r?.attempts == 8 && r?.action == 'network restart' && r?.backoff == 3600,
+	      'health method reports the remediation state');
+
+	/* healthy again, remediation starts over */
+	log = length(mock.log);
+	mock.hostapd.wlan1 = 'ENABLED';
+	advance(30000);
+	check(!length(keys(health().remediation)) &&
+	      logged('Self-healing of wifi.radio1 complete after 8 attempts', log),
+	      'remediation cleared once the radio is healthy');
+
+	start = mock.now;
+	mock.hostapd.wlan1 = 'DISABLED';
+	advance(30000);
+	check(length(calls('network.wireless.down', start)) == 1 &&
+	      !length(commands('/etc/init.d/network restart', start)),
+	      'next failure starts over with a radio restart');
+
+	mock.hostapd.wlan1 = 'ENABLED';
+	advance(30000);
+}
+
+function rrm() {
+	const restart = '/etc/init.d/rrmd restart';
+	let start = mock.now;
+	let log = length(mock.log);
+
+	mock.files[RRM_ENABLED] = '';
+	mock.files[RRM_STAMP] = `${now() - 200}`;
+
+	/* rrmd is gone from ubus */
+	mock.rrm_up = false;
+	advance(60000);
+	check(length(commands(restart, start)) == 1 && logged('RRM is not responding', log),
+	      'rrmd restarted once its ubus object is gone');
+
+	/* rrmd starts its first chanutil round 20s later */
+	advance(20000);
+	mock.files[RRM_STAMP] = `${now()}`;
+	start = mock.now;
+	log = length(mock.log);
+
+	advance(4200000);
+	check(!length(commands(restart, start)), 'no restart while the chanutil stamp is recent');
+	check(health().checks.rrm.healthy && !length(keys(health().remediation)),
+	      'rrm healthy again, its remediation cleared');
+
+	advance(60000);
+	check(length(commands(restart, start)) == 1 && logged('RRM with Channel utilization abnormal', log),
+	      'rrmd restarted once the chanutil stamp is older than the interval and the grace period');
+
+	/* the restart removed the stamp and rrmd never writes a new one */
+	start = mock.now;
+	advance(680000);
+	check(!length(commands(restart, start)), 'no restart within the grace period after a restart');
+	advance(60000);
+	check(length(commands(restart, start)) == 1, 'rrmd restarted once no stamp showed up in the grace period');
+
+	/* without a threshold the policy does nothing, so no stamp is expected */
+	mock.uci.rrm.chanutil.threshold = '0';
+	start = mock.now;
+	advance(2000000);
+	check(!length(commands(restart, start)) && health().checks.rrm.healthy &&
+	      health().checks.rrm.result.chanutil == null,
+	      'no chanutil check without a threshold');
+}
+
+function test() {
+	scheduling();
+	backoff();
+	remediation();
+	rrm();
+
+	if (failures)
+		exit(1);
+}
+
+mock.run = test;
+
+include('../files/ucentral-state', {
+	time: now,
+	clock: function(monotonic) {
+		return [ int(mock.now / 1000), (mock.now % 1000) * 1000000 ];
+	},
+	system: function(cmd) {
+		push(mock.commands, { time: mock.now, cmd });
+
+		/* like its init script */
+		if (cmd == '/etc/init.d/rrmd restart') {
+			delete mock.files['/tmp/rrm_timestamp'];
+			delete mock.files['/tmp/rrm_chan_switch'];
+			mock.rrm_up = true;
+		}
+		return 0;
+	},
+});
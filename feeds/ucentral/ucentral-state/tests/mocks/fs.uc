@@ -0,0 +1,27 @@
+let mock = require('mockstate');
+
+export function stat(path) {
+	return exists(mock.files, path) ? { type: 'file' } : null;
+}
+
+export function readfile(path) {
+	return mock.files[path];
+}
+
+/* only "*" is supported */
+export function glob(...patterns) {
+	let found = [];
+
+	for (let pattern in patterns) {
+		let re = regexp('^' + join('.*', map(split(pattern, '*'), (p) => replace(p, '.', '\\.'))) + '$');
+
+		for (let path in keys(mock.files))
+			if (match(path, re))
+				push(found, path);
+	}
+	return found;
+}
+
+export function open(path, mode) {
+	return null;
+}
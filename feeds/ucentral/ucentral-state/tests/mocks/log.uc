@@ -0,0 +1,15 @@
+let mock = require('mockstate');
+
+export const ULOG_SYSLOG = 2;
+export const ULOG_STDIO = 4;
+export const LOG_DAEMON = 24;
+export const LOG_INFO = 6;
+
+export function ulog_open(channels, facility, ident) {
+	return true;
+}
+
+export function ulog(priority, fmt, ...args) {
+	push(mock.log, sprintf(fmt, ...args));
+	return true;
+}
@@ -0,0 +1,42 @@
+/* state shared between the mocked modules and the test */
+return {
+	/* the fake clock in ms, time() and clock() are derived from it */
+	now: 1700000000000,
+	/* path -> contents */
+	files: {},
+	/* "object.method" -> [ { time, args } ] for every ubus call */
+	calls: {},
+	/* [ { time, cmd } ] for every system() call */
+	commands: [],
+	/* every uloop timer and interval, a null due means it is not armed */
+	timers: [],
+	/* commands passed to uloop.process() */
+	processes: [],
+	/* formatted ulog() messages */
+	log: [],
+	/* radio -> the ifname of its single AP interface */
+	radios: { radio0: 'wlan0', radio1: 'wlan1' },
+	/* ifname -> the status hostapd reports */
+	hostapd: { wlan0: 'ENABLED', wlan1: 'ENABLED' },
+	/* ms a network.wireless status call takes */
+	wireless_delay: 0,
+	/* whether rrmd has its ubus object */
+	rrm_up: true,
+	uci: {
+		state: {
+			ui: { '.type': 'admin' },
+			stats: { '.type': 'stats', interval: '600' },
+			health: { '.type': 'health', remediation: '1' },
+			wifi: { '.type': 'check', interval: '30', budget: '100' },
+			rrm: { '.type': 'check', interval: '60', budget: '20' },
+		},
+		rrm: {
+			base: { '.type': 'base' },
+			chanutil: { '.type': 'policy', name: 'chanutil', interval: '3600000', threshold: '70', algo: '1' },
+		},
+	},
+	/* the methods of the published state object */
+	methods: null,
+	/* called from uloop.run(), set by the test */
+	run: null,
+};
@@ -0,0 +1,4 @@
+/* imported by the daemon but not used by the health checks */
+export function request() {
+	return null;
+}
@@ -0,0 +1,62 @@
+let mock = require('mockstate');
+
+function record(object, method, args) {
+	push(mock.calls[`${object}.${method}`] ??= [], { time: mock.now, args });
+}
+
+function wireless_status() {
+	let status = {};
+
+	for (let radio, ifname in mock.radios)
+		status[radio] = {
+			up: true,
+			interfaces: [
+				{ ifname, config: { mode: 'ap', ssid: `ssid-${radio}`, network: [ 'lan' ] } },
+			],
+		};
+	return status;
+}
+
+export function connect() {
+	return {
+		STATUS_INVALID_ARGUMENT: 2,
+
+		publish: function(name, methods) {
+			mock.methods = methods;
+			return {};
+		},
+
+		call: function(object, method, args) {
+			record(object, method, args);
+
+			if (object == 'network.wireless' && method == 'status') {
+				mock.now += mock.wireless_delay;
+				return wireless_status();
+			}
+
+			if (index(object, 'hostapd.') == 0 && method == 'get_status')
+				return { status: mock.hostapd[substr(object, 8)] };
+
+			if (object == 'ucentral' && method == 'status')
+				return { connected: false };
+
+			return {};
+		},
+
+		list: function(path) {
+			let objects = [ 'network.wireless', 'ucentral' ];
+
+			record('list', path);
+			if (mock.rrm_up)
+				push(objects, 'rrm');
+			for (let radio, ifname in mock.radios)
+				push(objects, `hostapd.${ifname}`);
+
+			return path ? filter(objects, (o) => o == path) : objects;
+		},
+
+		error: function() {
+			return null;
+		},
+	};
+}
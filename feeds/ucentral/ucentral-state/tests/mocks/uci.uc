@@ -0,0 +1,17 @@
+let mock = require('mockstate');
+
+export function cursor() {
+	return {
+		load: function(config) {
+			return true;
+		},
+
+		get: function(config, section, option) {
+			return mock.uci[config]?.[section]?.[option];
+		},
+
+		get_all: function(config, section) {
+			return section ? mock.uci[config]?.[section] : mock.uci[config];
+		},
+	};
+}
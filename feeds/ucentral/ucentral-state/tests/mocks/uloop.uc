@@ -0,0 +1,48 @@
+let mock = require('mockstate');
+
+/* the test fires the timers as it moves the fake clock */
+function add_timer(delay, cb, periodic) {
+	let t = { cb, periodic, delay, due: mock.now + delay };
+
+	t.set = function(ms) {
+		t.delay = ms;
+		t.due = mock.now + ms;
+		return true;
+	};
+
+	t.cancel = function() {
+		t.due = null;
+		return true;
+	};
+
+	push(mock.timers, t);
+	return t;
+}
+
+export function init() {
+	return true;
+}
+
+export function timer(delay, cb) {
+	return add_timer(delay, cb, false);
+}
+
+export function interval(delay, cb) {
+	return add_timer(delay, cb, true);
+}
+
+export function process(cmd, args, env, cb) {
+	push(mock.processes, cmd);
+	return {
+		delete: function() {
+			return true;
+		},
+	};
+}
+
+export function run() {
+	mock.run();
+}
+
+export function done() {
+}
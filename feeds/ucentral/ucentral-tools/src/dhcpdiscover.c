@@ -70,6 +70,7 @@ const char *email = "p4u@dabax.net";
 #include <net/if.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -84,6 +85,7 @@ const char *email = "p4u@dabax.net";
 
 	#include <features.h>
 	#include <linux/if_ether.h>
+	#include <sys/epoll.h>
 
 #elif defined(__bsd__)
 
@@ -178,9 +180,23 @@ typedef struct dhcp_offer_struct {
 	u_int32_t lease_time;           /* lease time in seconds */
 	u_int32_t renewal_time;         /* renewal time in seconds */
 	u_int32_t rebinding_time;       /* rebinding time in seconds */
+	unsigned long latency;          /* usec from DHCPDISCOVER to DHCPOFFER */
 	struct dhcp_offer_struct *next;
 } dhcp_offer;
 
+/* one DHCPDISCOVER per interface, all of them are sent and received in parallel */
+typedef struct dhcp_probe_struct {
+	char interface_name[IFNAMSIZ];
+	int sock;
+	unsigned char hardware_address[MAX_DHCP_CHADDR_LENGTH];
+	u_int32_t xid;
+	struct timespec sent;
+	int responses;       /* DHCP packets seen on the wire */
+	int valid_responses; /* DHCPOFFERs for this probe */
+	int error;           /* the probe could not be sent */
+	dhcp_offer *offers;
+} dhcp_probe;
+
 typedef struct requested_server_struct {
 	struct in_addr server_address;
 	struct requested_server_struct *next;
@@ -225,11 +241,10 @@ char baddr[16];
 
 char network_interface_name[16] = "eth0";
 
-u_int32_t packet_xid = 0;
+#define MAX_INTERFACES 64
 
-u_int32_t dhcp_lease_time = 0;
-u_int32_t dhcp_renewal_time = 0;
-u_int32_t dhcp_rebinding_time = 0;
+dhcp_probe probes[MAX_INTERFACES];
+int n_probes = 0;
 
 int dhcpoffer_timeout = 2;
 
@@ -244,6 +259,7 @@ int request_specific_address = FALSE;
 int received_requested_address = FALSE;
 int verbose = 0;
 int prometheus = 0;
+int json = 0;
 struct in_addr requested_address;
 
 static void print_revision(const char *prog_name, const char *prog_revision)
@@ -259,24 +275,25 @@ void print_help(void);
 
 int get_hardware_address(int, char *);
 
-int send_dhcp_discover(int);
-int get_dhcp_offer(int);
+int send_dhcp_discover(dhcp_probe *);
+int probe_interfaces(void);
 
 int get_results(void);
+void print_json_results(void);
 
-int add_dhcp_offer(struct in_addr, dhcp_packet *);
+int add_dhcp_offer(dhcp_probe *, struct in_addr, dhcp_packet *, unsigned long);
 int free_dhcp_offer_list(void);
 int free_requested_server_list(void);
 
-int create_dhcp_socket(void);
+int create_dhcp_socket(const char *);
 int close_dhcp_socket(int);
 int send_dhcp_packet(void *, int, int, struct sockaddr_in *);
-int receive_dhcp_packet(void *, int, int, int, struct sockaddr_in *);
 
 int main(int argc, char **argv)
 {
-	int dhcp_socket;
+	dhcp_offer **tail = &dhcp_offer_list;
 	int result = STATE_UNKNOWN;
+	int ret, i;
 
 	setlocale(LC_ALL, "");
 	// bindtextdomain (PACKAGE, LOCALEDIR);
@@ -293,25 +310,29 @@ int main(int argc, char **argv)
 			fprintf(stderr, "Banned addr:%s\n", baddr);
 	}
 
-	/* create socket for DHCP communications */
-	dhcp_socket = create_dhcp_socket();
+	if (!n_probes)
+		strcpy(probes[n_probes++].interface_name, network_interface_name);
 
-	/* get hardware address of client machine */
-	get_hardware_address(dhcp_socket, network_interface_name);
+	/* send a DHCPDISCOVER on every interface and wait for the DHCPOFFERs */
+	ret = probe_interfaces();
 
-	/* send DHCPDISCOVER packet */
-	send_dhcp_discover(dhcp_socket);
-
-	/* wait for a DHCPOFFER packet */
-	get_dhcp_offer(dhcp_socket);
+	if (json) {
+		print_json_results();
+		result = ret == OK ? STATE_OK : STATE_UNKNOWN;
+	}
 
-	/* close socket we created */
-	close_dhcp_socket(dhcp_socket);
+	/* the checks of get_results() cover the offers of all interfaces */
+	for (i = 0; i < n_probes; i++) {
+		valid_responses += probes[i].valid_responses;
+		*tail = probes[i].offers;
+		while (*tail)
+			tail = &(*tail)->next;
+		probes[i].offers = NULL;
+	}
 
 	/* determine state/plugin output to return */
-	if (!prometheus) {
+	if (!json && !prometheus && ret == OK)
 		result = get_results();
-	}
 
 	/* free allocated memory */
 	free_dhcp_offer_list();
@@ -347,7 +368,7 @@ int get_hardware_address(int sock, char *interface_name)
 		if (ioctl(sock, SIOCGIFHWADDR, &ifr) < 0) {
 			fprintf(stderr, "Could not get hardware address of interface '%s'\n",
 			        interface_name);
-			exit(STATE_UNKNOWN);
+			return ERROR;
 		}
 		memcpy(&client_hardware_address[0], &ifr.ifr_hwaddr.sa_data, 6);
 	}
@@ -484,7 +505,7 @@ int get_hardware_address(int sock, char *interface_name)
 }
 
 /* sends a DHCPDISCOVER broadcast message in an attempt to find DHCP servers */
-int send_dhcp_discover(int sock)
+int send_dhcp_discover(dhcp_probe *probe)
 {
 	dhcp_packet discover_packet;
 	struct sockaddr_in sockaddr_broadcast;
@@ -504,14 +525,8 @@ int send_dhcp_discover(int sock)
 	discover_packet.hops = 0;
 
 	/* transaction id is supposed to be random */
-	srand(time(NULL));
-	packet_xid = random();
-	discover_packet.xid = htonl(packet_xid);
-
-	/**** WHAT THE HECK IS UP WITH THIS?!?  IF I DON'T MAKE THIS CALL, ONLY ONE
-	 * SERVER RESPONSE IS PROCESSED!!!! ****/
-	/* downright bizzarre... */
-	ntohl(discover_packet.xid);
+	probe->xid = random();
+	discover_packet.xid = htonl(probe->xid);
 
 	/*discover_packet.secs=htons(65535);*/
 	discover_packet.secs = 0xFF;
@@ -520,7 +535,7 @@ int send_dhcp_discover(int sock)
 	discover_packet.flags = htons(DHCP_BROADCAST_FLAG);
 
 	/* our hardware address */
-	memcpy(discover_packet.chaddr, client_hardware_address, ETHERNET_HARDWARE_ADDRESS_LENGTH);
+	memcpy(discover_packet.chaddr, probe->hardware_address, ETHERNET_HARDWARE_ADDRESS_LENGTH);
 
 	/* first four bytes of options field is magic cookie (as per RFC 2132) */
 	discover_packet.options[0] = '\x63';
@@ -559,7 +574,13 @@ int send_dhcp_discover(int sock)
 	}
 
 	/* send the DHCPDISCOVER packet out */
-	send_dhcp_packet(&discover_packet, sizeof(discover_packet), sock, &sockaddr_broadcast);
+	clock_gettime(CLOCK_MONOTONIC, &probe->sent);
+	if (send_dhcp_packet(&discover_packet, sizeof(discover_packet), probe->sock,
+	                     &sockaddr_broadcast) != OK) {
+		fprintf(stderr, "Could not send DHCPDISCOVER on interface %s\n",
+		        probe->interface_name);
+		return ERROR;
+	}
 
 	if (verbose)
 		fprintf(stderr, "\n\n");
@@ -567,196 +588,246 @@ int send_dhcp_discover(int sock)
 	return OK;
 }
 
-/* waits for a DHCPOFFER message from one or more DHCP servers */
-int get_dhcp_offer(int sock)
+/* sends a DHCP packet */
+int send_dhcp_packet(void *buffer, int buffer_size, int sock, struct sockaddr_in *dest)
 {
-	dhcp_packet offer_packet;
-	struct sockaddr_in source;
-	int responses = 0;
-	int x;
-	time_t start_time;
-	time_t current_time;
+	int result;
 
-	time(&start_time);
+	result =
+	    sendto(sock, (char *) buffer, buffer_size, 0, (struct sockaddr *) dest, sizeof(*dest));
 
-	/* receive as many responses as we can */
-	for (responses = 0, valid_responses = 0;;) {
-		time(&current_time);
-		if ((current_time - start_time) >= dhcpoffer_timeout)
-			break;
+	if (verbose)
+		fprintf(stderr, "send_dhcp_packet result: %d\n", result);
 
-		if (verbose)
-			fprintf(stderr, "\n\n");
+	if (result < 0)
+		return ERROR;
 
-		bzero(&source, sizeof(source));
-		bzero(&offer_packet, sizeof(offer_packet));
+	return OK;
+}
 
-		int result = receive_dhcp_packet(&offer_packet, sizeof(offer_packet), sock,
-		                                 dhcpoffer_timeout, &source);
+static unsigned long elapsed_us(const struct timespec *from, const struct timespec *to)
+{
+	return (to->tv_sec - from->tv_sec) * 1000000 + (to->tv_nsec - from->tv_nsec) / 1000;
+}
 
-		// checks if the source address is the banned one
-		char saddr[16];
-		inet_ntop(AF_INET, &(source.sin_addr), saddr, INET_ADDRSTRLEN);
+/* validates a packet received on the socket of a probe and records the offer */
+static void handle_dhcp_packet(dhcp_probe *probe, dhcp_packet *offer_packet, int len,
+                               struct sockaddr_in *source)
+{
+	struct timespec now;
+	char saddr[INET_ADDRSTRLEN];
+	int x;
 
-		if (banned && strcmp(saddr, baddr) == 0) {
-			fprintf(stderr, "DHCP offer comming from the banned addr %s, ignoring it\n",
-			        baddr);
-			result = 1;
-		}
+	clock_gettime(CLOCK_MONOTONIC, &now);
 
-		if (result != OK) {
-			if (verbose)
-				fprintf(stderr, "Result=ERROR\n");
-			continue;
-		} else {
-			if (verbose)
-				fprintf(stderr, "Result=OK\n");
-			responses++;
-		}
+	if (verbose) {
+		fprintf(stderr, "\n\n");
+		fprintf(stderr, "receive_dhcp_packet() result: %d\n", len);
+		fprintf(stderr, "receive_dhcp_packet() source: %s\n", inet_ntoa(source->sin_addr));
+	}
 
-		if (verbose) {
-			fprintf(stderr, "DHCPOFFER from IP address %s\n",
-			        inet_ntoa(source.sin_addr));
-			fprintf(stderr, "DHCPOFFER XID: %lu (0x%X)\n",
-			        (unsigned long) ntohl(offer_packet.xid), ntohl(offer_packet.xid));
-		}
+	// checks if the source address is the banned one
+	inet_ntop(AF_INET, &(source->sin_addr), saddr, INET_ADDRSTRLEN);
 
-		/* check packet xid to see if its the same as the one we used in the
-		 * discover packet */
-		if (ntohl(offer_packet.xid) != packet_xid) {
-			if (verbose)
-				fprintf(
-				    stderr,
-				    "DHCPOFFER XID (%lu) did not match DHCPDISCOVER XID (%lu) - "
-				    "ignoring packet\n",
-				    (unsigned long) ntohl(offer_packet.xid),
-				    (unsigned long) packet_xid);
-			continue;
-		}
+	if (banned && strcmp(saddr, baddr) == 0) {
+		fprintf(stderr, "DHCP offer comming from the banned addr %s, ignoring it\n", baddr);
+		return;
+	}
 
-		/* check hardware address */
-		result = OK;
+	if (len < (int) offsetof(dhcp_packet, options)) {
 		if (verbose)
-			fprintf(stderr, "DHCPOFFER chaddr: ");
+			fprintf(stderr, "Packet too short - ignoring packet\n");
+		return;
+	}
 
-		for (x = 0; x < ETHERNET_HARDWARE_ADDRESS_LENGTH; x++) {
-			if (verbose)
-				fprintf(stderr, "%02X", (unsigned char) offer_packet.chaddr[x]);
+	probe->responses++;
 
-			if (offer_packet.chaddr[x] != client_hardware_address[x])
-				result = ERROR;
-		}
+	if (verbose) {
+		fprintf(stderr, "DHCPOFFER from IP address %s on %s\n", saddr,
+		        probe->interface_name);
+		fprintf(stderr, "DHCPOFFER XID: %lu (0x%X)\n",
+		        (unsigned long) ntohl(offer_packet->xid), ntohl(offer_packet->xid));
+	}
 
+	/* check packet xid to see if its the same as the one we used in the
+	 * discover packet */
+	if (ntohl(offer_packet->xid) != probe->xid) {
 		if (verbose)
-			fprintf(stderr, "\n");
+			fprintf(stderr,
+			        "DHCPOFFER XID (%lu) did not match DHCPDISCOVER XID (%lu) - "
+			        "ignoring packet\n",
+			        (unsigned long) ntohl(offer_packet->xid), (unsigned long) probe->xid);
+		return;
+	}
 
-		if (result == ERROR) {
+	/* check hardware address */
+	for (x = 0; x < ETHERNET_HARDWARE_ADDRESS_LENGTH; x++) {
+		if (offer_packet->chaddr[x] != probe->hardware_address[x]) {
 			if (verbose)
-				fprintf(
-				    stderr,
-				    "DHCPOFFER hardware address did not match our own - ignoring "
-				    "packet\n");
-			continue;
+				fprintf(stderr,
+				        "DHCPOFFER hardware address did not match our own - ignoring "
+				        "packet\n");
+			return;
 		}
-
-		if (verbose) {
-			fprintf(stderr, "DHCPOFFER ciaddr: %s\n", inet_ntoa(offer_packet.ciaddr));
-			fprintf(stderr, "DHCPOFFER yiaddr: %s\n", inet_ntoa(offer_packet.yiaddr));
-			fprintf(stderr, "DHCPOFFER siaddr: %s\n", inet_ntoa(offer_packet.siaddr));
-			fprintf(stderr, "DHCPOFFER giaddr: %s\n", inet_ntoa(offer_packet.giaddr));
-		}
-
-		add_dhcp_offer(source.sin_addr, &offer_packet);
-
-		valid_responses++;
 	}
 
 	if (verbose) {
-		fprintf(stderr, "Total responses seen on the wire: %d\n", responses);
-		fprintf(stderr, "Valid responses for this machine: %d\n", valid_responses);
+		fprintf(stderr, "DHCPOFFER ciaddr: %s\n", inet_ntoa(offer_packet->ciaddr));
+		fprintf(stderr, "DHCPOFFER yiaddr: %s\n", inet_ntoa(offer_packet->yiaddr));
+		fprintf(stderr, "DHCPOFFER siaddr: %s\n", inet_ntoa(offer_packet->siaddr));
+		fprintf(stderr, "DHCPOFFER giaddr: %s\n", inet_ntoa(offer_packet->giaddr));
 	}
 
-	return OK;
+	add_dhcp_offer(probe, source->sin_addr, offer_packet, elapsed_us(&probe->sent, &now));
+
+	probe->valid_responses++;
 }
 
-/* sends a DHCP packet */
-int send_dhcp_packet(void *buffer, int buffer_size, int sock, struct sockaddr_in *dest)
+/* opens the socket of a probe and sends its DHCPDISCOVER */
+static int start_probe(dhcp_probe *probe, int epfd)
 {
-	int result;
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = probe };
 
-	result =
-	    sendto(sock, (char *) buffer, buffer_size, 0, (struct sockaddr *) dest, sizeof(*dest));
+	probe->sock = create_dhcp_socket(probe->interface_name);
+	if (probe->sock < 0)
+		return ERROR;
 
-	if (verbose)
-		fprintf(stderr, "send_dhcp_packet result: %d\n", result);
+	/* get hardware address of client machine */
+	if (get_hardware_address(probe->sock, probe->interface_name) != OK)
+		return ERROR;
 
-	if (result < 0)
+	memcpy(probe->hardware_address, client_hardware_address, sizeof(probe->hardware_address));
+
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, probe->sock, &ev) < 0) {
+		fprintf(stderr, "Could not watch DHCP socket of interface %s\n",
+		        probe->interface_name);
 		return ERROR;
+	}
 
-	return OK;
+	return send_dhcp_discover(probe);
 }
 
-/* receives a DHCP packet */
-int receive_dhcp_packet(void *buffer, int buffer_size, int sock, int timeout,
-                        struct sockaddr_in *address)
+/*
+ * Sends a DHCPDISCOVER on all interfaces at once and collects the DHCPOFFERs
+ * of all of them in a single epoll loop, so probing N interfaces takes one
+ * timeout instead of N. Every datagram is read once, straight into the packet.
+ */
+int probe_interfaces(void)
 {
-	struct timeval tv;
-	fd_set readfds;
+	struct epoll_event events[MAX_INTERFACES];
+	struct timespec start, now;
+	struct sockaddr_in source;
 	socklen_t address_size;
-	struct sockaddr_in source_address;
-
-	/* wait for data to arrive (up time timeout) */
-	tv.tv_sec = timeout;
-	tv.tv_usec = 0;
-	FD_ZERO(&readfds);
-	FD_SET(sock, &readfds);
-	select(sock + 1, &readfds, NULL, NULL, &tv);
+	dhcp_packet offer_packet;
+	long remaining;
+	int result = OK;
+	int epfd, i, n, len;
 
-	/* make sure some data has arrived */
-	if (!FD_ISSET(sock, &readfds)) {
-		if (verbose)
-			fprintf(stderr, "No (more) data received\n");
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0) {
+		fprintf(stderr, "Could not create epoll instance: %s\n", strerror(errno));
 		return ERROR;
-	} else {
-		/* why do we need to peek first?  i don't know, its a hack.  without it, the
-		   source address of the first packet received was not being interpreted
-		   correctly.  sigh... */
-		bzero(&source_address, sizeof(source_address));
-		address_size = sizeof(source_address);
-		int recv_result = recvfrom(sock, (char *) buffer, buffer_size, MSG_PEEK,
-		                           (struct sockaddr *) &source_address, &address_size);
+	}
 
-		if (verbose)
-			fprintf(stderr, "recv_result_1: %d\n", recv_result);
+	srandom(time(NULL) ^ getpid());
 
-		recv_result = recvfrom(sock, (char *) buffer, buffer_size, 0,
-		                       (struct sockaddr *) &source_address, &address_size);
-		if (verbose)
-			fprintf(stderr, "recv_result_2: %d\n", recv_result);
+	for (i = 0; i < n_probes; i++) {
+		if (start_probe(&probes[i], epfd) == OK)
+			continue;
 
-		if (recv_result == -1) {
-			if (verbose) {
-				fprintf(stderr, "recvfrom() failed, ");
-				fprintf(stderr, "errno: (%d) -> %s\n", errno, strerror(errno));
-			}
-			return ERROR;
-		} else {
-			if (verbose) {
-				fprintf(stderr, "receive_dhcp_packet() result: %d\n", recv_result);
-				fprintf(stderr, "receive_dhcp_packet() source: %s\n",
-				        inet_ntoa(source_address.sin_addr));
+		if (probes[i].sock >= 0)
+			close_dhcp_socket(probes[i].sock);
+		probes[i].sock = -1;
+		probes[i].error = TRUE;
+		result = ERROR;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	/* receive as many responses as we can */
+	while (1) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		remaining = dhcpoffer_timeout * 1000L - (long) (elapsed_us(&start, &now) / 1000);
+		if (remaining <= 0)
+			break;
+
+		n = epoll_wait(epfd, events, MAX_INTERFACES, remaining);
+		if (n < 0 && errno != EINTR)
+			break;
+
+		for (i = 0; i < n; i++) {
+			dhcp_probe *probe = events[i].data.ptr;
+
+			while (1) {
+				bzero(&source, sizeof(source));
+				bzero(&offer_packet, sizeof(offer_packet));
+				address_size = sizeof(source);
+
+				len = recvfrom(probe->sock, &offer_packet, sizeof(offer_packet), 0,
+				               (struct sockaddr *) &source, &address_size);
+				if (len < 0)
+					break;
+
+				handle_dhcp_packet(probe, &offer_packet, len, &source);
 			}
+		}
+	}
 
-			memcpy(address, &source_address, sizeof(source_address));
-			return OK;
+	for (i = 0; i < n_probes; i++) {
+		if (verbose) {
+			fprintf(stderr, "Total responses seen on the wire on %s: %d\n",
+			        probes[i].interface_name, probes[i].responses);
+			fprintf(stderr, "Valid responses for this machine on %s: %d\n",
+			        probes[i].interface_name, probes[i].valid_responses);
 		}
+
+		if (probes[i].sock >= 0)
+			close_dhcp_socket(probes[i].sock);
+		probes[i].sock = -1;
 	}
 
-	return OK;
+	close(epfd);
+
+	return result;
+}
+
+/* prints the offers received on each interface as json to stdout */
+void print_json_results(void)
+{
+	char server[INET_ADDRSTRLEN], address[INET_ADDRSTRLEN];
+	dhcp_offer *offer;
+	int i;
+
+	printf("{\"interfaces\":[");
+
+	for (i = 0; i < n_probes; i++) {
+		printf("%s{\"interface\":\"%s\"", i ? "," : "", probes[i].interface_name);
+
+		if (probes[i].error) {
+			printf(",\"error\":true}");
+			continue;
+		}
+
+		printf(",\"responses\":%d,\"offers\":[", probes[i].responses);
+
+		for (offer = probes[i].offers; offer != NULL; offer = offer->next) {
+			inet_ntop(AF_INET, &offer->server_address, server, sizeof(server));
+			inet_ntop(AF_INET, &offer->offered_address, address, sizeof(address));
+
+			printf("%s{\"server\":\"%s\",\"address\":\"%s\",\"lease_time\":%lu,"
+			       "\"latency_ms\":%.3f}",
+			       offer == probes[i].offers ? "" : ",", server, address,
+			       (unsigned long) offer->lease_time, offer->latency / 1000.0);
+		}
+
+		printf("]}");
+	}
+
+	printf("]}\n");
 }
 
 /* creates a socket for DHCP communication */
-int create_dhcp_socket(void)
+int create_dhcp_socket(const char *interface_name)
 {
 	struct sockaddr_in myname;
 	struct ifreq interface;
@@ -771,10 +842,10 @@ int create_dhcp_socket(void)
 	bzero(&myname.sin_zero, sizeof(myname.sin_zero));
 
 	/* create a socket for DHCP communications */
-	sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
 	if (sock < 0) {
 		fprintf(stderr, "Could not create socket!\n");
-		exit(STATE_UNKNOWN);
+		return -1;
 	}
 
 	if (verbose)
@@ -784,30 +855,29 @@ int create_dhcp_socket(void)
 	flag = 1;
 	if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (char *) &flag, sizeof(flag)) < 0) {
 		fprintf(stderr, "Could not set reuse address option on DHCP socket!\n");
-		exit(STATE_UNKNOWN);
+		goto error;
 	}
 
 	/* set the broadcast option - we need this to listen to DHCP broadcast
 	 * messages */
 	if (setsockopt(sock, SOL_SOCKET, SO_BROADCAST, (char *) &flag, sizeof flag) < 0) {
 		fprintf(stderr, "Could not set broadcast option on DHCP socket!\n");
-		exit(STATE_UNKNOWN);
+		goto error;
 	}
 
 	/* bind socket to interface */
 #if defined(__linux__)
-	strncpy(interface.ifr_ifrn.ifrn_name, network_interface_name, IFNAMSIZ);
+	strncpy(interface.ifr_ifrn.ifrn_name, interface_name, IFNAMSIZ);
 	if (setsockopt(sock, SOL_SOCKET, SO_BINDTODEVICE, (char *) &interface, sizeof(interface)) <
 	    0) {
 		fprintf(stderr,
 		        "Could not bind socket to interface %s.  Check your "
 		        "privileges...\n",
-		        network_interface_name);
-		perror("foo");
-		exit(STATE_UNKNOWN);
+		        interface_name);
+		goto error;
 	}
 #else
-	strncpy(interface.ifr_name, network_interface_name, IFNAMSIZ);
+	strncpy(interface.ifr_name, interface_name, IFNAMSIZ);
 #endif
 
 	/* bind the socket */
@@ -816,10 +886,14 @@ int create_dhcp_socket(void)
 		        "Could not bind to DHCP socket (port %d)!  Check your "
 		        "privileges...\n",
 		        DHCP_CLIENT_PORT);
-		exit(STATE_UNKNOWN);
+		goto error;
 	}
 
 	return sock;
+
+error:
+	close(sock);
+	return -1;
 }
 
 /* closes DHCP socket */
@@ -852,52 +926,62 @@ static int add_requested_server(struct in_addr server_address)
 	return OK;
 }
 
-/* adds a DHCP OFFER to list in memory */
-int add_dhcp_offer(struct in_addr source, dhcp_packet *offer_packet)
+/* adds a DHCP OFFER to the list of the probe it answers */
+int add_dhcp_offer(dhcp_probe *probe, struct in_addr source, dhcp_packet *offer_packet,
+                   unsigned long latency)
 {
+	u_int32_t dhcp_lease_time = 0;
+	u_int32_t dhcp_renewal_time = 0;
+	u_int32_t dhcp_rebinding_time = 0;
 	dhcp_offer *new_offer;
+	u_int32_t *option_time;
+	unsigned option_type, option_length;
 	int x;
-	unsigned int y;
 
 	if (offer_packet == NULL)
 		return ERROR;
 
 	/* process all DHCP options present in the packet */
-	for (x = 4; x < MAX_DHCP_OPTIONS_LENGTH;) {
+	for (x = 4; x < MAX_DHCP_OPTIONS_LENGTH - 1;) {
 		/* end of options (0 is really just a pad, but bail out anyway) */
 		if (offer_packet->options[x] == 255 || offer_packet->options[x] == 0)
 			break;
 
 		/* get option type */
-		unsigned option_type = offer_packet->options[x++];
+		option_type = offer_packet->options[x++];
 
 		/* get option length */
-		unsigned option_length = offer_packet->options[x++];
+		option_length = offer_packet->options[x++];
+
+		if (x + option_length > MAX_DHCP_OPTIONS_LENGTH)
+			break;
 
 		if (verbose)
 			fprintf(stderr, "Option: %u (0x%02X)\n", option_type, option_length);
 
 		/* get option data */
-		if (option_type == DHCP_OPTION_LEASE_TIME) {
-			memcpy(&dhcp_lease_time, &offer_packet->options[x],
-			       sizeof(dhcp_lease_time));
-			dhcp_lease_time = ntohl(dhcp_lease_time);
-		}
-		if (option_type == DHCP_OPTION_RENEWAL_TIME) {
-			memcpy(&dhcp_renewal_time, &offer_packet->options[x],
-			       sizeof(dhcp_renewal_time));
-			dhcp_renewal_time = ntohl(dhcp_renewal_time);
+		switch (option_type) {
+			case DHCP_OPTION_LEASE_TIME:
+				option_time = &dhcp_lease_time;
+				break;
+			case DHCP_OPTION_RENEWAL_TIME:
+				option_time = &dhcp_renewal_time;
+				break;
+			case DHCP_OPTION_REBINDING_TIME:
+				option_time = &dhcp_rebinding_time;
+				break;
+			default:
+				option_time = NULL;
+				break;
 		}
-		if (option_type == DHCP_OPTION_REBINDING_TIME) {
-			memcpy(&dhcp_rebinding_time, &offer_packet->options[x],
-			       sizeof(dhcp_rebinding_time));
-			dhcp_rebinding_time = ntohl(dhcp_rebinding_time);
+
+		if (option_time && option_length == sizeof(*option_time)) {
+			memcpy(option_time, &offer_packet->options[x], sizeof(*option_time));
+			*option_time = ntohl(*option_time);
 		}
 
-		/* skip option data we're ignoring */
-		else
-			for (y = 0; y < option_length; y++, x++)
-				;
+		/* skip to the next option */
+		x += option_length;
 	}
 
 	if (verbose) {
@@ -927,6 +1011,7 @@ int add_dhcp_offer(struct in_addr source, dhcp_packet *offer_packet)
 	new_offer->lease_time = dhcp_lease_time;
 	new_offer->renewal_time = dhcp_renewal_time;
 	new_offer->rebinding_time = dhcp_rebinding_time;
+	new_offer->latency = latency;
 
 	if (verbose) {
 		fprintf(stderr, "Added offer from server @ %s",
@@ -938,12 +1023,12 @@ int add_dhcp_offer(struct in_addr source, dhcp_packet *offer_packet)
 		fprintf(stderr, "dhcpdiscover_offer{ ");
 		fprintf(stderr, "server=\"%s\",", inet_ntoa(new_offer->server_address));
 		fprintf(stderr, "address=\"%s\",", inet_ntoa(new_offer->offered_address));
-		fprintf(stderr, "dev=\"%s\" } 1\n", network_interface_name);
+		fprintf(stderr, "dev=\"%s\" } 1\n", probe->interface_name);
 	}
 
 	/* add new offer to head of list */
-	new_offer->next = dhcp_offer_list;
-	dhcp_offer_list = new_offer;
+	new_offer->next = probe->offers;
+	probe->offers = new_offer;
 
 	return OK;
 }
@@ -1115,6 +1200,7 @@ int call_getopt(int argc, char **argv)
 		                                { "bannedip", required_argument, 0, 'b' },
 		                                { "verbose", no_argument, 0, 'v' },
 		                                { "prometheus", no_argument, 0, 'p' },
+		                                { "json", no_argument, 0, 'j' },
 		                                { "version", no_argument, 0, 'V' },
 		                                { "help", no_argument, 0, 'h' },
 		                                { 0, 0, 0, 0 } };
@@ -1122,9 +1208,9 @@ int call_getopt(int argc, char **argv)
 
 	while (1) {
 #ifdef HAVE_GETOPT_H
-		c = getopt_long(argc, argv, "+hVvpt:s:r:t:i:m:b:", long_options, &option_index);
+		c = getopt_long(argc, argv, "+hVvpjt:s:r:t:i:m:b:", long_options, &option_index);
 #else
-		c = getopt(argc, argv, "+?hVvpt:s:r:t:i:m:b:");
+		c = getopt(argc, argv, "+?hVvpjt:s:r:t:i:m:b:");
 #endif
 
 		i++;
@@ -1199,10 +1285,14 @@ int call_getopt(int argc, char **argv)
 				*/
 				break;
 
-			case 'i': /* interface name */
-				strncpy(network_interface_name, optarg,
-				        sizeof(network_interface_name) - 1);
-				network_interface_name[sizeof(network_interface_name) - 1] = '\x0';
+			case 'i': /* interface name, may be given more than once */
+				if (n_probes >= MAX_INTERFACES) {
+					fprintf(stderr, "Too many interfaces, ignoring %s\n", optarg);
+					break;
+				}
+				strncpy(probes[n_probes].interface_name, optarg,
+				        sizeof(probes[n_probes].interface_name) - 1);
+				n_probes++;
 				break;
 
 			case 'V': /* version */
@@ -1220,6 +1310,9 @@ int call_getopt(int argc, char **argv)
 			case 'p': /* prometheus */
 				prometheus = 1;
 				break;
+			case 'j': /* json */
+				json = 1;
+				break;
 
 			default: /* help */
 				fprintf(stderr, "Unknown argument: %s", optarg);
@@ -1385,11 +1478,14 @@ void print_help(void)
  -t, --timeout=INTEGER\n\
    Seconds to wait for DHCPOFFER before timeout occurs\n\
  -i, --interface=STRING\n\
-   Interface to to use for listening (i.e. eth0)\n\
+   Interface to to use for listening (i.e. eth0), may be given more than once\n\
+   to probe several interfaces in parallel\n\
  -v, --verbose\n\
    Print extra information (command-line use only)\n\
  -p, --prometheus\n\
    Print extra information in prometheus format\n\
+ -j, --json\n\
+   Print the offers of each interface and their latency as json\n\
  -h, --help\n\
    Print detailed help screen\n\
  -V, --version\n\
@@ -1402,6 +1498,6 @@ void print_usage(void)
 {
 	fprintf(stderr, "\
 Usage: %s [-s serverip] [-r requestedip] [-m clientmac ] [-b bannedip] [-t timeout] [-i interface]\n\
-                  [-v] [-p]",
+                  [-v] [-p] [-j]",
 	        progname);
 }
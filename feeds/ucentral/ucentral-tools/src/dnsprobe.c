@@ -81,6 +81,7 @@ struct ns {
 	len_and_sockaddr addr;
 	int failures;
 	int replies;
+	int sent;
 };
 
 struct query {
@@ -97,9 +98,22 @@ static const char *rcodes[] = { "NOERROR",    "FORMERR",    "SERVFAIL",   "NXDOM
 	                        "RESERVED12", "RESERVED13", "RESERVED14", "RESERVED15",
 	                        "BADVERS" };
 
+/* a single probe of the stats mode, one per server, name and round */
+struct probe {
+	unsigned long sent; /* usec, CLOCK_MONOTONIC */
+	unsigned long rtt;  /* usec */
+	int server, query;
+	int rcode;
+	int replied;
+	int done;
+};
+
 static unsigned int default_port = 53;
 static unsigned int default_retry = 1;
 static unsigned int default_timeout = 2;
+static unsigned int default_interval = 1000;
+
+#define MAX_ARGS 32
 
 
 static int parse_reply(const unsigned char *msg, size_t len)
@@ -550,6 +564,7 @@ static struct ns *add_ns(struct ns **ns, int *n_ns, const char *addr)
 				(*ns)[*n_ns].name = addr;
 				(*ns)[*n_ns].replies = 0;
 				(*ns)[*n_ns].failures = 0;
+				(*ns)[*n_ns].sent = 0;
 				(*ns)[*n_ns].addr.len = aip->ai_addrlen;
 
 				memcpy(&(*ns)[*n_ns].addr.u.sa, aip->ai_addr, aip->ai_addrlen);
@@ -576,6 +591,7 @@ static struct ns *add_ns(struct ns **ns, int *n_ns, const char *addr)
 	(*ns)[*n_ns].name = addr;
 	(*ns)[*n_ns].replies = 0;
 	(*ns)[*n_ns].failures = 0;
+	(*ns)[*n_ns].sent = 0;
 
 	return &(*ns)[(*n_ns)++];
 }
@@ -592,30 +608,311 @@ static struct query *add_query(struct query **queries, int *n_queries, int type,
 
 	memset(&tmp[*n_queries], 0, sizeof(*tmp));
 
+	*queries = tmp;
+
 	qlen = res_mkquery(QUERY, dname, C_IN, type, NULL, 0, NULL, tmp[*n_queries].query,
 	                   sizeof(tmp[*n_queries].query));
 
+	if (qlen < 0)
+		return NULL;
+
 	tmp[*n_queries].qlen = qlen;
 	tmp[*n_queries].name = dname;
-	*queries = tmp;
 
 	return &tmp[(*n_queries)++];
 }
 
+static unsigned long mtime_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int sockaddr_equal(const len_and_sockaddr *a, const struct sockaddr *b)
+{
+	if (a->u.sa.sa_family != b->sa_family)
+		return 0;
+
+#if ENABLE_FEATURE_IPV6
+	if (b->sa_family == AF_INET6) {
+		const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *) (const void *) b;
+
+		return a->u.sin6.sin6_port == sin6->sin6_port &&
+		       !memcmp(&a->u.sin6.sin6_addr, &sin6->sin6_addr, sizeof(sin6->sin6_addr));
+	}
+#endif
+
+	const struct sockaddr_in *sin = (const struct sockaddr_in *) (const void *) b;
+
+	return a->u.sin.sin_port == sin->sin_port &&
+	       a->u.sin.sin_addr.s_addr == sin->sin_addr.s_addr;
+}
+
+/*
+ * Match a reply to its probe by transaction id. The ids of a run are
+ * consecutive starting at id_base, so the id is the probe index. The source
+ * address and the question section have to match as well.
+ */
+static void receive_probes(int fd, struct ns *ns, struct query *queries, struct probe *probes,
+                           int n_sent, uint16_t id_base, int *pending)
+{
+	unsigned char reply[512];
+	len_and_sockaddr from;
+	struct probe *p;
+	struct query *q;
+	unsigned long now;
+	ssize_t len;
+	int idx;
+
+	while (1) {
+		from.len = sizeof(from.u);
+		len = recvfrom(fd, reply, sizeof(reply), 0, &from.u.sa, &from.len);
+		if (len < 0)
+			break;
+
+		now = mtime_us();
+
+		/* Ignore non-identifiable packets and queries */
+		if (len < 12 || !(reply[2] & 0x80))
+			continue;
+
+		idx = (uint16_t) (((reply[0] << 8) | reply[1]) - id_base);
+		if (idx >= n_sent)
+			continue;
+
+		p = &probes[idx];
+		q = &queries[p->query];
+		if (p->done || !sockaddr_equal(&ns[p->server].addr, &from.u.sa))
+			continue;
+
+		if ((size_t) len < q->qlen || memcmp(reply + 12, q->query + 12, q->qlen - 12))
+			continue;
+
+		p->rtt = now - p->sent;
+		p->rcode = reply[3] & 15;
+		p->replied = 1;
+		p->done = 1;
+		(*pending)--;
+
+		ns[p->server].replies++;
+
+		/* Anything but a positive or negative response is an error */
+		if (p->rcode != 0 && p->rcode != 3)
+			ns[p->server].failures++;
+	}
+}
+
+static int open_probe_socket(int family)
+{
+	int fd = socket(family, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+#if ENABLE_FEATURE_IPV6
+	int one = 1;
+
+	if (fd >= 0 && family == AF_INET6)
+		setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &one, sizeof(one));
+#endif
+
+	return fd;
+}
+
+/*
+ * Send count rounds of all queries to all servers, one round every interval
+ * ms, and collect the replies until every probe is answered or timed out.
+ * Probes are sent in index order and share one timeout, so they expire in
+ * that order as well.
+ */
+static int probe_servers(struct ns *ns, int n_ns, struct query *queries, int n_queries,
+                         struct probe *probes, int count, unsigned long interval,
+                         unsigned long timeout)
+{
+	struct pollfd pfd[2] = { { .fd = -1, .events = POLLIN }, { .fd = -1, .events = POLLIN } };
+	unsigned long now, next_round, delay;
+	int round = 0, n_sent = 0, first = 0, pending = 0;
+	unsigned char query[512];
+	uint16_t id_base;
+	struct probe *p;
+	int i, nn, qn;
+
+	srandom(mtime_us() ^ getpid());
+	id_base = random();
+
+	for (nn = 0; nn < n_ns; nn++) {
+		i = ns[nn].addr.u.sa.sa_family == AF_INET6;
+		if (pfd[i].fd >= 0)
+			continue;
+
+		pfd[i].fd = open_probe_socket(ns[nn].addr.u.sa.sa_family);
+		if (pfd[i].fd < 0)
+			goto out;
+	}
+
+	next_round = mtime_us();
+
+	while (round < count || pending) {
+		now = mtime_us();
+
+		if (round < count && now >= next_round) {
+			for (nn = 0; nn < n_ns; nn++) {
+				for (qn = 0; qn < n_queries; qn++) {
+					uint16_t id = id_base + n_sent;
+
+					p = &probes[n_sent++];
+					p->server = nn;
+					p->query = qn;
+
+					memcpy(query, queries[qn].query, queries[qn].qlen);
+					query[0] = id >> 8;
+					query[1] = id & 0xff;
+
+					i = ns[nn].addr.u.sa.sa_family == AF_INET6;
+					p->sent = mtime_us();
+					ns[nn].sent++;
+
+					if (sendto(pfd[i].fd, query, queries[qn].qlen, MSG_NOSIGNAL,
+					           &ns[nn].addr.u.sa, ns[nn].addr.len) < 0)
+						p->done = 1;
+					else
+						pending++;
+				}
+			}
+
+			round++;
+			next_round += interval * 1000;
+			continue;
+		}
+
+		while (first < n_sent && (probes[first].done || now - probes[first].sent >= timeout * 1000)) {
+			if (!probes[first].done) {
+				probes[first].done = 1;
+				pending--;
+			}
+			first++;
+		}
+
+		if (round >= count && !pending)
+			break;
+
+		delay = ~0UL;
+		if (round < count)
+			delay = next_round > now ? next_round - now : 0;
+		if (first < n_sent && probes[first].sent + timeout * 1000 - now < delay)
+			delay = probes[first].sent + timeout * 1000 - now;
+
+		if (poll(pfd, 2, (delay + 999) / 1000) <= 0)
+			continue;
+
+		for (i = 0; i < 2; i++)
+			if (pfd[i].fd >= 0 && (pfd[i].revents & POLLIN))
+				receive_probes(pfd[i].fd, ns, queries, probes, n_sent, id_base,
+				               &pending);
+	}
+
+out:
+	for (i = 0; i < 2; i++)
+		if (pfd[i].fd >= 0)
+			close(pfd[i].fd);
+
+	return n_sent;
+}
+
+static int cmp_ulong(const void *a, const void *b)
+{
+	unsigned long x = *(const unsigned long *) a, y = *(const unsigned long *) b;
+
+	return (x > y) - (x < y);
+}
+
+/* nearest rank percentile of a sorted array */
+static double percentile(const unsigned long *v, int n, int pct)
+{
+	int rank = (pct * n + 99) / 100;
+
+	return v[rank > 0 ? rank - 1 : 0] / 1000.0;
+}
+
+static void print_json_string(const char *str)
+{
+	putchar('"');
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			putchar('\\');
+		if ((unsigned char) *str >= 0x20)
+			putchar(*str);
+	}
+	putchar('"');
+}
+
+static int report_probes(struct ns *ns, int n_ns, struct probe *probes, int n_sent)
+{
+	char astr[INET6_ADDRSTRLEN];
+	unsigned long *rtt;
+	int nn, i, n, rc = 0;
+
+	rtt = calloc(n_sent ? n_sent : 1, sizeof(*rtt));
+	if (!rtt)
+		return -1;
+
+	printf("{\"servers\":[");
+
+	for (nn = 0; nn < n_ns; nn++) {
+		for (i = 0, n = 0; i < n_sent; i++)
+			if (probes[i].server == nn && probes[i].replied)
+				rtt[n++] = probes[i].rtt;
+
+		qsort(rtt, n, sizeof(*rtt), cmp_ulong);
+
+#if ENABLE_FEATURE_IPV6
+		if (ns[nn].addr.u.sa.sa_family == AF_INET6)
+			inet_ntop(AF_INET6, &ns[nn].addr.u.sin6.sin6_addr, astr, sizeof(astr));
+		else
+#endif
+			inet_ntop(AF_INET, &ns[nn].addr.u.sin.sin_addr, astr, sizeof(astr));
+
+		printf("%s{\"server\":", nn ? "," : "");
+		print_json_string(ns[nn].name);
+		printf(",\"address\":\"%s\",\"sent\":%d,\"received\":%d,\"errors\":%d,"
+		       "\"loss\":%.1f",
+		       astr, ns[nn].sent, ns[nn].replies, ns[nn].failures,
+		       ns[nn].sent ? 100.0 * (ns[nn].sent - ns[nn].replies) / ns[nn].sent : 0.0);
+
+		if (n)
+			printf(",\"rtt_ms\":{\"min\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,"
+			       "\"max\":%.3f}",
+			       rtt[0] / 1000.0, percentile(rtt, n, 50), percentile(rtt, n, 90),
+			       percentile(rtt, n, 99), rtt[n - 1] / 1000.0);
+		else
+			rc = 1;
+
+		printf("}");
+	}
+
+	printf("]}\n");
+	free(rtt);
+
+	return rc;
+}
+
 int main(int argc, char **argv)
 {
 	int rc = 1;
 	struct ns *ns = NULL;
 	struct query *queries = NULL;
 	int n_ns = 0, n_queries = 0;
-	int c = 0;
+	int c = 0, i;
 
-	const char *url = "telecominfraproject.com";
-	const char *server = "127.0.0.1";
+	const char *urls[MAX_ARGS] = { "telecominfraproject.com" };
+	const char *servers[MAX_ARGS] = { "127.0.0.1" };
+	const char *url, *server;
+	int n_urls = 0, n_servers = 0;
+	unsigned long interval = default_interval;
+	unsigned long timeout = default_timeout * 1000;
+	int count = 1;
+	int stats = 0;
 	int v6 = 0;
 
 	while (1) {
-		int option = getopt(argc, argv, "u:s:i:6");
+		int option = getopt(argc, argv, "u:s:i:c:t:S6");
 
 		if (option == -1)
 			break;
@@ -625,23 +922,88 @@ int main(int argc, char **argv)
 				v6 = 1;
 				break;
 			case 'u':
-				url = optarg;
+				if (n_urls < MAX_ARGS)
+					urls[n_urls++] = optarg;
 				break;
 			case 's':
-				server = optarg;
+				if (n_servers < MAX_ARGS)
+					servers[n_servers++] = optarg;
+				break;
+			case 'S':
+				stats = 1;
+				break;
+			case 'c':
+				count = atoi(optarg);
+				break;
+			case 'i':
+				interval = strtoul(optarg, NULL, 10);
+				break;
+			case 't':
+				timeout = strtoul(optarg, NULL, 10);
 				break;
 			default:
 			case 'h':
 				printf("Usage: dnsprobe OPTIONS\n"
 				       "  -6 - use ipv6\n"
 				       "  -u <url>\n"
-				       "  -s <server>\n");
+				       "  -s <server>\n"
+				       "  -S - probe all servers and urls, report per server stats as json\n"
+				       "  -c <count> - number of probe rounds (-S)\n"
+				       "  -i <interval> - ms between probe rounds (-S)\n"
+				       "  -t <timeout> - ms to wait for a reply (-S)\n");
 				return -1;
 		}
 	}
 
+	if (!n_urls)
+		n_urls = 1;
+	if (!n_servers)
+		n_servers = 1;
+	url = urls[0];
+	server = servers[0];
+
 	ulog_open(ULOG_SYSLOG | ULOG_STDIO, LOG_DAEMON, "dnsprobe");
 
+	if (stats) {
+		struct probe *probes;
+		int n_sent;
+
+		if (count < 1 || !timeout) {
+			fprintf(stderr, "Invalid count or timeout\n");
+			goto out;
+		}
+
+		for (i = 0; i < n_urls; i++) {
+			if (!add_query(&queries, &n_queries, v6 ? T_AAAA : T_A, urls[i])) {
+				fprintf(stderr, "Failed to build query for %s\n", urls[i]);
+				goto out;
+			}
+		}
+
+		for (i = 0; i < n_servers; i++) {
+			if (!add_ns(&ns, &n_ns, servers[i])) {
+				fprintf(stderr, "Invalid server %s\n", servers[i]);
+				goto out;
+			}
+		}
+
+		/* transaction ids are unique within a run */
+		if ((long) n_ns * n_queries * count > 65536) {
+			fprintf(stderr, "Too many probes\n");
+			goto out;
+		}
+
+		probes = calloc(n_ns * n_queries * count, sizeof(*probes));
+		if (!probes)
+			goto out;
+
+		n_sent = probe_servers(ns, n_ns, queries, n_queries, probes, count, interval,
+		                       timeout);
+		rc = report_probes(ns, n_ns, probes, n_sent);
+		free(probes);
+		goto out;
+	}
+
 	ULOG_INFO("attempting to probe dns - %s %s %s\n", url, server, v6 ? "ipv6" : "");
 
 
@@ -1,11 +1,599 @@
 #include <radcli/radcli.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
 
-int main(int argc, char **argv)
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+#define RADIUS_ACCESS_REQUEST		1
+#define RADIUS_ACCESS_ACCEPT		2
+#define RADIUS_ACCESS_REJECT		3
+#define RADIUS_ACCOUNTING_REQUEST	4
+#define RADIUS_ACCOUNTING_RESPONSE	5
+#define RADIUS_ACCESS_CHALLENGE		11
+
+#define RADIUS_ATTR_USER_NAME		1
+#define RADIUS_ATTR_USER_PASSWORD	2
+#define RADIUS_ATTR_SERVICE_TYPE	6
+#define RADIUS_ATTR_NAS_IDENTIFIER	32
+#define RADIUS_ATTR_ACCT_STATUS_TYPE	40
+#define RADIUS_ATTR_ACCT_SESSION_ID	44
+#define RADIUS_ATTR_EVENT_TIMESTAMP	55
+#define RADIUS_ATTR_MESSAGE_AUTH	80
+
+#define RADIUS_SERVICE_AUTHENTICATE_ONLY	8
+#define RADIUS_ACCT_INTERIM_UPDATE		3
+
+#define RADIUS_HDR_LEN			20
+#define RADIUS_AUTH_LEN			16
+#define RADIUS_MAX_LEN			4096
+#define RADIUS_MAX_PASS_LEN		128
+#define RADIUS_IDS			256
+
+#define MAX_SERVERS	16
+#define MAX_WINDOW	1024
+
+/* log-linear RTT histogram, 16 buckets per power of two, ~6% resolution */
+#define HIST_SUB	16
+#define HIST_BUCKETS	512
+
+enum {
+	FLOW_AUTH,
+	FLOW_ACCT,
+};
+
+/* a request in flight, indexed by socket * 256 + identifier */
+struct slot {
+	unsigned long sent; /* usec, CLOCK_MONOTONIC */
+	unsigned char auth[RADIUS_AUTH_LEN];
+	int busy;
+};
+
+/* the requests of one type sent to one server */
+struct flow {
+	const char *name;
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	int type;
+
+	int fds[(MAX_WINDOW + RADIUS_IDS - 1) / RADIUS_IDS];
+	int n_fds;
+	struct slot *slots;
+	int n_slots;
+	int next_slot;
+	int inflight;
+	unsigned long next_expiry;
+
+	unsigned long sent, received, accepted, rejected, timeouts, errors, invalid;
+	unsigned long rtt_min, rtt_max, last;
+	unsigned long hist[HIST_BUCKETS];
+};
+
+static const char *secret;
+static const char *user_name = "healthcheck";
+static const char *user_pass = "uCentral";
+static unsigned int session;
+static unsigned int acct_seq;
+static EVP_MD_CTX *md_ctx;
+
+static unsigned long mtime_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int hist_bucket(unsigned long us)
+{
+	int e = 0;
+
+	if (us < HIST_SUB)
+		return us;
+
+	while ((us >> e) >= 2 * HIST_SUB)
+		e++;
+
+	if ((e + 1) * HIST_SUB + (us >> e) - HIST_SUB >= HIST_BUCKETS)
+		return HIST_BUCKETS - 1;
+
+	return (e + 1) * HIST_SUB + (us >> e) - HIST_SUB;
+}
+
+/* the middle of a bucket, in usec */
+static unsigned long hist_value(int bucket)
+{
+	int e;
+
+	if (bucket < 2 * HIST_SUB)
+		return bucket;
+
+	e = bucket / HIST_SUB - 1;
+
+	return ((unsigned long) (bucket - e * HIST_SUB) << e) + (1UL << e) / 2;
+}
+
+/* nearest rank percentile, clamped to the exact extremes */
+static double hist_percentile(const struct flow *f, int pct)
+{
+	unsigned long rank = (pct * f->received + 99) / 100, n = 0, v;
+	int i;
+
+	for (i = 0; i < HIST_BUCKETS - 1; i++) {
+		n += f->hist[i];
+		if (n >= rank)
+			break;
+	}
+
+	v = hist_value(i);
+	if (v < f->rtt_min)
+		v = f->rtt_min;
+	if (v > f->rtt_max)
+		v = f->rtt_max;
+
+	return v / 1000.0;
+}
+
+static void md5(unsigned char *out, const void *a, size_t a_len, const void *b, size_t b_len)
+{
+	EVP_DigestInit_ex(md_ctx, EVP_md5(), NULL);
+	EVP_DigestUpdate(md_ctx, a, a_len);
+	EVP_DigestUpdate(md_ctx, b, b_len);
+	EVP_DigestFinal_ex(md_ctx, out, NULL);
+}
+
+static unsigned char *put_attr(unsigned char *p, int type, const void *data, size_t len)
+{
+	*p++ = type;
+	*p++ = len + 2;
+	memcpy(p, data, len);
+
+	return p + len;
+}
+
+static unsigned char *put_attr_int(unsigned char *p, int type, uint32_t val)
+{
+	val = htonl(val);
+
+	return put_attr(p, type, &val, sizeof(val));
+}
+
+/* RFC 2865 section 5.2 */
+static unsigned char *put_password(unsigned char *p, const unsigned char *req_auth)
+{
+	unsigned char buf[RADIUS_MAX_PASS_LEN] = {}, b[RADIUS_AUTH_LEN];
+	size_t len = strlen(user_pass), i, j;
+
+	len = len ? (len + RADIUS_AUTH_LEN - 1) & ~(RADIUS_AUTH_LEN - 1) : RADIUS_AUTH_LEN;
+	memcpy(buf, user_pass, strlen(user_pass));
+
+	for (i = 0; i < len; i += RADIUS_AUTH_LEN) {
+		if (i)
+			md5(b, secret, strlen(secret), buf + i - RADIUS_AUTH_LEN, RADIUS_AUTH_LEN);
+		else
+			md5(b, secret, strlen(secret), req_auth, RADIUS_AUTH_LEN);
+
+		for (j = 0; j < RADIUS_AUTH_LEN; j++)
+			buf[i + j] ^= b[j];
+	}
+
+	return put_attr(p, RADIUS_ATTR_USER_PASSWORD, buf, len);
+}
+
+/*
+ * Build an Access-Request or Accounting-Request with the given identifier
+ * and store its Request Authenticator in auth.
+ */
+static size_t build_request(unsigned char *pkt, int type, int id, unsigned char *auth)
+{
+	unsigned char *p = pkt + RADIUS_HDR_LEN, *ma = NULL;
+	char session_id[32];
+	unsigned int md_len;
+	size_t len;
+
+	pkt[1] = id;
+	p = put_attr(p, RADIUS_ATTR_USER_NAME, user_name, strlen(user_name));
+	p = put_attr(p, RADIUS_ATTR_NAS_IDENTIFIER, "radiusprobe", strlen("radiusprobe"));
+
+	if (type == FLOW_AUTH) {
+		pkt[0] = RADIUS_ACCESS_REQUEST;
+		RAND_bytes(auth, RADIUS_AUTH_LEN);
+		memcpy(pkt + 4, auth, RADIUS_AUTH_LEN);
+
+		p = put_password(p, auth);
+		p = put_attr_int(p, RADIUS_ATTR_SERVICE_TYPE, RADIUS_SERVICE_AUTHENTICATE_ONLY);
+
+		/* servers may insist on it, RFC 3579 section 3.2 */
+		ma = p;
+		p = put_attr(p, RADIUS_ATTR_MESSAGE_AUTH, "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0",
+		             RADIUS_AUTH_LEN);
+	} else {
+		pkt[0] = RADIUS_ACCOUNTING_REQUEST;
+		memset(pkt + 4, 0, RADIUS_AUTH_LEN);
+
+		/*
+		 * The Request Authenticator is a hash of the packet, identical
+		 * requests would let a late reply to a reused identifier verify
+		 * and servers answer them from their duplicate cache.
+		 */
+		snprintf(session_id, sizeof(session_id), "radiusprobe-%08x-%08x", session,
+		         acct_seq++);
+		p = put_attr_int(p, RADIUS_ATTR_ACCT_STATUS_TYPE, RADIUS_ACCT_INTERIM_UPDATE);
+		p = put_attr(p, RADIUS_ATTR_ACCT_SESSION_ID, session_id, strlen(session_id));
+		p = put_attr_int(p, RADIUS_ATTR_EVENT_TIMESTAMP, time(NULL));
+	}
+
+	len = p - pkt;
+	pkt[2] = len >> 8;
+	pkt[3] = len & 0xff;
+
+	if (ma)
+		HMAC(EVP_md5(), secret, strlen(secret), pkt, len, ma + 2, &md_len);
+
+	if (type == FLOW_ACCT) {
+		/* RFC 2866 section 3 */
+		md5(auth, pkt, len, secret, strlen(secret));
+		memcpy(pkt + 4, auth, RADIUS_AUTH_LEN);
+	}
+
+	return len;
+}
+
+/* RFC 2865 section 3, the Response Authenticator */
+static int verify_response(unsigned char *pkt, size_t len, const unsigned char *req_auth)
+{
+	unsigned char resp_auth[RADIUS_AUTH_LEN], md[RADIUS_AUTH_LEN];
+
+	memcpy(resp_auth, pkt + 4, RADIUS_AUTH_LEN);
+	memcpy(pkt + 4, req_auth, RADIUS_AUTH_LEN);
+	md5(md, pkt, len, secret, strlen(secret));
+
+	return !memcmp(md, resp_auth, RADIUS_AUTH_LEN);
+}
+
+static int open_flow(struct flow *f, int window)
+{
+	int i;
+
+	f->n_fds = (window + RADIUS_IDS - 1) / RADIUS_IDS;
+	f->n_slots = f->n_fds * RADIUS_IDS;
+	f->next_expiry = ~0UL;
+	f->slots = calloc(f->n_slots, sizeof(*f->slots));
+	if (!f->slots)
+		return -1;
+
+	/* a connected socket only sees datagrams from the server */
+	for (i = 0; i < f->n_fds; i++) {
+		f->fds[i] = socket(f->addr.ss_family, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+		if (f->fds[i] < 0)
+			return -1;
+
+		if (connect(f->fds[i], (struct sockaddr *) &f->addr, f->addr_len) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static void close_flow(struct flow *f)
+{
+	int i;
+
+	for (i = 0; i < f->n_fds; i++)
+		if (f->fds[i] >= 0)
+			close(f->fds[i]);
+
+	free(f->slots);
+}
+
+/*
+ * Send requests until window of them are in flight. Identifiers are handed
+ * out round robin, so a slot is reused as late as possible and a late reply
+ * to its previous request fails the authenticator check.
+ */
+static int fill_flow(struct flow *f, int window)
+{
+	unsigned char pkt[RADIUS_MAX_LEN];
+	struct slot *s;
+	size_t len;
+
+	while (f->inflight < window) {
+		while (f->slots[f->next_slot].busy)
+			f->next_slot = (f->next_slot + 1) % f->n_slots;
+
+		s = &f->slots[f->next_slot];
+		len = build_request(pkt, f->type, f->next_slot % RADIUS_IDS, s->auth);
+
+		if (send(f->fds[f->next_slot / RADIUS_IDS], pkt, len, MSG_NOSIGNAL) < 0) {
+			if (errno != EAGAIN && errno != ENOBUFS)
+				f->errors++;
+			return -1;
+		}
+
+		s->sent = mtime_us();
+		s->busy = 1;
+		if (s->sent < f->next_expiry)
+			f->next_expiry = s->sent;
+		f->next_slot = (f->next_slot + 1) % f->n_slots;
+		f->inflight++;
+		f->sent++;
+	}
+
+	return 0;
+}
+
+/* expire timed out requests, next_expiry is the oldest send time left */
+static void expire_flow(struct flow *f, unsigned long now, unsigned long timeout)
+{
+	int i;
+
+	if (f->next_expiry == ~0UL || now < f->next_expiry + timeout)
+		return;
+
+	f->next_expiry = ~0UL;
+	for (i = 0; i < f->n_slots; i++) {
+		struct slot *s = &f->slots[i];
+
+		if (!s->busy)
+			continue;
+
+		if (now - s->sent >= timeout) {
+			s->busy = 0;
+			f->inflight--;
+			f->timeouts++;
+		} else if (s->sent < f->next_expiry) {
+			f->next_expiry = s->sent;
+		}
+	}
+}
+
+static void receive_flow(struct flow *f, int fd_idx)
+{
+	unsigned char pkt[RADIUS_MAX_LEN];
+	unsigned long now, rtt;
+	struct slot *s;
+	ssize_t len;
+	size_t pkt_len;
+
+	while (1) {
+		len = recv(f->fds[fd_idx], pkt, sizeof(pkt), 0);
+		if (len < 0) {
+			/* ICMP unreachable from the server */
+			if (errno != EAGAIN && errno != EINTR)
+				f->errors++;
+			if (errno != EINTR)
+				break;
+			continue;
+		}
+
+		now = mtime_us();
+
+		if (len < RADIUS_HDR_LEN) {
+			f->invalid++;
+			continue;
+		}
+
+		pkt_len = (pkt[2] << 8) | pkt[3];
+		s = &f->slots[fd_idx * RADIUS_IDS + pkt[1]];
+
+		if (pkt_len < RADIUS_HDR_LEN || pkt_len > (size_t) len || !s->busy ||
+		    !verify_response(pkt, pkt_len, s->auth)) {
+			f->invalid++;
+			continue;
+		}
+
+		switch (pkt[0]) {
+			case RADIUS_ACCESS_ACCEPT:
+			case RADIUS_ACCESS_CHALLENGE:
+			case RADIUS_ACCOUNTING_RESPONSE:
+				f->accepted++;
+				break;
+			case RADIUS_ACCESS_REJECT:
+				f->rejected++;
+				break;
+			default:
+				f->invalid++;
+				continue;
+		}
+
+		rtt = now - s->sent;
+		s->busy = 0;
+		f->inflight--;
+		f->received++;
+		f->last = now;
+		f->hist[hist_bucket(rtt)]++;
+		if (f->received == 1 || rtt < f->rtt_min)
+			f->rtt_min = rtt;
+		if (rtt > f->rtt_max)
+			f->rtt_max = rtt;
+	}
+}
+
+/*
+ * Keep window requests in flight on every flow for duration seconds, then
+ * wait for the last of them to be answered or to time out.
+ */
+static void run_flows(struct flow *flows, int n_flows, int window, unsigned long duration,
+                      unsigned long timeout, unsigned long *start)
+{
+	struct pollfd pfd[MAX_SERVERS * 2 * (MAX_WINDOW / RADIUS_IDS)];
+	int pfd_flow[MAX_SERVERS * 2 * (MAX_WINDOW / RADIUS_IDS)];
+	int pfd_idx[MAX_SERVERS * 2 * (MAX_WINDOW / RADIUS_IDS)];
+	unsigned long now, end, delay;
+	int n_pfd = 0, busy, i, j;
+
+	for (i = 0; i < n_flows; i++) {
+		for (j = 0; j < flows[i].n_fds; j++) {
+			pfd[n_pfd].fd = flows[i].fds[j];
+			pfd[n_pfd].events = POLLIN;
+			pfd_flow[n_pfd] = i;
+			pfd_idx[n_pfd++] = j;
+		}
+	}
+
+	*start = mtime_us();
+	end = *start + duration * 1000000;
+
+	while (1) {
+		now = mtime_us();
+		busy = 0;
+		delay = now < end ? end - now : ~0UL;
+
+		for (i = 0; i < n_flows; i++) {
+			struct flow *f = &flows[i];
+
+			expire_flow(f, now, timeout);
+
+			/* the socket buffer is full, try again shortly */
+			if (now < end && fill_flow(f, window) && delay > 1000)
+				delay = 1000;
+
+			if (f->next_expiry != ~0UL && f->next_expiry + timeout - now < delay)
+				delay = f->next_expiry + timeout - now;
+
+			busy |= f->inflight;
+		}
+
+		if (now >= end && !busy)
+			break;
+
+		if (poll(pfd, n_pfd, (delay + 999) / 1000) <= 0)
+			continue;
+
+		for (i = 0; i < n_pfd; i++)
+			if (pfd[i].revents & (POLLIN | POLLERR))
+				receive_flow(&flows[pfd_flow[i]], pfd_idx[i]);
+	}
+}
+
+static void print_json_string(const char *str)
+{
+	putchar('"');
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			putchar('\\');
+		if ((unsigned char) *str >= 0x20)
+			putchar(*str);
+	}
+	putchar('"');
+}
+
+static int report_flows(struct flow *flows, int n_flows, unsigned long start)
+{
+	char host[NI_MAXHOST], serv[NI_MAXSERV];
+	int i, rc = 0;
+
+	printf("{\"servers\":[");
+
+	for (i = 0; i < n_flows; i++) {
+		struct flow *f = &flows[i];
+		unsigned long elapsed = f->last > start ? f->last - start : 0;
+
+		if (getnameinfo((struct sockaddr *) &f->addr, f->addr_len, host, sizeof(host), serv,
+		                sizeof(serv), NI_NUMERICHOST | NI_NUMERICSERV))
+			strcpy(host, "");
+
+		printf("%s{\"server\":", i ? "," : "");
+		print_json_string(f->name);
+		printf(",\"address\":\"%s\",\"port\":%s,\"type\":\"%s\",\"sent\":%lu,"
+		       "\"received\":%lu,\"accepted\":%lu,\"rejected\":%lu,\"timeouts\":%lu,"
+		       "\"errors\":%lu,\"invalid\":%lu,\"rps\":%.1f",
+		       host, serv, f->type == FLOW_AUTH ? "auth" : "acct", f->sent, f->received,
+		       f->accepted, f->rejected, f->timeouts, f->errors, f->invalid,
+		       elapsed ? f->received * 1000000.0 / elapsed : 0.0);
+
+		if (f->received)
+			printf(",\"rtt_ms\":{\"min\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,"
+			       "\"max\":%.3f}",
+			       f->rtt_min / 1000.0, hist_percentile(f, 50), hist_percentile(f, 90),
+			       hist_percentile(f, 99), f->rtt_max / 1000.0);
+		else
+			rc = 1;
+
+		printf("}");
+	}
+
+	printf("]}\n");
+
+	return rc;
+}
+
+static int add_flow(struct flow *f, const char *server, int type, const char *port)
+{
+	struct addrinfo *ai, hints = { .ai_flags = AI_NUMERICSERV, .ai_socktype = SOCK_DGRAM };
+
+	if (getaddrinfo(server, port, &hints, &ai))
+		return -1;
+
+	memcpy(&f->addr, ai->ai_addr, ai->ai_addrlen);
+	f->addr_len = ai->ai_addrlen;
+	f->name = server;
+	f->type = type;
+	memset(f->fds, -1, sizeof(f->fds));
+	freeaddrinfo(ai);
+
+	return 0;
+}
+
+static int load_test(const char **servers, int n_servers, int types, const char *auth_port,
+                     const char *acct_port, int window, unsigned long duration,
+                     unsigned long timeout)
+{
+	struct flow *flows;
+	unsigned long start;
+	int n_flows = 0, rc = -1, i;
+
+	flows = calloc(n_servers * 2, sizeof(*flows));
+	md_ctx = EVP_MD_CTX_new();
+	if (!flows || !md_ctx)
+		goto out;
+
+	RAND_bytes((unsigned char *) &session, sizeof(session));
+
+	for (i = 0; i < n_servers; i++) {
+		if ((types & (1 << FLOW_AUTH)) &&
+		    add_flow(&flows[n_flows++], servers[i], FLOW_AUTH, auth_port)) {
+			fprintf(stderr, "Invalid server %s\n", servers[i]);
+			goto out;
+		}
+
+		if ((types & (1 << FLOW_ACCT)) &&
+		    add_flow(&flows[n_flows++], servers[i], FLOW_ACCT, acct_port)) {
+			fprintf(stderr, "Invalid server %s\n", servers[i]);
+			goto out;
+		}
+	}
+
+	for (i = 0; i < n_flows; i++) {
+		if (open_flow(&flows[i], window)) {
+			fprintf(stderr, "Failed to open socket for %s: %s\n", flows[i].name,
+			        strerror(errno));
+			goto out;
+		}
+	}
+
+	run_flows(flows, n_flows, window, duration, timeout * 1000, &start);
+	rc = report_flows(flows, n_flows, start);
+
+out:
+	for (i = 0; flows && i < n_flows; i++)
+		close_flow(&flows[i]);
+	free(flows);
+	EVP_MD_CTX_free(md_ctx);
+
+	return rc;
+}
+
+static int probe_single(void)
 {
-	(void) argc;
-	(void) argv;
 	int result;
 	char username[128];
 	char passwd[AUTH_PASS_LEN + 1];
@@ -46,3 +634,98 @@ int main(int argc, char **argv)
 
 	return result;
 }
+
+int main(int argc, char **argv)
+{
+	const char *servers[MAX_SERVERS];
+	const char *auth_port = "1812", *acct_port = "1813";
+	unsigned long duration = 10, timeout = 2000;
+	int n_servers = 0, window = 32, types = 1 << FLOW_AUTH;
+	int load = 0;
+
+	while (1) {
+		int option = getopt(argc, argv, "Ls:k:m:w:d:t:u:p:P:A:");
+
+		if (option == -1)
+			break;
+
+		switch (option) {
+			case 'L':
+				load = 1;
+				break;
+			case 's':
+				if (n_servers < MAX_SERVERS)
+					servers[n_servers++] = optarg;
+				break;
+			case 'k':
+				secret = optarg;
+				break;
+			case 'm':
+				if (!strcmp(optarg, "auth"))
+					types = 1 << FLOW_AUTH;
+				else if (!strcmp(optarg, "acct"))
+					types = 1 << FLOW_ACCT;
+				else if (!strcmp(optarg, "both"))
+					types = (1 << FLOW_AUTH) | (1 << FLOW_ACCT);
+				else
+					types = 0;
+				break;
+			case 'w':
+				window = atoi(optarg);
+				break;
+			case 'd':
+				duration = strtoul(optarg, NULL, 10);
+				break;
+			case 't':
+				timeout = strtoul(optarg, NULL, 10);
+				break;
+			case 'u':
+				user_name = optarg;
+				break;
+			case 'p':
+				user_pass = optarg;
+				break;
+			case 'P':
+				auth_port = optarg;
+				break;
+			case 'A':
+				acct_port = optarg;
+				break;
+			default:
+			case 'h':
+				printf("Usage: radiusprobe OPTIONS\n"
+				       "  -L - keep requests in flight, report per server stats as json\n"
+				       "  -s <server> - server to load (-L)\n"
+				       "  -k <secret> - shared secret (-L)\n"
+				       "  -m auth|acct|both - request types (-L)\n"
+				       "  -w <window> - requests in flight per server and type (-L)\n"
+				       "  -d <duration> - seconds to send requests for (-L)\n"
+				       "  -t <timeout> - ms to wait for a reply (-L)\n"
+				       "  -u <username>, -p <password> (-L)\n"
+				       "  -P <port>, -A <port> - auth and acct ports (-L)\n"
+				       "Without -L a single Access-Request is sent as set up in "
+				       "/tmp/radius.conf\n");
+				return -1;
+		}
+	}
+
+	if (!load)
+		return probe_single();
+
+	if (!n_servers || !secret || !types) {
+		fprintf(stderr, "Need a server, a secret and a request type\n");
+		return -1;
+	}
+
+	if (window < 1 || window > MAX_WINDOW || !timeout) {
+		fprintf(stderr, "Invalid window or timeout\n");
+		return -1;
+	}
+
+	if (strlen(user_name) > 253 || strlen(user_pass) > RADIUS_MAX_PASS_LEN) {
+		fprintf(stderr, "Username or password too long\n");
+		return -1;
+	}
+
+	return load_test(servers, n_servers, types, auth_port, acct_port, window, duration, timeout);
+}
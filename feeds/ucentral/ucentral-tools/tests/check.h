@@ -0,0 +1,18 @@
+// Pass/fail reporting shared by the tests, each check prints one line and
+// main() returns failures ? 1 : 0.
+
+#ifndef __UCENTRAL_TOOLS_CHECK_H
+#define __UCENTRAL_TOOLS_CHECK_H
+
+#include <stdio.h>
+
+static int failures;
+
+static void check(int cond, const char *msg)
+{
+	printf("%s: %s\n", cond ? "ok" : "FAIL", msg);
+	if (!cond)
+		failures++;
+}
+
+#endif
@@ -0,0 +1,326 @@
+// Runs "dhcpdiscover -j" on several veth pairs in a scratch network namespace
+// with a stub DHCP server on the far end of each one and checks the offers it
+// reports per interface. The server ends live in a namespace of their own, the
+// client would use the server address as source otherwise.
+//
+//  - dhc0: a server answering after SLOW_MS
+//  - dhc1: a server answering at once, after a reply with another xid that
+//    must be counted as a response but not as an offer
+//  - dhc2: no server
+//  - dhcX: no such interface
+//
+// All interfaces are probed in parallel, so the run takes one timeout.
+// Needs root.
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdarg.h>
+
+// pull in the probe code, it is driven through its main()
+#define main dhcpdiscover_main
+#include "../src/dhcpdiscover.c"
+#undef main
+
+#include "check.h"
+
+#define N_VETH		3
+#define SLOW_MS		200
+#define TIMEOUT_S	1
+#define LEASE_TIME	3600
+
+struct stub {
+	int delay_ms;
+	int bogus_xid;
+	int silent;
+
+	char dev[IFNAMSIZ];
+	int fd;
+	int discovers;
+	pthread_t thread;
+};
+
+static struct stub stubs[N_VETH] = {
+	{ .delay_ms = SLOW_MS },
+	{ .bogus_xid = 1 },
+	{ .silent = 1 },
+};
+
+static volatile int stop;
+
+static int run(const char *fmt, ...)
+{
+	char cmd[256];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(cmd, sizeof(cmd), fmt, ap);
+	va_end(ap);
+
+	return system(cmd);
+}
+
+/* srvN with 10.N.0.1 in the server namespace, dhcN moved to the client one */
+static int setup_veth(int n, int client_ns)
+{
+	return run("ip link add dhc%d type veth peer name srv%d && "
+	           "ip addr add 10.%d.0.1/24 dev srv%d && ip link set srv%d up && "
+	           "ip link set dhc%d netns /proc/%d/fd/%d",
+	           n, n, n, n, n, n, (int) getpid(), client_ns);
+}
+
+static int stub_open(struct stub *s, int n)
+{
+	struct timeval tv = { .tv_usec = 50000 };
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(DHCP_SERVER_PORT),
+	};
+	int one = 1;
+
+	snprintf(s->dev, sizeof(s->dev), "srv%d", n);
+
+	s->fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (s->fd < 0)
+		return -1;
+
+	setsockopt(s->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	setsockopt(s->fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+	setsockopt(s->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	if (setsockopt(s->fd, SOL_SOCKET, SO_BINDTODEVICE, s->dev, strlen(s->dev) + 1))
+		return -1;
+
+	return bind(s->fd, (struct sockaddr *) &addr, sizeof(addr));
+}
+
+static void stub_offer(struct stub *s, const dhcp_packet *discover, u_int32_t xid, int n)
+{
+	struct sockaddr_in to = {
+		.sin_family = AF_INET,
+		.sin_port = htons(DHCP_CLIENT_PORT),
+		.sin_addr.s_addr = INADDR_BROADCAST,
+	};
+	u_int32_t lease = htonl(LEASE_TIME);
+	dhcp_packet offer = {
+		.op = BOOTREPLY,
+		.htype = ETHERNET_HARDWARE_ADDRESS,
+		.hlen = ETHERNET_HARDWARE_ADDRESS_LENGTH,
+		.xid = xid,
+	};
+	unsigned char *o = offer.options;
+
+	offer.yiaddr.s_addr = htonl(0x0a000064 | n << 16);
+	memcpy(offer.chaddr, discover->chaddr, sizeof(offer.chaddr));
+
+	memcpy(o, "\x63\x82\x53\x63", 4);
+	o += 4;
+	*o++ = DHCP_OPTION_MESSAGE_TYPE;
+	*o++ = 1;
+	*o++ = DHCPOFFER;
+	*o++ = DHCP_OPTION_LEASE_TIME;
+	*o++ = 4;
+	memcpy(o, &lease, 4);
+	o += 4;
+	*o = 255;
+
+	sendto(s->fd, &offer, sizeof(offer), 0, (struct sockaddr *) &to, sizeof(to));
+}
+
+static void *stub_serve(void *arg)
+{
+	struct stub *s = arg;
+	int n = s - stubs;
+	dhcp_packet discover;
+	ssize_t len;
+
+	while (!stop) {
+		len = recv(s->fd, &discover, sizeof(discover), 0);
+		if (len < (ssize_t) offsetof(dhcp_packet, options) || discover.op != BOOTREQUEST)
+			continue;
+
+		s->discovers++;
+		if (s->silent)
+			continue;
+
+		if (s->delay_ms)
+			usleep(s->delay_ms * 1000);
+
+		if (s->bogus_xid)
+			stub_offer(s, &discover, discover.xid ^ htonl(1), n);
+
+		stub_offer(s, &discover, discover.xid, n);
+	}
+
+	return NULL;
+}
+
+/* runs dhcpdiscover_main() with its output going to out */
+static int run_discover(int argc, char **argv, char *out, size_t size)
+{
+	FILE *f = tmpfile();
+	int saved, rc;
+	size_t len;
+
+	if (!f)
+		return -1;
+
+	fflush(stdout);
+	saved = dup(STDOUT_FILENO);
+	dup2(fileno(f), STDOUT_FILENO);
+
+	optind = 1;
+	rc = dhcpdiscover_main(argc, argv);
+
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+
+	rewind(f);
+	len = fread(out, 1, size - 1, f);
+	out[len] = '\0';
+	fclose(f);
+
+	return rc;
+}
+
+struct iface_result {
+	int error;
+	int responses;
+	int offers;
+	char server[INET_ADDRSTRLEN];
+	char address[INET_ADDRSTRLEN];
+	unsigned long lease_time;
+	double latency_ms;
+};
+
+/* the json entry of one interface, the offers of the first server only */
+static int parse_iface(const char *out, const char *dev, struct iface_result *r)
+{
+	char key[64];
+	const char *p, *end, *o;
+
+	memset(r, 0, sizeof(*r));
+
+	snprintf(key, sizeof(key), "{\"interface\":\"%s\"", dev);
+	p = strstr(out, key);
+	if (!p)
+		return -1;
+
+	p += strlen(key);
+	end = strstr(p, "{\"interface\":");
+	if (!end)
+		end = p + strlen(p);
+
+	if (!strncmp(p, ",\"error\":true", 13)) {
+		r->error = 1;
+		return 0;
+	}
+
+	if (sscanf(p, ",\"responses\":%d", &r->responses) != 1)
+		return -1;
+
+	for (o = strstr(p, "{\"server\":"); o && o < end; o = strstr(o + 1, "{\"server\":")) {
+		if (!r->offers++)
+			sscanf(o, "{\"server\":\"%15[^\"]\",\"address\":\"%15[^\"]\",\"lease_time\":%lu,"
+			       "\"latency_ms\":%lf", r->server, r->address, &r->lease_time,
+			       &r->latency_ms);
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	char *argv[] = {
+		"dhcpdiscover", "-j", "-t", "1",
+		"-i", "dhc0", "-i", "dhc1", "-i", "dhc2", "-i", "dhcX", NULL,
+	};
+	struct iface_result r[N_VETH + 1];
+	const char *devs[] = { "dhc0", "dhc1", "dhc2", "dhcX" };
+	struct timespec start, end;
+	char out[4096], msg[160];
+	unsigned long ms;
+	int client_ns, rc, i;
+
+	if (unshare(CLONE_NEWNET)) {
+		perror("unshare");
+		return 1;
+	}
+
+	/* the stub sockets stay in the server namespace once opened */
+	client_ns = open("/proc/self/ns/net", O_RDONLY);
+	if (client_ns < 0 || unshare(CLONE_NEWNET)) {
+		perror("server namespace");
+		return 1;
+	}
+
+	for (i = 0; i < N_VETH; i++) {
+		if (setup_veth(i, client_ns) || stub_open(&stubs[i], i)) {
+			fprintf(stderr, "Failed to set up srv%d: %s\n", i, strerror(errno));
+			return 1;
+		}
+	}
+
+	if (setns(client_ns, CLONE_NEWNET)) {
+		perror("setns");
+		return 1;
+	}
+
+	for (i = 0; i < N_VETH; i++) {
+		if (run("ip link set dhc%d up", i)) {
+			fprintf(stderr, "Failed to set up dhc%d\n", i);
+			return 1;
+		}
+	}
+
+	for (i = 0; i < N_VETH; i++)
+		pthread_create(&stubs[i].thread, NULL, stub_serve, &stubs[i]);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	rc = run_discover(sizeof(argv) / sizeof(argv[0]) - 1, argv, out, sizeof(out));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ms = elapsed_us(&start, &end) / 1000;
+
+	stop = 1;
+	for (i = 0; i < N_VETH; i++)
+		pthread_join(stubs[i].thread, NULL);
+
+	printf("dhcpdiscover -j: %s", out);
+
+	for (i = 0; i <= N_VETH; i++) {
+		if (parse_iface(out, devs[i], &r[i])) {
+			snprintf(msg, sizeof(msg), "%s reported", devs[i]);
+			check(0, msg);
+			return 1;
+		}
+	}
+
+	check(rc == STATE_UNKNOWN, "missing interface makes the run fail");
+
+	for (i = 0; i < N_VETH; i++) {
+		snprintf(msg, sizeof(msg), "%s: one DHCPDISCOVER on the wire (got %d)", devs[i],
+		         stubs[i].discovers);
+		check(stubs[i].discovers == 1 && !r[i].error, msg);
+	}
+
+	snprintf(msg, sizeof(msg), "dhc0: offer of 10.0.0.100 from 10.0.0.1 after %.3f ms",
+	         r[0].latency_ms);
+	check(r[0].offers == 1 && r[0].responses == 1 && !strcmp(r[0].server, "10.0.0.1") &&
+	      !strcmp(r[0].address, "10.0.0.100") && r[0].lease_time == LEASE_TIME &&
+	      r[0].latency_ms >= SLOW_MS, msg);
+
+	snprintf(msg, sizeof(msg), "dhc1: reply with another xid ignored (%d responses, %d offers)",
+	         r[1].responses, r[1].offers);
+	check(r[1].responses == 2 && r[1].offers == 1 && !strcmp(r[1].server, "10.1.0.1") &&
+	      !strcmp(r[1].address, "10.1.0.100") && r[1].latency_ms < SLOW_MS, msg);
+
+	check(!r[2].responses && !r[2].offers, "dhc2: no server, no offers");
+	check(r[3].error, "dhcX: reported as error");
+
+	/* all interfaces share one timeout */
+	snprintf(msg, sizeof(msg), "run took %lu ms for %d interfaces", ms, N_VETH + 1);
+	check(ms >= TIMEOUT_S * 1000 && ms < TIMEOUT_S * 1000 + 500, msg);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,273 @@
+// Runs "dnsprobe -S" against stub DNS responders on the loopback and checks
+// the per server stats it reports.
+//
+//  - a slow server that drops every third query
+//  - a fast server that also sends a reply with a mismatched question and
+//    a copy of every reply from another address, both must be ignored
+//  - an IPv6 server answering SERVFAIL
+//  - a server that never answers
+
+// pull in the probe code, the stats mode is driven through its main()
+#define main dnsprobe_main
+#include "../src/dnsprobe.c"
+#undef main
+
+#include <pthread.h>
+
+#include "check.h"
+
+#define ROUNDS		10
+#define INTERVAL_MS	50
+#define TIMEOUT_MS	300
+#define SLOW_MS		10
+
+struct stub {
+	int family;
+	const char *addr;
+	int delay_ms;
+	int drop_every;
+	int rcode;
+	int decoy;
+	int silent;
+
+	int fd, port;
+	int queries;
+	pthread_t thread;
+};
+
+static struct stub stubs[] = {
+	{ .family = AF_INET, .addr = "127.0.0.1", .delay_ms = SLOW_MS, .drop_every = 3 },
+	{ .family = AF_INET, .addr = "127.0.0.2", .decoy = 1 },
+	{ .family = AF_INET6, .addr = "::1", .rcode = 2 },
+	{ .family = AF_INET, .addr = "127.0.0.1", .silent = 1 },
+};
+
+#define N_STUBS (int) (sizeof(stubs) / sizeof(stubs[0]))
+
+static volatile int stop;
+
+static int stub_open(struct stub *s)
+{
+	struct timeval tv = { .tv_usec = 50000 };
+	len_and_sockaddr a = {};
+
+	if (s->family == AF_INET6) {
+		a.u.sin6.sin6_family = AF_INET6;
+		inet_pton(AF_INET6, s->addr, &a.u.sin6.sin6_addr);
+		a.len = sizeof(a.u.sin6);
+	} else {
+		a.u.sin.sin_family = AF_INET;
+		inet_pton(AF_INET, s->addr, &a.u.sin.sin_addr);
+		a.len = sizeof(a.u.sin);
+	}
+
+	s->fd = socket(s->family, SOCK_DGRAM, 0);
+	if (s->fd < 0 || bind(s->fd, &a.u.sa, a.len))
+		return -1;
+
+	/* lets the thread notice stop */
+	setsockopt(s->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	if (getsockname(s->fd, &a.u.sa, &a.len))
+		return -1;
+
+	s->port = ntohs(s->family == AF_INET6 ? a.u.sin6.sin6_port : a.u.sin.sin_port);
+
+	return 0;
+}
+
+static void *stub_serve(void *arg)
+{
+	struct stub *s = arg;
+	unsigned char buf[512];
+	len_and_sockaddr from;
+	ssize_t len;
+
+	while (!stop) {
+		from.len = sizeof(from.u);
+		len = recvfrom(s->fd, buf, sizeof(buf), 0, &from.u.sa, &from.len);
+		if (len < 12)
+			continue;
+
+		s->queries++;
+		if (s->silent || (s->drop_every && s->queries % s->drop_every == 0))
+			continue;
+
+		if (s->delay_ms)
+			usleep(s->delay_ms * 1000);
+
+		buf[2] |= 0x80;
+		buf[3] = 0x80 | s->rcode;
+
+		if (s->decoy) {
+			/* same id, other question */
+			buf[13] ^= 0x20;
+			sendto(s->fd, buf, len, 0, &from.u.sa, from.len);
+			buf[13] ^= 0x20;
+
+			/* right reply, wrong server */
+			sendto(stubs[N_STUBS - 1].fd, buf, len, 0, &from.u.sa, from.len);
+		}
+
+		sendto(s->fd, buf, len, 0, &from.u.sa, from.len);
+	}
+
+	return NULL;
+}
+
+/* runs dnsprobe_main() with its output going to out */
+static int run_probe(int argc, char **argv, char *out, size_t size)
+{
+	FILE *f = tmpfile();
+	int saved, rc;
+	size_t len;
+
+	if (!f)
+		return -1;
+
+	fflush(stdout);
+	saved = dup(STDOUT_FILENO);
+	dup2(fileno(f), STDOUT_FILENO);
+
+	optind = 1;
+	rc = dnsprobe_main(argc, argv);
+
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+
+	rewind(f);
+	len = fread(out, 1, size - 1, f);
+	out[len] = '\0';
+	fclose(f);
+
+	return rc;
+}
+
+struct server_stats {
+	int sent, received, errors;
+	double loss;
+	int has_rtt;
+	double rtt_min;
+};
+
+/* the servers are reported in command line order */
+static int parse_server(const char *out, int idx, struct server_stats *st)
+{
+	const char *p = out, *next;
+	int i;
+
+	for (i = 0; i <= idx; i++) {
+		p = strstr(p, "{\"server\":");
+		if (!p)
+			return -1;
+		p++;
+	}
+
+	p = strstr(p, "\"sent\":");
+	if (!p || sscanf(p, "\"sent\":%d,\"received\":%d,\"errors\":%d,\"loss\":%lf",
+	                 &st->sent, &st->received, &st->errors, &st->loss) != 4)
+		return -1;
+
+	next = strstr(p, "{\"server\":");
+	p = strstr(p, "\"rtt_ms\":{\"min\":");
+	st->has_rtt = p && (!next || p < next);
+	if (st->has_rtt)
+		sscanf(p, "\"rtt_ms\":{\"min\":%lf", &st->rtt_min);
+
+	return 0;
+}
+
+int main(void)
+{
+	char server_args[N_STUBS][64], out[4096], msg[128];
+	char count[16], interval[16], timeout[16];
+	char *argv[32];
+	struct server_stats st[N_STUBS];
+	unsigned long start, ms;
+	int argc = 0, rc, i;
+
+	for (i = 0; i < N_STUBS; i++) {
+		if (stub_open(&stubs[i])) {
+			fprintf(stderr, "Failed to bind %s: %s\n", stubs[i].addr, strerror(errno));
+			return 1;
+		}
+	}
+
+	for (i = 0; i < N_STUBS; i++)
+		pthread_create(&stubs[i].thread, NULL, stub_serve, &stubs[i]);
+
+	snprintf(count, sizeof(count), "%d", ROUNDS);
+	snprintf(interval, sizeof(interval), "%d", INTERVAL_MS);
+	snprintf(timeout, sizeof(timeout), "%d", TIMEOUT_MS);
+
+	argv[argc++] = (char *) "dnsprobe";
+	argv[argc++] = (char *) "-S";
+	argv[argc++] = (char *) "-c";
+	argv[argc++] = count;
+	argv[argc++] = (char *) "-i";
+	argv[argc++] = interval;
+	argv[argc++] = (char *) "-t";
+	argv[argc++] = timeout;
+	argv[argc++] = (char *) "-u";
+	argv[argc++] = (char *) "probe.example";
+	argv[argc++] = (char *) "-u";
+	argv[argc++] = (char *) "other.example";
+	for (i = 0; i < N_STUBS; i++) {
+		snprintf(server_args[i], sizeof(server_args[i]), "%s#%d", stubs[i].addr, stubs[i].port);
+		argv[argc++] = (char *) "-s";
+		argv[argc++] = server_args[i];
+	}
+	argv[argc] = NULL;
+
+	start = mtime_us();
+	rc = run_probe(argc, argv, out, sizeof(out));
+	ms = (mtime_us() - start) / 1000;
+
+	stop = 1;
+	for (i = 0; i < N_STUBS; i++)
+		pthread_join(stubs[i].thread, NULL);
+
+	printf("dnsprobe -S: %s", out);
+
+	for (i = 0; i < N_STUBS; i++) {
+		if (parse_server(out, i, &st[i])) {
+			snprintf(msg, sizeof(msg), "server %d reported", i);
+			check(0, msg);
+			return 1;
+		}
+	}
+
+	check(rc == 1, "exit code 1 as one server never answered");
+
+	for (i = 0; i < N_STUBS; i++) {
+		snprintf(msg, sizeof(msg), "server %d: %d probes sent (got %d), %d received by the stub",
+		         i, 2 * ROUNDS, st[i].sent, stubs[i].queries);
+		check(st[i].sent == 2 * ROUNDS && stubs[i].queries == 2 * ROUNDS, msg);
+	}
+
+	snprintf(msg, sizeof(msg), "slow server: every third probe lost (%d received, %.1f%% loss)",
+	         st[0].received, st[0].loss);
+	check(st[0].received == 2 * ROUNDS - 2 * ROUNDS / 3 && !st[0].errors, msg);
+	snprintf(msg, sizeof(msg), "slow server: rtt includes the reply delay (min %.3f ms)",
+	         st[0].rtt_min);
+	check(st[0].has_rtt && st[0].rtt_min >= SLOW_MS, msg);
+
+	snprintf(msg, sizeof(msg), "decoy replies ignored (%d received, %d errors)",
+	         st[1].received, st[1].errors);
+	check(st[1].received == 2 * ROUNDS && !st[1].errors && st[1].loss == 0.0 &&
+	      st[1].has_rtt, msg);
+
+	snprintf(msg, sizeof(msg), "SERVFAIL answers counted as errors (%d of %d)",
+	         st[2].errors, st[2].received);
+	check(st[2].received == 2 * ROUNDS && st[2].errors == 2 * ROUNDS, msg);
+
+	check(!st[3].received && st[3].loss == 100.0 && !st[3].has_rtt,
+	      "silent server: all probes lost, no rtt");
+
+	/* the last round goes out after ROUNDS - 1 intervals, then one timeout at most */
+	snprintf(msg, sizeof(msg), "run took %lu ms", ms);
+	check(ms < (ROUNDS - 1) * INTERVAL_MS + TIMEOUT_MS + 200, msg);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,363 @@
+// Runs "radiusprobe -L" against a stub RADIUS server on the loopback and
+// checks the per flow stats it reports against what the server saw.
+//
+// The stub checks the Message-Authenticator and the hidden password of every
+// Access-Request and the Request Authenticator of every Accounting-Request.
+// It drops every DROP_EVERY-th request of each type and sends the reply to a
+// dropped Accounting-Request once its identifier is reused, which has to be
+// counted as invalid. An Accounting-Request that repeats the previous request
+// with the same identifier is counted as a duplicate.
+
+// pull in the load code, it is driven through its main()
+#define main radiusprobe_main
+#include "../src/radiusprobe.c"
+#undef main
+
+#include <pthread.h>
+
+#include "check.h"
+
+#define SECRET		"testing123"
+#define PASSWORD	"uCentral"
+#define DROP_EVERY	100
+#define WINDOW		16
+#define TIMEOUT_MS	100
+
+struct stub {
+	int acct;
+
+	int fd, port;
+	unsigned long requests, drops, late, bad_auth, duplicates;
+	unsigned long accepted, rejected;
+
+	/* per identifier: the last request and a held back reply */
+	unsigned char last_auth[RADIUS_IDS][RADIUS_AUTH_LEN];
+	int seen[RADIUS_IDS];
+	unsigned char late_reply[RADIUS_IDS][RADIUS_HDR_LEN];
+	struct sockaddr_storage late_addr[RADIUS_IDS];
+	socklen_t late_addr_len[RADIUS_IDS];
+
+	pthread_t thread;
+};
+
+static struct stub stubs[2] = { { .acct = 0 }, { .acct = 1 } };
+
+static volatile int stop;
+
+static void stub_md5(unsigned char *out, const void *a, size_t a_len, const void *b,
+                     size_t b_len)
+{
+	EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+
+	EVP_DigestInit_ex(ctx, EVP_md5(), NULL);
+	EVP_DigestUpdate(ctx, a, a_len);
+	EVP_DigestUpdate(ctx, b, b_len);
+	EVP_DigestFinal_ex(ctx, out, NULL);
+	EVP_MD_CTX_free(ctx);
+}
+
+static unsigned char *find_attr(unsigned char *pkt, size_t len, int type)
+{
+	size_t i = RADIUS_HDR_LEN;
+
+	while (i + 2 <= len && pkt[i + 1] >= 2 && i + pkt[i + 1] <= len) {
+		if (pkt[i] == type)
+			return pkt + i;
+		i += pkt[i + 1];
+	}
+
+	return NULL;
+}
+
+/* RFC 3579 section 3.2 and RFC 2865 section 5.2, the code of the reply */
+static int stub_check_auth(unsigned char *pkt, size_t len)
+{
+	unsigned char *ma = find_attr(pkt, len, RADIUS_ATTR_MESSAGE_AUTH);
+	unsigned char *pw = find_attr(pkt, len, RADIUS_ATTR_USER_PASSWORD);
+	unsigned char md[RADIUS_AUTH_LEN], plain[RADIUS_MAX_PASS_LEN + 1] = {};
+	unsigned char saved[RADIUS_AUTH_LEN];
+	const unsigned char *b = pkt + 4;
+	unsigned int md_len;
+	size_t pw_len, i, j;
+
+	if (!ma || ma[1] != 2 + RADIUS_AUTH_LEN || !pw)
+		return -1;
+
+	memcpy(saved, ma + 2, RADIUS_AUTH_LEN);
+	memset(ma + 2, 0, RADIUS_AUTH_LEN);
+	HMAC(EVP_md5(), SECRET, strlen(SECRET), pkt, len, md, &md_len);
+	if (memcmp(md, saved, RADIUS_AUTH_LEN))
+		return -1;
+
+	pw_len = pw[1] - 2;
+	if (pw_len % RADIUS_AUTH_LEN || pw_len > RADIUS_MAX_PASS_LEN)
+		return -1;
+
+	for (i = 0; i < pw_len; i += RADIUS_AUTH_LEN) {
+		stub_md5(md, SECRET, strlen(SECRET), b, RADIUS_AUTH_LEN);
+		for (j = 0; j < RADIUS_AUTH_LEN; j++)
+			plain[i + j] = pw[2 + i + j] ^ md[j];
+		b = pw + 2 + i;
+	}
+
+	return strcmp((char *) plain, PASSWORD) ? RADIUS_ACCESS_REJECT : RADIUS_ACCESS_ACCEPT;
+}
+
+/* RFC 2866 section 3 */
+static int stub_check_acct(unsigned char *pkt, size_t len)
+{
+	unsigned char req_auth[RADIUS_AUTH_LEN], md[RADIUS_AUTH_LEN];
+
+	memcpy(req_auth, pkt + 4, RADIUS_AUTH_LEN);
+	memset(pkt + 4, 0, RADIUS_AUTH_LEN);
+	stub_md5(md, pkt, len, SECRET, strlen(SECRET));
+	memcpy(pkt + 4, req_auth, RADIUS_AUTH_LEN);
+
+	return memcmp(md, req_auth, RADIUS_AUTH_LEN) ? -1 : RADIUS_ACCOUNTING_RESPONSE;
+}
+
+static void stub_reply(unsigned char *reply, int code, const unsigned char *req)
+{
+	reply[0] = code;
+	reply[1] = req[1];
+	reply[2] = 0;
+	reply[3] = RADIUS_HDR_LEN;
+	memcpy(reply + 4, req + 4, RADIUS_AUTH_LEN);
+	stub_md5(reply + 4, reply, RADIUS_HDR_LEN, SECRET, strlen(SECRET));
+}
+
+static void *stub_serve(void *arg)
+{
+	struct stub *s = arg;
+	unsigned char pkt[RADIUS_MAX_LEN], reply[RADIUS_HDR_LEN];
+	struct sockaddr_storage from;
+	socklen_t from_len;
+	ssize_t len;
+	int code, id;
+
+	while (!stop) {
+		from_len = sizeof(from);
+		len = recvfrom(s->fd, pkt, sizeof(pkt), 0, (struct sockaddr *) &from, &from_len);
+		if (len < RADIUS_HDR_LEN || ((pkt[2] << 8) | pkt[3]) != len)
+			continue;
+
+		id = pkt[1];
+		s->requests++;
+
+		code = s->acct ? stub_check_acct(pkt, len) : stub_check_auth(pkt, len);
+		if (code < 0) {
+			s->bad_auth++;
+			continue;
+		}
+
+		if (s->acct) {
+			if (s->seen[id] && !memcmp(s->last_auth[id], pkt + 4, RADIUS_AUTH_LEN))
+				s->duplicates++;
+			memcpy(s->last_auth[id], pkt + 4, RADIUS_AUTH_LEN);
+			s->seen[id] = 1;
+
+			/* the reply to the previous request with this id, long timed out */
+			if (s->late_addr_len[id]) {
+				sendto(s->fd, s->late_reply[id], RADIUS_HDR_LEN, 0,
+				       (struct sockaddr *) &s->late_addr[id], s->late_addr_len[id]);
+				s->late_addr_len[id] = 0;
+				s->late++;
+			}
+		}
+
+		stub_reply(reply, code, pkt);
+
+		if (s->requests % DROP_EVERY == 0) {
+			s->drops++;
+			if (s->acct) {
+				memcpy(s->late_reply[id], reply, RADIUS_HDR_LEN);
+				memcpy(&s->late_addr[id], &from, from_len);
+				s->late_addr_len[id] = from_len;
+			}
+			continue;
+		}
+
+		if (code == RADIUS_ACCESS_REJECT)
+			s->rejected++;
+		else
+			s->accepted++;
+
+		sendto(s->fd, reply, RADIUS_HDR_LEN, 0, (struct sockaddr *) &from, from_len);
+	}
+
+	return NULL;
+}
+
+static int stub_open(struct stub *s)
+{
+	struct timeval tv = { .tv_usec = 50000 };
+	struct sockaddr_in addr = { .sin_family = AF_INET };
+	socklen_t addr_len = sizeof(addr);
+
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	s->fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (s->fd < 0 || bind(s->fd, (struct sockaddr *) &addr, addr_len))
+		return -1;
+
+	setsockopt(s->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	if (getsockname(s->fd, (struct sockaddr *) &addr, &addr_len))
+		return -1;
+
+	s->port = ntohs(addr.sin_port);
+
+	return 0;
+}
+
+static void stub_reset(struct stub *s)
+{
+	int acct = s->acct, fd = s->fd, port = s->port;
+
+	memset(s, 0, sizeof(*s));
+	s->acct = acct;
+	s->fd = fd;
+	s->port = port;
+}
+
+/* runs radiusprobe_main() with its output going to out */
+static int run_load(int argc, char **argv, char *out, size_t size)
+{
+	FILE *f = tmpfile();
+	int saved, rc;
+	size_t len;
+
+	if (!f)
+		return -1;
+
+	fflush(stdout);
+	saved = dup(STDOUT_FILENO);
+	dup2(fileno(f), STDOUT_FILENO);
+
+	optind = 1;
+	rc = radiusprobe_main(argc, argv);
+
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+
+	rewind(f);
+	len = fread(out, 1, size - 1, f);
+	out[len] = '\0';
+	fclose(f);
+
+	return rc;
+}
+
+struct flow_stats {
+	unsigned long sent, received, accepted, rejected, timeouts, errors, invalid;
+};
+
+static int parse_flow(const char *out, const char *type, struct flow_stats *st)
+{
+	char key[32];
+	const char *p;
+
+	snprintf(key, sizeof(key), "\"type\":\"%s\"", type);
+	p = strstr(out, key);
+	if (!p)
+		return -1;
+
+	p += strlen(key);
+	if (sscanf(p, ",\"sent\":%lu,\"received\":%lu,\"accepted\":%lu,\"rejected\":%lu,"
+	           "\"timeouts\":%lu,\"errors\":%lu,\"invalid\":%lu",
+	           &st->sent, &st->received, &st->accepted, &st->rejected, &st->timeouts,
+	           &st->errors, &st->invalid) != 7)
+		return -1;
+
+	return 0;
+}
+
+static int run(const char *password, struct flow_stats *auth, struct flow_stats *acct)
+{
+	char auth_port[8], acct_port[8], window[8], timeout[8], pass[64];
+	char out[4096];
+	char *argv[] = {
+		"radiusprobe", "-L", "-m", "both", "-d", "1", "-k", SECRET,
+		"-s", "127.0.0.1", "-P", auth_port, "-A", acct_port,
+		"-w", window, "-t", timeout, "-p", pass, NULL,
+	};
+	int i, rc;
+
+	snprintf(auth_port, sizeof(auth_port), "%d", stubs[0].port);
+	snprintf(acct_port, sizeof(acct_port), "%d", stubs[1].port);
+	snprintf(window, sizeof(window), "%d", WINDOW);
+	snprintf(timeout, sizeof(timeout), "%d", TIMEOUT_MS);
+	snprintf(pass, sizeof(pass), "%s", password);
+
+	stop = 0;
+	for (i = 0; i < 2; i++) {
+		stub_reset(&stubs[i]);
+		pthread_create(&stubs[i].thread, NULL, stub_serve, &stubs[i]);
+	}
+
+	rc = run_load(sizeof(argv) / sizeof(argv[0]) - 1, argv, out, sizeof(out));
+
+	stop = 1;
+	for (i = 0; i < 2; i++)
+		pthread_join(stubs[i].thread, NULL);
+
+	printf("radiusprobe -L: %s", out);
+
+	if (parse_flow(out, "auth", auth) || parse_flow(out, "acct", acct)) {
+		check(0, "auth and acct flows reported");
+		return -1;
+	}
+
+	return rc;
+}
+
+int main(void)
+{
+	struct flow_stats auth, acct;
+	char msg[192];
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (stub_open(&stubs[i])) {
+			fprintf(stderr, "Failed to bind stub: %s\n", strerror(errno));
+			return 1;
+		}
+	}
+
+	check(run(PASSWORD, &auth, &acct) == 0, "run with the right password succeeds");
+
+	snprintf(msg, sizeof(msg), "auth: %lu sent, %lu seen by the server, %lu bad authenticators",
+	         auth.sent, stubs[0].requests, stubs[0].bad_auth);
+	check(auth.sent > DROP_EVERY && auth.sent == stubs[0].requests && !stubs[0].bad_auth, msg);
+
+	snprintf(msg, sizeof(msg), "auth: %lu accepted, %lu timeouts for %lu drops, %lu invalid",
+	         auth.accepted, auth.timeouts, stubs[0].drops, auth.invalid);
+	check(auth.accepted == stubs[0].accepted && !auth.rejected &&
+	      auth.timeouts == stubs[0].drops && !auth.invalid && !auth.errors, msg);
+
+	snprintf(msg, sizeof(msg), "acct: %lu sent, %lu seen by the server, %lu bad authenticators",
+	         acct.sent, stubs[1].requests, stubs[1].bad_auth);
+	check(acct.sent > DROP_EVERY && acct.sent == stubs[1].requests && !stubs[1].bad_auth, msg);
+
+	snprintf(msg, sizeof(msg), "acct: every request differs from the last one with its id "
+	         "(%lu duplicates)", stubs[1].duplicates);
+	check(!stubs[1].duplicates, msg);
+
+	snprintf(msg, sizeof(msg), "acct: %lu accepted, %lu timeouts for %lu drops",
+	         acct.accepted, acct.timeouts, stubs[1].drops);
+	check(acct.accepted == stubs[1].accepted && acct.timeouts == stubs[1].drops &&
+	      !acct.errors, msg);
+
+	snprintf(msg, sizeof(msg), "acct: %lu late replies to reused ids counted as invalid (got %lu)",
+	         stubs[1].late, acct.invalid);
+	check(stubs[1].late && acct.invalid == stubs[1].late, msg);
+
+	check(run("wrong", &auth, &acct) == 0, "run with a wrong password succeeds");
+
+	snprintf(msg, sizeof(msg), "auth: %lu rejected of %lu received", auth.rejected,
+	         auth.received);
+	check(auth.received && auth.rejected == auth.received && !auth.accepted &&
+	      auth.rejected == stubs[0].rejected && !stubs[0].bad_auth, msg);
+
+	return failures ? 1 : 0;
+}
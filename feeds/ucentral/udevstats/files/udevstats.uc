@@ -1,31 +1,14 @@
 #!/usr/bin/ucode
 'use strict';
-let bpf = require("bpf");
-let struct = require("struct");
+let udevstats = require("udevstats");
 let fs = require("fs");
 let ubus = require("ubus");
 let uloop = require("uloop");
 let PRIO_VAL = 0x200;
+let max_vlans = +(ARGV[0] ?? 1000);
 
-bpf.set_debug_handler(function(level, msg) { print(`[${level}] ${msg}`); });
-
-let bpf_mod = bpf.open_module("/lib/bpf/udevstats.o", {
-	"program-type": {
-		udevstats_in: bpf.BPF_PROG_TYPE_SCHED_CLS,
-		udevstats_out: bpf.BPF_PROG_TYPE_SCHED_CLS
-	}
-});
-assert(bpf_mod, `Could not load BPF module: ${bpf.error()}`);
-bpf.set_debug_handler(null);
-
-let map = bpf_mod.get_map("vlans");
-assert(map, `Could not find vlan map in BPF module`);
-
-let prog = {
-	ingress: bpf_mod.get_program("udevstats_in"),
-	egress: bpf_mod.get_program("udevstats_out")
-};
-assert(prog.ingress && prog.egress, "Missing BPF program");
+let bpf_mod = udevstats.load("/lib/bpf/udevstats.o", max_vlans);
+assert(bpf_mod, `Could not load BPF module: ${udevstats.error()}`);
 
 function device_list_init() {
 	return {
@@ -77,7 +60,7 @@ function device_hook_get(name, tx) {
 		return null;
 
 	if (dev.ifindex != ifindex)
-		prog[type].tc_attach(name, type, PRIO_VAL);
+		bpf_mod.tc_attach(name, type, PRIO_VAL);
 
 	dev.ifindex = ifindex;
 	dev.tx = tx;
@@ -90,7 +73,7 @@ function device_hook_get(name, tx) {
 function device_update_end() {
 	for (let type in [ "ingress", "egress" ])
 		for (let dev in old_hooks[type])
-			bpf.tc_detach(dev, type, PRIO_VAL);
+			bpf_mod.tc_detach(dev, type, PRIO_VAL);
 
 	old_hooks = device_list_init();
 }
@@ -104,13 +87,13 @@ function vlan_update_start() {
 function vlan_update_end() {
 	device_update_end();
 
-	for (let key in old_vlans)
-		map.delete(b64dec(key));
+	for (let key, vlan in old_vlans)
+		bpf_mod.vlan_delete(...vlan);
 }
 
 function vlan_key(ifindex, vid, tx, ad)
 {
-	return struct.pack("IH??", ifindex, vid, tx, ad);
+	return `${ifindex}:${vid}:${tx ? 1 : 0}:${ad ? 1 : 0}`;
 }
 
 function vlan_add(dev, vid, ad)
@@ -119,14 +102,14 @@ function vlan_add(dev, vid, ad)
 		return;
 
 	let key = vlan_key(dev.ifindex, vid, dev.tx, ad);
-	let keystr = b64enc(key);
+	let vlan = [ dev.ifindex, vid, dev.tx, ad ];
 
-	if (old_vlans[keystr])
-		delete old_vlans[keystr];
+	if (old_vlans[key])
+		delete old_vlans[key];
 	else
-		map.set(key, struct.pack("QQ", 0, 0));
+		bpf_mod.vlan_add(...vlan);
 
-	vlans[keystr] = true;
+	vlans[key] = vlan;
 }
 
 function vlan_config_push(vlan_config, dev, vid)
@@ -173,6 +156,7 @@ function vlan_set_config(config)
 
 function vlan_dump_stats()
 {
+	let map_stats = bpf_mod.dump() ?? {};
 	let stats = {};
 	for (let dev in vlan_config) {
 		stats[dev] = [];
@@ -187,15 +171,11 @@ function vlan_dump_stats()
 				if (!hook.ifindex)
 					continue;
 
-				let stats = map.get(vlan_key(hook.ifindex, vlan[0], tx, false));
+				let stats = map_stats[vlan_key(hook.ifindex, vlan[0], tx, false)];
 				if (!stats)
 					continue;
 
-				stats = struct.unpack("QQ", stats);
-				vlan_stats[tx ? "tx" : "rx"] = {
-					packets: stats[0],
-					bytes: stats[1]
-				}
+				vlan_stats[tx ? "tx" : "rx"] = stats;
 			}
 			push(stats[dev], vlan_stats);
 		}
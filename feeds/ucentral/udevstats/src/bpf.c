@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) 2022 Felix Fietkau <nbd@nbd.name>
+ */
+#include <sys/resource.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "udevstats.h"
+
+static int
+udevstats_bpf_pr(enum libbpf_print_level level, const char *format,
+		 va_list args)
+{
+	if (level == LIBBPF_DEBUG)
+		return 0;
+
+	return vfprintf(stderr, format, args);
+}
+
+static void
+udevstats_init_env(void)
+{
+	struct rlimit limit = {
+		.rlim_cur = RLIM_INFINITY,
+		.rlim_max = RLIM_INFINITY,
+	};
+
+	setrlimit(RLIMIT_MEMLOCK, &limit);
+}
+
+int
+udevstats_bpf_load(struct udevstats_bpf *b, const char *path,
+		   unsigned int max_entries)
+{
+	struct bpf_program *prog_i, *prog_e;
+	struct bpf_map *map;
+	int err;
+
+	libbpf_set_print(udevstats_bpf_pr);
+	udevstats_init_env();
+
+	memset(b, 0, sizeof(*b));
+	b->max_entries = max_entries ? max_entries : UDEVSTATS_MAX_VLANS;
+
+	b->ncpus = libbpf_num_possible_cpus();
+	if (b->ncpus <= 0)
+		return b->ncpus ? b->ncpus : -EINVAL;
+
+	b->obj = bpf_object__open_file(path, NULL);
+	err = libbpf_get_error(b->obj);
+	if (err) {
+		b->obj = NULL;
+		return err;
+	}
+
+	map = bpf_object__find_map_by_name(b->obj, "vlans");
+	prog_i = bpf_object__find_program_by_name(b->obj, "udevstats_in");
+	prog_e = bpf_object__find_program_by_name(b->obj, "udevstats_out");
+	if (!map || !prog_i || !prog_e) {
+		err = -ENOENT;
+		goto error;
+	}
+
+	bpf_program__set_type(prog_i, BPF_PROG_TYPE_SCHED_CLS);
+	bpf_program__set_type(prog_e, BPF_PROG_TYPE_SCHED_CLS);
+	bpf_map__set_max_entries(map, b->max_entries);
+
+	err = bpf_object__load(b->obj);
+	if (err)
+		goto error;
+
+	b->prog_ingress = bpf_program__fd(prog_i);
+	b->prog_egress = bpf_program__fd(prog_e);
+	b->map_fd = bpf_map__fd(map);
+
+	b->keys = calloc(b->max_entries, sizeof(*b->keys));
+	b->values = calloc((size_t)b->max_entries * b->ncpus, sizeof(*b->values));
+	if (!b->keys || !b->values) {
+		err = -ENOMEM;
+		goto error;
+	}
+
+	return 0;
+
+error:
+	udevstats_bpf_free(b);
+	return err;
+}
+
+void
+udevstats_bpf_free(struct udevstats_bpf *b)
+{
+	bpf_object__close(b->obj);
+	free(b->keys);
+	free(b->values);
+	memset(b, 0, sizeof(*b));
+}
+
+int
+udevstats_bpf_attach(struct udevstats_bpf *b, int ifindex, bool egress,
+		     int prio)
+{
+	DECLARE_LIBBPF_OPTS(bpf_tc_hook, hook,
+			    .ifindex = ifindex,
+			    .attach_point = egress ? BPF_TC_EGRESS : BPF_TC_INGRESS);
+	DECLARE_LIBBPF_OPTS(bpf_tc_opts, opts,
+			    .handle = 1,
+			    .priority = prio,
+			    .prog_fd = egress ? b->prog_egress : b->prog_ingress,
+			    .flags = BPF_TC_F_REPLACE);
+
+	bpf_tc_hook_create(&hook);
+	if (bpf_tc_attach(&hook, &opts))
+		return -errno;
+
+	return 0;
+}
+
+int
+udevstats_bpf_detach(int ifindex, bool egress, int prio)
+{
+	DECLARE_LIBBPF_OPTS(bpf_tc_hook, hook,
+			    .ifindex = ifindex,
+			    .attach_point = egress ? BPF_TC_EGRESS : BPF_TC_INGRESS);
+	DECLARE_LIBBPF_OPTS(bpf_tc_opts, opts,
+			    .handle = 1,
+			    .priority = prio);
+
+	if (bpf_tc_detach(&hook, &opts))
+		return -errno;
+
+	return 0;
+}
+
+int
+udevstats_bpf_vlan_add(struct udevstats_bpf *b,
+		       const struct udevstats_vlan_key *key)
+{
+	/* per-CPU maps take one value per possible CPU */
+	memset(b->values, 0, b->ncpus * sizeof(*b->values));
+	if (bpf_map_update_elem(b->map_fd, key, b->values, BPF_ANY))
+		return -errno;
+
+	return 0;
+}
+
+int
+udevstats_bpf_vlan_delete(struct udevstats_bpf *b,
+			  const struct udevstats_vlan_key *key)
+{
+	if (bpf_map_delete_elem(b->map_fd, key))
+		return -errno;
+
+	return 0;
+}
+
+static void
+udevstats_dump_entry(struct udevstats_bpf *b, udevstats_dump_cb cb, void *priv,
+		     const struct udevstats_vlan_key *key,
+		     const struct udevstats_vlan_stats *val)
+{
+	uint64_t packets = 0, bytes = 0;
+	int i;
+
+	for (i = 0; i < b->ncpus; i++) {
+		packets += val[i].packets;
+		bytes += val[i].bytes;
+	}
+
+	cb(priv, key, packets, bytes);
+}
+
+/* fails on kernels before 5.6, which do not support batched lookups */
+int
+udevstats_bpf_dump_batch(struct udevstats_bpf *b, udevstats_dump_cb cb,
+			 void *priv)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts);
+	struct udevstats_vlan_key batch;
+	void *in_batch = NULL;
+	__u32 count, i;
+	int err;
+
+	do {
+		count = b->max_entries;
+		err = bpf_map_lookup_batch(b->map_fd, in_batch, &batch, b->keys,
+					   b->values, &count, &opts);
+		if (err && errno != ENOENT)
+			return -errno;
+
+		for (i = 0; i < count; i++)
+			udevstats_dump_entry(b, cb, priv, &b->keys[i],
+					     &b->values[(size_t)i * b->ncpus]);
+
+		in_batch = &batch;
+	} while (!err);
+
+	return 0;
+}
+
+void
+udevstats_bpf_dump_iter(struct udevstats_bpf *b, udevstats_dump_cb cb,
+			void *priv)
+{
+	struct udevstats_vlan_key key, next, *prev = NULL;
+
+	while (!bpf_map_get_next_key(b->map_fd, prev, &next)) {
+		key = next;
+		prev = &key;
+
+		if (bpf_map_lookup_elem(b->map_fd, &key, b->values))
+			continue;
+
+		udevstats_dump_entry(b, cb, priv, &key, b->values);
+	}
+}
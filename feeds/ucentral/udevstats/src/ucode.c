@@ -0,0 +1,272 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) 2022 Felix Fietkau <nbd@nbd.name>
+ */
+#include <net/if.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <ucode/module.h>
+
+#include "udevstats.h"
+
+static uc_resource_type_t *bpf_type;
+static int last_error;
+
+static void
+udevstats_free(void *ptr)
+{
+	struct udevstats_bpf *b = ptr;
+
+	if (!b)
+		return;
+
+	udevstats_bpf_free(b);
+	free(b);
+}
+
+static uc_value_t *
+uc_udevstats_load(uc_vm_t *vm, size_t nargs)
+{
+	uc_value_t *path = uc_fn_arg(0);
+	uc_value_t *max_vlans = uc_fn_arg(1);
+	unsigned int max_entries = 0;
+	struct udevstats_bpf *b;
+	int err;
+
+	if (ucv_type(path) != UC_STRING) {
+		last_error = EINVAL;
+		return NULL;
+	}
+
+	if (ucv_type(max_vlans) == UC_INTEGER && ucv_int64_get(max_vlans) > 0)
+		max_entries = ucv_int64_get(max_vlans);
+
+	b = calloc(1, sizeof(*b));
+	if (!b) {
+		last_error = ENOMEM;
+		return NULL;
+	}
+
+	err = udevstats_bpf_load(b, ucv_string_get(path), max_entries);
+	if (err) {
+		last_error = -err;
+		free(b);
+		return NULL;
+	}
+
+	return ucv_resource_new(bpf_type, b);
+}
+
+static uc_value_t *
+uc_udevstats_error(uc_vm_t *vm, size_t nargs)
+{
+	uc_value_t *ret;
+
+	if (!last_error)
+		return NULL;
+
+	ret = ucv_string_new(strerror(last_error));
+	last_error = 0;
+
+	return ret;
+}
+
+static bool
+udevstats_hook_get(uc_vm_t *vm, size_t nargs, int *ifindex, bool *egress,
+		   int *prio)
+{
+	uc_value_t *name = uc_fn_arg(0);
+	uc_value_t *type = uc_fn_arg(1);
+	uc_value_t *prio_val = uc_fn_arg(2);
+	const char *type_str;
+
+	if (ucv_type(name) != UC_STRING || ucv_type(type) != UC_STRING ||
+	    ucv_type(prio_val) != UC_INTEGER)
+		goto invalid;
+
+	type_str = ucv_string_get(type);
+	if (!strcmp(type_str, "ingress"))
+		*egress = false;
+	else if (!strcmp(type_str, "egress"))
+		*egress = true;
+	else
+		goto invalid;
+
+	*ifindex = if_nametoindex(ucv_string_get(name));
+	if (!*ifindex) {
+		last_error = errno;
+		return false;
+	}
+
+	*prio = ucv_int64_get(prio_val);
+
+	return true;
+
+invalid:
+	last_error = EINVAL;
+	return false;
+}
+
+static uc_value_t *
+uc_udevstats_tc_attach(uc_vm_t *vm, size_t nargs)
+{
+	struct udevstats_bpf *b = uc_fn_thisval("udevstats.bpf");
+	int ifindex, prio, err;
+	bool egress;
+
+	if (!b || !udevstats_hook_get(vm, nargs, &ifindex, &egress, &prio))
+		return NULL;
+
+	err = udevstats_bpf_attach(b, ifindex, egress, prio);
+	if (err) {
+		last_error = -err;
+		return ucv_boolean_new(false);
+	}
+
+	return ucv_boolean_new(true);
+}
+
+static uc_value_t *
+uc_udevstats_tc_detach(uc_vm_t *vm, size_t nargs)
+{
+	int ifindex, prio, err;
+	bool egress;
+
+	if (!udevstats_hook_get(vm, nargs, &ifindex, &egress, &prio))
+		return NULL;
+
+	err = udevstats_bpf_detach(ifindex, egress, prio);
+	if (err) {
+		last_error = -err;
+		return ucv_boolean_new(false);
+	}
+
+	return ucv_boolean_new(true);
+}
+
+static bool
+udevstats_vlan_key_get(uc_vm_t *vm, size_t nargs, struct udevstats_vlan_key *key)
+{
+	uc_value_t *ifindex = uc_fn_arg(0);
+	uc_value_t *vid = uc_fn_arg(1);
+
+	if (ucv_type(ifindex) != UC_INTEGER || ucv_type(vid) != UC_INTEGER) {
+		last_error = EINVAL;
+		return false;
+	}
+
+	memset(key, 0, sizeof(*key));
+	key->vlan_ifindex = ucv_int64_get(ifindex);
+	key->vlan_id = ucv_int64_get(vid);
+	key->vlan_tx = ucv_is_truish(uc_fn_arg(2));
+	key->vlan_is_ad = ucv_is_truish(uc_fn_arg(3));
+
+	return true;
+}
+
+static uc_value_t *
+uc_udevstats_vlan_add(uc_vm_t *vm, size_t nargs)
+{
+	struct udevstats_bpf *b = uc_fn_thisval("udevstats.bpf");
+	struct udevstats_vlan_key key;
+	int err;
+
+	if (!b || !udevstats_vlan_key_get(vm, nargs, &key))
+		return NULL;
+
+	err = udevstats_bpf_vlan_add(b, &key);
+	if (err) {
+		last_error = -err;
+		return ucv_boolean_new(false);
+	}
+
+	return ucv_boolean_new(true);
+}
+
+static uc_value_t *
+uc_udevstats_vlan_delete(uc_vm_t *vm, size_t nargs)
+{
+	struct udevstats_bpf *b = uc_fn_thisval("udevstats.bpf");
+	struct udevstats_vlan_key key;
+	int err;
+
+	if (!b || !udevstats_vlan_key_get(vm, nargs, &key))
+		return NULL;
+
+	err = udevstats_bpf_vlan_delete(b, &key);
+	if (err) {
+		last_error = -err;
+		return ucv_boolean_new(false);
+	}
+
+	return ucv_boolean_new(true);
+}
+
+struct udevstats_dump_ctx {
+	uc_vm_t *vm;
+	uc_value_t *ret;
+};
+
+static void
+udevstats_dump_entry(void *priv, const struct udevstats_vlan_key *key,
+		     uint64_t packets, uint64_t bytes)
+{
+	struct udevstats_dump_ctx *ctx = priv;
+	uc_value_t *stats;
+	char name[32];
+
+	snprintf(name, sizeof(name), "%u:%u:%u:%u", key->vlan_ifindex,
+		 key->vlan_id, key->vlan_tx, key->vlan_is_ad);
+
+	stats = ucv_object_new(ctx->vm);
+	ucv_object_add(stats, "packets", ucv_uint64_new(packets));
+	ucv_object_add(stats, "bytes", ucv_uint64_new(bytes));
+	ucv_object_add(ctx->ret, name, stats);
+}
+
+static uc_value_t *
+uc_udevstats_dump(uc_vm_t *vm, size_t nargs)
+{
+	struct udevstats_bpf *b = uc_fn_thisval("udevstats.bpf");
+	struct udevstats_dump_ctx ctx = { .vm = vm };
+
+	if (!b)
+		return NULL;
+
+	ctx.ret = ucv_object_new(vm);
+	if (!b->no_batch) {
+		if (!udevstats_bpf_dump_batch(b, udevstats_dump_entry, &ctx))
+			return ctx.ret;
+
+		/* kernels before 5.6 do not support batched lookups */
+		b->no_batch = true;
+		ucv_put(ctx.ret);
+		ctx.ret = ucv_object_new(vm);
+	}
+
+	udevstats_bpf_dump_iter(b, udevstats_dump_entry, &ctx);
+
+	return ctx.ret;
+}
+
+static const uc_function_list_t bpf_fns[] = {
+	{ "tc_attach",		uc_udevstats_tc_attach },
+	{ "tc_detach",		uc_udevstats_tc_detach },
+	{ "vlan_add",		uc_udevstats_vlan_add },
+	{ "vlan_delete",	uc_udevstats_vlan_delete },
+	{ "dump",		uc_udevstats_dump },
+};
+
+static const uc_function_list_t global_fns[] = {
+	{ "load",	uc_udevstats_load },
+	{ "error",	uc_udevstats_error },
+};
+
+void uc_module_init(uc_vm_t *vm, uc_value_t *scope)
+{
+	bpf_type = uc_type_declare(vm, "udevstats.bpf", bpf_fns, udevstats_free);
+	uc_function_list_register(scope, global_fns);
+}
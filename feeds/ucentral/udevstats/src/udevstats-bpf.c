@@ -14,11 +14,12 @@
 #include "bpf_skb_utils.h"
 #include "udevstats-bpf.h"
 
+/* max_entries is overridden by the loader, see udevstats_bpf_load() */
 struct {
-	__uint(type, BPF_MAP_TYPE_HASH);
+	__uint(type, BPF_MAP_TYPE_PERCPU_HASH);
 	__uint(key_size, sizeof(struct udevstats_vlan_key));
 	__type(value, struct udevstats_vlan_stats);
-	__uint(max_entries, 1000);
+	__uint(max_entries, UDEVSTATS_MAX_VLANS);
 	__uint(map_flags, BPF_F_NO_PREALLOC);
 } vlans SEC(".maps");
 
@@ -40,9 +41,14 @@ static inline int udevstats_handle_packet(struct __sk_buff *skb, int ifindex, bo
 	if (skb->vlan_present) {
 		key.vlan_id = skb->vlan_tci;
 		vlan_proto = skb->vlan_proto;
-	} else if ((vlan = skb_parse_vlan(&info)) != NULL) {
+	} else {
+		/* skb_parse_vlan() moves info.proto on to the inner protocol */
 		vlan_proto = info.proto;
-		key.vlan_id = bpf_ntohs(vlan->h_vlan_TCI);
+		vlan = skb_parse_vlan(&info);
+		if (vlan)
+			key.vlan_id = bpf_ntohs(vlan->h_vlan_TCI);
+		else
+			vlan_proto = 0;
 	}
 
 	key.vlan_id &= VLAN_VID_MASK;
@@ -52,8 +58,8 @@ static inline int udevstats_handle_packet(struct __sk_buff *skb, int ifindex, bo
 	if (!stats)
 		return TC_ACT_UNSPEC;
 
-	__sync_fetch_and_add(&stats->packets, 1);
-	__sync_fetch_and_add(&stats->bytes, skb->len);
+	stats->packets++;
+	stats->bytes += skb->len;
 
 	return TC_ACT_UNSPEC;
 }
@@ -5,6 +5,8 @@
 #ifndef __BPF_UDEVSTATS_H
 #define __BPF_UDEVSTATS_H
 
+#define UDEVSTATS_MAX_VLANS	1000
+
 struct udevstats_vlan_key {
 	uint32_t vlan_ifindex;
 	uint16_t vlan_id;
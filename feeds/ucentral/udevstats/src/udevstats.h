@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) 2022 Felix Fietkau <nbd@nbd.name>
+ */
+#ifndef __UDEVSTATS_H
+#define __UDEVSTATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+#include "udevstats-bpf.h"
+
+struct udevstats_bpf {
+	struct bpf_object *obj;
+	int prog_ingress;
+	int prog_egress;
+	int map_fd;
+
+	unsigned int max_entries;
+	int ncpus;
+	bool no_batch;
+
+	/* dump buffers, sized for a full map */
+	struct udevstats_vlan_key *keys;
+	struct udevstats_vlan_stats *values;
+};
+
+/* called once per VLAN with the counters summed across CPUs */
+typedef void (*udevstats_dump_cb)(void *priv, const struct udevstats_vlan_key *key,
+				  uint64_t packets, uint64_t bytes);
+
+int udevstats_bpf_load(struct udevstats_bpf *b, const char *path,
+		       unsigned int max_entries);
+void udevstats_bpf_free(struct udevstats_bpf *b);
+
+int udevstats_bpf_attach(struct udevstats_bpf *b, int ifindex, bool egress,
+			 int prio);
+int udevstats_bpf_detach(int ifindex, bool egress, int prio);
+
+int udevstats_bpf_vlan_add(struct udevstats_bpf *b,
+			   const struct udevstats_vlan_key *key);
+int udevstats_bpf_vlan_delete(struct udevstats_bpf *b,
+			      const struct udevstats_vlan_key *key);
+
+int udevstats_bpf_dump_batch(struct udevstats_bpf *b, udevstats_dump_cb cb,
+			     void *priv);
+void udevstats_bpf_dump_iter(struct udevstats_bpf *b, udevstats_dump_cb cb,
+			     void *priv);
+
+#endif
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Fills the udevstats map with VLAN entries and reports how long a dump of
+ * all of them takes, through the batched lookup and through the key walk
+ * used on kernels without batched lookups.
+ *
+ *   udevstats-bench [-n vlans] [-r rounds] <udevstats.o>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "udevstats.h"
+
+static int entries;
+static uint64_t packets;
+
+static void dump_cb(void *priv, const struct udevstats_vlan_key *key,
+		    uint64_t pkts, uint64_t bytes)
+{
+	entries++;
+	packets += pkts;
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main(int argc, char **argv)
+{
+	struct udevstats_bpf bpf;
+	struct udevstats_vlan_key key = {};
+	double start, batch_us, iter_us;
+	int vlans = 1000, rounds = 100;
+	int batch_entries = 0, iter_entries = 0;
+	int ch, i, err;
+
+	while ((ch = getopt(argc, argv, "n:r:")) != -1) {
+		switch (ch) {
+		case 'n':
+			vlans = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+
+	if (optind >= argc || vlans <= 0 || rounds <= 0)
+		goto usage;
+
+	err = udevstats_bpf_load(&bpf, argv[optind], vlans);
+	if (err) {
+		fprintf(stderr, "Failed to load %s: %s\n", argv[optind],
+			strerror(-err));
+		return 1;
+	}
+
+	/* the same VLAN in both directions counts as two entries, as in the daemon */
+	for (i = 0; i < vlans; i++) {
+		key.vlan_ifindex = 1;
+		key.vlan_id = 1 + i / 2;
+		key.vlan_tx = i & 1;
+		if (udevstats_bpf_vlan_add(&bpf, &key)) {
+			fprintf(stderr, "Failed to add VLAN entry %d\n", i);
+			return 1;
+		}
+	}
+
+	start = now_us();
+	for (i = 0; i < rounds; i++) {
+		entries = 0;
+		if (udevstats_bpf_dump_batch(&bpf, dump_cb, NULL)) {
+			fprintf(stderr, "Batched lookups are not supported\n");
+			return 1;
+		}
+		batch_entries = entries;
+	}
+	batch_us = (now_us() - start) / rounds;
+
+	start = now_us();
+	for (i = 0; i < rounds; i++) {
+		entries = 0;
+		udevstats_bpf_dump_iter(&bpf, dump_cb, NULL);
+		iter_entries = entries;
+	}
+	iter_us = (now_us() - start) / rounds;
+
+	printf("%d VLANs, %d CPUs: batched dump %.1f us, key walk %.1f us\n",
+	       vlans, bpf.ncpus, batch_us, iter_us);
+
+	udevstats_bpf_free(&bpf);
+
+	if (batch_entries != vlans || iter_entries != vlans) {
+		printf("FAIL: dumped %d (batched) and %d (key walk) of %d entries\n",
+		       batch_entries, iter_entries, vlans);
+		return 1;
+	}
+
+	return 0;
+
+usage:
+	fprintf(stderr, "Usage: %s [-n vlans] [-r rounds] <udevstats.o>\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,341 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Attaches the udevstats hooks to a veth pair in a scratch network namespace,
+ * sends tagged frames on several VLANs in both directions and checks the
+ * totals of both dump paths. The frames are sent from every CPU the test may
+ * run on, so the totals come from several per-CPU slots.
+ *
+ *   udevstats-veth <udevstats.o>
+ */
+#define _GNU_SOURCE
+#include <sys/socket.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "udevstats.h"
+
+#define DEV		"us0"
+#define PEER		"us1"
+#define PRIO		0x200
+#define VLAN_HLEN	4
+
+struct flow {
+	uint16_t vid;
+	bool ad;
+	bool tx;
+	/* no map entry, the frames must not be counted anywhere */
+	bool untracked;
+	int frames;
+	int len;
+
+	uint64_t packets;
+	uint64_t bytes;
+	int found;
+};
+
+static struct flow flows[] = {
+	{ .vid = 10, .frames = 5, .len = 64 },
+	{ .vid = 20, .frames = 7, .len = 300 },
+	{ .vid = 20, .tx = true, .frames = 3, .len = 128 },
+	{ .vid = 30, .ad = true, .tx = true, .frames = 4, .len = 90 },
+	{ .vid = 30, .ad = true, .frames = 6, .len = 1000 },
+	{ .vid = 40, .untracked = true, .frames = 2, .len = 64 },
+	{ .vid = 40, .tx = true, .untracked = true, .frames = 2, .len = 64 },
+};
+
+#define N_FLOWS	(int)(sizeof(flows) / sizeof(flows[0]))
+
+static struct udevstats_bpf bpf;
+static int ifindex;
+static int entries;
+static int failures;
+
+static void check(bool cond, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("%s: ", cond ? "ok" : "FAIL");
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf("\n");
+
+	if (!cond)
+		failures++;
+}
+
+static void flow_key(const struct flow *f, struct udevstats_vlan_key *key)
+{
+	memset(key, 0, sizeof(*key));
+	key->vlan_ifindex = ifindex;
+	key->vlan_id = f->vid;
+	key->vlan_tx = f->tx;
+	key->vlan_is_ad = f->ad;
+}
+
+/* on ingress the outer tag is already in the skb metadata, not in its length */
+static uint64_t flow_bytes(const struct flow *f)
+{
+	return (uint64_t)f->frames * (f->len - (f->tx ? 0 : VLAN_HLEN));
+}
+
+static void send_frame(int fd, const struct flow *f)
+{
+	struct sockaddr_ll addr = {
+		.sll_family = AF_PACKET,
+		.sll_protocol = htons(ETH_P_ALL),
+		.sll_ifindex = if_nametoindex(f->tx ? DEV : PEER),
+		.sll_halen = ETH_ALEN,
+	};
+	unsigned char frame[ETH_FRAME_LEN] = {
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0x02, 0x00, 0x00, 0x00, 0x00, 0x01,
+	};
+	uint16_t *hdr = (uint16_t *)&frame[2 * ETH_ALEN];
+
+	hdr[0] = htons(f->ad ? ETH_P_8021AD : ETH_P_8021Q);
+	hdr[1] = htons(f->vid);
+	/* local experimental ethertype */
+	hdr[2] = htons(0x88b5);
+
+	sendto(fd, frame, f->len, 0, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+/* spread the frames of every flow over the CPUs the test may run on */
+static void send_flows(void)
+{
+	cpu_set_t allowed, cpu;
+	int fd, i, n, c = 0;
+
+	fd = socket(AF_PACKET, SOCK_RAW, 0);
+	if (fd < 0) {
+		perror("socket");
+		return;
+	}
+
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+	for (i = 0; i < N_FLOWS; i++) {
+		for (n = 0; n < flows[i].frames; n++) {
+			do {
+				c = (c + 1) % CPU_SETSIZE;
+			} while (!CPU_ISSET(c, &allowed));
+
+			CPU_ZERO(&cpu);
+			CPU_SET(c, &cpu);
+			sched_setaffinity(0, sizeof(cpu), &cpu);
+			send_frame(fd, &flows[i]);
+		}
+	}
+
+	sched_setaffinity(0, sizeof(allowed), &allowed);
+	close(fd);
+}
+
+static void dump_cb(void *priv, const struct udevstats_vlan_key *key,
+		    uint64_t packets, uint64_t bytes)
+{
+	int i;
+
+	entries++;
+	for (i = 0; i < N_FLOWS; i++) {
+		struct flow *f = &flows[i];
+
+		if (key->vlan_ifindex != ifindex || key->vlan_id != f->vid ||
+		    key->vlan_tx != f->tx || key->vlan_is_ad != f->ad)
+			continue;
+
+		f->packets = packets;
+		f->bytes = bytes;
+		f->found++;
+	}
+}
+
+static void dump_reset(void)
+{
+	int i;
+
+	entries = 0;
+	for (i = 0; i < N_FLOWS; i++) {
+		flows[i].packets = 0;
+		flows[i].bytes = 0;
+		flows[i].found = 0;
+	}
+}
+
+static bool dump_batch(void)
+{
+	dump_reset();
+
+	return !udevstats_bpf_dump_batch(&bpf, dump_cb, NULL);
+}
+
+static uint64_t dump_packets(void)
+{
+	uint64_t packets = 0;
+	int i;
+
+	for (i = 0; i < N_FLOWS; i++)
+		packets += flows[i].packets;
+
+	return packets;
+}
+
+/* the frames are counted from softirq, give them some time */
+static void wait_counted(void)
+{
+	uint64_t expected = 0;
+	int i;
+
+	for (i = 0; i < N_FLOWS; i++)
+		if (!flows[i].untracked)
+			expected += flows[i].frames;
+
+	for (i = 0; i < 100; i++) {
+		if (dump_batch() && dump_packets() >= expected)
+			return;
+		usleep(10000);
+	}
+}
+
+static void check_totals(const char *what)
+{
+	int i, tracked = 0;
+
+	for (i = 0; i < N_FLOWS; i++) {
+		struct flow *f = &flows[i];
+		const char *dir = f->tx ? "tx" : "rx";
+
+		if (f->untracked) {
+			check(!f->found, "%s: no entry for untracked VLAN %u %s",
+			      what, f->vid, dir);
+			continue;
+		}
+
+		tracked++;
+		check(f->found == 1, "%s: VLAN %u%s %s dumped once", what,
+		      f->vid, f->ad ? " (802.1ad)" : "", dir);
+		check(f->packets == (uint64_t)f->frames &&
+		      f->bytes == flow_bytes(f),
+		      "%s: VLAN %u%s %s counted %llu/%llu packets, %llu/%llu bytes",
+		      what, f->vid, f->ad ? " (802.1ad)" : "", dir,
+		      (unsigned long long)f->packets, (unsigned long long)f->frames,
+		      (unsigned long long)f->bytes,
+		      (unsigned long long)flow_bytes(f));
+	}
+
+	check(entries == tracked, "%s: %d entries dumped, %d expected", what,
+	      entries, tracked);
+}
+
+/* number of CPU slots that counted frames of any tracked flow */
+static int cpus_used(void)
+{
+	struct udevstats_vlan_key key;
+	bool used[CPU_SETSIZE] = {};
+	int i, c, n = 0;
+
+	for (i = 0; i < N_FLOWS; i++) {
+		if (flows[i].untracked)
+			continue;
+
+		flow_key(&flows[i], &key);
+		if (bpf_map_lookup_elem(bpf.map_fd, &key, bpf.values))
+			continue;
+
+		for (c = 0; c < bpf.ncpus && c < CPU_SETSIZE; c++)
+			if (bpf.values[c].packets)
+				used[c] = true;
+	}
+
+	for (c = 0; c < CPU_SETSIZE; c++)
+		n += used[c];
+
+	return n;
+}
+
+int main(int argc, char **argv)
+{
+	struct udevstats_vlan_key key;
+	cpu_set_t allowed;
+	int i, err;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <udevstats.o>\n", argv[0]);
+		return 1;
+	}
+
+	if (unshare(CLONE_NEWNET)) {
+		perror("unshare");
+		return 1;
+	}
+
+	/* keeps router solicitations and MLD reports off the wire */
+	if (system("sysctl -qw net.ipv6.conf.all.disable_ipv6=1 "
+		   "net.ipv6.conf.default.disable_ipv6=1 && "
+		   "ip link add " DEV " type veth peer name " PEER " && "
+		   "ip link set " DEV " up && ip link set " PEER " up")) {
+		fprintf(stderr, "Failed to set up the veth pair\n");
+		return 1;
+	}
+	ifindex = if_nametoindex(DEV);
+
+	err = udevstats_bpf_load(&bpf, argv[1], 16);
+	if (err) {
+		fprintf(stderr, "Failed to load %s: %s\n", argv[1], strerror(-err));
+		return 1;
+	}
+
+	check(!udevstats_bpf_attach(&bpf, ifindex, false, PRIO) &&
+	      !udevstats_bpf_attach(&bpf, ifindex, true, PRIO),
+	      "hooks attached");
+
+	for (i = 0; i < N_FLOWS; i++) {
+		if (flows[i].untracked)
+			continue;
+
+		flow_key(&flows[i], &key);
+		udevstats_bpf_vlan_add(&bpf, &key);
+	}
+
+	send_flows();
+	wait_counted();
+
+	check(dump_batch(), "batched dump");
+	check_totals("batched dump");
+
+	dump_reset();
+	udevstats_bpf_dump_iter(&bpf, dump_cb, NULL);
+	check_totals("key walk");
+
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+	if (CPU_COUNT(&allowed) > 1)
+		check(cpus_used() > 1, "frames counted on %d CPUs", cpus_used());
+
+	/* a re-added VLAN starts from zero */
+	flow_key(&flows[0], &key);
+	udevstats_bpf_vlan_delete(&bpf, &key);
+	udevstats_bpf_vlan_add(&bpf, &key);
+	dump_batch();
+	check(flows[0].found == 1 && !flows[0].packets && !flows[0].bytes,
+	      "re-added VLAN %u starts from zero", flows[0].vid);
+
+	udevstats_bpf_vlan_delete(&bpf, &key);
+	dump_batch();
+	check(!flows[0].found, "deleted VLAN %u no longer dumped", flows[0].vid);
+
+	check(!udevstats_bpf_detach(ifindex, false, PRIO) &&
+	      !udevstats_bpf_detach(ifindex, true, PRIO),
+	      "hooks detached");
+
+	udevstats_bpf_free(&bpf);
+
+	return failures ? 1 : 0;
+}
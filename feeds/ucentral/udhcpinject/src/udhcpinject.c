@@ -4,9 +4,21 @@
 #include <linux/if_packet.h>
 #include <linux/if_vlan.h>
 #include <linux/ip.h>
+#include <linux/nl80211.h>
+#include <linux/pkt_cls.h>
+#include <linux/pkt_sched.h>
+#include <linux/rtnetlink.h>
+#include <linux/tc_act/tc_gact.h>
+#include <linux/tc_act/tc_mirred.h>
+#include <linux/tc_act/tc_vlan.h>
 #include <linux/udp.h>
 #include <net/if.h>
 
+#include <netlink/attr.h>
+#include <netlink/msg.h>
+#include <netlink/socket.h>
+#include <unl.h>
+
 #include <pcap.h>
 #include <poll.h>
 #include <signal.h>
@@ -19,6 +31,134 @@
 
 #include "udhcpinject.h"
 
+// Filters are attached to the ingress qdisc (ffff:fff2, as tc and libbpf use)
+#define TC_INGRESS_PARENT TC_H_MAKE(TC_H_CLSACT, TC_H_MIN_INGRESS)
+
+static struct nl_sock *rtnl;
+static struct unl unl;
+
+static int rtnl_finish_cb(struct nl_msg *msg, void *arg)
+{
+    int *ret = arg;
+
+    *ret = 0;
+    return NL_STOP;
+}
+
+static int rtnl_error_cb(struct sockaddr_nl *nla, struct nlmsgerr *err, void *arg)
+{
+    int *ret = arg;
+
+    *ret = err->error;
+    return NL_STOP;
+}
+
+// Send an rtnetlink request and wait for its ack (or the end of a dump),
+// passing every reply to handler. Returns 0 or a negative errno.
+static int rtnl_request(struct nl_msg *msg, int (*handler)(struct nl_msg *, void *), void *arg)
+{
+    struct nl_cb *cb;
+    int ret;
+
+    cb = nl_cb_alloc(NL_CB_CUSTOM);
+    if (!cb)
+    {
+        nlmsg_free(msg);
+        return -ENOMEM;
+    }
+
+    ret = nl_send_auto_complete(rtnl, msg);
+    nlmsg_free(msg);
+    if (ret < 0)
+        goto out;
+
+    ret = 1;
+    nl_cb_err(cb, NL_CB_CUSTOM, rtnl_error_cb, &ret);
+    nl_cb_set(cb, NL_CB_FINISH, NL_CB_CUSTOM, rtnl_finish_cb, &ret);
+    nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, rtnl_finish_cb, &ret);
+    if (handler)
+        nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, handler, arg);
+
+    while (ret > 0)
+    {
+        if (nl_recvmsgs(rtnl, cb) < 0 && ret > 0)
+            ret = -EIO;
+    }
+
+out:
+    nl_cb_put(cb);
+    return ret;
+}
+
+static struct nl_msg *tc_msg(int cmd, int flags, int ifindex, uint32_t parent,
+                             uint32_t handle, uint32_t info)
+{
+    struct tcmsg tcm = {
+        .tcm_family = AF_UNSPEC,
+        .tcm_ifindex = ifindex,
+        .tcm_parent = parent,
+        .tcm_handle = handle,
+        .tcm_info = info,
+    };
+    struct nl_msg *msg;
+
+    msg = nlmsg_alloc_simple(cmd, NLM_F_REQUEST | flags);
+    if (!msg)
+        return NULL;
+
+    if (nlmsg_append(msg, &tcm, sizeof(tcm), NLMSG_ALIGNTO) < 0)
+    {
+        nlmsg_free(msg);
+        return NULL;
+    }
+
+    return msg;
+}
+
+// Open the rtnetlink socket used for tc management and the nl80211 socket
+// used to resolve VAPs. Returns 0 on success.
+int nl_setup()
+{
+    rtnl = nl_socket_alloc();
+    if (!rtnl)
+        return -1;
+
+    if (nl_connect(rtnl, NETLINK_ROUTE))
+    {
+        nl_socket_free(rtnl);
+        rtnl = NULL;
+        return -1;
+    }
+
+    if (unl_genl_init(&unl, "nl80211"))
+    {
+        nl_socket_free(rtnl);
+        rtnl = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Remove our redirect filter (every filter at TC_FILTER_PRIO) from the given
+// VAP ingress.
+int tc_filter_del(const char *iface)
+{
+    struct nl_msg *msg;
+    int ifindex;
+
+    ifindex = if_nametoindex(iface);
+    if (!ifindex || !rtnl)
+        return -1;
+
+    msg = tc_msg(RTM_DELTFILTER, 0, ifindex, TC_INGRESS_PARENT, 0,
+                 TC_H_MAKE(TC_FILTER_PRIO << 16, 0));
+    if (!msg)
+        return -1;
+
+    return rtnl_request(msg, NULL, NULL);
+}
+
 // Cleanup function
 void cleanup()
 {
@@ -32,16 +172,21 @@ void cleanup()
 
     if (iface_map)
     {
-        char cmd[1024];
         for (int i = 0; i < iface_map_size; i++)
         {
-            snprintf(cmd, sizeof(cmd), "tc filter del dev %s ingress pref 32 2>/dev/null",
-                     iface_map[i].iface);
-            system(cmd);
+            if (iface_map[i].iface[0])
+                tc_filter_del(iface_map[i].iface);
         }
         free(iface_map);
     }
 
+    if (rtnl)
+    {
+        nl_socket_free(rtnl);
+        rtnl = NULL;
+        unl_free(&unl);
+    }
+
     if (port_map)
     {
         for (int i = 0; i < port_map_size; i++)
@@ -60,12 +205,11 @@ int setup_ifb()
     char cmd[512];
 
     // check if ifb-inject exists, if not create it
-    snprintf(cmd, sizeof(cmd), "ip link show ifb-inject >/dev/null 2>&1");
-    if (system(cmd) != 0)
+    if (if_nametoindex(IFB_IFACE) == 0)
     {
         snprintf(cmd, sizeof(cmd),
-                 "ip link add name ifb-inject type ifb && ip link set "
-                 "ifb-inject up");
+                 "ip link add name " IFB_IFACE " type ifb && ip link set "
+                 IFB_IFACE " up");
         if (system(cmd) != 0)
         {
             syslog(LOG_ERR, "Failed to setup ifb-inject\n");
@@ -78,36 +222,112 @@ int setup_ifb()
 // Install the ingress qdisc + DHCP redirect filter for a single resolved VAP.
 // Returns 0 on success, -1 if the filter could not be installed (caller should
 // leave the VAP unresolved and retry later).
+//
+// The filter is the netlink equivalent of
+//   tc filter add dev <vap> ingress protocol ip pref 32 u32
+//     match ip protocol 17 0xff
+//     match u16 0x0044 0xffff at 20
+//     match u16 0x0043 0xffff at 22
+//     match u8 0x01 0xff at 28
+//     action vlan push id <serial> pipe
+//     action mirred egress mirror dev ifb-inject pipe
+//     action drop
 int setup_tc_for_iface(struct iface_info *iface)
 {
-    char cmd[512];
+    struct {
+        struct tc_u32_sel sel;
+        struct tc_u32_key keys[4];
+    } sel = {
+        .sel = {
+            .flags = TC_U32_TERMINAL,
+            .nkeys = 4,
+        },
+        .keys = {
+            { .mask = htonl(0x00ff0000), .val = htonl(0x00110000), .off = 8 },
+            { .mask = htonl(0xffff0000), .val = htonl(0x00440000), .off = 20 },
+            { .mask = htonl(0x0000ffff), .val = htonl(0x00000043), .off = 20 },
+            { .mask = htonl(0xff000000), .val = htonl(0x01000000), .off = 28 },
+        },
+    };
+    struct tc_vlan vlan = {
+        .action = TC_ACT_PIPE,
+        .v_action = TCA_VLAN_ACT_PUSH,
+    };
+    struct tc_mirred mirred = {
+        .action = TC_ACT_PIPE,
+        .eaction = TCA_EGRESS_MIRROR,
+    };
+    struct tc_gact gact = {
+        .action = TC_ACT_SHOT,
+    };
+    struct nlattr *opts, *acts, *act, *act_opts;
+    struct nl_msg *msg;
+    int ifindex;
+
+    ifindex = if_nametoindex(iface->iface);
+    mirred.ifindex = if_nametoindex(IFB_IFACE);
+    if (!ifindex || !mirred.ifindex)
+        goto error;
+
+    // Adding the ingress qdisc fails harmlessly with EEXIST if one is already
+    // there, so it is never treated as fatal. The filter add below is the
+    // operation we actually gate on.
+    msg = tc_msg(RTM_NEWQDISC, NLM_F_CREATE | NLM_F_EXCL, ifindex, TC_H_INGRESS,
+                 TC_H_MAKE(TC_H_INGRESS, 0), 0);
+    if (!msg)
+        goto error;
+    NLA_PUT_STRING(msg, TCA_KIND, "ingress");
+    rtnl_request(msg, NULL, NULL);
+
+    msg = tc_msg(RTM_NEWTFILTER, NLM_F_CREATE | NLM_F_EXCL, ifindex, TC_INGRESS_PARENT,
+                 0, TC_H_MAKE(TC_FILTER_PRIO << 16, htons(ETH_P_IP)));
+    if (!msg)
+        goto error;
+
+    NLA_PUT_STRING(msg, TCA_KIND, "u32");
+    opts = nla_nest_start(msg, TCA_OPTIONS);
+    NLA_PUT(msg, TCA_U32_SEL, sizeof(sel), &sel);
+
+    acts = nla_nest_start(msg, TCA_U32_ACT);
+
+    act = nla_nest_start(msg, 1);
+    NLA_PUT_STRING(msg, TCA_ACT_KIND, "vlan");
+    act_opts = nla_nest_start(msg, TCA_ACT_OPTIONS);
+    NLA_PUT(msg, TCA_VLAN_PARMS, sizeof(vlan), &vlan);
+    NLA_PUT_U16(msg, TCA_VLAN_PUSH_VLAN_ID, iface->serial);
+    nla_nest_end(msg, act_opts);
+    nla_nest_end(msg, act);
+
+    act = nla_nest_start(msg, 2);
+    NLA_PUT_STRING(msg, TCA_ACT_KIND, "mirred");
+    act_opts = nla_nest_start(msg, TCA_ACT_OPTIONS);
+    NLA_PUT(msg, TCA_MIRRED_PARMS, sizeof(mirred), &mirred);
+    nla_nest_end(msg, act_opts);
+    nla_nest_end(msg, act);
+
+    act = nla_nest_start(msg, 3);
+    NLA_PUT_STRING(msg, TCA_ACT_KIND, "gact");
+    act_opts = nla_nest_start(msg, TCA_ACT_OPTIONS);
+    NLA_PUT(msg, TCA_GACT_PARMS, sizeof(gact), &gact);
+    nla_nest_end(msg, act_opts);
+    nla_nest_end(msg, act);
+
+    nla_nest_end(msg, acts);
+    nla_nest_end(msg, opts);
+
+    if (rtnl_request(msg, NULL, NULL) != 0)
+        goto error;
 
-    // Adding the ingress qdisc is idempotent-ish: it fails harmlessly if one
-    // already exists, so we suppress its output and never treat it as fatal.
-    // The filter add below is the operation we actually gate on.
-    snprintf(cmd, sizeof(cmd), "tc qdisc add dev %s ingress 2>/dev/null",
-             iface->iface);
-    system(cmd);
-
-    snprintf(cmd, sizeof(cmd),
-             "tc filter add dev %s ingress protocol ip pref 32 u32 "
-             "match ip protocol 17 0xff "
-             "match u16 0x0044 0xffff at 20 "
-             "match u16 0x0043 0xffff at 22 "
-             "match u8 0x01 0xff at 28 "
-             "action vlan push id %d pipe "
-             "action mirred egress mirror dev ifb-inject pipe "
-             "action drop",
-             iface->iface, iface->serial);
-    if (system(cmd) != 0)
-    {
-        syslog(LOG_ERR, "Failed to setup tc for %s\n", iface->iface);
-        return -1;
-    }
     return 0;
+
+nla_put_failure:
+    nlmsg_free(msg);
+error:
+    syslog(LOG_ERR, "Failed to setup tc for %s\n", iface->iface);
+    return -1;
 }
 
-// Attempt to resolve every not-yet-resolved VAP via iwinfo and, on success,
+// Attempt to resolve every not-yet-resolved VAP via nl80211 and, on success,
 // install its tc redirect. Missing VAPs are NOT fatal: they are simply left
 // unresolved so they can be retried later (e.g. DFS VAPs that appear only after
 // CAC completes). Returns the number of VAPs still unresolved.
@@ -115,12 +335,15 @@ int resolve_and_setup()
 {
     int unresolved = 0;
 
+    // A single interface dump fills in every pending VAP that is up.
+    nl80211_resolve_ifaces();
+
     for (int i = 0; i < iface_map_size; i++)
     {
         if (iface_map[i].resolved)
             continue;
 
-        if (parse_iwinfo_by_essid(&iface_map[i]) != 0 || iface_map[i].iface[0] == '\0')
+        if (iface_map[i].iface[0] == '\0')
         {
             unresolved++;
             continue;
@@ -129,12 +352,12 @@ int resolve_and_setup()
         if (setup_tc_for_iface(&iface_map[i]) != 0)
         {
             // VAP exists but tc install failed; retry on the next pass.
+            iface_map[i].iface[0] = '\0';
             unresolved++;
             continue;
         }
 
         iface_map[i].resolved = 1;
-        iface_map[i].ifindex = (int)if_nametoindex(iface_map[i].iface);
         syslog(LOG_INFO,
                "Resolved iface_info[%d]: iface='%s', freq='%s', essid='%s', bssid='%s', upstream='%s', serial=%d",
                i, iface_map[i].iface, iface_map[i].frequency, iface_map[i].essid,
@@ -144,32 +367,41 @@ int resolve_and_setup()
     return unresolved;
 }
 
-// Return 1 if our DHCP redirect filter (installed at "pref 32") is currently
-// present on the given VAP's ingress, 0 otherwise. If the device is missing tc
-// prints nothing (stderr suppressed) and we report absent.
+static int tc_filter_cb(struct nl_msg *msg, void *arg)
+{
+    struct nlmsghdr *nlh = nlmsg_hdr(msg);
+    struct tcmsg *tcm = nlmsg_data(nlh);
+    int *present = arg;
+
+    // Only match our own priority, never the unrelated bridger bpf filter
+    // which lives at a much higher pref.
+    if (nlh->nlmsg_type == RTM_NEWTFILTER &&
+        TC_H_MAJ(tcm->tcm_info) >> 16 == TC_FILTER_PRIO)
+        *present = 1;
+
+    return NL_OK;
+}
+
+// Return 1 if our DHCP redirect filter (installed at TC_FILTER_PRIO) is
+// currently present on the given VAP's ingress, 0 otherwise. A missing device
+// or ingress qdisc is reported as absent.
 int tc_filter_present(const char *iface)
 {
-    char cmd[256];
-    snprintf(cmd, sizeof(cmd), "tc filter show dev %s ingress 2>/dev/null", iface);
+    struct nl_msg *msg;
+    int present = 0;
+    int ifindex;
 
-    FILE *fp = popen(cmd, "r");
-    if (!fp)
+    ifindex = if_nametoindex(iface);
+    if (!ifindex || !rtnl)
+        return 0;
+
+    msg = tc_msg(RTM_GETTFILTER, NLM_F_DUMP, ifindex, TC_INGRESS_PARENT, 0, 0);
+    if (!msg)
+        return 0;
+
+    if (rtnl_request(msg, tc_filter_cb, &present) != 0)
         return 0;
 
-    int present = 0;
-    char line[256];
-    while (fgets(line, sizeof(line), fp))
-    {
-        // Our filter renders as "... pref 32 u32 ...". Match "pref 32 " so we
-        // don't accidentally match a higher pref like 320, and never confuse it
-        // with the unrelated bridger bpf filter at a much higher pref.
-        if (strstr(line, "pref 32 "))
-        {
-            present = 1;
-            break;
-        }
-    }
-    pclose(fp);
     return present;
 }
 
@@ -180,10 +412,10 @@ int tc_filter_present(const char *iface)
 // Instead of inferring this from the ifindex (which misses a flush that keeps
 // the same index), we check the actual invariant - is our filter present?
 //
-//   - device gone     -> mark unresolved so it re-resolves via iwinfo later
+//   - device gone     -> mark unresolved so it re-resolves via nl80211 later
 //   - filter missing   -> reinstall in place (the VAP name is stable, so no
-//                         iwinfo lookup is needed). If that fails, fall back to
-//                         unresolved so the iwinfo path retries next pass.
+//                         nl80211 lookup is needed). If that fails, fall back to
+//                         unresolved so the nl80211 path retries next pass.
 //
 // Returns the number of VAPs that still need re-resolution (device gone or an
 // in-place reinstall failed), so the caller knows to run resolve_and_setup().
@@ -217,7 +449,7 @@ int revalidate_resolved()
         if (setup_tc_for_iface(&iface_map[i]) != 0)
         {
             // Could not reinstall right now; drop to unresolved and let the
-            // iwinfo-based path retry on the next pass.
+            // nl80211-based path retry on the next pass.
             iface_map[i].resolved = 0;
             iface_map[i].ifindex = 0;
             iface_map[i].iface[0] = '\0';
@@ -234,50 +466,79 @@ int revalidate_resolved()
     return need_resolve;
 }
 
-int parse_iwinfo_by_essid(struct iface_info *iface)
+// Map a channel frequency (MHz) to the band names used in the config
+static const char *freq_band(uint32_t freq)
 {
-    char cmd[256];
-    FILE *fp;
-    char output[128];
-    char *line;
+    if (freq >= 2400 && freq < 2500)
+        return "2";
+    if (freq >= 5925 && freq <= 7125)
+        return "6";
+    if (freq >= 5000 && freq < 5925)
+        return "5";
+    return "";
+}
 
-    snprintf(cmd, sizeof(cmd), IWINFO_CMD, iface->essid, iface->frequency);
+static int nl80211_iface_cb(struct nl_msg *msg, void *arg)
+{
+    struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+    struct nlattr *tb[NL80211_ATTR_MAX + 1];
+    const char *band;
+    uint8_t *mac;
+    int ssid_len;
 
-    fp = popen(cmd, "r");
-    if (fp == NULL)
-    {
-        syslog(LOG_ERR, "Failed to execute command: %s\n", cmd);
-        return 1;
-    }
+    nla_parse(tb, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
+              genlmsg_attrlen(gnlh, 0), NULL);
 
-    // Read the first line (interface name)
-    line = fgets(output, sizeof(output), fp);
-    if (line)
-    {
-        output[strcspn(output, "\n")] = '\0'; // Remove trailing newline
-        snprintf(iface->iface, LEN_IFACE + 1, "%s", output);
-    }
-    else
-    {
-        pclose(fp);
-        return 1;
-    }
+    if (!tb[NL80211_ATTR_IFNAME] || !tb[NL80211_ATTR_IFINDEX] ||
+        !tb[NL80211_ATTR_MAC] || !tb[NL80211_ATTR_SSID] ||
+        !tb[NL80211_ATTR_WIPHY_FREQ])
+        return NL_SKIP;
+
+    if (tb[NL80211_ATTR_IFTYPE] &&
+        nla_get_u32(tb[NL80211_ATTR_IFTYPE]) != NL80211_IFTYPE_AP)
+        return NL_SKIP;
 
-    // Read the second line (BSSID)
-    line = fgets(output, sizeof(output), fp);
-    if (line)
+    band = freq_band(nla_get_u32(tb[NL80211_ATTR_WIPHY_FREQ]));
+    ssid_len = nla_len(tb[NL80211_ATTR_SSID]);
+    mac = nla_data(tb[NL80211_ATTR_MAC]);
+
+    for (int i = 0; i < iface_map_size; i++)
     {
-        output[strcspn(output, "\n")] = '\0'; // Remove trailing newline
-        snprintf(iface->bssid, LEN_BSSID + 1, "%s", output);
+        struct iface_info *info = &iface_map[i];
+
+        // the first matching VAP in the dump wins
+        if (info->resolved || info->iface[0])
+            continue;
+
+        if (strcmp(info->frequency, band) != 0 ||
+            (int)strlen(info->essid) != ssid_len ||
+            memcmp(info->essid, nla_data(tb[NL80211_ATTR_SSID]), ssid_len) != 0)
+            continue;
+
+        snprintf(info->iface, LEN_IFACE + 1, "%s", nla_get_string(tb[NL80211_ATTR_IFNAME]));
+        snprintf(info->bssid, LEN_BSSID + 1, "%02X%02X%02X%02X%02X%02X",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        info->ifindex = nla_get_u32(tb[NL80211_ATTR_IFINDEX]);
     }
-    else
+
+    return NL_SKIP;
+}
+
+// Fill in ifname, BSSID and ifindex of every pending VAP whose ESSID is
+// currently beaconing on the configured band, using one nl80211 interface
+// dump. Returns 0 if the dump was sent.
+int nl80211_resolve_ifaces(void)
+{
+    struct nl_msg *msg;
+
+    msg = unl_genl_msg(&unl, NL80211_CMD_GET_INTERFACE, true);
+    if (!msg)
     {
-        pclose(fp);
+        syslog(LOG_ERR, "Failed to allocate nl80211 interface dump\n");
         return 1;
     }
 
-    // Close the pipe
-    pclose(fp);
+    unl_genl_request(&unl, msg, nl80211_iface_cb, NULL);
     return 0;
 }
 
@@ -399,16 +660,29 @@ int parse_uci_config()
     return 0;
 }
 
-struct iface_info *find_iface_info_by_vlan(int vlan_id)
+// Index iface_map by the VLAN id pushed by its redirect filter. Must be rerun
+// whenever iface_map is reallocated.
+void build_vlan_map()
 {
+    memset(vlan_map, 0, sizeof(vlan_map));
     for (int i = 0; i < iface_map_size; i++)
     {
-        if (iface_map[i].serial == vlan_id)
+        if (iface_map[i].serial <= 0 || iface_map[i].serial >= MAX_VLANS)
         {
-            return &iface_map[i];
+            syslog(LOG_ERR, "SSID '%s' exceeds the VLAN id range, ignoring",
+                   iface_map[i].essid);
+            continue;
         }
+        vlan_map[iface_map[i].serial] = &iface_map[i];
     }
-    return NULL;
+}
+
+struct iface_info *find_iface_info_by_vlan(int vlan_id)
+{
+    if (vlan_id < 0 || vlan_id >= MAX_VLANS)
+        return NULL;
+
+    return vlan_map[vlan_id];
 }
 
 void process_packet(unsigned char *user, const struct pcap_pkthdr *header,
@@ -677,6 +951,14 @@ int main(int argc, char *argv[])
         cleanup();
         return 1;
     }
+    build_vlan_map();
+
+    if (nl_setup() != 0)
+    {
+        syslog(LOG_ERR, "Failed to open netlink sockets\n");
+        cleanup();
+        return 1;
+    }
 
     if (setup_ifb() != 0)
     {
@@ -697,7 +979,7 @@ int main(int argc, char *argv[])
     }
 
     char errbuf[PCAP_ERRBUF_SIZE];
-    handle = pcap_open_live("ifb-inject", BUFSIZ, 1, 1000, errbuf);
+    handle = pcap_open_live(IFB_IFACE, BUFSIZ, 1, 1000, errbuf);
     if (handle == NULL)
     {
         syslog(LOG_ERR, "Couldn't open device ifb-inject: %s\n", errbuf);
@@ -757,7 +1039,7 @@ int main(int argc, char *argv[])
         // everything is currently resolved. This is what lets us recover after
         // a radio restart: every resolved VAP is checked for its redirect
         // filter (reinstalled in place if flushed), and any VAP whose netdev
-        // has gone is re-resolved via iwinfo once it returns.
+        // has gone is re-resolved via nl80211 once it returns.
         time_t now = time(NULL);
         if (now - last_resolve >= RESOLVE_RETRY_INTERVAL)
         {
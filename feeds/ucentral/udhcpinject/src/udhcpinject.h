@@ -23,7 +23,14 @@
 
 #define CONFIG_PATH "/etc/config/dhcpinject"
 
-#define IWINFO_CMD "iwinfo | grep '\"%s\"$' -A2 | grep '.*Channel:.*\\(%s\\..*\\) GHz' -B2 | awk '/ESSID/{print $1} /Access Point/{gsub(/:/, \"\", $3); print $3}'"
+#define IFB_IFACE "ifb-inject"
+
+// Priority of the DHCP redirect filter on the VAP ingress
+#define TC_FILTER_PRIO 32
+
+// VLAN ids are 12 bits wide, the serial pushed by the redirect filter is used
+// directly as index into vlan_map
+#define MAX_VLANS 4096
 
 static pcap_t 		*handle = NULL;
 
@@ -31,6 +38,7 @@ static int 			 iface_map_size = 0;
 struct iface_info 	*iface_map = NULL;
 static int 			 port_map_size = 0;
 struct port_info 	*port_map = NULL;
+static struct iface_info *vlan_map[MAX_VLANS];
 
 // DHCP header structure
 struct dhcp_packet {
@@ -62,7 +70,7 @@ struct iface_info {
 	char upstream[LEN_IFACE + 1];
 	char frequency[LEN_FREQ + 1];
     int serial;
-    int resolved; // 1 once the VAP has been resolved via iwinfo and tc is set up
+    int resolved; // 1 once the VAP has been resolved via nl80211 and tc is set up
     int ifindex;  // netdev ifindex recorded at resolve time; used to detect a
                   // VAP that was torn down and recreated (radar/DFS, wifi reload)
 };
@@ -88,5 +96,5 @@ char *get_hostname() {
 }
 
 // Forward declarations (definitions live in udhcpinject.c)
-int parse_iwinfo_by_essid(struct iface_info *iface);
+int nl80211_resolve_ifaces(void);
 int setup_tc_for_iface(struct iface_info *iface);
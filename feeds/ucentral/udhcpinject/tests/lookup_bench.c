@@ -0,0 +1,140 @@
+// Benchmark of the per-packet VLAN id to VAP lookup done by process_packet().
+//
+// Fills iface_map with synthetic SSIDs (512 by default, one VLAN id each, as
+// parse_uci_config() assigns them), builds vlan_map and then maps a stream of
+// 802.1q tagged frames to their VAP, both through find_iface_info_by_vlan()
+// and through the linear iface_map scan it replaced. A share of the frames
+// carries VLAN ids without a VAP, the miss case is the slowest for the scan.
+
+// pull in the static tables, the daemon main() is not used
+#define main udhcpinject_main
+#include "../src/udhcpinject.c"
+#undef main
+
+#define N_FRAMES 4096
+
+struct frame {
+    struct ethhdr eth;
+    struct vlan_hdr vlan;
+};
+
+static struct frame frames[N_FRAMES];
+
+// the lookup before the table was introduced
+static struct iface_info *find_iface_info_linear(int vlan_id)
+{
+    for (int i = 0; i < iface_map_size; i++)
+    {
+        if (iface_map[i].serial == vlan_id)
+            return &iface_map[i];
+    }
+    return NULL;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// the part of process_packet() that runs for every captured frame
+static inline int frame_vlan(const struct frame *f)
+{
+    if (ntohs(f->eth.h_proto) != ETH_P_8021Q)
+        return -1;
+
+    return ntohs(f->vlan.h_vlan_TCI) & 0x0FFF;
+}
+
+static double run(struct iface_info *(*lookup)(int), long n_packets,
+                  struct iface_info **res, long *hits)
+{
+    uint64_t start;
+
+    *hits = 0;
+    start = now_ns();
+    for (long i = 0; i < n_packets; i++)
+    {
+        struct iface_info *info = lookup(frame_vlan(&frames[i % N_FRAMES]));
+
+        if (info)
+            (*hits)++;
+        if (i < N_FRAMES)
+            res[i] = info;
+    }
+
+    return (double)(now_ns() - start) / n_packets;
+}
+
+int main(int argc, char *argv[])
+{
+    static struct iface_info *res_table[N_FRAMES], *res_linear[N_FRAMES];
+    long n_packets = 10000000, hits_table, hits_linear;
+    int n_vlans = 512, miss_percent = 10, ch, i;
+    double ns_table, ns_linear;
+
+    while ((ch = getopt(argc, argv, "v:n:m:")) != -1)
+    {
+        switch (ch)
+        {
+        case 'v':
+            n_vlans = atoi(optarg);
+            break;
+        case 'n':
+            n_packets = atol(optarg);
+            break;
+        case 'm':
+            miss_percent = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-v vlans] [-n packets] [-m miss %%]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (n_vlans < 1 || n_vlans >= MAX_VLANS || n_packets < N_FRAMES)
+    {
+        fprintf(stderr, "need 1..%d vlans and at least %d packets\n",
+                MAX_VLANS - 1, N_FRAMES);
+        return 1;
+    }
+
+    for (i = 1; i <= n_vlans; i++)
+    {
+        char essid[LEN_ESSID + 1];
+
+        snprintf(essid, sizeof(essid), "ssid-%d", i);
+        add_iface_info(essid, "up0v0", i % 2 ? "5" : "2", i);
+    }
+    build_vlan_map();
+
+    srand(1);
+    for (i = 0; i < N_FRAMES; i++)
+    {
+        int vlan = 1 + rand() % n_vlans;
+
+        if (n_vlans < MAX_VLANS - 1 && rand() % 100 < miss_percent)
+            vlan = n_vlans + 1 + rand() % (MAX_VLANS - 1 - n_vlans);
+
+        frames[i].eth.h_proto = htons(ETH_P_8021Q);
+        frames[i].vlan.h_vlan_TCI = htons(vlan);
+        frames[i].vlan.h_vlan_encapsulated_proto = htons(ETH_P_IP);
+    }
+
+    ns_table = run(find_iface_info_by_vlan, n_packets, res_table, &hits_table);
+    ns_linear = run(find_iface_info_linear, n_packets, res_linear, &hits_linear);
+
+    printf("%d vlans, %ld packets, %d%% misses\n", n_vlans, n_packets, miss_percent);
+    printf("  vlan_map:   %6.1f ns/packet\n", ns_table);
+    printf("  linear map: %6.1f ns/packet\n", ns_linear);
+
+    if (hits_table != hits_linear || memcmp(res_table, res_linear, sizeof(res_table)))
+    {
+        printf("FAIL: lookups disagree (%ld vs %ld hits)\n", hits_table, hits_linear);
+        return 1;
+    }
+
+    return 0;
+}